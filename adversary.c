@@ -0,0 +1,440 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "adversary.h"
+#include "allocator.h"
+#include "platform.h"
+#include "search.h"
+
+#define ADVERSARY_TABLE_SIZE (1 << ADVERSARY_TABLE_BITS)
+#define ADVERSARY_CLOCK_INTERVAL 4096 // Nodes between looks at the clock
+#define ADVERSARY_INFINITY 127
+#define ADVERSARY_MAX_SPAWNS (2 * TILE_COUNT)
+#define ADVERSARY_MAX_ITEMS (DIRECTION_COUNT * ADVERSARY_MAX_SPAWNS)
+
+typedef enum Adversary_bound {
+    ADVERSARY_BOUND_EXACT,
+    ADVERSARY_BOUND_LOWER,
+    ADVERSARY_BOUND_UPPER
+} Adversary_bound;
+
+typedef struct Adversary_child {
+    Packed_board board;
+    f32 order;
+    u8 index; // Direction or spawn, as in Adversary_entry.best
+} Adversary_child;
+
+// Each spawn after each root move is a work item. Its alpha is just below the previous depth's value (which can't
+// drop) and its beta the lowest value already found for its move.
+typedef struct Adversary_item {
+    Packed_board board;
+    Direction move;
+    i32 value;
+} Adversary_item;
+
+typedef struct Adversary_root {
+    Adversary_item items[ADVERSARY_MAX_ITEMS];
+    i32 itemCount;
+    i32 depth;
+    i32 alpha;
+    volatile i32 moveValues[DIRECTION_COUNT]; // Lowest so far, only a hint to prune with: updates can race
+    volatile i64 nextItem;
+} Adversary_root;
+
+typedef struct Adversary_worker {
+    Adversary_search search;
+    Adversary_root *root;
+} Adversary_worker;
+
+
+void InitAdversarySearch(Adversary_search *search, f64 deadline, volatile i32 *isStopped) {
+    search->tables = GetMoveTables();
+    search->table = TrackedAlloc(ADVERSARY_TABLE_SIZE * sizeof(Adversary_entry), ALLOC_TAG_SEARCH);
+    memset(search->table, 0, ADVERSARY_TABLE_SIZE * sizeof(Adversary_entry));
+    search->nodeCount = 0;
+    search->deadline = deadline;
+    search->isStopped = isStopped;
+}
+
+void FreeAdversarySearch(Adversary_search *search) {
+    TrackedFree(search->table, ALLOC_TAG_SEARCH);
+    search->table = NULL;
+}
+
+static Adversary_entry *GetAdversaryEntry(Adversary_search *search, Packed_board board, bool isSpawner) {
+    u64 hash = (board ^ (isSpawner ? 0xD6E8FEB86659FD93ull : 0)) * 0x9E3779B97F4A7C15ull;
+    return &search->table[hash >> (64 - ADVERSARY_TABLE_BITS)];
+}
+
+// Each node counts, and every so often one looks at the clock for the whole search
+static bool CountAdversaryNode(Adversary_search *search) {
+    if (++search->nodeCount % ADVERSARY_CLOCK_INTERVAL == 0 && GetWallTime() > search->deadline) {
+        AtomicStoreI32(search->isStopped, 1);
+    }
+
+    return AtomicLoadI32(search->isStopped) == 0;
+}
+
+// The largest tile the tiles on the board, plus a 4 for each of the spawns to come, could add up to
+static i32 GetTileBound(Packed_board board, i32 spawnCount) {
+    u32 sum = 4 * spawnCount;
+    for (i32 i = 0; i < TILE_COUNT; ++i) {
+        u32 exponent = (board >> (PACKED_TILE_BITS * i)) & PACKED_TILE_MASK;
+        sum += exponent ? 1u << exponent : 0;
+    }
+
+    i32 bound = 0;
+    while ((2u << bound) <= sum) {
+        ++bound;
+    }
+
+    return bound;
+}
+
+static void SortChildren(Adversary_child *children, i32 count, i32 first) {
+    // Insertion sort by order, highest first, with the table's choice (if any) in front
+    for (i32 i = 1; i < count; ++i) {
+        Adversary_child child = children[i];
+        i32 j = i;
+        while (j > 0 && (child.index == first || (children[j - 1].index != first && children[j - 1].order < child.order))) {
+            children[j] = children[j - 1];
+            --j;
+        }
+        children[j] = child;
+    }
+}
+
+static bool ProbeAdversaryEntry(const Adversary_entry *entry, Packed_board board, bool isSpawner, i32 depth,
+    i32 alpha, i32 beta, i32 *value) {
+    if (entry->board != board || entry->isSpawner != isSpawner || entry->depth < depth) {
+        return false;
+    }
+
+    *value = entry->value;
+    return entry->bound == ADVERSARY_BOUND_EXACT ||
+        (entry->bound == ADVERSARY_BOUND_LOWER && entry->value >= beta) ||
+        (entry->bound == ADVERSARY_BOUND_UPPER && entry->value <= alpha);
+}
+
+static void StoreAdversaryEntry(Adversary_entry *entry, Packed_board board, bool isSpawner, i32 depth, i32 value,
+    i32 alpha, i32 beta, i32 best) {
+    *entry = (Adversary_entry){
+        .board = board,
+        .depth = depth,
+        .value = value,
+        .bound = value <= alpha ? ADVERSARY_BOUND_UPPER : value >= beta ? ADVERSARY_BOUND_LOWER : ADVERSARY_BOUND_EXACT,
+        .best = best,
+        .isSpawner = isSpawner
+    };
+}
+
+static i32 SearchSpawner(Adversary_search *search, Packed_board board, i32 depth, i32 alpha, i32 beta);
+
+// board has just had a tile spawn, the player has depth moves left
+static i32 SearchPlayer(Adversary_search *search, Packed_board board, i32 depth, i32 alpha, i32 beta) {
+    if (!CountAdversaryNode(search)) {
+        return 0;
+    }
+
+    // The largest tile never shrinks, and can't outgrow what the tiles add up to
+    i32 maxTile = GetPackedMaxTile(board);
+    if (depth <= 0 || maxTile >= beta) {
+        return maxTile;
+    }
+    i32 bound = GetTileBound(board, depth);
+    if (bound <= alpha || bound == maxTile) {
+        return bound;
+    }
+
+    Adversary_entry *entry = GetAdversaryEntry(search, board, false);
+    i32 value;
+    if (ProbeAdversaryEntry(entry, board, false, depth, alpha, beta, &value)) {
+        return value;
+    }
+    i32 first = entry->board == board && !entry->isSpawner ? entry->best : DIRECTION_NONE;
+
+    Adversary_child children[DIRECTION_COUNT];
+    i32 childCount = 0;
+    for (i32 direction = 0; direction < DIRECTION_COUNT; ++direction) {
+        i32 score = 0;
+        Packed_board moved = MoveWithTables(search->tables, board, direction, &score);
+        if (moved != board) {
+            children[childCount++] = (Adversary_child){
+                .board = moved,
+                .order = EvaluatePackedBoard(moved),
+                .index = direction
+            };
+        }
+    }
+    SortChildren(children, childCount, first);
+
+    // A board nothing can move on keeps its largest tile for good
+    i32 best = maxTile;
+    i32 bestMove = DIRECTION_NONE;
+    i32 originalAlpha = alpha;
+    for (i32 i = 0; i < childCount; ++i) {
+        value = SearchSpawner(search, children[i].board, depth - 1, alpha, beta);
+        if (bestMove == DIRECTION_NONE || value > best) {
+            best = value;
+            bestMove = children[i].index;
+        }
+        if (best >= beta) {
+            break;
+        }
+        alpha = MaxI32(alpha, best);
+    }
+
+    if (AtomicLoadI32(search->isStopped) == 0) {
+        StoreAdversaryEntry(entry, board, false, depth, best, originalAlpha, beta, bestMove);
+    }
+    return best;
+}
+
+// board has just been moved, a tile spawns in the worst place and then the player has depth moves left
+static i32 SearchSpawner(Adversary_search *search, Packed_board board, i32 depth, i32 alpha, i32 beta) {
+    if (!CountAdversaryNode(search)) {
+        return 0;
+    }
+
+    i32 maxTile = GetPackedMaxTile(board);
+    if (maxTile >= beta) {
+        return maxTile;
+    }
+    i32 bound = GetTileBound(board, depth + 1);
+    if (bound <= alpha || bound == maxTile) {
+        return bound;
+    }
+
+    Adversary_entry *entry = GetAdversaryEntry(search, board, true);
+    i32 value;
+    if (ProbeAdversaryEntry(entry, board, true, depth, alpha, beta, &value)) {
+        return value;
+    }
+    i32 first = entry->board == board && entry->isSpawner ? entry->best : -1;
+
+    // Ordered by the heuristic negated, so that the spawns that look worst for the player come first
+    Adversary_child children[ADVERSARY_MAX_SPAWNS];
+    i32 childCount = 0;
+    for (i32 i = 0; i < TILE_COUNT; ++i) {
+        if (((board >> (PACKED_TILE_BITS * i)) & PACKED_TILE_MASK) != 0) {
+            continue;
+        }
+
+        for (u64 exponent = 1; exponent <= 2; ++exponent) {
+            Packed_board spawned = board | (exponent << (PACKED_TILE_BITS * i));
+            children[childCount++] = (Adversary_child){
+                .board = spawned,
+                .order = -EvaluatePackedBoard(spawned),
+                .index = (u8)(2 * i + exponent - 1)
+            };
+        }
+    }
+    SortChildren(children, childCount, first);
+
+    i32 best = ADVERSARY_INFINITY;
+    i32 bestSpawn = 0;
+    i32 originalBeta = beta;
+    for (i32 i = 0; i < childCount; ++i) {
+        value = SearchPlayer(search, children[i].board, depth, alpha, beta);
+        if (value < best) {
+            best = value;
+            bestSpawn = children[i].index;
+        }
+        if (best <= alpha) {
+            break;
+        }
+        beta = MinI32(beta, best);
+    }
+
+    if (AtomicLoadI32(search->isStopped) == 0) {
+        StoreAdversaryEntry(entry, board, true, depth, best, alpha, originalBeta, bestSpawn);
+    }
+    return best;
+}
+
+i32 SearchGuaranteedTile(Adversary_search *search, Packed_board board, i32 depth, Direction *bestMove) {
+    *bestMove = DIRECTION_NONE;
+    i32 best = GetPackedMaxTile(board);
+    for (i32 direction = 0; direction < DIRECTION_COUNT; ++direction) {
+        i32 score = 0;
+        Packed_board moved = MoveWithTables(search->tables, board, direction, &score);
+        if (moved == board) {
+            continue;
+        }
+
+        // With alpha at the best so far only a strictly better move comes back exact, so ties go to the first move
+        i32 value = SearchSpawner(search, moved, depth - 1, *bestMove == DIRECTION_NONE ? -1 : best, ADVERSARY_INFINITY);
+        if (*bestMove == DIRECTION_NONE || value > best) {
+            best = value;
+            *bestMove = direction;
+        }
+    }
+
+    return AtomicLoadI32(search->isStopped) == 0 ? best : -1;
+}
+
+static void RunAdversaryWorker(void *data) {
+    Adversary_worker *worker = data;
+    Adversary_root *root = worker->root;
+
+    for (;;) {
+        i64 index = AtomicAddI64(&root->nextItem, 1) - 1;
+        if (index >= root->itemCount || AtomicLoadI32(worker->search.isStopped)) {
+            break;
+        }
+
+        // Once a spawn holds a move to the previous value or below, the move is out and its other spawns can go
+        Adversary_item *item = &root->items[index];
+        i32 lowest = AtomicLoadI32(&root->moveValues[item->move]);
+        if (lowest <= root->alpha) {
+            item->value = ADVERSARY_INFINITY;
+            continue;
+        }
+
+        item->value = SearchPlayer(&worker->search, item->board, root->depth - 1, root->alpha, lowest);
+        if (item->value < lowest) {
+            AtomicStoreI32(&root->moveValues[item->move], item->value);
+        }
+    }
+}
+
+static void PrintPackedBoard(Packed_board board) {
+    for (i32 y = 0; y < TILE_COUNT_Y; ++y) {
+        printf(" ");
+        for (i32 x = 0; x < TILE_COUNT_X; ++x) {
+            i32 exponent = (board >> (PACKED_TILE_BITS * (y * TILE_COUNT_X + x))) & PACKED_TILE_MASK;
+            printf(" %5u", exponent ? PowerOf2(exponent) : 0);
+        }
+        printf("\n");
+    }
+}
+
+i32 RunAdversary(f64 seconds, i32 threadCount, Packed_board board) {
+    if (threadCount <= 0) {
+        threadCount = GetProcessorCount();
+    }
+    threadCount = MinI32(threadCount, ADVERSARY_MAX_THREADS);
+
+    if (board == 0) {
+        Rng rng = CreateRng(GetWallTime() * 1e9);
+        Board start;
+        ResetBoard(&start, &rng);
+        board = PackBoard(&start);
+    }
+
+    printf("Worst-case spawns from %016llx, %.1f s, %d threads\n", (unsigned long long)board, seconds, threadCount);
+    PrintPackedBoard(board);
+
+    f64 start = GetWallTime();
+    volatile i32 isStopped = 0;
+
+    Adversary_root *root = TrackedAlloc(sizeof(Adversary_root), ALLOC_TAG_SEARCH);
+    Adversary_worker *workers = TrackedAlloc(threadCount * sizeof(Adversary_worker), ALLOC_TAG_SEARCH);
+    Thread threads[ADVERSARY_MAX_THREADS];
+    for (i32 i = 0; i < threadCount; ++i) {
+        workers[i].root = root;
+        InitAdversarySearch(&workers[i].search, start + seconds, &isStopped);
+    }
+
+    root->itemCount = 0;
+    const Move_tables_data *tables = GetMoveTables();
+    for (i32 direction = 0; direction < DIRECTION_COUNT; ++direction) {
+        i32 score = 0;
+        Packed_board moved = MoveWithTables(tables, board, direction, &score);
+        if (moved == board) {
+            continue;
+        }
+
+        for (i32 i = 0; i < TILE_COUNT; ++i) {
+            if (((moved >> (PACKED_TILE_BITS * i)) & PACKED_TILE_MASK) != 0) {
+                continue;
+            }
+            for (u64 exponent = 1; exponent <= 2; ++exponent) {
+                root->items[root->itemCount++] = (Adversary_item){
+                    .board = moved | (exponent << (PACKED_TILE_BITS * i)),
+                    .move = direction
+                };
+            }
+        }
+    }
+
+    i32 guaranteed = GetPackedMaxTile(board);
+    Direction guaranteedMove = DIRECTION_NONE;
+    i32 guaranteedDepth = 0;
+    i64 nodeCount = 0;
+
+    if (root->itemCount == 0) {
+        printf("The game is over\n");
+    }
+
+    for (i32 depth = 1; depth <= ADVERSARY_MAX_DEPTH && root->itemCount > 0; ++depth) {
+        root->depth = depth;
+        root->alpha = guaranteed - 1;
+        root->nextItem = 0;
+        for (i32 i = 0; i < DIRECTION_COUNT; ++i) {
+            root->moveValues[i] = ADVERSARY_INFINITY;
+        }
+
+        f64 depthStart = GetWallTime();
+        for (i32 i = 1; i < threadCount; ++i) {
+            StartThread(&threads[i], &RunAdversaryWorker, &workers[i]);
+        }
+        RunAdversaryWorker(&workers[0]);
+        for (i32 i = 1; i < threadCount; ++i) {
+            JoinThread(&threads[i]);
+        }
+        f64 depthEnd = GetWallTime();
+
+        i64 depthNodeCount = -nodeCount;
+        nodeCount = 0;
+        for (i32 i = 0; i < threadCount; ++i) {
+            nodeCount += workers[i].search.nodeCount;
+        }
+        depthNodeCount += nodeCount;
+
+        if (isStopped) {
+            printf("  depth %2d  out of time after %.2f s\n", depth, depthEnd - depthStart);
+            break;
+        }
+
+        // A move is worth its worst spawn, ties go to the first direction
+        i32 moveValues[DIRECTION_COUNT] = {0};
+        bool isLegal[DIRECTION_COUNT] = {0};
+        for (i32 i = 0; i < DIRECTION_COUNT; ++i) {
+            moveValues[i] = ADVERSARY_INFINITY;
+        }
+        for (i32 i = 0; i < root->itemCount; ++i) {
+            const Adversary_item *item = &root->items[i];
+            moveValues[item->move] = MinI32(moveValues[item->move], item->value);
+            isLegal[item->move] = true;
+        }
+
+        guaranteedMove = DIRECTION_NONE;
+        for (i32 i = 0; i < DIRECTION_COUNT; ++i) {
+            if (isLegal[i] && (guaranteedMove == DIRECTION_NONE || moveValues[i] > guaranteed)) {
+                guaranteed = moveValues[i];
+                guaranteedMove = i;
+            }
+        }
+        guaranteedDepth = depth;
+
+        printf("  depth %2d  tile %5u  move %-5s  %12lld nodes  %8.2f s  %6.2f M nodes/s\n", depth,
+            PowerOf2(guaranteed), GetDirectionName(guaranteedMove), (long long)depthNodeCount, depthEnd - depthStart,
+            depthNodeCount / (depthEnd - depthStart) / 1e6);
+    }
+
+    f64 end = GetWallTime();
+    printf("Guaranteed within %d moves: %u", guaranteedDepth, PowerOf2(guaranteed));
+    if (guaranteedMove != DIRECTION_NONE) {
+        printf(", playing %s", GetDirectionName(guaranteedMove));
+    }
+    printf("\n%lld nodes in %.2f s, %.2f M nodes/s\n", (long long)nodeCount, end - start, nodeCount / (end - start) / 1e6);
+
+    for (i32 i = 0; i < threadCount; ++i) {
+        FreeAdversarySearch(&workers[i].search);
+    }
+    TrackedFree(workers, ALLOC_TAG_SEARCH);
+    TrackedFree(root, ALLOC_TAG_SEARCH);
+
+    return 0;
+}
@@ -0,0 +1,52 @@
+#ifndef ADVERSARY_H
+#define ADVERSARY_H
+
+#include "common.h"
+#include "board.h"
+#include "move_tables.h"
+
+#define ADVERSARY_MAX_DEPTH 64
+#define ADVERSARY_MAX_THREADS 64
+#define ADVERSARY_TABLE_BITS 20
+#define ADVERSARY_DEFAULT_SECONDS 10.0
+
+// Minimax against a spawner that picks the worst cell and value (2 or 4) instead of a random one, to see how much of
+// a strategy's result comes down to luck. The value of a position is the largest tile (an exponent) the player can be
+// sure to have on the board within depth moves, whatever spawns. It never drops with more depth, so iterative
+// deepening gives a rising lower bound on the tile the player can guarantee for the whole game.
+//
+// Alpha-beta with fail-soft bounds. Both sides try the transposition table's move first, then the player the moves
+// the heuristic likes most and the spawner the spawns it likes least. Positions are also cut when the sum of the
+// tiles can't make a tile above alpha in the moves left.
+//
+// Like Search, everything here is per thread, the table included.
+
+typedef struct Adversary_entry {
+    Packed_board board;
+    i8 depth;
+    i8 value;
+    u8 bound;
+    u8 best; // A direction at player nodes, cell * 2 + (exponent - 1) at spawner nodes
+    u8 isSpawner;
+} Adversary_entry;
+
+typedef struct Adversary_search {
+    const Move_tables_data *tables;
+    Adversary_entry *table; // 1 << ADVERSARY_TABLE_BITS entries, kept from one depth to the next
+    i64 nodeCount; // Since InitAdversarySearch
+    f64 deadline; // GetWallTime seconds
+    volatile i32 *isStopped; // Set by whichever thread sees the deadline pass first
+} Adversary_search;
+
+void InitAdversarySearch(Adversary_search *search, f64 deadline, volatile i32 *isStopped);
+void FreeAdversarySearch(Adversary_search *search);
+
+// The guaranteed tile within depth moves and the move that guarantees it (DIRECTION_NONE if the game is over).
+// Returns -1 if the deadline passed first.
+i32 SearchGuaranteedTile(Adversary_search *search, Packed_board board, i32 depth, Direction *bestMove);
+
+// Deepens from board (0 for a random start) across threads until seconds have passed, printing the guaranteed tile,
+// its move and nodes/s at every depth
+i32 RunAdversary(f64 seconds, i32 threadCount, Packed_board board);
+
+#endif
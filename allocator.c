@@ -0,0 +1,133 @@
+#include <stdlib.h>
+
+#include "cJSON.h"
+
+#include "allocator.h"
+
+
+// Stored in front of every block so TrackedFree knows how many bytes went away. 16 bytes keeps the user pointer
+// aligned the same way malloc's would be.
+typedef union Alloc_header {
+    size_t size;
+    u8 padding[16];
+} Alloc_header;
+
+static Alloc_stats frameStats;
+static Alloc_stats totalStats;
+
+
+static void CountAlloc(Alloc_tag tag, size_t size) {
+    frameStats.tags[tag].allocs += 1;
+    frameStats.tags[tag].bytes += size;
+    frameStats.total.allocs += 1;
+    frameStats.total.bytes += size;
+
+    totalStats.tags[tag].allocs += 1;
+    totalStats.tags[tag].bytes += size;
+    totalStats.total.allocs += 1;
+    totalStats.total.bytes += size;
+    totalStats.peakBytes = totalStats.total.bytes > totalStats.peakBytes ? totalStats.total.bytes : totalStats.peakBytes;
+}
+
+static void CountFree(Alloc_tag tag, size_t size) {
+    frameStats.tags[tag].frees += 1;
+    frameStats.total.frees += 1;
+
+    totalStats.tags[tag].frees += 1;
+    totalStats.tags[tag].bytes -= size;
+    totalStats.total.frees += 1;
+    totalStats.total.bytes -= size;
+}
+
+void *TrackedAlloc(size_t size, Alloc_tag tag) {
+    Alloc_header *header = malloc(sizeof(Alloc_header) + size);
+    if (header == NULL) {
+        return NULL;
+    }
+
+    header->size = size;
+    CountAlloc(tag, size);
+
+    return header + 1;
+}
+
+void *TrackedRealloc(void *ptr, size_t size, Alloc_tag tag) {
+    if (ptr == NULL) {
+        return TrackedAlloc(size, tag);
+    }
+
+    Alloc_header *header = (Alloc_header *)ptr - 1;
+    size_t oldSize = header->size;
+
+    Alloc_header *newHeader = realloc(header, sizeof(Alloc_header) + size);
+    if (newHeader == NULL) {
+        return NULL;
+    }
+
+    // Counted as a free of the old block plus an allocation of the new one
+    CountFree(tag, oldSize);
+    newHeader->size = size;
+    CountAlloc(tag, size);
+
+    return newHeader + 1;
+}
+
+void TrackedFree(void *ptr, Alloc_tag tag) {
+    if (ptr == NULL) {
+        return;
+    }
+
+    Alloc_header *header = (Alloc_header *)ptr - 1;
+    CountFree(tag, header->size);
+
+    free(header);
+}
+
+static void *JSONAlloc(size_t size) {
+    return TrackedAlloc(size, ALLOC_TAG_JSON);
+}
+
+static void JSONFree(void *ptr) {
+    TrackedFree(ptr, ALLOC_TAG_JSON);
+}
+
+void InitJSONAllocHooks(void) {
+    cJSON_Hooks hooks = {
+        .malloc_fn = &JSONAlloc,
+        .free_fn = &JSONFree
+    };
+    cJSON_InitHooks(&hooks);
+}
+
+void BeginAllocFrame(void) {
+    frameStats = (Alloc_stats){0};
+}
+
+Alloc_stats EndAllocFrame(void) {
+    return frameStats;
+}
+
+Alloc_stats GetAllocTotals(void) {
+    return totalStats;
+}
+
+const char *GetAllocTagName(Alloc_tag tag) {
+    switch (tag) {
+        case ALLOC_TAG_GAME:     return "game";
+        case ALLOC_TAG_JSON:     return "json";
+        case ALLOC_TAG_HISTORY:  return "history";
+        case ALLOC_TAG_SERVER:   return "server";
+        case ALLOC_TAG_ENV:      return "env";
+        case ALLOC_TAG_STATS:    return "stats";
+        case ALLOC_TAG_SEARCH:   return "search";
+        case ALLOC_TAG_BOOK:     return "book";
+        case ALLOC_TAG_SOLVER:   return "solver";
+        case ALLOC_TAG_ANALYSIS: return "analysis";
+        case ALLOC_TAG_RESULTS:  return "results";
+        case ALLOC_TAG_TABLES:   return "tables";
+        case ALLOC_TAG_ARENA:    return "arena";
+        case ALLOC_TAG_PERF:     return "perf";
+        case ALLOC_TAG_CORPUS:   return "corpus";
+        default:                 return "unknown";
+    }
+}
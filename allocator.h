@@ -0,0 +1,55 @@
+#ifndef ALLOCATOR_H
+#define ALLOCATOR_H
+
+#include <stddef.h>
+
+#include "common.h"
+
+// Every heap allocation the game makes goes through TrackedAlloc/TrackedFree so that we can count them per frame
+// and per subsystem. The steady-state frame loop is supposed to allocate nothing, anything else is a regression.
+
+typedef enum Alloc_tag {
+    ALLOC_TAG_GAME,
+    ALLOC_TAG_JSON,
+    ALLOC_TAG_HISTORY,
+    ALLOC_TAG_SERVER,
+    ALLOC_TAG_ENV,
+    ALLOC_TAG_STATS,
+    ALLOC_TAG_SEARCH,
+    ALLOC_TAG_BOOK,
+    ALLOC_TAG_SOLVER,
+    ALLOC_TAG_ANALYSIS,
+    ALLOC_TAG_RESULTS,
+    ALLOC_TAG_TABLES,
+    ALLOC_TAG_ARENA,
+    ALLOC_TAG_PERF,
+    ALLOC_TAG_CORPUS,
+    ALLOC_TAG_COUNT
+} Alloc_tag;
+
+typedef struct Alloc_counters {
+    i32 allocs;
+    i32 frees;
+    i64 bytes;
+} Alloc_counters;
+
+typedef struct Alloc_stats {
+    Alloc_counters tags[ALLOC_TAG_COUNT];
+    Alloc_counters total;
+    i64 peakBytes; // Most bytes live at once, only kept for the totals
+} Alloc_stats;
+
+void *TrackedAlloc(size_t size, Alloc_tag tag);
+void *TrackedRealloc(void *ptr, size_t size, Alloc_tag tag);
+void TrackedFree(void *ptr, Alloc_tag tag);
+
+// Routes cJSON through the tracker (tagged ALLOC_TAG_JSON)
+void InitJSONAllocHooks(void);
+
+void BeginAllocFrame(void);
+Alloc_stats EndAllocFrame(void); // Returns what was allocated since BeginAllocFrame
+Alloc_stats GetAllocTotals(void); // Since startup; bytes is the amount currently live
+
+const char *GetAllocTagName(Alloc_tag tag);
+
+#endif
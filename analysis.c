@@ -0,0 +1,396 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "analysis.h"
+#include "move_tables.h"
+
+#define ANALYSIS_CHUNK_SIZE 16 // Positions a thread takes at a time
+#define ANALYSIS_WORST_MOVE_COUNT 5
+#define REPLAY_INITIAL_CAPACITY 1024
+
+
+typedef struct Analysis_worker {
+    const Replay *replay;
+    Analysis_move *moves;
+    Search *search;
+    volatile i64 *nextPosition;
+    volatile i32 *isStopped;
+} Analysis_worker;
+
+
+static bool AllocReplay(Replay *replay, i64 moveCount) {
+    replay->boards = TrackedAlloc((moveCount + 1) * sizeof(Packed_board), ALLOC_TAG_ANALYSIS);
+    replay->moves = TrackedAlloc((moveCount > 0 ? moveCount : 1) * sizeof(u8), ALLOC_TAG_ANALYSIS);
+    replay->moveCount = moveCount;
+
+    return replay->boards != NULL && replay->moves != NULL;
+}
+
+void FreeReplay(Replay *replay) {
+    TrackedFree(replay->boards, ALLOC_TAG_ANALYSIS);
+    TrackedFree(replay->moves, ALLOC_TAG_ANALYSIS);
+    *replay = (Replay){0};
+}
+
+// The move that, followed by the spawn rng makes, turns before into after
+static Direction FindPlayedMove(const Move_tables_data *tables, const History_entry *before, 
+    const History_entry *after) {
+    for (i32 direction = 0; direction < DIRECTION_COUNT; ++direction) {
+        i32 score = 0;
+        Packed_board moved = MoveWithTables(tables, before->board, direction, &score);
+        if (moved == before->board) {
+            continue;
+        }
+
+        Board board = UnpackBoard(moved);
+        Rng rng = {.state = before->rng};
+        SpawnTile(&board, &rng);
+        if (PackBoard(&board) == after->board) {
+            return direction;
+        }
+    }
+
+    return DIRECTION_NONE;
+}
+
+bool ReadReplayFromHistory(Replay *replay, History *history) {
+    *replay = (Replay){0};
+
+    i64 entryCount = GetHistoryLength(history);
+    History_entry *entries = TrackedAlloc((entryCount > 0 ? entryCount : 1) * sizeof(History_entry), ALLOC_TAG_ANALYSIS);
+    bool isOk = entryCount > 0 && entries != NULL && ReadHistoryEntries(history, entries) && 
+        AllocReplay(replay, entryCount - 1);
+
+    const Move_tables_data *tables = GetMoveTables();
+    for (i64 i = 0; isOk && i < entryCount; ++i) {
+        replay->boards[i] = entries[i].board;
+        if (i + 1 < entryCount) {
+            Direction move = FindPlayedMove(tables, &entries[i], &entries[i + 1]);
+            replay->moves[i] = move;
+            isOk = move != DIRECTION_NONE;
+        }
+    }
+
+    TrackedFree(entries, ALLOC_TAG_ANALYSIS);
+    if (!isOk) {
+        FreeReplay(replay);
+    }
+    return isOk;
+}
+
+bool ReadReplay(Replay *replay, const char *path) {
+    *replay = (Replay){0};
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+
+    Replay_header header;
+    bool isOk = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, REPLAY_MAGIC, 8) == 0 &&
+        header.version == REPLAY_VERSION && AllocReplay(replay, header.moveCount);
+    if (isOk) {
+        isOk = fread(replay->boards, sizeof(Packed_board), header.moveCount + 1, file) == header.moveCount + 1 &&
+            fread(replay->moves, sizeof(u8), header.moveCount, file) == header.moveCount;
+    }
+    fclose(file);
+
+    for (i64 i = 0; isOk && i < replay->moveCount; ++i) {
+        isOk = replay->moves[i] < DIRECTION_COUNT;
+    }
+
+    if (!isOk) {
+        FreeReplay(replay);
+    }
+    return isOk;
+}
+
+bool WriteReplay(const Replay *replay, const char *path) {
+    Replay_header header = {
+        .magic = REPLAY_MAGIC,
+        .version = REPLAY_VERSION,
+        .moveCount = replay->moveCount
+    };
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        return false;
+    }
+
+    bool isOk = fwrite(&header, sizeof(header), 1, file) == 1 &&
+        fwrite(replay->boards, sizeof(Packed_board), replay->moveCount + 1, file) == (size_t)replay->moveCount + 1 &&
+        fwrite(replay->moves, sizeof(u8), replay->moveCount, file) == (size_t)replay->moveCount;
+    isOk &= fclose(file) == 0;
+
+    return isOk;
+}
+
+static void RunAnalysisWorker(void *data) {
+    Analysis_worker *worker = data;
+    const Replay *replay = worker->replay;
+
+    for (;;) {
+        i64 end = AtomicAddI64(worker->nextPosition, ANALYSIS_CHUNK_SIZE);
+        i64 start = end - ANALYSIS_CHUNK_SIZE;
+        if (start >= replay->moveCount || AtomicLoadI32(worker->isStopped)) {
+            break;
+        }
+        end = end < replay->moveCount ? end : replay->moveCount;
+
+        for (i64 i = start; i < end; ++i) {
+            f32 values[DIRECTION_COUNT];
+            u32 legalMoves = SearchMoveValues(worker->search, replay->boards[i], values);
+
+            Direction best = replay->moves[i];
+            for (i32 direction = 0; direction < DIRECTION_COUNT; ++direction) {
+                if ((legalMoves & (1u << direction)) && values[direction] > values[best]) {
+                    best = direction;
+                }
+            }
+
+            worker->moves[i] = (Analysis_move){
+                .loss = values[best] - values[replay->moves[i]],
+                .bestValue = values[best],
+                .played = replay->moves[i],
+                .best = best
+            };
+        }
+    }
+}
+
+void AnalyseReplay(const Replay *replay, Analysis_move *moves, Search *searches, i32 threadCount,
+    volatile i32 *isStopped) {
+    threadCount = MinI32(MaxI32(threadCount, 1), ANALYSIS_MAX_THREADS);
+
+    Analysis_worker workers[ANALYSIS_MAX_THREADS];
+    Thread threads[ANALYSIS_MAX_THREADS];
+    volatile i64 nextPosition = 0;
+
+    for (i32 i = 0; i < threadCount; ++i) {
+        workers[i] = (Analysis_worker){
+            .replay = replay,
+            .moves = moves,
+            .search = &searches[i],
+            .nextPosition = &nextPosition,
+            .isStopped = isStopped
+        };
+    }
+
+    for (i32 i = 1; i < threadCount; ++i) {
+        StartThread(&threads[i], &RunAnalysisWorker, &workers[i]);
+    }
+    RunAnalysisWorker(&workers[0]);
+    for (i32 i = 1; i < threadCount; ++i) {
+        JoinThread(&threads[i]);
+    }
+}
+
+static void RunGameAnalysis(void *data) {
+    Game_analysis *analysis = data;
+    AnalyseReplay(&analysis->replay, analysis->moves, analysis->searches, analysis->threadCount, &analysis->isStopped);
+    if (AtomicLoadI32(&analysis->isStopped)) {
+        return;
+    }
+
+    i64 bestCount = 0;
+    analysis->maxLoss = 0.0f;
+    for (i64 i = 0; i < analysis->replay.moveCount; ++i) {
+        bestCount += analysis->moves[i].loss == 0.0f;
+        analysis->maxLoss = MaxF32(analysis->maxLoss, analysis->moves[i].loss);
+    }
+    analysis->accuracy = (f32)bestCount / analysis->replay.moveCount;
+
+    AtomicStoreI32(&analysis->isDone, 1);
+}
+
+void StartGameAnalysis(Game_analysis *analysis, History *history) {
+    *analysis = (Game_analysis){.isStarted = true};
+
+    if (!ReadReplayFromHistory(&analysis->replay, history) || analysis->replay.moveCount == 0) {
+        return;
+    }
+
+    // The window keeps a core for itself
+    analysis->threadCount = MinI32(MaxI32(GetProcessorCount() - 1, 1), ANALYSIS_MAX_THREADS);
+    analysis->moves = TrackedAlloc(analysis->replay.moveCount * sizeof(Analysis_move), ALLOC_TAG_ANALYSIS);
+    analysis->searches = TrackedAlloc(analysis->threadCount * sizeof(Search), ALLOC_TAG_ANALYSIS);
+    for (i32 i = 0; i < analysis->threadCount; ++i) {
+        InitSearch(&analysis->searches[i], ANALYSIS_DEFAULT_DEPTH);
+    }
+
+    if (!StartThread(&analysis->thread, &RunGameAnalysis, analysis)) {
+        analysis->isStopped = 1;
+    }
+}
+
+void StopGameAnalysis(Game_analysis *analysis) {
+    if (!analysis->isStarted) {
+        return;
+    }
+
+    if (analysis->searches != NULL) {
+        if (!analysis->isStopped) {
+            AtomicStoreI32(&analysis->isStopped, 1);
+            JoinThread(&analysis->thread);
+        }
+
+        for (i32 i = 0; i < analysis->threadCount; ++i) {
+            FreeSearch(&analysis->searches[i]);
+        }
+        TrackedFree(analysis->searches, ALLOC_TAG_ANALYSIS);
+        TrackedFree(analysis->moves, ALLOC_TAG_ANALYSIS);
+    }
+    FreeReplay(&analysis->replay);
+
+    *analysis = (Game_analysis){0};
+}
+
+i32 RunAnalysis(const char *replayPath, const char *reportPath, i32 threadCount, i32 searchDepth) {
+    if (threadCount <= 0) {
+        threadCount = GetProcessorCount();
+    }
+    threadCount = MinI32(threadCount, ANALYSIS_MAX_THREADS);
+
+    Replay replay;
+    if (!ReadReplay(&replay, replayPath)) {
+        fprintf(stderr, "Could not read %s, or it isn't a replay\n", replayPath);
+        return 1;
+    }
+
+    printf("Analysing %lld moves of %s, search depth %d, %d threads\n", (long long)replay.moveCount, replayPath,
+        searchDepth, threadCount);
+
+    Analysis_move *moves = TrackedAlloc((replay.moveCount > 0 ? replay.moveCount : 1) * sizeof(Analysis_move), 
+        ALLOC_TAG_ANALYSIS);
+    Search *searches = TrackedAlloc(threadCount * sizeof(Search), ALLOC_TAG_ANALYSIS);
+    for (i32 i = 0; i < threadCount; ++i) {
+        InitSearch(&searches[i], searchDepth);
+    }
+
+    f64 start = GetWallTime();
+    volatile i32 isStopped = 0;
+    AnalyseReplay(&replay, moves, searches, threadCount, &isStopped);
+    f64 time = GetWallTime() - start;
+
+    i64 nodeCount = 0;
+    for (i32 i = 0; i < threadCount; ++i) {
+        nodeCount += searches[i].nodeCount;
+        FreeSearch(&searches[i]);
+    }
+    TrackedFree(searches, ALLOC_TAG_ANALYSIS);
+
+    Analysis_header header = {
+        .magic = ANALYSIS_MAGIC,
+        .version = ANALYSIS_VERSION,
+        .searchDepth = searchDepth,
+        .moveCount = replay.moveCount
+    };
+
+    // The worst moves, kept sorted by loss
+    i64 worst[ANALYSIS_WORST_MOVE_COUNT];
+    i32 worstCount = 0;
+    for (i64 i = 0; i < replay.moveCount; ++i) {
+        header.bestCount += moves[i].loss == 0.0f;
+        header.totalLoss += moves[i].loss;
+
+        if (moves[i].loss > 0.0f && (worstCount < ANALYSIS_WORST_MOVE_COUNT ||
+            moves[i].loss > moves[worst[ANALYSIS_WORST_MOVE_COUNT - 1]].loss)) {
+            i32 j = MinI32(worstCount, ANALYSIS_WORST_MOVE_COUNT - 1);
+            worstCount = MinI32(worstCount + 1, ANALYSIS_WORST_MOVE_COUNT);
+            for (; j > 0 && moves[worst[j - 1]].loss < moves[i].loss; --j) {
+                worst[j] = worst[j - 1];
+            }
+            worst[j] = i;
+        }
+    }
+
+    FILE *file = fopen(reportPath, "wb");
+    bool isOk = file != NULL;
+    if (isOk) {
+        isOk = fwrite(&header, sizeof(header), 1, file) == 1 &&
+            fwrite(moves, sizeof(Analysis_move), replay.moveCount, file) == (size_t)replay.moveCount;
+        isOk &= fclose(file) == 0;
+    }
+
+    if (isOk) {
+        printf("Wrote %s: %.1f KB\n", reportPath, (sizeof(header) + replay.moveCount * sizeof(Analysis_move)) / 1e3);
+        printf("Analysed in %.2f s (%.0f positions/s, %.1f M nodes/s)\n", time, replay.moveCount / time,
+            nodeCount / time / 1e6);
+        printf("Best move played %lld of %lld times (%.1f%%), total loss %.0f\n", (long long)header.bestCount,
+            (long long)replay.moveCount, 100.0 * header.bestCount / (replay.moveCount > 0 ? replay.moveCount : 1), header.totalLoss);
+        for (i32 i = 0; i < worstCount; ++i) {
+            const Analysis_move *move = &moves[worst[i]];
+            printf("  move %6lld: %-5s instead of %-5s, loss %.0f (%.1f%% of the best value)\n", (long long)worst[i] + 1,
+                GetDirectionName(move->played), GetDirectionName(move->best), move->loss,
+                100.0 * move->loss / move->bestValue);
+        }
+    } else {
+        fprintf(stderr, "Could not write %s\n", reportPath);
+    }
+
+    TrackedFree(moves, ALLOC_TAG_ANALYSIS);
+    FreeReplay(&replay);
+
+    return isOk ? 0 : 1;
+}
+
+i32 RecordGame(const char *path, i32 searchDepth, i32 randomPercent, u64 seed) {
+    Search search;
+    InitSearch(&search, searchDepth);
+
+    Rng rng = CreateRng(seed);
+    Board board;
+    ResetBoard(&board, &rng);
+    Packed_board packed = PackBoard(&board);
+
+    i64 capacity = REPLAY_INITIAL_CAPACITY;
+    Replay replay = {
+        .boards = TrackedAlloc(capacity * sizeof(Packed_board), ALLOC_TAG_ANALYSIS),
+        .moves = TrackedAlloc(capacity * sizeof(u8), ALLOC_TAG_ANALYSIS)
+    };
+    replay.boards[0] = packed;
+
+    f64 start = GetWallTime();
+    i32 score = 0;
+    while (GetPackedMaxTile(packed) < (i32)PACKED_TILE_MASK) {
+        Direction move;
+        SearchBestMove(&search, packed, &move);
+        if (move == DIRECTION_NONE) {
+            break;
+        }
+
+        if (RandomRange(&rng, 0, 99) < randomPercent) {
+            do {
+                move = RandomRange(&rng, 0, DIRECTION_COUNT - 1);
+            } while (MovePackedBoard(packed, move, &(i32){0}) == packed);
+        }
+
+        if (replay.moveCount + 1 == capacity) {
+            capacity *= 2;
+            replay.boards = TrackedRealloc(replay.boards, capacity * sizeof(Packed_board), ALLOC_TAG_ANALYSIS);
+            replay.moves = TrackedRealloc(replay.moves, capacity * sizeof(u8), ALLOC_TAG_ANALYSIS);
+        }
+
+        board = UnpackBoard(MovePackedBoard(packed, move, &score));
+        SpawnTile(&board, &rng);
+        packed = PackBoard(&board);
+
+        replay.moves[replay.moveCount++] = move;
+        replay.boards[replay.moveCount] = packed;
+    }
+
+    FreeSearch(&search);
+
+    bool isOk = WriteReplay(&replay, path);
+    if (isOk) {
+        printf("Wrote %s: %lld moves, score %d, largest tile %u, played in %.2f s\n", path,
+            (long long)replay.moveCount, score, PowerOf2(GetPackedMaxTile(packed)), GetWallTime() - start);
+    } else {
+        fprintf(stderr, "Could not write %s\n", path);
+    }
+
+    FreeReplay(&replay);
+
+    return isOk ? 0 : 1;
+}
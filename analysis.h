@@ -0,0 +1,96 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include "common.h"
+#include "board.h"
+#include "history.h"
+#include "platform.h"
+#include "search.h"
+
+#define REPLAY_MAGIC "R2048RPL"
+#define REPLAY_VERSION 1
+#define ANALYSIS_MAGIC "R2048ANL"
+#define ANALYSIS_VERSION 1
+#define ANALYSIS_DEFAULT_REPORT_PATH "analysis.bin"
+#define ANALYSIS_DEFAULT_DEPTH SEARCH_DEFAULT_DEPTH
+#define ANALYSIS_MAX_THREADS 64
+
+// Post-game analysis: every position of a finished game gets its own search of the same depth, and each move is
+// marked with how far its value falls short of the best move's. Search values are the expectimax heuristic rather
+// than a score, so a loss only compares moves against each other (see EvaluatePackedBoard), and a move into a lost
+// game loses everything.
+//
+// Positions don't depend on each other, so threads take them in chunks and the time goes down with the core count.
+
+// A game as the positions before each move, the final one too, and the moves between them. The file is a
+// Replay_header, the boards (moveCount + 1) and then the moves (a byte each).
+typedef struct Replay_header {
+    char magic[8];
+    u32 version;
+    u32 reserved;
+    u64 moveCount;
+} Replay_header;
+
+typedef struct Replay {
+    Packed_board *boards;
+    u8 *moves;
+    i64 moveCount;
+} Replay;
+
+// The report file is an Analysis_header followed by an Analysis_move per move, in the order they were played
+typedef struct Analysis_header {
+    char magic[8];
+    u32 version;
+    u32 searchDepth;
+    u64 moveCount;
+    u64 bestCount; // Moves that were the best one
+    f64 totalLoss;
+} Analysis_header;
+
+typedef struct Analysis_move {
+    f32 loss; // Best move's value minus the played one's, 0 if the best was played
+    f32 bestValue;
+    u8 played;
+    u8 best;
+    u16 reserved;
+} Analysis_move;
+
+// The game over screen's analysis, run on its own thread so the window keeps drawing. Everything is allocated before
+// the thread starts.
+typedef struct Game_analysis {
+    Replay replay;
+    Analysis_move *moves;
+    Search *searches;
+    i32 threadCount;
+    Thread thread;
+    bool isStarted;
+    volatile i32 isDone;
+    volatile i32 isStopped;
+    f32 maxLoss;
+    f32 accuracy; // Share of moves that were the best one
+} Game_analysis;
+
+
+// The moves are worked out by replaying each spawn from the entry's rng state after each direction in turn
+bool ReadReplayFromHistory(Replay *replay, History *history);
+bool ReadReplay(Replay *replay, const char *path);
+bool WriteReplay(const Replay *replay, const char *path);
+void FreeReplay(Replay *replay);
+
+// Fills moves[replay->moveCount], using one search per thread (all of the same depth). Returns early, with the rest
+// of moves unset, once isStopped is set.
+void AnalyseReplay(const Replay *replay, Analysis_move *moves, Search *searches, i32 threadCount,
+    volatile i32 *isStopped);
+
+// Start takes the game from the history, Stop waits for the thread and frees everything. Stop is fine to call on an
+// analysis that never started.
+void StartGameAnalysis(Game_analysis *analysis, History *history);
+void StopGameAnalysis(Game_analysis *analysis);
+
+// Writes the report and prints the time taken, the accuracy and the worst moves
+i32 RunAnalysis(const char *replayPath, const char *reportPath, i32 threadCount, i32 searchDepth);
+
+// Plays a game with the search, with randomPercent of the moves random instead, and writes its replay
+i32 RecordGame(const char *path, i32 searchDepth, i32 randomPercent, u64 seed);
+
+#endif
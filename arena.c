@@ -0,0 +1,404 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "arena.h"
+#include "cJSON.h"
+#include "platform.h"
+
+#define ARENA_MAX_THREADS 64
+#define ARENA_Z 1.96 // 95% intervals
+#define ARENA_MIN_REACH_EXPONENT 8  // 256
+#define ARENA_MAX_REACH_EXPONENT 15 // 32768, where games stop
+
+
+typedef struct Arena_worker {
+    const Arena_policy *policy;
+    Arena_player player;
+    u64 firstSeed;
+    i64 gameCount;
+    volatile i64 *nextGame;
+    Game_stats stats;
+    f64 cpuTime; // Seconds
+} Arena_worker;
+
+typedef struct Arena_result {
+    const Arena_policy *policy;
+    Game_stats stats;
+    f64 wallTime;
+    f64 cpuTime; // Summed over the threads
+} Arena_result;
+
+typedef struct Arena_interval {
+    f64 value;
+    f64 lower;
+    f64 upper;
+} Arena_interval;
+
+
+static Direction ChooseRandomMove(Arena_player *player, const Board *board, const Successors *successors) {
+    (void)board;
+
+    Direction legalMoves[DIRECTION_COUNT];
+    i32 legalCount = 0;
+    for (i32 direction = 0; direction < DIRECTION_COUNT; ++direction) {
+        if (successors->moves[direction].didMove) {
+            legalMoves[legalCount++] = direction;
+        }
+    }
+
+    return legalMoves[RandomRange(&player->rng, 0, legalCount - 1)];
+}
+
+// The move that scores the most right now, ties broken at random
+static Direction ChooseGreedyMove(Arena_player *player, const Board *board, const Successors *successors) {
+    (void)board;
+
+    Direction bestMoves[DIRECTION_COUNT];
+    i32 bestCount = 0;
+    i32 bestScore = -1;
+    for (i32 direction = 0; direction < DIRECTION_COUNT; ++direction) {
+        const Successor *move = &successors->moves[direction];
+        if (!move->didMove || move->scoreDelta < bestScore) {
+            continue;
+        }
+
+        if (move->scoreDelta > bestScore) {
+            bestScore = move->scoreDelta;
+            bestCount = 0;
+        }
+        bestMoves[bestCount++] = direction;
+    }
+
+    return bestMoves[RandomRange(&player->rng, 0, bestCount - 1)];
+}
+
+// Keeps the large tiles in the bottom left: down when it can, then left, then right, and up only when nothing else
+// moves
+static Direction ChooseCornerMove(Arena_player *player, const Board *board, const Successors *successors) {
+    (void)player;
+    (void)board;
+
+    const Direction PREFERENCE[DIRECTION_COUNT] = {DIRECTION_DOWN, DIRECTION_LEFT, DIRECTION_RIGHT, DIRECTION_UP};
+    for (i32 i = 0; i < DIRECTION_COUNT; ++i) {
+        if (successors->moves[PREFERENCE[i]].didMove) {
+            return PREFERENCE[i];
+        }
+    }
+
+    return DIRECTION_NONE;
+}
+
+static Direction ChooseSearchMove(Arena_player *player, const Board *board, const Successors *successors) {
+    (void)successors;
+
+    return SuggestMove(player->book, &player->search, PackBoard(board), NULL);
+}
+
+static const Arena_policy ARENA_POLICIES[] = {
+    {"random", &ChooseRandomMove},
+    {"greedy", &ChooseGreedyMove},
+    {"corner", &ChooseCornerMove},
+    {"search", &ChooseSearchMove}
+};
+
+#define ARENA_POLICY_COUNT (i32)(sizeof(ARENA_POLICIES) / sizeof(ARENA_POLICIES[0]))
+
+static i32 GetBoardMaxTile(const Board *board) {
+    i32 maxTile = 0;
+    for (i32 i = 0; i < TILE_COUNT; ++i) {
+        maxTile = MaxI32(maxTile, board->board[i]);
+    }
+
+    return maxTile;
+}
+
+void PlayArenaGame(const Arena_policy *policy, Arena_player *player, u64 seed, Game_result *result) {
+    f64 start = GetWallTime();
+
+    Rng rng = CreateRng(seed);
+    player->rng = CreateRng(~seed); // A stream of its own, so the spawns don't depend on the policy
+    Board board;
+    ResetBoard(&board, &rng);
+
+    i32 score = 0;
+    u32 moveCount = 0;
+    i32 maxTile = GetBoardMaxTile(&board);
+    while (maxTile < (i32)PACKED_TILE_MASK) {
+        Successors successors;
+        ComputeSuccessors(&board, &successors, false);
+        if (!successors.canMove) {
+            break;
+        }
+
+        const Successor *move = &successors.moves[policy->choose(player, &board, &successors)];
+        board = move->board;
+        score += move->scoreDelta;
+        ++moveCount;
+
+        SpawnTile(&board, &rng);
+        maxTile = GetBoardMaxTile(&board);
+    }
+
+    *result = (Game_result){
+        .seed = seed,
+        .score = score,
+        .moveCount = moveCount,
+        .duration = GetWallTime() - start,
+        .maxTile = maxTile
+    };
+}
+
+static void RunArenaWorker(void *data) {
+    Arena_worker *worker = data;
+    f64 start = GetThreadCpuTime();
+
+    // Games are long and vary a lot in length, so they're handed out one at a time
+    for (;;) {
+        i64 game = AtomicAddI64(worker->nextGame, 1) - 1;
+        if (game >= worker->gameCount) {
+            break;
+        }
+
+        Game_result result;
+        PlayArenaGame(worker->policy, &worker->player, worker->firstSeed + game, &result);
+        AddGameResult(&worker->stats, &result);
+    }
+
+    worker->cpuTime = GetThreadCpuTime() - start;
+}
+
+// Fills selected from a comma separated list of names, or with every policy for NULL
+static bool SelectPolicies(const char *list, bool selected[ARENA_POLICY_COUNT]) {
+    for (i32 i = 0; i < ARENA_POLICY_COUNT; ++i) {
+        selected[i] = list == NULL;
+    }
+
+    for (const char *name = list; name != NULL && *name != '\0';) {
+        size_t length = strcspn(name, ",");
+        i32 i = 0;
+        while (i < ARENA_POLICY_COUNT &&
+            (strlen(ARENA_POLICIES[i].name) != length || strncmp(ARENA_POLICIES[i].name, name, length) != 0)) {
+            ++i;
+        }
+
+        if (i == ARENA_POLICY_COUNT) {
+            fprintf(stderr, "Unknown policy \"%.*s\"\n", (int)length, name);
+            return false;
+        }
+
+        selected[i] = true;
+        name += length + (name[length] == ',');
+    }
+
+    return true;
+}
+
+static Arena_interval GetMeanScoreInterval(const Game_stats *stats) {
+    i64 n = stats->gameCount;
+    f64 mean = n > 0 ? (f64)stats->scoreSum / n : 0.0;
+
+    // The sample standard deviation, GetScoreStandardDeviation divides by n
+    f64 halfWidth = n > 1 ? ARENA_Z * GetScoreStandardDeviation(stats) * sqrt((f64)n / (n - 1)) / sqrt((f64)n) : 0.0;
+
+    return (Arena_interval){mean, mean - halfWidth, mean + halfWidth};
+}
+
+// The ranks n/2 +- z*sqrt(n)/2 bound the median (the normal approximation to the binomial), read off the sketch, so
+// they're within its accuracy
+static Arena_interval GetMedianScoreInterval(const Game_stats *stats) {
+    f64 offset = stats->gameCount > 0 ? ARENA_Z / 2.0 / sqrt((f64)stats->gameCount) : 0.0;
+
+    return (Arena_interval){
+        GetSketchQuantile(&stats->scores, 0.5),
+        GetSketchQuantile(&stats->scores, 0.5 - offset > 0.0 ? 0.5 - offset : 0.0),
+        GetSketchQuantile(&stats->scores, 0.5 + offset < 1.0 ? 0.5 + offset : 1.0)
+    };
+}
+
+// Wilson score interval, which stays inside [0, 1] and doesn't collapse for rates of 0 or 1
+static Arena_interval GetReachInterval(const Game_stats *stats, i32 exponent) {
+    f64 n = (f64)stats->gameCount;
+    f64 rate = GetTileReachRate(stats, exponent);
+    if (n == 0.0) {
+        return (Arena_interval){0};
+    }
+
+    f64 z2 = ARENA_Z * ARENA_Z;
+    f64 denominator = 1.0 + z2 / n;
+    f64 center = (rate + z2 / (2.0 * n)) / denominator;
+    f64 halfWidth = ARENA_Z * sqrt(rate * (1.0 - rate) / n + z2 / (4.0 * n * n)) / denominator;
+
+    return (Arena_interval){rate, center - halfWidth, center + halfWidth};
+}
+
+static void AddIntervalToObject(cJSON *object, const char *name, Arena_interval interval) {
+    cJSON *item = cJSON_AddObjectToObject(object, name);
+    cJSON_AddNumberToObject(item, "value", interval.value);
+    cJSON_AddNumberToObject(item, "lower", interval.lower);
+    cJSON_AddNumberToObject(item, "upper", interval.upper);
+}
+
+static bool WriteArenaJson(const Arena_result *results, i32 resultCount, i32 threadCount, u64 firstSeed,
+    const char *path) {
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "games", resultCount > 0 ? (f64)results[0].stats.gameCount : 0.0);
+    cJSON_AddNumberToObject(json, "firstSeed", (f64)firstSeed);
+    cJSON_AddNumberToObject(json, "threads", threadCount);
+    cJSON_AddNumberToObject(json, "searchDepth", ARENA_SEARCH_DEPTH);
+
+    cJSON *policies = cJSON_AddObjectToObject(json, "policies");
+    for (i32 i = 0; i < resultCount; ++i) {
+        const Arena_result *result = &results[i];
+        const Game_stats *stats = &result->stats;
+        f64 moveCount = stats->moveSum > 0 ? (f64)stats->moveSum : 1.0;
+
+        cJSON *policy = cJSON_AddObjectToObject(policies, result->policy->name);
+        AddIntervalToObject(policy, "scoreMean", GetMeanScoreInterval(stats));
+        AddIntervalToObject(policy, "scoreMedian", GetMedianScoreInterval(stats));
+        cJSON_AddNumberToObject(policy, "scoreStandardDeviation", GetScoreStandardDeviation(stats));
+        cJSON_AddNumberToObject(policy, "maxScore", stats->maxScore);
+        cJSON_AddNumberToObject(policy, "movesMean", stats->gameCount > 0 ? (f64)stats->moveSum / stats->gameCount : 0.0);
+        cJSON_AddNumberToObject(policy, "movesPerSecond", stats->moveSum / result->wallTime);
+        cJSON_AddNumberToObject(policy, "cpuMicrosecondsPerMove", result->cpuTime * 1e6 / moveCount);
+        cJSON_AddNumberToObject(policy, "wallSeconds", result->wallTime);
+
+        // Keyed by the tile, "2048" and so on
+        cJSON *reach = cJSON_AddObjectToObject(policy, "reach");
+        for (i32 exponent = ARENA_MIN_REACH_EXPONENT; exponent <= ARENA_MAX_REACH_EXPONENT; ++exponent) {
+            char tile[16];
+            snprintf(tile, sizeof(tile), "%u", PowerOf2(exponent));
+            AddIntervalToObject(reach, tile, GetReachInterval(stats, exponent));
+        }
+    }
+
+    char *text = cJSON_Print(json);
+    cJSON_Delete(json);
+
+    FILE *file = text != NULL ? fopen(path, "w") : NULL;
+    bool isOk = file != NULL;
+    if (isOk) {
+        isOk = fputs(text, file) >= 0;
+        isOk &= fclose(file) == 0;
+    }
+    cJSON_free(text);
+
+    return isOk;
+}
+
+// The reach columns are the share of games that got to each tile, their intervals are in the JSON
+static void PrintArenaTable(const Arena_result *results, i32 resultCount) {
+    printf("\n%-8s %26s %26s %11s %8s", "policy", "mean score (95% CI)", "median score (95% CI)", "moves/s",
+        "us/move");
+    for (i32 exponent = ARENA_MIN_REACH_EXPONENT; exponent <= ARENA_MAX_REACH_EXPONENT; ++exponent) {
+        printf(" %6u", PowerOf2(exponent));
+    }
+    printf("\n");
+
+    for (i32 i = 0; i < resultCount; ++i) {
+        const Arena_result *result = &results[i];
+        const Game_stats *stats = &result->stats;
+        Arena_interval mean = GetMeanScoreInterval(stats);
+        Arena_interval median = GetMedianScoreInterval(stats);
+
+        char meanText[32];
+        char medianText[32];
+        snprintf(meanText, sizeof(meanText), "%.0f (%.0f-%.0f)", mean.value, mean.lower, mean.upper);
+        snprintf(medianText, sizeof(medianText), "%.0f (%.0f-%.0f)", median.value, median.lower, median.upper);
+
+        printf("%-8s %26s %26s %11.0f %8.2f", result->policy->name, meanText, medianText,
+            stats->moveSum / result->wallTime, result->cpuTime * 1e6 / (stats->moveSum > 0 ? stats->moveSum : 1));
+        for (i32 exponent = ARENA_MIN_REACH_EXPONENT; exponent <= ARENA_MAX_REACH_EXPONENT; ++exponent) {
+            printf(" %5.1f%%", 100.0 * GetTileReachRate(stats, exponent));
+        }
+        printf("\n");
+    }
+}
+
+i32 RunArena(i64 gameCount, i32 threadCount, u64 firstSeed, const char *jsonPath, const char *policies) {
+    if (threadCount <= 0) {
+        threadCount = GetProcessorCount();
+    }
+    threadCount = MinI32(threadCount, ARENA_MAX_THREADS);
+    gameCount = gameCount > 0 ? gameCount : ARENA_DEFAULT_GAMES;
+
+    bool selected[ARENA_POLICY_COUNT];
+    if (!SelectPolicies(policies, selected)) {
+        return 1;
+    }
+
+    // A book searched to another depth would be a different policy playing under the search's name
+    Book book;
+    if (OpenBook(&book, BOOK_DEFAULT_PATH) && book.header->searchDepth != ARENA_SEARCH_DEPTH) {
+        CloseBook(&book);
+    }
+
+    // Everything is allocated up front, the allocator isn't for use from several threads at once
+    Arena_worker *workers = TrackedAlloc(threadCount * sizeof(Arena_worker), ALLOC_TAG_ARENA);
+    Arena_result *results = TrackedAlloc(ARENA_POLICY_COUNT * sizeof(Arena_result), ALLOC_TAG_ARENA);
+    for (i32 i = 0; i < threadCount; ++i) {
+        InitSearch(&workers[i].player.search, ARENA_SEARCH_DEPTH);
+        workers[i].player.book = &book;
+    }
+
+    printf("Playing %lld games per policy on %d threads, seeds from %llu, %s\n", (long long)gameCount, threadCount,
+        (unsigned long long)firstSeed, book.entries != NULL ? "openings from the book" : "no book");
+
+    i32 resultCount = 0;
+    for (i32 policy = 0; policy < ARENA_POLICY_COUNT; ++policy) {
+        if (!selected[policy]) {
+            continue;
+        }
+
+        volatile i64 nextGame = 0;
+        for (i32 i = 0; i < threadCount; ++i) {
+            workers[i].policy = &ARENA_POLICIES[policy];
+            workers[i].firstSeed = firstSeed;
+            workers[i].gameCount = gameCount;
+            workers[i].nextGame = &nextGame;
+            workers[i].cpuTime = 0.0;
+            InitGameStats(&workers[i].stats);
+        }
+
+        Thread threads[ARENA_MAX_THREADS];
+        f64 start = GetWallTime();
+        for (i32 i = 1; i < threadCount; ++i) {
+            StartThread(&threads[i], &RunArenaWorker, &workers[i]);
+        }
+        RunArenaWorker(&workers[0]);
+        for (i32 i = 1; i < threadCount; ++i) {
+            JoinThread(&threads[i]);
+        }
+
+        Arena_result *result = &results[resultCount++];
+        result->policy = &ARENA_POLICIES[policy];
+        result->wallTime = GetWallTime() - start;
+        result->cpuTime = 0.0;
+        InitGameStats(&result->stats);
+        for (i32 i = 0; i < threadCount; ++i) {
+            MergeGameStats(&result->stats, &workers[i].stats);
+            result->cpuTime += workers[i].cpuTime;
+        }
+
+        printf("%s: %lld moves in %.2f s\n", result->policy->name, (long long)result->stats.moveSum, result->wallTime);
+    }
+
+    PrintArenaTable(results, resultCount);
+
+    bool isOk = WriteArenaJson(results, resultCount, threadCount, firstSeed, jsonPath);
+    if (isOk) {
+        printf("Wrote %s\n", jsonPath);
+    } else {
+        fprintf(stderr, "Could not write %s\n", jsonPath);
+    }
+
+    for (i32 i = 0; i < threadCount; ++i) {
+        FreeSearch(&workers[i].player.search);
+    }
+    TrackedFree(workers, ALLOC_TAG_ARENA);
+    TrackedFree(results, ALLOC_TAG_ARENA);
+    CloseBook(&book);
+
+    return isOk ? 0 : 1;
+}
@@ -0,0 +1,40 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "common.h"
+#include "board.h"
+#include "book.h"
+#include "search.h"
+#include "stats.h"
+
+#define ARENA_DEFAULT_GAMES 100
+#define ARENA_DEFAULT_JSON_PATH "arena.json"
+#define ARENA_SEARCH_DEPTH SEARCH_DEFAULT_DEPTH
+
+// Every policy plays the same games: game i of each starts from seed firstSeed + i, and the spawns come from that
+// seed alone, so two policies that make the same moves see the same tiles. A policy that needs randomness gets its
+// own Rng. The rules are the GUI's (ComputeSuccessors and SpawnTile), up to the 32768 tile where the packed engine
+// stops.
+//
+// Each policy gets a row with its score (mean and median with 95% confidence intervals), the tiles it reaches and
+// how fast it picks its moves, in a table and in a JSON file to compare runs against.
+
+typedef struct Arena_player {
+    Rng rng;
+    Search search;
+    const Book *book; // Openings for the search policy, may be NULL or closed
+} Arena_player;
+
+typedef struct Arena_policy {
+    const char *name;
+    Direction (*choose)(Arena_player *player, const Board *board, const Successors *successors);
+} Arena_policy;
+
+
+// Plays one game with the policy, which has to have a legal move whenever successors->canMove
+void PlayArenaGame(const Arena_policy *policy, Arena_player *player, u64 seed, Game_result *result);
+
+// policies is a comma separated list of names, NULL for all of them
+i32 RunArena(i64 gameCount, i32 threadCount, u64 firstSeed, const char *jsonPath, const char *policies);
+
+#endif
@@ -0,0 +1,278 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "batch_env.h"
+#include "platform.h"
+
+#define BENCHMARK_MAX_THREADS 64
+
+
+typedef struct Benchmark_worker {
+    Batch_env *env;
+    u8 *actions;
+    i32 first;
+    i32 count;
+    f64 endTime;
+    Rng rng;
+    i64 stepCount;
+} Benchmark_worker;
+
+
+bool InitBatchEnv(Batch_env *env, i32 count, u64 seed) {
+    *env = (Batch_env){.count = count, .ownsOutputs = true};
+
+    env->boards = TrackedAlloc(count * sizeof(Packed_board), ALLOC_TAG_ENV);
+    env->scores = TrackedAlloc(count * sizeof(i32), ALLOC_TAG_ENV);
+    env->moveCounts = TrackedAlloc(count * sizeof(u32), ALLOC_TAG_ENV);
+    env->rngStates = TrackedAlloc(count * sizeof(u64), ALLOC_TAG_ENV);
+    env->legalMoves = TrackedAlloc(count * sizeof(u8), ALLOC_TAG_ENV);
+    env->rewards = TrackedAlloc(count * sizeof(f32), ALLOC_TAG_ENV);
+    env->dones = TrackedAlloc(count * sizeof(u8), ALLOC_TAG_ENV);
+    env->finalScores = TrackedAlloc(count * sizeof(i32), ALLOC_TAG_ENV);
+    env->afterstates = TrackedAlloc(count * DIRECTION_COUNT * sizeof(Packed_board), ALLOC_TAG_ENV);
+    env->afterstateRewards = TrackedAlloc(count * DIRECTION_COUNT * sizeof(i32), ALLOC_TAG_ENV);
+
+    if (env->boards == NULL || env->scores == NULL || env->moveCounts == NULL || env->rngStates == NULL || 
+        env->legalMoves == NULL || env->rewards == NULL || env->dones == NULL || env->finalScores == NULL || 
+        env->afterstates == NULL || env->afterstateRewards == NULL) {
+        FreeBatchEnv(env);
+        return false;
+    }
+
+    // Every game gets its own stream
+    Rng seeder = CreateRng(seed);
+    for (i32 i = 0; i < count; ++i) {
+        env->rngStates[i] = NextRandom(&seeder);
+    }
+
+    ResetBatchEnv(env, NULL);
+
+    return true;
+}
+
+void FreeBatchEnv(Batch_env *env) {
+    TrackedFree(env->boards, ALLOC_TAG_ENV);
+    TrackedFree(env->scores, ALLOC_TAG_ENV);
+    TrackedFree(env->moveCounts, ALLOC_TAG_ENV);
+    TrackedFree(env->rngStates, ALLOC_TAG_ENV);
+    if (env->ownsOutputs) {
+        TrackedFree(env->legalMoves, ALLOC_TAG_ENV);
+        TrackedFree(env->rewards, ALLOC_TAG_ENV);
+        TrackedFree(env->dones, ALLOC_TAG_ENV);
+        TrackedFree(env->finalScores, ALLOC_TAG_ENV);
+    }
+    TrackedFree(env->afterstates, ALLOC_TAG_ENV);
+    TrackedFree(env->afterstateRewards, ALLOC_TAG_ENV);
+
+    *env = (Batch_env){0};
+}
+
+void BindBatchEnvOutputs(Batch_env *env, u8 *legalMoves, f32 *rewards, u8 *dones, i32 *finalScores) {
+    memcpy(legalMoves, env->legalMoves, env->count * sizeof(u8));
+    memcpy(rewards, env->rewards, env->count * sizeof(f32));
+    memcpy(dones, env->dones, env->count * sizeof(u8));
+    memcpy(finalScores, env->finalScores, env->count * sizeof(i32));
+
+    if (env->ownsOutputs) {
+        TrackedFree(env->legalMoves, ALLOC_TAG_ENV);
+        TrackedFree(env->rewards, ALLOC_TAG_ENV);
+        TrackedFree(env->dones, ALLOC_TAG_ENV);
+        TrackedFree(env->finalScores, ALLOC_TAG_ENV);
+    }
+
+    env->legalMoves = legalMoves;
+    env->rewards = rewards;
+    env->dones = dones;
+    env->finalScores = finalScores;
+    env->ownsOutputs = false;
+}
+
+// Fills in the afterstates and legal moves of game i. Returns false if the game can't go on.
+static bool PrepareMoves(Batch_env *env, i32 i, const Board *board) {
+    Successors successors;
+    ComputeSuccessors(board, &successors, false);
+
+    u8 legalMoves = 0;
+    for (i32 direction = 0; direction < DIRECTION_COUNT; ++direction) {
+        Successor *successor = &successors.moves[direction];
+        if (!successor->didMove) {
+            continue;
+        }
+
+        if (!CanPackBoard(&successor->board)) {
+            return false;
+        }
+
+        env->afterstates[i * DIRECTION_COUNT + direction] = PackBoard(&successor->board);
+        env->afterstateRewards[i * DIRECTION_COUNT + direction] = successor->scoreDelta;
+        legalMoves |= 1 << direction;
+    }
+
+    env->legalMoves[i] = legalMoves;
+
+    return legalMoves != 0;
+}
+
+static void ResetGame(Batch_env *env, i32 i) {
+    Rng rng = CreateRng(env->rngStates[i]);
+    Board board;
+    ResetBoard(&board, &rng);
+
+    env->boards[i] = PackBoard(&board);
+    env->scores[i] = 0;
+    env->moveCounts[i] = 0;
+    env->rngStates[i] = rng.state;
+    env->rewards[i] = 0.0f;
+    env->dones[i] = 0;
+    env->finalScores[i] = 0;
+
+    PrepareMoves(env, i, &board); // A fresh board always has moves
+}
+
+void ResetBatchEnv(Batch_env *env, const u8 *mask) {
+    for (i32 i = 0; i < env->count; ++i) {
+        if (mask == NULL || mask[i]) {
+            ResetGame(env, i);
+        }
+    }
+}
+
+void StepBatchEnvRange(Batch_env *env, const u8 *actions, i32 first, i32 count) {
+    for (i32 i = first; i < first + count; ++i) {
+        u8 action = actions[i];
+        env->dones[i] = 0;
+
+        if (action >= DIRECTION_COUNT || !(env->legalMoves[i] & (1 << action))) {
+            env->rewards[i] = 0.0f;
+            continue;
+        }
+
+        Board board = UnpackBoard(env->afterstates[i * DIRECTION_COUNT + action]);
+        i32 reward = env->afterstateRewards[i * DIRECTION_COUNT + action];
+
+        Rng rng = CreateRng(env->rngStates[i]);
+        SpawnTile(&board, &rng);
+
+        env->boards[i] = PackBoard(&board);
+        env->scores[i] += reward;
+        env->moveCounts[i] += 1;
+        env->rngStates[i] = rng.state;
+
+        if (!PrepareMoves(env, i, &board)) {
+            i32 finalScore = env->scores[i];
+            ResetGame(env, i);
+            env->dones[i] = 1;
+            env->finalScores[i] = finalScore;
+        }
+
+        env->rewards[i] = reward;
+    }
+}
+
+void StepBatchEnv(Batch_env *env, const u8 *actions) {
+    StepBatchEnvRange(env, actions, 0, env->count);
+}
+
+void GetBatchEnvObservations(const Batch_env *env, u8 *exponents) {
+    for (i32 i = 0; i < env->count; ++i) {
+        Packed_board board = env->boards[i];
+        for (i32 j = 0; j < TILE_COUNT; ++j) {
+            exponents[i * TILE_COUNT + j] = (board >> (PACKED_TILE_BITS * j)) & PACKED_TILE_MASK;
+        }
+    }
+}
+
+void ChooseRandomActions(const u8 *legalMoves, u8 *actions, i32 count, Rng *rng) {
+    for (i32 i = 0; i < count; ++i) {
+        u8 action;
+        do {
+            action = RandomRange(rng, 0, DIRECTION_COUNT - 1);
+        } while (!(legalMoves[i] & (1 << action)));
+
+        actions[i] = action;
+    }
+}
+
+// Plays random legal moves on its range until time is up. Picking the moves is included in the timing, as it
+// would be for a real agent.
+static void RunBenchmarkWorker(void *data) {
+    Benchmark_worker *worker = data;
+    Batch_env *env = worker->env;
+
+    while (GetWallTime() < worker->endTime) {
+        ChooseRandomActions(env->legalMoves + worker->first, worker->actions + worker->first, worker->count, 
+            &worker->rng);
+        StepBatchEnvRange(env, worker->actions, worker->first, worker->count);
+        worker->stepCount += worker->count;
+    }
+}
+
+i32 RunBatchEnvBenchmark(i32 count, f64 secondsPerLevel) {
+    if (count <= 0) {
+        fprintf(stderr, "Game count must be positive\n");
+        return 1;
+    }
+
+    Batch_env env;
+    u8 *actions = TrackedAlloc(count, ALLOC_TAG_ENV);
+    if (actions == NULL || !InitBatchEnv(&env, count, 2048)) {
+        fprintf(stderr, "Could not allocate %d games\n", count);
+        return 1;
+    }
+
+    i32 processorCount = MinI32(GetProcessorCount(), BENCHMARK_MAX_THREADS);
+    printf("Stepping %d games, %.1f s per level, %d cores\n", count, secondsPerLevel, processorCount);
+
+    Thread threads[BENCHMARK_MAX_THREADS];
+    Benchmark_worker workers[BENCHMARK_MAX_THREADS];
+
+    // Doubles the threads each level, always finishing on every core
+    for (i32 threadCount = 1; ; threadCount = MinI32(threadCount * 2, processorCount)) {
+        Alloc_stats before = GetAllocTotals();
+        f64 start = GetWallTime();
+
+        // Ranges start on multiples of 64 games so threads don't write to the same cache lines
+        i32 chunk = ((count + threadCount - 1) / threadCount + 63) & ~63;
+        i32 workerCount = 0;
+        for (i32 first = 0; first < count && workerCount < threadCount; first += chunk) {
+            workers[workerCount] = (Benchmark_worker){
+                .env = &env,
+                .actions = actions,
+                .first = first,
+                .count = MinI32(chunk, count - first),
+                .endTime = start + secondsPerLevel,
+                .rng = CreateRng(0x2048 + workerCount)
+            };
+            ++workerCount;
+        }
+
+        // The calling thread does the first range itself
+        for (i32 i = 1; i < workerCount; ++i) {
+            StartThread(&threads[i], &RunBenchmarkWorker, &workers[i]);
+        }
+        RunBenchmarkWorker(&workers[0]);
+        for (i32 i = 1; i < workerCount; ++i) {
+            JoinThread(&threads[i]);
+        }
+
+        f64 elapsed = GetWallTime() - start;
+        i64 stepCount = 0;
+        for (i32 i = 0; i < workerCount; ++i) {
+            stepCount += workers[i].stepCount;
+        }
+
+        Alloc_stats after = GetAllocTotals();
+        printf("%3d threads  %12.0f steps/s  %10.0f steps/s per thread  %d allocations\n", workerCount, 
+            stepCount / elapsed, stepCount / elapsed / workerCount, after.total.allocs - before.total.allocs);
+
+        if (threadCount >= processorCount) {
+            break;
+        }
+    }
+
+    FreeBatchEnv(&env);
+    TrackedFree(actions, ALLOC_TAG_ENV);
+
+    return 0;
+}
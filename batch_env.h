@@ -0,0 +1,61 @@
+#ifndef BATCH_ENV_H
+#define BATCH_ENV_H
+
+#include "common.h"
+#include "board.h"
+
+// Many independent games stepped together, for training agents. Every field is an array with one entry per game
+// (struct-of-arrays), so a trainer can hand them to its own code without copying. Nothing is allocated after
+// InitBatchEnv.
+//
+// After ResetBatchEnv or StepBatchEnv, legalMoves[i] has bit d set if direction d changes game i. A game that ends
+// on a step is restarted right away: dones[i] is set, finalScores[i] holds the score it ended with, and the other
+// fields already describe the new game.
+//
+// Games also end once a move could make a tile larger than 32768, since boards are stored packed (see Packed_board).
+
+typedef struct Batch_env {
+    i32 count;
+
+    Packed_board *boards;
+    i32 *scores;
+    u32 *moveCounts;
+    u64 *rngStates;
+
+    u8 *legalMoves;
+    f32 *rewards; // Score gained on the last step, 0 for illegal actions (which leave the game as it was)
+    u8 *dones;
+    i32 *finalScores;
+    bool ownsOutputs; // False once the four arrays above point into memory the caller provided
+
+    // The board after each move, before the spawn, computed along with legalMoves so a step is a lookup plus a spawn
+    Packed_board *afterstates; // count * DIRECTION_COUNT
+    i32 *afterstateRewards;
+} Batch_env;
+
+bool InitBatchEnv(Batch_env *env, i32 count, u64 seed);
+void FreeBatchEnv(Batch_env *env);
+
+// Moves legalMoves, rewards, dones and finalScores into caller-owned arrays (e.g. memory shared with another
+// process) so that stepping writes there directly. The caller keeps them alive until FreeBatchEnv.
+void BindBatchEnvOutputs(Batch_env *env, u8 *legalMoves, f32 *rewards, u8 *dones, i32 *finalScores);
+
+// mask has one entry per game, nonzero to restart it. NULL restarts every game.
+void ResetBatchEnv(Batch_env *env, const u8 *mask);
+
+// actions has one Direction per game
+void StepBatchEnv(Batch_env *env, const u8 *actions);
+
+// Steps games [first, first + count) only, so threads can share one Batch_env by taking disjoint ranges
+void StepBatchEnvRange(Batch_env *env, const u8 *actions, i32 first, i32 count);
+
+// Picks a uniformly random legal direction for each of count games, for tests and benchmarks
+void ChooseRandomActions(const u8 *legalMoves, u8 *actions, i32 count, Rng *rng);
+
+// Writes TILE_COUNT exponents per game into exponents (count * TILE_COUNT bytes)
+void GetBatchEnvObservations(const Batch_env *env, u8 *exponents);
+
+// Prints environment steps/sec for 1 thread up to one per core
+i32 RunBatchEnvBenchmark(i32 count, f64 secondsPerLevel);
+
+#endif
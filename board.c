@@ -0,0 +1,444 @@
+#include <stddef.h>
+
+#include "board.h"
+
+
+Rng CreateRng(u64 seed) {
+    return (Rng){.state = seed};
+}
+
+// splitmix64
+u64 NextRandom(Rng *rng) {
+    u64 z = (rng->state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+i32 RandomRange(Rng *rng, i32 min, i32 max) {
+    u64 range = (u64)(max - min) + 1;
+    return min + (i32)(((NextRandom(rng) >> 32) * range) >> 32);
+}
+
+Packed_board PackBoard(const Board *board) {
+    Packed_board packed = 0;
+    for (i32 i = 0; i < TILE_COUNT; ++i) {
+        packed |= ((u64)board->board[i] & PACKED_TILE_MASK) << (PACKED_TILE_BITS * i);
+    }
+
+    return packed;
+}
+
+Board UnpackBoard(Packed_board packed) {
+    Board board;
+    for (i32 i = 0; i < TILE_COUNT; ++i) {
+        board.board[i] = (packed >> (PACKED_TILE_BITS * i)) & PACKED_TILE_MASK;
+    }
+
+    return board;
+}
+
+bool CanPackBoard(const Board *board) {
+    for (i32 i = 0; i < TILE_COUNT; ++i) {
+        if ((u64)board->board[i] > PACKED_TILE_MASK) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+i32 GetPackedMaxTile(Packed_board board) {
+    i32 maxTile = 0;
+    for (i32 i = 0; i < TILE_COUNT; ++i) {
+        maxTile = MaxI32(maxTile, (board >> (PACKED_TILE_BITS * i)) & PACKED_TILE_MASK);
+    }
+
+    return maxTile;
+}
+
+u32 PowerOf2(i32 exponent) {
+    if (exponent < 0 || exponent > 32) {
+        return 0;
+    }
+
+    u32 result = 1;
+    while (exponent--) {
+        result *= 2;
+    }
+
+    return result;
+}
+
+const char *GetDirectionName(Direction direction) {
+    static const char *const DIRECTION_NAMES[DIRECTION_COUNT] = {
+        [DIRECTION_UP] = "UP",
+        [DIRECTION_DOWN] = "DOWN",
+        [DIRECTION_LEFT] = "LEFT",
+        [DIRECTION_RIGHT] = "RIGHT"
+    };
+
+    if (direction < 0 || direction >= DIRECTION_COUNT) {
+        return "NONE";
+    }
+
+    return DIRECTION_NAMES[direction];
+}
+
+bool IsBoardFull(const i32 *board) {
+    for (i32 i = 0; i < TILE_COUNT; ++i) {
+        if (board[i] == 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool CanMove(const i32 *board) {
+    if (!IsBoardFull(board)) {
+        return true;
+    }
+
+    for (i32 y = 0; y < TILE_COUNT_Y; ++y) {
+        for (i32 x = 0; x < TILE_COUNT_X; ++x) {
+            i32 index = y * TILE_COUNT_X + x;
+            if ((y > 0 && board[index] == board[index - TILE_COUNT_X]) || (y < TILE_COUNT_Y - 1 && board[index] == board[index + TILE_COUNT_X]) ||
+                (x > 0 && board[index] == board[index - 1]) || (x < TILE_COUNT_X - 1 && board[index] == board[index + 1])) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static bool HandleMovement_Up(i32 index) {
+    return index >= TILE_COUNT_X;
+}
+
+static bool HandleMovement_Down(i32 index) {
+    return index < TILE_COUNT - TILE_COUNT_X;
+}
+
+static bool HandleMovement_Left(i32 index) {
+    return index % TILE_COUNT_X != 0;
+}
+
+static bool HandleMovement_Right(i32 index) {
+    return index % TILE_COUNT_X != (TILE_COUNT_X - 1);
+}
+
+typedef struct Move_state {
+    Board *board;
+    u32 combinedCells;
+    bool didMove;
+    i32 score;
+    Tile_events *events;
+} Move_state;
+
+static void AddEvent(Tile_events *events, Tile_event_type type, i32 from, i32 to, i32 value) {
+    events->events[events->count++] = (Tile_event){
+        .type = type,
+        .from = from,
+        .to = to,
+        .value = value
+    };
+}
+
+static void HandleMovement(Move_state *state, i32 index, i32 offset, bool (*condition)(i32)) {
+    i32 *board = state->board->board;
+    i32 startIndex = index;
+    i32 value = board[index];
+    bool didCombine = false;
+
+    while ((*condition)(index) && board[index] != 0 && !(state->combinedCells & CELL_BIT(index + offset)) && 
+        (board[index + offset] == 0 || board[index + offset] == board[index])) {
+        state->didMove = true;
+        index += offset;
+
+        if (board[index] > 0) {
+            state->score += PowerOf2(board[index] + 1);
+            board[index] += 1;
+            board[index - offset] = 0;
+
+            state->combinedCells |= CELL_BIT(index);
+            didCombine = true;
+
+            break;
+        }
+
+        board[index] = board[index - offset];
+        board[index - offset] = 0;
+    }
+
+    if (state->events != NULL && startIndex != index) {
+        if (didCombine) {
+            AddEvent(state->events, TILE_EVENT_MERGE, startIndex, index, value);
+            state->events->mergedCells |= CELL_BIT(index);
+        } else {
+            AddEvent(state->events, TILE_EVENT_SLIDE, startIndex, index, value);
+            state->events->slidCells |= CELL_BIT(index);
+        }
+    }
+}
+
+static void MoveUp(Move_state *state) {
+    for (i32 y = 1; y < TILE_COUNT_Y; ++y) {
+        for (i32 x = 0; x < TILE_COUNT_X; ++x) {
+            i32 index = y * TILE_COUNT_X + x;
+            HandleMovement(state, index, -TILE_COUNT_X, &HandleMovement_Up);
+        }
+    }
+}
+
+static void MoveDown(Move_state *state) {
+    for (i32 y = TILE_COUNT_Y - 2; y >= 0; --y) {
+        for (i32 x = 0; x < TILE_COUNT_X; ++x) {
+            i32 index = y * TILE_COUNT_X + x;
+            HandleMovement(state, index, TILE_COUNT_X, &HandleMovement_Down);
+        }
+    }
+}
+
+static void MoveLeft(Move_state *state) {
+    for (i32 x = 1; x < TILE_COUNT_X; ++x) {
+        for (i32 y = 0; y < TILE_COUNT_Y; ++y) {
+            i32 index = y * TILE_COUNT_X + x;
+            HandleMovement(state, index, -1, &HandleMovement_Left);
+        }
+    }
+}
+
+static void MoveRight(Move_state *state) {
+    for (i32 x = TILE_COUNT_X - 2; x >= 0; --x) {
+        for (i32 y = 0; y < TILE_COUNT_Y; ++y) {
+            i32 index = y * TILE_COUNT_X + x;
+            HandleMovement(state, index, 1, &HandleMovement_Right);
+        }
+    }
+}
+
+static void (*const MOVE_FUNCTIONS[DIRECTION_COUNT])(Move_state *) = {
+    [DIRECTION_UP] = &MoveUp,
+    [DIRECTION_DOWN] = &MoveDown,
+    [DIRECTION_LEFT] = &MoveLeft,
+    [DIRECTION_RIGHT] = &MoveRight
+};
+
+bool MoveBoard(Board *board, Direction direction, i32 *score, Tile_events *events) {
+    if (direction < 0 || direction >= DIRECTION_COUNT) {
+        return false;
+    }
+
+    if (events != NULL) {
+        *events = (Tile_events){0};
+    }
+
+    Board newBoard = *board;
+    Move_state state = {
+        .board = &newBoard,
+        .events = events
+    };
+    MOVE_FUNCTIONS[direction](&state);
+
+    if (state.didMove) {
+        *board = newBoard;
+        *score += state.score;
+    }
+
+    return state.didMove;
+}
+
+// A line has the cell next to the wall being moved towards in its lowest nibble
+static u16 MovePackedLine(u16 line, i32 *score) {
+    u16 result = 0;
+    i32 count = 0;
+    u32 last = 0;
+    bool canMerge = false;
+
+    for (i32 i = 0; i < 4; ++i) {
+        u32 value = (line >> (PACKED_TILE_BITS * i)) & PACKED_TILE_MASK;
+        if (value == 0) {
+            continue;
+        }
+
+        if (canMerge && value == last) {
+            *score += PowerOf2(value + 1);
+            result += 1 << (PACKED_TILE_BITS * (count - 1));
+            canMerge = false;
+            continue;
+        }
+
+        result |= value << (PACKED_TILE_BITS * count);
+        ++count;
+        last = value;
+        canMerge = true;
+    }
+
+    return result;
+}
+
+static u16 ReversePackedLine(u16 line) {
+    return (line >> 12) | ((line >> 4) & 0x00F0) | ((line << 4) & 0x0F00) | (line << 12);
+}
+
+Packed_board TransposePackedBoard(Packed_board board) {
+    u64 a = (board & 0xF0F00F0FF0F00F0Full) | ((board & 0x0000F0F00000F0F0ull) << 12) | 
+        ((board & 0x0F0F00000F0F0000ull) >> 12);
+    return (a & 0xFF00FF0000FF00FFull) | ((a & 0x00FF00FF00000000ull) >> 24) | ((a & 0x00000000FF00FF00ull) << 24);
+}
+
+Packed_board MovePackedBoard(Packed_board board, Direction direction, i32 *score) {
+    bool isVertical = direction == DIRECTION_UP || direction == DIRECTION_DOWN;
+    bool isReversed = direction == DIRECTION_DOWN || direction == DIRECTION_RIGHT;
+
+    Packed_board rows = isVertical ? TransposePackedBoard(board) : board;
+    Packed_board result = 0;
+
+    for (i32 y = 0; y < 4; ++y) {
+        u16 line = rows >> (16 * y);
+        line = isReversed ? ReversePackedLine(MovePackedLine(ReversePackedLine(line), score)) : 
+            MovePackedLine(line, score);
+        result |= (u64)line << (16 * y);
+    }
+
+    return isVertical ? TransposePackedBoard(result) : result;
+}
+
+// Mirrors x: the nibbles of each row in reverse order
+static Packed_board FlipPackedBoardX(Packed_board board) {
+    board = ((board & 0x0F0F0F0F0F0F0F0Full) << 4) | ((board >> 4) & 0x0F0F0F0F0F0F0F0Full);
+    return ((board & 0x00FF00FF00FF00FFull) << 8) | ((board >> 8) & 0x00FF00FF00FF00FFull);
+}
+
+// Mirrors y: the rows in reverse order
+static Packed_board FlipPackedBoardY(Packed_board board) {
+    board = (board << 32) | (board >> 32);
+    return ((board & 0x0000FFFF0000FFFFull) << 16) | ((board >> 16) & 0x0000FFFF0000FFFFull);
+}
+
+Packed_board TransformPackedBoard(Packed_board board, i32 symmetry) {
+    if (symmetry & SYMMETRY_TRANSPOSE) {
+        board = TransposePackedBoard(board);
+    }
+    if (symmetry & SYMMETRY_FLIP_X) {
+        board = FlipPackedBoardX(board);
+    }
+    if (symmetry & SYMMETRY_FLIP_Y) {
+        board = FlipPackedBoardY(board);
+    }
+
+    return board;
+}
+
+Direction TransformDirection(Direction direction, i32 symmetry) {
+    static const Direction TRANSPOSED[DIRECTION_COUNT] = {
+        [DIRECTION_UP] = DIRECTION_LEFT,
+        [DIRECTION_DOWN] = DIRECTION_RIGHT,
+        [DIRECTION_LEFT] = DIRECTION_UP,
+        [DIRECTION_RIGHT] = DIRECTION_DOWN
+    };
+
+    if (symmetry & SYMMETRY_TRANSPOSE) {
+        direction = TRANSPOSED[direction];
+    }
+
+    bool isVertical = direction == DIRECTION_UP || direction == DIRECTION_DOWN;
+    if ((isVertical && (symmetry & SYMMETRY_FLIP_Y)) || (!isVertical && (symmetry & SYMMETRY_FLIP_X))) {
+        direction ^= 1; // Up/down and left/right are neighbours in the enum
+    }
+
+    return direction;
+}
+
+i32 InvertSymmetry(i32 symmetry) {
+    // Flipping and then transposing is transposing and then flipping the other axis
+    if (symmetry & SYMMETRY_TRANSPOSE) {
+        symmetry = SYMMETRY_TRANSPOSE | ((symmetry & SYMMETRY_FLIP_X) << 1) | ((symmetry & SYMMETRY_FLIP_Y) >> 1);
+    }
+
+    return symmetry;
+}
+
+Direction UntransformDirection(Direction direction, i32 symmetry) {
+    return TransformDirection(direction, InvertSymmetry(symmetry));
+}
+
+Packed_board CanonicalisePackedBoard(Packed_board board, i32 *symmetry) {
+    // All 8 forms from one transpose and three flips each, in the order of their symmetry so ties go to the lowest
+    Packed_board transposed = TransposePackedBoard(board);
+    Packed_board forms[SYMMETRY_COUNT] = {
+        board,
+        FlipPackedBoardX(board),
+        FlipPackedBoardY(board),
+        FlipPackedBoardY(FlipPackedBoardX(board)),
+        transposed,
+        FlipPackedBoardX(transposed),
+        FlipPackedBoardY(transposed),
+        FlipPackedBoardY(FlipPackedBoardX(transposed))
+    };
+
+    Packed_board best = board;
+    *symmetry = 0;
+
+    // Selects rather than branches, as which form wins is close to random
+    for (i32 i = 1; i < SYMMETRY_COUNT; ++i) {
+        bool isSmaller = forms[i] < best;
+        best = isSmaller ? forms[i] : best;
+        *symmetry = isSmaller ? i : *symmetry;
+    }
+
+    return best;
+}
+
+u64 HashPackedBoard(Packed_board board) {
+    // splitmix64's finaliser, every step of which can be undone
+    u64 hash = board;
+    hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+    return hash ^ (hash >> 31);
+}
+
+void ComputeSuccessors(const Board *board, Successors *successors, bool recordEvents) {
+    successors->canMove = false;
+
+    for (i32 i = 0; i < DIRECTION_COUNT; ++i) {
+        Successor *successor = &successors->moves[i];
+
+        successor->board = *board;
+        successor->scoreDelta = 0;
+        successor->didMove = MoveBoard(&successor->board, i, &successor->scoreDelta, recordEvents ? &successor->events : NULL);
+
+        successors->canMove |= successor->didMove;
+    }
+}
+
+void AddSpawnEvent(Tile_events *events, i32 index, i32 value) {
+    AddEvent(events, TILE_EVENT_SPAWN, index, index, value);
+    events->spawnedCells |= CELL_BIT(index);
+}
+
+i32 SpawnTile(Board *board, Rng *rng) {
+    if (IsBoardFull(board->board)) {
+        return -1;
+    }
+
+    i32 index;
+    do {
+        index = RandomRange(rng, 0, TILE_COUNT - 1);
+    } while (board->board[index] != 0);
+
+    board->board[index] = RandomRange(rng, 1, 2);
+
+    return index;
+}
+
+void ResetBoard(Board *board, Rng *rng) {
+    *board = (Board){0};
+
+    for (i32 i = 0; i < 2; ++i) {
+        i32 index = SpawnTile(board, rng);
+        board->board[index] = 1;
+    }
+}
@@ -0,0 +1,133 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+#include "common.h"
+
+#define TILE_COUNT_X 4
+#define TILE_COUNT_Y 4
+#define TILE_COUNT (TILE_COUNT_X * TILE_COUNT_Y)
+
+#if TILE_COUNT > 16
+#error "Packed_board has room for 16 cells"
+#endif
+
+#define TILE_EVENT_CAPACITY (TILE_COUNT + 1) // Every tile moves at most once, plus the spawn
+
+#define CELL_BIT(index) (1u << (index))
+
+#define PACKED_TILE_BITS 4
+#define PACKED_TILE_MASK 0xFull
+
+// The 8 symmetries of a square board are combinations of these, with the transpose applied first
+#define SYMMETRY_FLIP_X 1
+#define SYMMETRY_FLIP_Y 2
+#define SYMMETRY_TRANSPOSE 4
+#define SYMMETRY_COUNT 8
+
+
+typedef enum Direction {
+    DIRECTION_UP,
+    DIRECTION_DOWN,
+    DIRECTION_LEFT,
+    DIRECTION_RIGHT,
+    DIRECTION_COUNT,
+    DIRECTION_NONE = -1
+} Direction;
+
+typedef struct Board {
+    i32 board[TILE_COUNT];
+} Board;
+
+// One exponent per nibble, cell 0 in the lowest bits. Only exact for exponents below 16 (the 65536 tile).
+typedef u64 Packed_board;
+
+// Spawns come from this rather than raylib's GetRandomValue so that a position together with its Rng state
+// always produces the same spawns, which is what undo/redo and headless runs rely on
+typedef struct Rng {
+    u64 state;
+} Rng;
+
+typedef enum Tile_event_type {
+    TILE_EVENT_SLIDE,
+    TILE_EVENT_MERGE,
+    TILE_EVENT_SPAWN
+} Tile_event_type;
+
+// value is the exponent of the tile before the move, or of the new tile for spawns (where from == to)
+typedef struct Tile_event {
+    u8 type;
+    u8 from;
+    u8 to;
+    u8 value;
+} Tile_event;
+
+// What a move did to the board, for the renderer. The bitmaps have one bit per cell (see CELL_BIT) so that
+// drawing a cell doesn't have to search the event list.
+typedef struct Tile_events {
+    Tile_event events[TILE_EVENT_CAPACITY];
+    i32 count;
+    u32 slidCells;   // Destinations of TILE_EVENT_SLIDE
+    u32 mergedCells; // Destinations of TILE_EVENT_MERGE
+    u32 spawnedCells;
+} Tile_events;
+
+typedef struct Successor {
+    Board board;
+    Tile_events events;
+    i32 scoreDelta;
+    bool didMove;
+} Successor;
+
+// The positions reachable from a board in one move, computed right after a tile spawns so that a keypress
+// only has to pick one of them
+typedef struct Successors {
+    Successor moves[DIRECTION_COUNT];
+    bool canMove;
+} Successors;
+
+
+Rng CreateRng(u64 seed);
+u64 NextRandom(Rng *rng);
+i32 RandomRange(Rng *rng, i32 min, i32 max); // Inclusive
+
+Packed_board PackBoard(const Board *board);
+Board UnpackBoard(Packed_board packed);
+bool CanPackBoard(const Board *board);
+i32 GetPackedMaxTile(Packed_board board); // Exponent
+
+u32 PowerOf2(i32 exponent);
+const char *GetDirectionName(Direction direction); // "UP" and so on, "NONE" for anything else
+bool IsBoardFull(const i32 *board);
+bool CanMove(const i32 *board);
+
+// events may be NULL, in which case nothing is recorded
+bool MoveBoard(Board *board, Direction direction, i32 *score, Tile_events *events);
+
+// The same rules on a packed board, a line at a time, for the headless modes. Returns the board unchanged if nothing
+// moved. Merging two 32768 tiles doesn't fit in a Packed_board, so the result is only exact if no move on the board
+// makes a 65536 tile. Assumes a 4x4 board.
+Packed_board MovePackedBoard(Packed_board board, Direction direction, i32 *score);
+Packed_board TransposePackedBoard(Packed_board board); // Swaps x and y, so that columns can be moved as rows
+
+// Equivalent positions have equal canonical forms, so tables of positions only need to store one of them. A move
+// found for the canonical board is turned back into one for the original with UntransformDirection. Assume a 4x4
+// board.
+Packed_board TransformPackedBoard(Packed_board board, i32 symmetry);
+Direction TransformDirection(Direction direction, i32 symmetry);
+Direction UntransformDirection(Direction direction, i32 symmetry);
+i32 InvertSymmetry(i32 symmetry); // The symmetry that undoes it
+Packed_board CanonicalisePackedBoard(Packed_board board, i32 *symmetry); // The smallest symmetric form
+
+// Every bit of the board affects every bit of the hash, and it is a bijection, so equal hashes mean equal boards. Any
+// range of its bits makes a table index.
+u64 HashPackedBoard(Packed_board board);
+
+void ComputeSuccessors(const Board *board, Successors *successors, bool recordEvents);
+
+void AddSpawnEvent(Tile_events *events, i32 index, i32 value);
+
+// Returns the cell the tile went into, or -1 if the board is full
+i32 SpawnTile(Board *board, Rng *rng);
+void ResetBoard(Board *board, Rng *rng);
+
+#endif
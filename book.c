@@ -0,0 +1,452 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "book.h"
+
+#define BOOK_MAX_THREADS 64
+#define BOOK_CHUNK_SIZE 16 // Positions a thread claims at a time
+#define BOOK_INITIAL_CAPACITY 4096
+#define BOOK_BENCHMARK_LOOKUPS 1000000
+#define BOOK_BENCHMARK_SEARCHES 20
+#define BOOK_BENCHMARK_SEED 1
+
+
+// Open addressing on the board itself, 0 marks an empty slot (no position has an empty board)
+typedef struct Position_set {
+    Packed_board *slots;
+    i64 capacity;
+    i64 count;
+} Position_set;
+
+// The positions in the order they were found, a level (moves made) after another
+typedef struct Position_list {
+    Packed_board *boards;
+    i64 capacity;
+    i64 count;
+} Position_list;
+
+typedef struct Book_worker {
+    const Position_list *positions;
+    Book_entry *entries;
+    volatile i64 *nextPosition;
+    Search search;
+} Book_worker;
+
+
+static void InitPositionSet(Position_set *set, i64 capacity) {
+    set->slots = TrackedAlloc(capacity * sizeof(Packed_board), ALLOC_TAG_BOOK);
+    memset(set->slots, 0, capacity * sizeof(Packed_board));
+    set->capacity = capacity;
+    set->count = 0;
+}
+
+static bool AddToPositionSet(Position_set *set, Packed_board board);
+
+// Kept at most half full
+static void GrowPositionSet(Position_set *set) {
+    Position_set grown;
+    InitPositionSet(&grown, 2 * set->capacity);
+
+    for (i64 i = 0; i < set->capacity; ++i) {
+        if (set->slots[i] != 0) {
+            AddToPositionSet(&grown, set->slots[i]);
+        }
+    }
+
+    TrackedFree(set->slots, ALLOC_TAG_BOOK);
+    *set = grown;
+}
+
+// False if it was already there
+static bool AddToPositionSet(Position_set *set, Packed_board board) {
+    if (2 * (set->count + 1) > set->capacity) {
+        GrowPositionSet(set);
+    }
+
+    i64 mask = set->capacity - 1;
+    for (i64 i = HashPackedBoard(board) & mask;; i = (i + 1) & mask) {
+        if (set->slots[i] == board) {
+            return false;
+        }
+
+        if (set->slots[i] == 0) {
+            set->slots[i] = board;
+            ++set->count;
+            return true;
+        }
+    }
+}
+
+static void AddToPositionList(Position_list *list, Packed_board board) {
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity > 0 ? 2 * list->capacity : BOOK_INITIAL_CAPACITY;
+        list->boards = TrackedRealloc(list->boards, list->capacity * sizeof(Packed_board), ALLOC_TAG_BOOK);
+    }
+
+    list->boards[list->count++] = board;
+}
+
+static void AddPosition(Position_set *set, Position_list *list, Packed_board board) {
+    i32 symmetry;
+    Packed_board canonical = CanonicalisePackedBoard(board, &symmetry);
+    if (AddToPositionSet(set, canonical)) {
+        AddToPositionList(list, canonical);
+    }
+}
+
+// Every position a player can face before one of the first moveCount moves. A position can be reached after
+// different numbers of moves, it's only expanded the first time.
+static void EnumerateBookPositions(Position_list *list, i32 moveCount) {
+    Position_set set;
+    InitPositionSet(&set, BOOK_INITIAL_CAPACITY);
+
+    // ResetBoard's starts, two 2s anywhere
+    for (i32 i = 0; i < TILE_COUNT; ++i) {
+        for (i32 j = i + 1; j < TILE_COUNT; ++j) {
+            AddPosition(&set, list, (1ull << (PACKED_TILE_BITS * i)) | (1ull << (PACKED_TILE_BITS * j)));
+        }
+    }
+
+    i64 levelStart = 0;
+    for (i32 level = 1; level < moveCount; ++level) {
+        i64 levelEnd = list->count;
+        printf("  %lld positions before move %d\n", (long long)(levelEnd - levelStart), level);
+
+        for (i64 i = levelStart; i < levelEnd; ++i) {
+            Packed_board board = list->boards[i];
+
+            for (i32 direction = 0; direction < DIRECTION_COUNT; ++direction) {
+                i32 score = 0;
+                Packed_board moved = MovePackedBoard(board, direction, &score);
+                if (moved == board) {
+                    continue;
+                }
+
+                for (i32 cell = 0; cell < TILE_COUNT; ++cell) {
+                    if (((moved >> (PACKED_TILE_BITS * cell)) & PACKED_TILE_MASK) != 0) {
+                        continue;
+                    }
+
+                    for (u64 exponent = 1; exponent <= 2; ++exponent) {
+                        AddPosition(&set, list, moved | (exponent << (PACKED_TILE_BITS * cell)));
+                    }
+                }
+            }
+        }
+
+        levelStart = levelEnd;
+    }
+    printf("  %lld positions before move %d\n", (long long)(list->count - levelStart), moveCount);
+
+    TrackedFree(set.slots, ALLOC_TAG_BOOK);
+}
+
+static void RunBookWorker(void *data) {
+    Book_worker *worker = data;
+    const Position_list *positions = worker->positions;
+
+    for (;;) {
+        i64 end = AtomicAddI64(worker->nextPosition, BOOK_CHUNK_SIZE);
+        i64 start = end - BOOK_CHUNK_SIZE;
+        if (start >= positions->count) {
+            break;
+        }
+        end = end < positions->count ? end : positions->count;
+
+        for (i64 i = start; i < end; ++i) {
+            Direction move;
+            f32 value = SearchBestMove(&worker->search, positions->boards[i], &move);
+
+            worker->entries[i] = (Book_entry){
+                .board = positions->boards[i],
+                .value = value,
+                .move = move
+            };
+        }
+    }
+}
+
+static i32 CompareBookEntries(const void *a, const void *b) {
+    u64 hashA = HashPackedBoard(((const Book_entry *)a)->board);
+    u64 hashB = HashPackedBoard(((const Book_entry *)b)->board);
+    return (hashA > hashB) - (hashA < hashB);
+}
+
+i32 BuildBook(const char *path, i32 moveCount, i32 searchDepth, i32 threadCount) {
+    if (threadCount <= 0) {
+        threadCount = GetProcessorCount();
+    }
+    threadCount = MinI32(threadCount, BOOK_MAX_THREADS);
+    moveCount = MaxI32(moveCount, 1);
+
+    printf("Building a book of the first %d moves, search depth %d, %d threads\n", moveCount, searchDepth, threadCount);
+
+    f64 start = GetWallTime();
+
+    Position_list positions = {0};
+    EnumerateBookPositions(&positions, moveCount);
+
+    f64 enumerated = GetWallTime();
+
+    Book_entry *entries = TrackedAlloc(positions.count * sizeof(Book_entry), ALLOC_TAG_BOOK);
+    Book_worker *workers = TrackedAlloc(threadCount * sizeof(Book_worker), ALLOC_TAG_BOOK);
+    Thread threads[BOOK_MAX_THREADS];
+    volatile i64 nextPosition = 0;
+
+    for (i32 i = 0; i < threadCount; ++i) {
+        workers[i] = (Book_worker){
+            .positions = &positions,
+            .entries = entries,
+            .nextPosition = &nextPosition
+        };
+        InitSearch(&workers[i].search, searchDepth);
+    }
+
+    for (i32 i = 1; i < threadCount; ++i) {
+        StartThread(&threads[i], &RunBookWorker, &workers[i]);
+    }
+    RunBookWorker(&workers[0]);
+    for (i32 i = 1; i < threadCount; ++i) {
+        JoinThread(&threads[i]);
+    }
+
+    i64 nodeCount = 0;
+    for (i32 i = 0; i < threadCount; ++i) {
+        nodeCount += workers[i].search.nodeCount;
+        FreeSearch(&workers[i].search);
+    }
+
+    f64 searched = GetWallTime();
+
+    qsort(entries, positions.count, sizeof(Book_entry), &CompareBookEntries);
+
+    Book_header header = {
+        .magic = BOOK_MAGIC,
+        .version = BOOK_VERSION,
+        .moveCount = moveCount,
+        .searchDepth = searchDepth,
+        .entryCount = positions.count
+    };
+
+    FILE *file = fopen(path, "wb");
+    bool isOk = file != NULL;
+    if (isOk) {
+        isOk = fwrite(&header, sizeof(header), 1, file) == 1 &&
+            fwrite(entries, sizeof(Book_entry), positions.count, file) == (size_t)positions.count;
+        isOk &= fclose(file) == 0;
+    }
+
+    f64 end = GetWallTime();
+    if (isOk) {
+        f64 searchTime = searched - enumerated;
+        printf("Wrote %s: %lld positions, %.1f MB\n", path, (long long)positions.count,
+            (sizeof(header) + positions.count * sizeof(Book_entry)) / 1e6);
+        printf("Enumerated in %.2f s, searched in %.2f s (%.0f positions/s, %.1f M nodes/s), %.2f s in total\n",
+            enumerated - start, searchTime, positions.count / searchTime, nodeCount / searchTime / 1e6, end - start);
+    } else {
+        fprintf(stderr, "Could not write %s\n", path);
+    }
+
+    TrackedFree(workers, ALLOC_TAG_BOOK);
+    TrackedFree(entries, ALLOC_TAG_BOOK);
+    TrackedFree(positions.boards, ALLOC_TAG_BOOK);
+
+    return isOk ? 0 : 1;
+}
+
+bool OpenBook(Book *book, const char *path) {
+    *book = (Book){0};
+
+    if (!MapFile(&book->file, path)) {
+        return false;
+    }
+
+    const Book_header *header = book->file.data;
+    bool isValid = book->file.size >= (i64)sizeof(Book_header) && memcmp(header->magic, BOOK_MAGIC, 8) == 0 &&
+        header->version == BOOK_VERSION &&
+        (u64)book->file.size == sizeof(Book_header) + header->entryCount * sizeof(Book_entry);
+    if (!isValid) {
+        UnmapFile(&book->file);
+        return false;
+    }
+
+    book->header = header;
+    book->entries = (const Book_entry *)(header + 1);
+    book->entryCount = header->entryCount;
+
+    return true;
+}
+
+void CloseBook(Book *book) {
+    UnmapFile(&book->file);
+    *book = (Book){0};
+}
+
+static const Book_entry *FindBookEntry(const Book *book, Packed_board canonical) {
+    u64 hash = HashPackedBoard(canonical);
+
+    i64 low = 0;
+    i64 high = book->entryCount - 1;
+    while (low <= high) {
+        u64 lowHash = HashPackedBoard(book->entries[low].board);
+        u64 highHash = HashPackedBoard(book->entries[high].board);
+        if (hash < lowHash || hash > highHash) {
+            return NULL;
+        }
+
+        // Where the hash would be if the hashes in [low, high] were evenly spaced
+        i64 middle = low;
+        if (highHash > lowHash) {
+            middle += (i64)((f64)(hash - lowHash) / (f64)(highHash - lowHash) * (f64)(high - low));
+        }
+
+        u64 middleHash = HashPackedBoard(book->entries[middle].board);
+        if (middleHash == hash) {
+            return &book->entries[middle];
+        }
+
+        if (middleHash < hash) {
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+
+    return NULL;
+}
+
+bool LookUpBook(const Book *book, Packed_board board, Direction *move, f32 *value) {
+    if (book == NULL || book->entries == NULL) {
+        return false;
+    }
+
+    i32 symmetry;
+    Packed_board canonical = CanonicalisePackedBoard(board, &symmetry);
+    const Book_entry *entry = FindBookEntry(book, canonical);
+    if (entry == NULL) {
+        return false;
+    }
+
+    *move = UntransformDirection(entry->move, symmetry);
+    *value = entry->value;
+
+    return true;
+}
+
+Direction SuggestMove(const Book *book, Search *search, Packed_board board, bool *isFromBook) {
+    Direction move;
+    f32 value;
+    bool isInBook = LookUpBook(book, board, &move, &value);
+    if (!isInBook) {
+        SearchBestMove(search, board, &move);
+    }
+
+    if (isFromBook != NULL) {
+        *isFromBook = isInBook;
+    }
+
+    return move;
+}
+
+// Positions the book doesn't have, from the middle of random games
+static Packed_board GetRandomMidgameBoard(Rng *rng) {
+    Board board;
+    ResetBoard(&board, rng);
+    Packed_board packed = PackBoard(&board);
+
+    i32 moveCount = RandomRange(rng, 50, 150);
+    for (i32 i = 0; i < moveCount; ++i) {
+        Direction direction = RandomRange(rng, 0, DIRECTION_COUNT - 1);
+        i32 score = 0;
+        Packed_board moved = MovePackedBoard(packed, direction, &score);
+        if (moved == packed) {
+            continue;
+        }
+
+        board = UnpackBoard(moved);
+        if (SpawnTile(&board, rng) < 0) {
+            break;
+        }
+        Packed_board next = PackBoard(&board);
+
+        bool canMove = false;
+        for (i32 j = 0; j < DIRECTION_COUNT && !canMove; ++j) {
+            canMove = MovePackedBoard(next, j, &score) != next;
+        }
+        if (!canMove) {
+            break;
+        }
+        packed = next;
+    }
+
+    return packed;
+}
+
+i32 RunBookBenchmark(const char *path) {
+    Book book;
+    if (!OpenBook(&book, path)) {
+        fprintf(stderr, "Could not open %s, or it isn't a book\n", path);
+        return 1;
+    }
+
+    if (book.entryCount == 0) {
+        fprintf(stderr, "%s has no positions to look up\n", path);
+        CloseBook(&book);
+        return 1;
+    }
+
+    printf("%s: %lld positions from the first %u moves, search depth %u, %.1f MB mapped\n", path,
+        (long long)book.entryCount, book.header->moveCount, book.header->searchDepth, book.file.size / 1e6);
+
+    // Queries are turned by a random symmetry first, so the canonicalisation is part of what is measured
+    Rng rng = CreateRng(BOOK_BENCHMARK_SEED);
+    Packed_board *hits = TrackedAlloc(BOOK_BENCHMARK_LOOKUPS * sizeof(Packed_board), ALLOC_TAG_BOOK);
+    Packed_board *misses = TrackedAlloc(BOOK_BENCHMARK_LOOKUPS * sizeof(Packed_board), ALLOC_TAG_BOOK);
+    for (i32 i = 0; i < BOOK_BENCHMARK_LOOKUPS; ++i) {
+        Packed_board board = book.entries[NextRandom(&rng) % book.entryCount].board;
+        hits[i] = TransformPackedBoard(board, RandomRange(&rng, 0, SYMMETRY_COUNT - 1));
+    }
+    for (i32 i = 0; i < BOOK_BENCHMARK_LOOKUPS; ++i) {
+        misses[i] = i < 1000 ? GetRandomMidgameBoard(&rng) : misses[i % 1000];
+    }
+
+    i32 hitCount = 0;
+    i32 missCount = 0;
+    Direction move;
+    f32 value;
+
+    f64 start = GetWallTime();
+    for (i32 i = 0; i < BOOK_BENCHMARK_LOOKUPS; ++i) {
+        hitCount += LookUpBook(&book, hits[i], &move, &value);
+    }
+    f64 hitTime = GetWallTime() - start;
+
+    start = GetWallTime();
+    for (i32 i = 0; i < BOOK_BENCHMARK_LOOKUPS; ++i) {
+        missCount += !LookUpBook(&book, misses[i], &move, &value);
+    }
+    f64 missTime = GetWallTime() - start;
+
+    Search search;
+    InitSearch(&search, book.header->searchDepth);
+    start = GetWallTime();
+    for (i32 i = 0; i < BOOK_BENCHMARK_SEARCHES; ++i) {
+        SearchBestMove(&search, hits[i], &move);
+    }
+    f64 searchTime = GetWallTime() - start;
+    FreeSearch(&search);
+
+    printf("Lookup in the book:   %8.0f ns (%d of %d found)\n", hitTime / BOOK_BENCHMARK_LOOKUPS * 1e9, hitCount,
+        BOOK_BENCHMARK_LOOKUPS);
+    printf("Lookup of a miss:     %8.0f ns (%d of %d missed)\n", missTime / BOOK_BENCHMARK_LOOKUPS * 1e9, missCount,
+        BOOK_BENCHMARK_LOOKUPS);
+    printf("Search it replaces:   %8.0f ns\n", searchTime / BOOK_BENCHMARK_SEARCHES * 1e9);
+
+    TrackedFree(hits, ALLOC_TAG_BOOK);
+    TrackedFree(misses, ALLOC_TAG_BOOK);
+    CloseBook(&book);
+
+    return 0;
+}
@@ -0,0 +1,59 @@
+#ifndef BOOK_H
+#define BOOK_H
+
+#include "common.h"
+#include "board.h"
+#include "platform.h"
+#include "search.h"
+
+#define BOOK_MAGIC "R2048BOK"
+#define BOOK_VERSION 1
+#define BOOK_DEFAULT_PATH "assets/book.bin"
+#define BOOK_DEFAULT_MOVE_COUNT 4
+#define BOOK_DEFAULT_SEARCH_DEPTH 3
+
+// The best move and its search value for every position before each of the first moveCount moves of a game, from
+// every start ResetBoard can make. Equivalent positions are stored once, as their canonical board (see
+// CanonicalisePackedBoard).
+//
+// The file is a Book_header followed by the entries, sorted by HashPackedBoard. That hash is spread evenly over the
+// u64 range, so a lookup guesses where its entry is from the hash alone (interpolation search) and usually lands
+// within a probe or two, straight out of the mapped file.
+
+typedef struct Book_header {
+    char magic[8];
+    u32 version;
+    u32 moveCount;
+    u32 searchDepth;
+    u32 reserved;
+    u64 entryCount;
+} Book_header;
+
+typedef struct Book_entry {
+    Packed_board board; // Canonical
+    f32 value;
+    u32 move; // Direction on the canonical board
+} Book_entry;
+
+typedef struct Book {
+    Mapped_file file;
+    const Book_header *header;
+    const Book_entry *entries;
+    i64 entryCount;
+} Book;
+
+
+bool OpenBook(Book *book, const char *path);
+void CloseBook(Book *book);
+bool LookUpBook(const Book *book, Packed_board board, Direction *move, f32 *value);
+
+// The book's move if it has the position, otherwise a search. book may be NULL or closed. isFromBook may be NULL.
+Direction SuggestMove(const Book *book, Search *search, Packed_board board, bool *isFromBook);
+
+// Enumerates the positions, searches them across threads and writes the book. Prints its size and the build time.
+i32 BuildBook(const char *path, i32 moveCount, i32 searchDepth, i32 threadCount);
+
+// Prints lookup latency for positions in the book and out of it, next to the search it saves
+i32 RunBookBenchmark(const char *path);
+
+#endif
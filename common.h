@@ -33,4 +33,8 @@ static inline i32 MaxI32(i32 a, i32 b) {
     return a > b ? a : b;
 }
 
+static inline f32 LerpF32(f32 a, f32 b, f32 t) {
+    return a + t * (b - a);
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,616 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "raylib.h"
+
+#include "allocator.h"
+#include "corpus.h"
+#include "inflate.h"
+#include "move_tables.h"
+
+#define CORPUS_MAX_HEADER_SIZE 30 // Three varints: seed, board and move count
+#define CORPUS_INITIAL_MOVE_CAPACITY (CORPUS_BLOCK_GAMES * 256)
+#define CORPUS_BENCHMARK_LOOKUPS 1000
+#define CORPUS_BENCHMARK_MAX_MOVES 65536 // Random games stop long before this
+#define CORPUS_STOP_TILE PACKED_TILE_MASK // Where the benchmark's games stop, like the other headless games
+
+
+typedef struct Corpus_read_worker {
+    const Corpus *corpus;
+    Corpus_block block;
+    volatile i64 *nextBlock;
+    i64 gameCount;
+    i64 moveCount;
+    i64 scoreSum;
+    bool isOk;
+} Corpus_read_worker;
+
+
+// FNV-1a
+static u32 GetCorpusChecksum(const u8 *data, i64 size) {
+    u32 hash = 2166136261u;
+    for (i64 i = 0; i < size; ++i) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+static i32 WriteVarint(u8 *out, u64 value) {
+    i32 size = 0;
+    while (value >= 0x80) {
+        out[size++] = (u8)(value | 0x80);
+        value >>= 7;
+    }
+    out[size++] = (u8)value;
+
+    return size;
+}
+
+static bool ReadVarint(const u8 **cursor, const u8 *end, u64 *value) {
+    *value = 0;
+    for (i32 shift = 0; shift < 64 && *cursor < end; shift += 7) {
+        u8 byte = *(*cursor)++;
+        *value |= (u64)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Small differences either way make small numbers
+static u64 ZigzagEncode(i64 value) {
+    return ((u64)value << 1) ^ (u64)(value >> 63);
+}
+
+static i64 ZigzagDecode(u64 value) {
+    return (i64)(value >> 1) ^ -(i64)(value & 1);
+}
+
+// A bit per empty cell
+static u32 GetEmptyCells(Packed_board board) {
+    u32 empty = 0;
+    for (i32 i = 0; i < TILE_COUNT; ++i) {
+        empty |= (((board >> (PACKED_TILE_BITS * i)) & PACKED_TILE_MASK) == 0) << i;
+    }
+
+    return empty;
+}
+
+static i32 CountBits(u32 bits) {
+    i32 count = 0;
+    for (; bits != 0; bits &= bits - 1) {
+        ++count;
+    }
+
+    return count;
+}
+
+static void ResetPendingBlock(Corpus_pending_block *block) {
+    block->headerSize = 0;
+    block->moveCount = 0;
+    block->gameCount = 0;
+    block->previousSeed = 0;
+    block->compressed = NULL;
+    block->compressedSize = 0;
+    block->rawSize = 0;
+    block->isOk = false;
+}
+
+bool OpenCorpusWriter(Corpus_writer *writer, const char *path, i32 threadCount) {
+    *writer = (Corpus_writer){0};
+    writer->file = fopen(path, "wb");
+    if (writer->file == NULL) {
+        return false;
+    }
+
+    // A header without the magic until CloseCorpusWriter rewrites it
+    writer->header.version = CORPUS_VERSION;
+    writer->header.blockGames = CORPUS_BLOCK_GAMES;
+    writer->isOk = fwrite(&writer->header, sizeof(writer->header), 1, writer->file) == 1;
+    writer->fileSize = sizeof(writer->header);
+
+    writer->threadCount = MinI32(threadCount > 0 ? threadCount : GetProcessorCount(), CORPUS_MAX_THREADS);
+    writer->moveCapacity = CORPUS_INITIAL_MOVE_CAPACITY;
+    for (i32 i = 0; i < writer->threadCount; ++i) {
+        Corpus_pending_block *block = &writer->blocks[i];
+        block->raw = TrackedAlloc(CORPUS_BLOCK_GAMES * CORPUS_MAX_HEADER_SIZE, ALLOC_TAG_CORPUS);
+        block->moves = TrackedAlloc(writer->moveCapacity, ALLOC_TAG_CORPUS);
+        ResetPendingBlock(block);
+    }
+    writer->blockCount = 1;
+
+    return true;
+}
+
+static void CompressPendingBlock(void *data) {
+    Corpus_pending_block *block = data;
+    block->compressed = CompressData(block->raw, block->rawSize, &block->compressedSize);
+    block->isOk = block->compressed != NULL && block->compressedSize > 0;
+}
+
+// Compresses the blocks across threads and writes them out in order. Buffers are sized here, before the threads
+// start, as the allocator is single threaded.
+static void FlushCorpusBlocks(Corpus_writer *writer) {
+    i32 blockCount = writer->blocks[writer->blockCount - 1].gameCount > 0 ? writer->blockCount :
+        writer->blockCount - 1;
+    if (blockCount == 0) {
+        return;
+    }
+
+    for (i32 i = 0; i < blockCount; ++i) {
+        Corpus_pending_block *block = &writer->blocks[i];
+        block->rawSize = (i32)(block->headerSize + block->moveCount);
+        block->raw = TrackedRealloc(block->raw, MaxI32(block->rawSize, CORPUS_BLOCK_GAMES * CORPUS_MAX_HEADER_SIZE),
+            ALLOC_TAG_CORPUS);
+        memcpy(block->raw + block->headerSize, block->moves, block->moveCount);
+    }
+
+    if ((i64)writer->header.blockCount + blockCount > writer->indexCapacity) {
+        writer->indexCapacity = MaxI32((i32)writer->indexCapacity * 2, 64) + blockCount;
+        writer->index = TrackedRealloc(writer->index, writer->indexCapacity * sizeof(Corpus_block_entry),
+            ALLOC_TAG_CORPUS);
+    }
+
+    // The calling thread compresses the first block
+    Thread threads[CORPUS_MAX_THREADS];
+    bool isStarted[CORPUS_MAX_THREADS] = {0};
+    for (i32 i = 1; i < blockCount; ++i) {
+        isStarted[i] = StartThread(&threads[i], &CompressPendingBlock, &writer->blocks[i]);
+    }
+    for (i32 i = 0; i < blockCount; ++i) {
+        if (!isStarted[i]) {
+            CompressPendingBlock(&writer->blocks[i]);
+        }
+    }
+    for (i32 i = 1; i < blockCount; ++i) {
+        if (isStarted[i]) {
+            JoinThread(&threads[i]);
+        }
+    }
+
+    for (i32 i = 0; i < blockCount; ++i) {
+        Corpus_pending_block *block = &writer->blocks[i];
+        writer->isOk &= block->isOk;
+
+        if (block->isOk) {
+            writer->index[writer->header.blockCount++] = (Corpus_block_entry){
+                .offset = writer->fileSize,
+                .firstGame = writer->header.gameCount,
+                .gameCount = (u32)block->gameCount,
+                .rawSize = (u32)block->rawSize,
+                .compressedSize = (u32)block->compressedSize,
+                .checksum = GetCorpusChecksum(block->compressed, block->compressedSize)
+            };
+            writer->isOk &= fwrite(block->compressed, block->compressedSize, 1, writer->file) == 1;
+            writer->fileSize += block->compressedSize;
+            writer->header.gameCount += block->gameCount;
+        }
+
+        MemFree(block->compressed);
+        ResetPendingBlock(block);
+    }
+
+    writer->blockCount = 1;
+}
+
+bool AddCorpusGame(Corpus_writer *writer, const Corpus_game *game) {
+    const Move_tables_data *tables = GetMoveTables();
+    Corpus_pending_block *block = &writer->blocks[writer->blockCount - 1];
+
+    // Every block's moves buffer is the same size, so any of them can take the next game
+    if (block->moveCount + game->moveCount > writer->moveCapacity) {
+        writer->moveCapacity = 2 * (block->moveCount + game->moveCount);
+        for (i32 i = 0; i < writer->threadCount; ++i) {
+            writer->blocks[i].moves = TrackedRealloc(writer->blocks[i].moves, writer->moveCapacity, ALLOC_TAG_CORPUS);
+        }
+    }
+
+    // Spawn cells become their rank among the empty cells, checking the game on the way
+    u8 *moves = block->moves + block->moveCount;
+    Packed_board board = game->start;
+    for (u32 i = 0; i < game->moveCount; ++i) {
+        Direction direction = CORPUS_MOVE_DIRECTION(game->moves[i]);
+        i32 cell = CORPUS_MOVE_CELL(game->moves[i]);
+        u64 exponent = CORPUS_MOVE_EXPONENT(game->moves[i]);
+
+        i32 score = 0;
+        Packed_board moved = MoveWithTables(tables, board, direction, &score);
+        u32 empty = GetEmptyCells(moved);
+        if (moved == board || (empty & CELL_BIT(cell)) == 0) {
+            return false;
+        }
+
+        i32 rank = CountBits(empty & (CELL_BIT(cell) - 1));
+        moves[i] = CORPUS_MOVE(direction, rank, exponent);
+        board = moved | (exponent << (PACKED_TILE_BITS * cell));
+    }
+
+    u8 *header = block->raw + block->headerSize;
+    i64 headerSize = WriteVarint(header, ZigzagEncode((i64)(game->seed - block->previousSeed)));
+    headerSize += WriteVarint(header + headerSize, game->start);
+    headerSize += WriteVarint(header + headerSize, game->moveCount);
+
+    block->headerSize += headerSize;
+    block->moveCount += game->moveCount;
+    block->previousSeed = game->seed;
+    writer->header.moveCount += game->moveCount;
+
+    if (++block->gameCount == CORPUS_BLOCK_GAMES) {
+        if (writer->blockCount == writer->threadCount) {
+            FlushCorpusBlocks(writer);
+        } else {
+            ++writer->blockCount;
+        }
+    }
+
+    return true;
+}
+
+bool CloseCorpusWriter(Corpus_writer *writer) {
+    FlushCorpusBlocks(writer);
+
+    // Padded so the index can be read in place from the mapped file
+    static const u8 PADDING[sizeof(u64)] = {0};
+    u64 paddingSize = -writer->fileSize & (sizeof(u64) - 1);
+    writer->isOk &= paddingSize == 0 || fwrite(PADDING, paddingSize, 1, writer->file) == 1;
+
+    writer->header.indexOffset = writer->fileSize + paddingSize;
+    bool isOk = writer->isOk && (writer->header.blockCount == 0 ||
+        fwrite(writer->index, sizeof(Corpus_block_entry), writer->header.blockCount, writer->file) ==
+        writer->header.blockCount);
+
+    memcpy(writer->header.magic, CORPUS_MAGIC, sizeof(writer->header.magic));
+    isOk &= fseek(writer->file, 0, SEEK_SET) == 0;
+    isOk &= fwrite(&writer->header, sizeof(writer->header), 1, writer->file) == 1;
+    isOk &= fclose(writer->file) == 0;
+
+    for (i32 i = 0; i < writer->threadCount; ++i) {
+        TrackedFree(writer->blocks[i].raw, ALLOC_TAG_CORPUS);
+        TrackedFree(writer->blocks[i].moves, ALLOC_TAG_CORPUS);
+    }
+    TrackedFree(writer->index, ALLOC_TAG_CORPUS);
+    *writer = (Corpus_writer){0};
+
+    return isOk;
+}
+
+bool OpenCorpus(Corpus *corpus, const char *path) {
+    *corpus = (Corpus){0};
+    if (!MapFile(&corpus->file, path)) {
+        return false;
+    }
+
+    const Corpus_header *header = corpus->file.data;
+    u64 size = (u64)corpus->file.size;
+    if (size < sizeof(Corpus_header) || memcmp(header->magic, CORPUS_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != CORPUS_VERSION || header->blockGames == 0 || header->indexOffset % sizeof(u64) != 0 ||
+        header->indexOffset > size || header->blockCount > (size - header->indexOffset) / sizeof(Corpus_block_entry)) {
+        UnmapFile(&corpus->file);
+        return false;
+    }
+
+    corpus->header = header;
+    corpus->index = (const Corpus_block_entry *)((const u8 *)corpus->file.data + header->indexOffset);
+    for (u64 i = 0; i < header->blockCount; ++i) {
+        const Corpus_block_entry *entry = &corpus->index[i];
+        if (entry->offset + entry->compressedSize > header->indexOffset) {
+            CloseCorpus(corpus);
+            return false;
+        }
+        corpus->maxRawSize = entry->rawSize > corpus->maxRawSize ? entry->rawSize : corpus->maxRawSize;
+    }
+
+    return true;
+}
+
+void CloseCorpus(Corpus *corpus) {
+    UnmapFile(&corpus->file);
+    *corpus = (Corpus){0};
+}
+
+void InitCorpusBlock(Corpus_block *block, const Corpus *corpus) {
+    block->games = TrackedAlloc(corpus->header->blockGames * sizeof(Corpus_game), ALLOC_TAG_CORPUS);
+    block->capacity = corpus->maxRawSize > 0 ? corpus->maxRawSize : 1;
+    block->raw = TrackedAlloc(block->capacity, ALLOC_TAG_CORPUS);
+    block->moves = TrackedAlloc(block->capacity, ALLOC_TAG_CORPUS);
+    block->gameCount = 0;
+    block->blockIndex = -1;
+}
+
+void FreeCorpusBlock(Corpus_block *block) {
+    TrackedFree(block->games, ALLOC_TAG_CORPUS);
+    TrackedFree(block->raw, ALLOC_TAG_CORPUS);
+    TrackedFree(block->moves, ALLOC_TAG_CORPUS);
+    *block = (Corpus_block){0};
+}
+
+// Replays each game to turn the spawn ranks back into cells, which also checks them and works out the score
+static bool DecodeCorpusBlock(const Corpus_block_entry *entry, const u8 *raw, i64 rawSize, Corpus_block *block) {
+    const Move_tables_data *tables = GetMoveTables();
+    const u8 *cursor = raw;
+    const u8 *end = raw + rawSize;
+
+    u64 seed = 0;
+    i64 moveCount = 0;
+    for (u32 i = 0; i < entry->gameCount; ++i) {
+        u64 seedDelta, start, gameMoves;
+        if (!ReadVarint(&cursor, end, &seedDelta) || !ReadVarint(&cursor, end, &start) ||
+            !ReadVarint(&cursor, end, &gameMoves) || gameMoves > (u64)(rawSize - moveCount)) {
+            return false;
+        }
+
+        seed += (u64)ZigzagDecode(seedDelta);
+        block->games[i] = (Corpus_game){.seed = seed, .start = start, .moveCount = (u32)gameMoves};
+        moveCount += (i64)gameMoves;
+    }
+
+    if (end - cursor != moveCount || moveCount > block->capacity) {
+        return false;
+    }
+
+    u8 *moves = block->moves;
+    for (u32 i = 0; i < entry->gameCount; ++i) {
+        Corpus_game *game = &block->games[i];
+        game->moves = moves;
+
+        Packed_board board = game->start;
+        for (u32 j = 0; j < game->moveCount; ++j) {
+            u8 code = *cursor++;
+            Direction direction = CORPUS_MOVE_DIRECTION(code);
+            i32 rank = CORPUS_MOVE_CELL(code);
+            u64 exponent = CORPUS_MOVE_EXPONENT(code);
+
+            Packed_board moved = MoveWithTables(tables, board, direction, &game->score);
+            u32 empty = GetEmptyCells(moved);
+            if (moved == board || rank >= CountBits(empty)) {
+                return false;
+            }
+
+            for (i32 k = 0; k < rank; ++k) {
+                empty &= empty - 1;
+            }
+            i32 cell = 0;
+            while ((empty & CELL_BIT(cell)) == 0) {
+                ++cell;
+            }
+
+            *moves++ = CORPUS_MOVE(direction, cell, exponent);
+            board = moved | (exponent << (PACKED_TILE_BITS * cell));
+        }
+    }
+
+    block->gameCount = (i32)entry->gameCount;
+    return true;
+}
+
+bool ReadCorpusBlock(const Corpus *corpus, i64 blockIndex, Corpus_block *block) {
+    block->blockIndex = -1;
+    if (blockIndex < 0 || (u64)blockIndex >= corpus->header->blockCount) {
+        return false;
+    }
+
+    const Corpus_block_entry *entry = &corpus->index[blockIndex];
+    const u8 *compressed = (const u8 *)corpus->file.data + entry->offset;
+    if (entry->gameCount > corpus->header->blockGames ||
+        GetCorpusChecksum(compressed, entry->compressedSize) != entry->checksum) {
+        return false;
+    }
+
+    i64 rawSize = DecompressDataInto(compressed, entry->compressedSize, block->raw, block->capacity);
+    bool isOk = rawSize == entry->rawSize && DecodeCorpusBlock(entry, block->raw, rawSize, block);
+
+    block->blockIndex = isOk ? blockIndex : -1;
+    return isOk;
+}
+
+bool ReadCorpusGame(const Corpus *corpus, u64 gameId, Corpus_block *block, Corpus_game *game) {
+    if (gameId >= corpus->header->gameCount) {
+        return false;
+    }
+
+    // Every block but the last is full
+    i64 blockIndex = (i64)(gameId / corpus->header->blockGames);
+    if (block->blockIndex != blockIndex && !ReadCorpusBlock(corpus, blockIndex, block)) {
+        return false;
+    }
+
+    u64 blockGame = gameId - corpus->index[blockIndex].firstGame;
+    if (blockGame >= (u64)block->gameCount) {
+        return false;
+    }
+
+    *game = block->games[blockGame];
+    return true;
+}
+
+// A random game with the GUI's rules, moves recorded as CORPUS_MOVE. moves has room for CORPUS_BENCHMARK_MAX_MOVES.
+static void PlayCorpusGame(u64 seed, u8 *moves, Corpus_game *game) {
+    const Move_tables_data *tables = GetMoveTables();
+    Rng rng = CreateRng(seed);
+    Board board;
+    ResetBoard(&board, &rng);
+
+    *game = (Corpus_game){.seed = seed, .start = PackBoard(&board), .moves = moves};
+    Packed_board packed = game->start;
+
+    while (GetPackedMaxTile(packed) < (i32)CORPUS_STOP_TILE && game->moveCount < CORPUS_BENCHMARK_MAX_MOVES) {
+        Packed_board moved[DIRECTION_COUNT];
+        i32 scores[DIRECTION_COUNT] = {0};
+        Direction legalMoves[DIRECTION_COUNT];
+        i32 legalCount = 0;
+        for (i32 direction = 0; direction < DIRECTION_COUNT; ++direction) {
+            moved[direction] = MoveWithTables(tables, packed, direction, &scores[direction]);
+            if (moved[direction] != packed) {
+                legalMoves[legalCount++] = direction;
+            }
+        }
+
+        if (legalCount == 0) {
+            break;
+        }
+
+        Direction direction = legalMoves[RandomRange(&rng, 0, legalCount - 1)];
+        game->score += scores[direction];
+        board = UnpackBoard(moved[direction]);
+        i32 cell = SpawnTile(&board, &rng);
+        moves[game->moveCount++] = CORPUS_MOVE(direction, cell, board.board[cell]);
+        packed = PackBoard(&board);
+    }
+}
+
+static void RunCorpusReadWorker(void *data) {
+    Corpus_read_worker *worker = data;
+    i64 blockCount = (i64)worker->corpus->header->blockCount;
+
+    for (;;) {
+        i64 blockIndex = AtomicAddI64(worker->nextBlock, 1) - 1;
+        if (blockIndex >= blockCount) {
+            break;
+        }
+
+        if (!ReadCorpusBlock(worker->corpus, blockIndex, &worker->block)) {
+            worker->isOk = false;
+            continue;
+        }
+
+        for (i32 i = 0; i < worker->block.gameCount; ++i) {
+            worker->scoreSum += worker->block.games[i].score;
+            worker->moveCount += worker->block.games[i].moveCount;
+        }
+        worker->gameCount += worker->block.gameCount;
+    }
+}
+
+i32 RunCorpusBenchmark(const char *path, i64 gameCount, i32 threadCount, u64 firstSeed) {
+    gameCount = gameCount > 0 ? gameCount : CORPUS_DEFAULT_GAMES;
+    threadCount = MinI32(threadCount > 0 ? threadCount : GetProcessorCount(), CORPUS_MAX_THREADS);
+
+    FILE *existing = fopen(path, "rb");
+    if (existing != NULL) {
+        fclose(existing);
+        fprintf(stderr, "%s already exists, benchmark a path that doesn't\n", path);
+        return 1;
+    }
+
+    Corpus_writer writer;
+    if (!OpenCorpusWriter(&writer, path, threadCount)) {
+        fprintf(stderr, "Could not create %s\n", path);
+        return 1;
+    }
+
+    u8 *moves = TrackedAlloc(CORPUS_BENCHMARK_MAX_MOVES, ALLOC_TAG_CORPUS);
+    i64 scoreSum = 0;
+    f64 playTime = 0.0;
+    f64 start = GetWallTime();
+    bool isOk = true;
+    for (i64 i = 0; i < gameCount && isOk; ++i) {
+        f64 playStart = GetWallTime();
+        Corpus_game game;
+        PlayCorpusGame(firstSeed + i, moves, &game);
+        playTime += GetWallTime() - playStart;
+
+        scoreSum += game.score;
+        isOk = AddCorpusGame(&writer, &game);
+    }
+    i64 moveCount = (i64)writer.header.moveCount;
+    isOk &= CloseCorpusWriter(&writer);
+    f64 writeTime = GetWallTime() - start - playTime;
+    TrackedFree(moves, ALLOC_TAG_CORPUS);
+
+    Corpus corpus;
+    if (!isOk || !OpenCorpus(&corpus, path)) {
+        fprintf(stderr, "Writing %s failed\n", path);
+        return 1;
+    }
+
+    f64 bytesPerMove = (f64)corpus.file.size / (moveCount > 0 ? moveCount : 1);
+    printf("%lld games, %lld moves in %llu blocks: %.1f MB, %.3f bytes per move\n", (long long)gameCount,
+        (long long)moveCount, (unsigned long long)corpus.header->blockCount, corpus.file.size / 1e6, bytesPerMove);
+    printf("Against a Board per move (%d bytes): %.0fx smaller, a Packed_board and a direction (9 bytes): %.0fx\n",
+        (i32)sizeof(Board), sizeof(Board) / bytesPerMove, 9.0 / bytesPerMove);
+    printf("Write on %d threads: %.0f games/s (playing the games took another %.2f s)\n", threadCount,
+        gameCount / writeTime, playTime);
+
+    // Everything is allocated up front, the allocator isn't for use from several threads at once
+    Corpus_read_worker workers[CORPUS_MAX_THREADS];
+    volatile i64 nextBlock = 0;
+    for (i32 i = 0; i < threadCount; ++i) {
+        workers[i] = (Corpus_read_worker){.corpus = &corpus, .nextBlock = &nextBlock, .isOk = true};
+        InitCorpusBlock(&workers[i].block, &corpus);
+    }
+
+    Thread threads[CORPUS_MAX_THREADS];
+    start = GetWallTime();
+    for (i32 i = 1; i < threadCount; ++i) {
+        StartThread(&threads[i], &RunCorpusReadWorker, &workers[i]);
+    }
+    RunCorpusReadWorker(&workers[0]);
+    for (i32 i = 1; i < threadCount; ++i) {
+        JoinThread(&threads[i]);
+    }
+    f64 readTime = GetWallTime() - start;
+
+    i64 readGames = 0;
+    i64 readMoves = 0;
+    i64 readScoreSum = 0;
+    for (i32 i = 0; i < threadCount; ++i) {
+        readGames += workers[i].gameCount;
+        readMoves += workers[i].moveCount;
+        readScoreSum += workers[i].scoreSum;
+        isOk &= workers[i].isOk;
+    }
+    isOk &= readGames == gameCount && readMoves == moveCount && readScoreSum == scoreSum;
+
+    printf("Decode on %d threads: %.0f games/s, %.1f M moves/s%s\n", threadCount, readGames / readTime,
+        readMoves / readTime / 1e6, isOk ? "" : " (MISMATCH)");
+
+    // Random access, where nearly every game is in a different block
+    Rng rng = CreateRng(firstSeed);
+    start = GetWallTime();
+    for (i32 i = 0; i < CORPUS_BENCHMARK_LOOKUPS; ++i) {
+        Corpus_game game;
+        isOk &= ReadCorpusGame(&corpus, NextRandom(&rng) % corpus.header->gameCount, &workers[0].block, &game);
+    }
+    printf("Random game by id: %.1f us\n", (GetWallTime() - start) / CORPUS_BENCHMARK_LOOKUPS * 1e6);
+
+    for (i32 i = 0; i < threadCount; ++i) {
+        FreeCorpusBlock(&workers[i].block);
+    }
+    CloseCorpus(&corpus);
+
+    return isOk ? 0 : 1;
+}
+
+i32 RunCorpusGame(const char *path, u64 gameId) {
+    Corpus corpus;
+    if (!OpenCorpus(&corpus, path)) {
+        fprintf(stderr, "Could not open %s, or it isn't a corpus\n", path);
+        return 1;
+    }
+
+    Corpus_block block;
+    InitCorpusBlock(&block, &corpus);
+
+    Corpus_game game;
+    bool isFound = ReadCorpusGame(&corpus, gameId, &block, &game);
+    if (isFound) {
+        const char DIRECTION_LETTERS[DIRECTION_COUNT] = {'U', 'D', 'L', 'R'};
+        printf("Game %llu: seed %llu, score %d, %u moves\n", (unsigned long long)gameId,
+            (unsigned long long)game.seed, game.score, game.moveCount);
+        for (u32 i = 0; i < game.moveCount; ++i) {
+            putchar(DIRECTION_LETTERS[CORPUS_MOVE_DIRECTION(game.moves[i])]);
+        }
+        putchar('\n');
+    } else {
+        fprintf(stderr, "%s has %llu games, %llu isn't one of them or its block is damaged\n", path,
+            (unsigned long long)corpus.header->gameCount, (unsigned long long)gameId);
+    }
+
+    FreeCorpusBlock(&block);
+    CloseCorpus(&corpus);
+
+    return isFound ? 0 : 1;
+}
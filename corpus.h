@@ -0,0 +1,129 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <stdio.h>
+
+#include "common.h"
+#include "board.h"
+#include "platform.h"
+
+#define CORPUS_MAGIC "R2048CRP"
+#define CORPUS_VERSION 1
+#define CORPUS_DEFAULT_PATH "corpus.bin"
+#define CORPUS_BLOCK_GAMES 256
+#define CORPUS_MAX_THREADS 64
+#define CORPUS_DEFAULT_GAMES 100000
+#define CORPUS_DEFAULT_SEED 1 // Of the benchmark's first game
+
+// A move and the spawn after it in a byte: the direction in the low 2 bits, the spawn's exponent less 1 in the next
+// and its cell in the 4 above that
+#define CORPUS_MOVE(direction, cell, exponent) (u8)((direction) | (((exponent) - 1) << 2) | ((cell) << 3))
+#define CORPUS_MOVE_DIRECTION(move) (Direction)((move) & 3)
+#define CORPUS_MOVE_EXPONENT(move) ((((move) >> 2) & 1) + 1)
+#define CORPUS_MOVE_CELL(move) ((move) >> 3)
+
+// Recorded games, far more than fit in memory, in blocks of CORPUS_BLOCK_GAMES compressed one at a time so any game
+// can be read without the others. A block holds its games' headers as varints (the seed as the difference from the
+// previous game's, zigzagged, then the starting board and the move count) and then all of their moves. Each move's
+// spawn cell is stored as its rank among the empty cells, which the decoder knows as it replays the game, so late in a
+// game it takes a few values only. The block is then DEFLATE compressed with raylib's CompressData, and read back with
+// DecompressDataInto (see inflate.h) straight into a Corpus_block's own buffer.
+//
+// The file is a Corpus_header, the compressed blocks and then a Corpus_block_entry per block, where the header's
+// indexOffset says. The header is written last, so a file whose writer didn't finish has no magic. Writing compresses
+// the blocks across threads, and reading decodes them across threads.
+
+typedef struct Corpus_header {
+    char magic[8];
+    u32 version;
+    u32 blockGames;
+    u64 gameCount;
+    u64 moveCount;
+    u64 blockCount;
+    u64 indexOffset;
+} Corpus_header;
+
+typedef struct Corpus_block_entry {
+    u64 offset;
+    u64 firstGame;
+    u32 gameCount;
+    u32 rawSize; // Before compression
+    u32 compressedSize;
+    u32 checksum; // Of the compressed bytes
+} Corpus_block_entry;
+
+typedef struct Corpus_game {
+    u64 seed; // 0 if the game didn't come from CreateRng
+    Packed_board start; // Before the first move
+    u32 moveCount;
+    i32 score; // Worked out when the game is read, the writer ignores it
+    const u8 *moves; // CORPUS_MOVE
+} Corpus_game;
+
+// The games of one block, whose moves live in the block's own buffer
+typedef struct Corpus_block {
+    Corpus_game *games;
+    u8 *raw; // Decompressed into
+    u8 *moves;
+    i64 capacity; // Of raw and moves, the largest block's raw size
+    i32 gameCount;
+    i64 blockIndex; // -1 before the first read
+} Corpus_block;
+
+typedef struct Corpus_pending_block {
+    u8 *raw; // Headers, then moves
+    u8 *moves; // Collected separately until the block is full
+    i64 headerSize;
+    i64 moveCount;
+    i32 gameCount;
+    u64 previousSeed;
+    u8 *compressed; // From CompressData
+    i32 compressedSize;
+    i32 rawSize;
+    bool isOk;
+} Corpus_pending_block;
+
+// Fills a block per thread, then compresses them all at once and writes them in order
+typedef struct Corpus_writer {
+    FILE *file;
+    Corpus_header header;
+    u64 fileSize; // Written so far, counted rather than asked for since ftell's long is 32 bits on Windows
+    Corpus_block_entry *index;
+    i64 indexCapacity;
+    Corpus_pending_block blocks[CORPUS_MAX_THREADS];
+    i32 threadCount;
+    i32 blockCount; // Filled or being filled
+    i64 moveCapacity; // Of each block's moves
+    bool isOk;
+} Corpus_writer;
+
+typedef struct Corpus {
+    Mapped_file file;
+    const Corpus_header *header;
+    const Corpus_block_entry *index;
+    i64 maxRawSize; // Of any block, which bounds its moves
+} Corpus;
+
+
+bool OpenCorpusWriter(Corpus_writer *writer, const char *path, i32 threadCount);
+// False if a move doesn't move the board or its spawn isn't on an empty cell. Assumes a 4x4 board.
+bool AddCorpusGame(Corpus_writer *writer, const Corpus_game *game);
+bool CloseCorpusWriter(Corpus_writer *writer);
+
+bool OpenCorpus(Corpus *corpus, const char *path);
+void CloseCorpus(Corpus *corpus);
+
+// Has room for the largest block of the corpus, so reading into it never allocates and can happen on any thread
+void InitCorpusBlock(Corpus_block *block, const Corpus *corpus);
+void FreeCorpusBlock(Corpus_block *block);
+bool ReadCorpusBlock(const Corpus *corpus, i64 blockIndex, Corpus_block *block);
+// Reads the game's block unless it's the one already in block. game points into block.
+bool ReadCorpusGame(const Corpus *corpus, u64 gameId, Corpus_block *block, Corpus_game *game);
+
+// Writes gameCount random games from firstSeed, then decodes the whole corpus and prints bytes per move, the
+// compression against storing the boards and the write and decode rates. Refuses to overwrite an existing file.
+i32 RunCorpusBenchmark(const char *path, i64 gameCount, i32 threadCount, u64 firstSeed);
+// Prints a game's seed, score and moves
+i32 RunCorpusGame(const char *path, u64 gameId);
+
+#endif
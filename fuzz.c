@@ -0,0 +1,313 @@
+#include <stdio.h>
+
+#include "board.h"
+#include "fuzz.h"
+#include "move_tables.h"
+#include "platform.h"
+
+#define FUZZ_MAX_THREADS 64
+#define FUZZ_BATCH_SIZE 4096 // Boards between checks of the shared state
+#define FUZZ_PROGRESS_INTERVAL 5.0
+
+
+typedef struct Move_engine {
+    const char *name;
+    Packed_board (*move)(Packed_board board, Direction direction, i32 *score);
+} Move_engine;
+
+static const Move_engine MOVE_ENGINES[] = {
+    {"packed", &MovePackedBoard},
+    {"tables", &MovePackedBoardWithTables}
+};
+
+#define MOVE_ENGINE_COUNT (i32)(sizeof(MOVE_ENGINES) / sizeof(MOVE_ENGINES[0]))
+
+typedef enum Fuzz_generator {
+    FUZZ_GENERATOR_UNIFORM,    // Any exponent anywhere
+    FUZZ_GENERATOR_SPARSE,     // Mostly empty, so tiles slide far
+    FUZZ_GENERATOR_FEW_VALUES, // Long runs of equal tiles, which is where the one-merge rule matters
+    FUZZ_GENERATOR_HIGH_TILES, // Right below the largest exponent a Packed_board holds
+    FUZZ_GENERATOR_PLAYOUT,    // Positions from random games
+    FUZZ_GENERATOR_COUNT
+} Fuzz_generator;
+
+static const char *const FUZZ_GENERATOR_NAMES[FUZZ_GENERATOR_COUNT] = {
+    [FUZZ_GENERATOR_UNIFORM] = "uniform",
+    [FUZZ_GENERATOR_SPARSE] = "sparse",
+    [FUZZ_GENERATOR_FEW_VALUES] = "few values",
+    [FUZZ_GENERATOR_HIGH_TILES] = "high tiles",
+    [FUZZ_GENERATOR_PLAYOUT] = "playout"
+};
+
+typedef struct Mismatch {
+    Board board;
+    Direction direction;
+    i32 engine;
+    Fuzz_generator generator;
+} Mismatch;
+
+typedef struct Fuzz_worker {
+    i64 boardCount;
+    Rng rng;
+
+    Board playout;
+    Rng playoutRng;
+
+    volatile i32 *isMismatchFound;
+    volatile i64 *boardsChecked;
+
+    i64 skippedCount; // Moves whose result doesn't fit in a Packed_board
+    bool hasMismatch;
+    Mismatch mismatch;
+} Fuzz_worker;
+
+
+static void GenerateBoard(Fuzz_worker *worker, Fuzz_generator generator, Board *board) {
+    Rng *rng = &worker->rng;
+
+    switch (generator) {
+        case FUZZ_GENERATOR_UNIFORM: {
+            for (i32 i = 0; i < TILE_COUNT; ++i) {
+                board->board[i] = RandomRange(rng, 0, PACKED_TILE_MASK);
+            }
+        } break;
+        case FUZZ_GENERATOR_SPARSE: {
+            for (i32 i = 0; i < TILE_COUNT; ++i) {
+                board->board[i] = RandomRange(rng, 0, 3) == 0 ? RandomRange(rng, 1, PACKED_TILE_MASK) : 0;
+            }
+        } break;
+        case FUZZ_GENERATOR_FEW_VALUES: {
+            i32 values[3] = {0, RandomRange(rng, 1, PACKED_TILE_MASK), RandomRange(rng, 1, PACKED_TILE_MASK)};
+            for (i32 i = 0; i < TILE_COUNT; ++i) {
+                board->board[i] = values[RandomRange(rng, 0, 2)];
+            }
+        } break;
+        case FUZZ_GENERATOR_HIGH_TILES: {
+            for (i32 i = 0; i < TILE_COUNT; ++i) {
+                i32 value = RandomRange(rng, PACKED_TILE_MASK - 3, PACKED_TILE_MASK);
+                board->board[i] = value == PACKED_TILE_MASK - 3 ? 0 : value;
+            }
+        } break;
+        case FUZZ_GENERATOR_PLAYOUT: {
+            Successors successors;
+            ComputeSuccessors(&worker->playout, &successors, false);
+
+            Direction direction;
+            do {
+                direction = RandomRange(rng, 0, DIRECTION_COUNT - 1);
+            } while (successors.canMove && !successors.moves[direction].didMove);
+
+            if (successors.canMove && CanPackBoard(&successors.moves[direction].board)) {
+                worker->playout = successors.moves[direction].board;
+                SpawnTile(&worker->playout, &worker->playoutRng);
+            } else {
+                ResetBoard(&worker->playout, &worker->playoutRng);
+            }
+
+            *board = worker->playout;
+        } break;
+        default: break;
+    }
+}
+
+typedef enum Check_result {
+    CHECK_MATCH,
+    CHECK_MISMATCH,
+    CHECK_SKIPPED
+} Check_result;
+
+static Check_result CheckMove(const Board *board, Direction direction, i32 engine) {
+    Board expected = *board;
+    i32 expectedScore = 0;
+    bool didMove = MoveBoard(&expected, direction, &expectedScore, NULL);
+    if (!CanPackBoard(&expected)) {
+        return CHECK_SKIPPED;
+    }
+
+    Packed_board packed = PackBoard(board);
+    i32 score = 0;
+    Packed_board result = MOVE_ENGINES[engine].move(packed, direction, &score);
+
+    if (result != PackBoard(&expected) || score != expectedScore || (result != packed) != didMove) {
+        return CHECK_MISMATCH;
+    }
+
+    return CHECK_MATCH;
+}
+
+static void RunFuzzWorker(void *data) {
+    Fuzz_worker *worker = data;
+
+    for (i64 done = 0; done < worker->boardCount; done += FUZZ_BATCH_SIZE) {
+        if (AtomicLoadI32(worker->isMismatchFound)) {
+            return;
+        }
+
+        i64 batchSize = worker->boardCount - done < FUZZ_BATCH_SIZE ? worker->boardCount - done : FUZZ_BATCH_SIZE;
+        for (i64 i = 0; i < batchSize; ++i) {
+            Fuzz_generator generator = (done + i) % FUZZ_GENERATOR_COUNT;
+            Board board;
+            GenerateBoard(worker, generator, &board);
+
+            for (i32 engine = 0; engine < MOVE_ENGINE_COUNT; ++engine) {
+                for (i32 direction = 0; direction < DIRECTION_COUNT; ++direction) {
+                    Check_result result = CheckMove(&board, direction, engine);
+                    worker->skippedCount += result == CHECK_SKIPPED;
+
+                    if (result == CHECK_MISMATCH) {
+                        worker->hasMismatch = true;
+                        worker->mismatch = (Mismatch){board, direction, engine, generator};
+                        AtomicStoreI32(worker->isMismatchFound, 1);
+                        return;
+                    }
+                }
+            }
+        }
+
+        AtomicAddI64(worker->boardsChecked, batchSize);
+    }
+}
+
+// Greedily empties and lowers tiles for as long as the mismatch survives. Equal tiles usually have to stay equal,
+// so lowering all of them at once is tried too.
+static void ShrinkMismatch(Mismatch *mismatch) {
+    bool didShrink = true;
+    while (didShrink) {
+        didShrink = false;
+
+        Board lowered = mismatch->board;
+        bool canLower = true;
+        for (i32 i = 0; i < TILE_COUNT; ++i) {
+            canLower &= lowered.board[i] != 1;
+            lowered.board[i] -= lowered.board[i] > 0;
+        }
+        if (canLower && CheckMove(&lowered, mismatch->direction, mismatch->engine) == CHECK_MISMATCH) {
+            mismatch->board = lowered;
+            didShrink = true;
+            continue;
+        }
+
+        for (i32 i = 0; i < TILE_COUNT; ++i) {
+            i32 original = mismatch->board.board[i];
+
+            for (i32 value = 0; value < original; ++value) {
+                mismatch->board.board[i] = value;
+                if (CheckMove(&mismatch->board, mismatch->direction, mismatch->engine) == CHECK_MISMATCH) {
+                    didShrink = true;
+                    break;
+                }
+                mismatch->board.board[i] = original;
+            }
+        }
+    }
+}
+
+static void PrintBoard(const char *name, const Board *board) {
+    printf("    .%s = {", name);
+    for (i32 i = 0; i < TILE_COUNT; ++i) {
+        printf(i % TILE_COUNT_X == 0 ? "\n        " : " ");
+        printf("%2d,", board->board[i]);
+    }
+    printf("\n    },\n");
+}
+
+static void PrintMismatch(const Mismatch *mismatch) {
+    Board expected = mismatch->board;
+    i32 expectedScore = 0;
+    MoveBoard(&expected, mismatch->direction, &expectedScore, NULL);
+
+    i32 score = 0;
+    Board actual = UnpackBoard(MOVE_ENGINES[mismatch->engine].move(PackBoard(&mismatch->board), mismatch->direction, 
+        &score));
+
+    printf("Engine \"%s\" disagrees with MoveBoard (found by the %s generator, shrunk):\n", 
+        MOVE_ENGINES[mismatch->engine].name, FUZZ_GENERATOR_NAMES[mismatch->generator]);
+    printf("{\n");
+    PrintBoard("board", &mismatch->board);
+    printf("    .direction = DIRECTION_%s,\n", GetDirectionName(mismatch->direction));
+    PrintBoard("expected", &expected);
+    printf("    .expectedScore = %d,\n", expectedScore);
+    printf("},\n");
+    printf("// The engine gave score %d and\n", score);
+    for (i32 y = 0; y < TILE_COUNT_Y; ++y) {
+        printf("//  ");
+        for (i32 x = 0; x < TILE_COUNT_X; ++x) {
+            printf(" %2d", actual.board[y * TILE_COUNT_X + x]);
+        }
+        printf("\n");
+    }
+}
+
+i32 RunFuzzer(i64 boardCount, i32 threadCount, u64 seed) {
+    if (threadCount <= 0) {
+        threadCount = GetProcessorCount();
+    }
+    threadCount = MinI32(threadCount, FUZZ_MAX_THREADS);
+
+    printf("Fuzzing %d engine(s) with %lld boards on %d threads, seed %llu\n", MOVE_ENGINE_COUNT, 
+        (long long)boardCount, threadCount, (unsigned long long)seed);
+
+    volatile i32 isMismatchFound = 0;
+    volatile i64 boardsChecked = 0;
+
+    Thread threads[FUZZ_MAX_THREADS];
+    Fuzz_worker workers[FUZZ_MAX_THREADS];
+    Rng seeder = CreateRng(seed);
+
+    for (i32 i = 0; i < threadCount; ++i) {
+        workers[i] = (Fuzz_worker){
+            .boardCount = boardCount / threadCount + (i < boardCount % threadCount),
+            .rng = CreateRng(NextRandom(&seeder)),
+            .playoutRng = CreateRng(NextRandom(&seeder)),
+            .isMismatchFound = &isMismatchFound,
+            .boardsChecked = &boardsChecked
+        };
+        ResetBoard(&workers[i].playout, &workers[i].playoutRng);
+    }
+
+    f64 start = GetWallTime();
+    for (i32 i = 0; i < threadCount; ++i) {
+        StartThread(&threads[i], &RunFuzzWorker, &workers[i]);
+    }
+
+    f64 lastProgress = start;
+    while (true) {
+        i64 checked = AtomicAddI64(&boardsChecked, 0);
+        if (checked >= boardCount || AtomicLoadI32(&isMismatchFound)) {
+            break;
+        }
+
+        f64 now = GetWallTime();
+        if (now - lastProgress >= FUZZ_PROGRESS_INTERVAL) {
+            printf("%lld boards, %.0f boards/s\n", (long long)checked, checked / (now - start));
+            fflush(stdout);
+            lastProgress = now;
+        }
+
+        SleepSeconds(0.05);
+    }
+
+    for (i32 i = 0; i < threadCount; ++i) {
+        JoinThread(&threads[i]);
+    }
+
+    f64 elapsed = GetWallTime() - start;
+    i64 skippedCount = 0;
+    for (i32 i = 0; i < threadCount; ++i) {
+        skippedCount += workers[i].skippedCount;
+    }
+
+    for (i32 i = 0; i < threadCount; ++i) {
+        if (workers[i].hasMismatch) {
+            Mismatch mismatch = workers[i].mismatch;
+            ShrinkMismatch(&mismatch);
+            PrintMismatch(&mismatch);
+            return 1;
+        }
+    }
+
+    printf("No mismatches in %lld boards (%.0f boards/s), %lld moves skipped for making a 65536 tile\n", 
+        (long long)boardsChecked, boardsChecked / elapsed, (long long)skippedCount);
+
+    return 0;
+}
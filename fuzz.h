@@ -0,0 +1,12 @@
+#ifndef FUZZ_H
+#define FUZZ_H
+
+#include "common.h"
+
+// Differential testing of the move engines. MoveBoard, which the game uses, is the reference and every other engine
+// must produce exactly the same boards and scores. Boards come from several generators, from uniform noise to
+// real playouts, and are spread across threads. The first mismatch found is shrunk to a minimal board and printed
+// as a test case.
+i32 RunFuzzer(i64 boardCount, i32 threadCount, u64 seed);
+
+#endif
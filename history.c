@@ -0,0 +1,260 @@
+#include "allocator.h"
+#include "history.h"
+
+
+static History_entry *GetEntry(History *history, i32 index) {
+    return &history->entries[(history->start + index) % history->capacity];
+}
+
+static bool GrowHistory(History *history, i32 minCapacity) {
+    if (history->capacity >= minCapacity) {
+        return true;
+    }
+
+    i32 capacity = MaxI32(history->capacity, HISTORY_INITIAL_CAPACITY);
+    while (capacity < minCapacity) {
+        capacity *= 2;
+    }
+    capacity = MinI32(capacity, HISTORY_MAX_IN_MEMORY);
+
+    History_entry *entries = TrackedAlloc(capacity * sizeof(History_entry), ALLOC_TAG_HISTORY);
+    if (entries == NULL) {
+        return false;
+    }
+
+    for (i32 i = 0; i < history->count; ++i) {
+        entries[i] = *GetEntry(history, i);
+    }
+
+    TrackedFree(history->entries, ALLOC_TAG_HISTORY);
+    history->entries = entries;
+    history->capacity = capacity;
+    history->start = 0;
+
+    return true;
+}
+
+static bool WriteSpilled(History *history, i32 first, i32 count) {
+    if (history->spillFile == NULL) {
+        history->spillFile = tmpfile();
+        if (history->spillFile == NULL) {
+            return false;
+        }
+    }
+
+    if (fseek(history->spillFile, (history->windowStart + first) * (i64)sizeof(History_entry), SEEK_SET) != 0) {
+        return false;
+    }
+
+    for (i32 i = first; i < first + count; ++i) {
+        if (fwrite(GetEntry(history, i), sizeof(History_entry), 1, history->spillFile) != 1) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool ReadSpilled(History *history, i64 globalIndex, i32 first, i32 count) {
+    if (fseek(history->spillFile, globalIndex * (i64)sizeof(History_entry), SEEK_SET) != 0) {
+        return false;
+    }
+
+    for (i32 i = first; i < first + count; ++i) {
+        if (fread(GetEntry(history, i), sizeof(History_entry), 1, history->spillFile) != 1) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Makes sure every entry of the window is in the file as well, so any part of it can be dropped from memory
+static bool FlushWindow(History *history) {
+    i64 windowEnd = history->windowStart + history->count;
+    if (history->fileCount >= windowEnd) {
+        return true;
+    }
+
+    i32 first = history->fileCount - history->windowStart;
+    if (!WriteSpilled(history, first, history->count - first)) {
+        return false;
+    }
+
+    history->fileCount = windowEnd;
+
+    return true;
+}
+
+static void DropFront(History *history, i32 count) {
+    history->start = (history->start + count) % history->capacity;
+    history->windowStart += count;
+    history->count -= count;
+    history->cursor -= count;
+}
+
+static bool SlideBack(History *history) {
+    if (!FlushWindow(history)) {
+        return false;
+    }
+
+    i32 chunk = MinI32(history->windowStart, HISTORY_SPILL_CHUNK);
+
+    // The newest entries make room, they are in the file now
+    history->count = MinI32(history->count, HISTORY_MAX_IN_MEMORY - chunk);
+    if (!GrowHistory(history, history->count + chunk)) {
+        return false;
+    }
+
+    history->start = (history->start - chunk + history->capacity) % history->capacity;
+    history->windowStart -= chunk;
+    history->count += chunk;
+    history->cursor += chunk;
+
+    return ReadSpilled(history, history->windowStart, 0, chunk);
+}
+
+static bool SlideForward(History *history) {
+    i64 windowEnd = history->windowStart + history->count;
+    i32 chunk = MinI32(history->totalCount - windowEnd, HISTORY_SPILL_CHUNK);
+
+    // Anything past the window was flushed together with the window itself, so the front is safe to drop
+    i32 overflow = history->count + chunk - HISTORY_MAX_IN_MEMORY;
+    if (overflow > 0) {
+        DropFront(history, overflow);
+    }
+
+    if (!GrowHistory(history, history->count + chunk)) {
+        return false;
+    }
+
+    history->count += chunk;
+
+    return ReadSpilled(history, windowEnd, history->count - chunk, chunk);
+}
+
+static void RestoreEntry(History *history, Board *board, Rng *rng, i32 *score) {
+    History_entry *entry = GetEntry(history, history->cursor);
+    *board = UnpackBoard(entry->board);
+    *rng = (Rng){.state = entry->rng};
+    *score = entry->score;
+}
+
+void InitHistory(History *history) {
+    *history = (History){0};
+}
+
+void FreeHistory(History *history) {
+    TrackedFree(history->entries, ALLOC_TAG_HISTORY);
+
+    if (history->spillFile != NULL) {
+        fclose(history->spillFile);
+    }
+
+    *history = (History){0};
+}
+
+void ClearHistory(History *history) {
+    history->start = 0;
+    history->count = 0;
+    history->cursor = 0;
+    history->windowStart = 0;
+    history->totalCount = 0;
+    history->fileCount = 0;
+}
+
+bool PushHistory(History *history, const Board *board, const Rng *rng, i32 score) {
+    if (!CanPackBoard(board)) {
+        // Past the 32768 tile the board doesn't fit the packed format, so there is nothing valid to undo into anymore
+        ClearHistory(history);
+        return false;
+    }
+
+    if (history->count > 0) {
+        history->count = history->cursor + 1;
+    }
+    history->totalCount = history->windowStart + history->count;
+    if (history->fileCount > history->totalCount) {
+        history->fileCount = history->totalCount;
+    }
+
+    if (history->count == HISTORY_MAX_IN_MEMORY) {
+        if (!FlushWindow(history)) {
+            return false;
+        }
+        DropFront(history, HISTORY_SPILL_CHUNK);
+    }
+
+    if (!GrowHistory(history, history->count + 1)) {
+        return false;
+    }
+
+    *GetEntry(history, history->count) = (History_entry){
+        .board = PackBoard(board),
+        .rng = rng->state,
+        .score = score
+    };
+    history->cursor = history->count;
+    ++history->count;
+    ++history->totalCount;
+
+    return true;
+}
+
+i64 GetHistoryLength(const History *history) {
+    return history->count > 0 ? history->windowStart + history->cursor + 1 : 0;
+}
+
+bool ReadHistoryEntries(History *history, History_entry *entries) {
+    // Everything before the window was flushed to the file before it was dropped
+    if (history->windowStart > 0) {
+        if (fseek(history->spillFile, 0, SEEK_SET) != 0 ||
+            fread(entries, sizeof(History_entry), history->windowStart, history->spillFile) != (size_t)history->windowStart) {
+            return false;
+        }
+    }
+
+    for (i32 i = 0; i <= history->cursor && i < history->count; ++i) {
+        entries[history->windowStart + i] = *GetEntry(history, i);
+    }
+
+    return true;
+}
+
+bool CanUndo(const History *history) {
+    return history->count > 0 && (history->cursor > 0 || history->windowStart > 0);
+}
+
+bool CanRedo(const History *history) {
+    return history->count > 0 && history->windowStart + history->cursor + 1 < history->totalCount;
+}
+
+bool UndoHistory(History *history, Board *board, Rng *rng, i32 *score) {
+    if (!CanUndo(history)) {
+        return false;
+    }
+
+    if (history->cursor == 0 && !SlideBack(history)) {
+        return false;
+    }
+
+    --history->cursor;
+    RestoreEntry(history, board, rng, score);
+
+    return true;
+}
+
+bool RedoHistory(History *history, Board *board, Rng *rng, i32 *score) {
+    if (!CanRedo(history)) {
+        return false;
+    }
+
+    if (history->cursor == history->count - 1 && !SlideForward(history)) {
+        return false;
+    }
+
+    ++history->cursor;
+    RestoreEntry(history, board, rng, score);
+
+    return true;
+}
@@ -0,0 +1,58 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdio.h>
+
+#include "common.h"
+#include "board.h"
+
+#define HISTORY_INITIAL_CAPACITY 256
+#define HISTORY_MAX_IN_MEMORY 65536 // Entries beyond this are spilled to disk, oldest first
+#define HISTORY_SPILL_CHUNK (HISTORY_MAX_IN_MEMORY / 2)
+
+
+// The position right after a move and its spawn. Restoring rng too means that replaying from an entry gives the
+// same spawns as the first time.
+typedef struct History_entry {
+    Packed_board board;
+    u64 rng;
+    i32 score;
+} History_entry;
+
+// A growable ring holding a window of the game's entries, entries[(start + i) % capacity] being entry windowStart + i.
+// cursor is the window index of the entry currently on the board, everything after it can be redone. Once the window
+// reaches HISTORY_MAX_IN_MEMORY entries the oldest ones only live in a temporary file, and undo/redo read chunks
+// back in when they get to the edge of the window.
+typedef struct History {
+    History_entry *entries;
+    i32 capacity;
+    i32 start;
+    i32 count;
+    i32 cursor;
+
+    i64 windowStart;
+    i64 totalCount; // Including redo entries that are currently only in the file
+    FILE *spillFile;
+    i64 fileCount; // Entries [0, fileCount) are up to date in spillFile
+} History;
+
+
+void InitHistory(History *history);
+void FreeHistory(History *history);
+void ClearHistory(History *history);
+
+// Drops everything that could have been redone
+bool PushHistory(History *history, const Board *board, const Rng *rng, i32 score);
+
+bool UndoHistory(History *history, Board *board, Rng *rng, i32 *score);
+bool RedoHistory(History *history, Board *board, Rng *rng, i32 *score);
+
+// The entries from the start of the game up to the current one, oldest first. Spilled entries are read back from
+// the file, so this is for the end of a game rather than every frame.
+i64 GetHistoryLength(const History *history);
+bool ReadHistoryEntries(History *history, History_entry *entries); // GetHistoryLength of them
+
+bool CanUndo(const History *history);
+bool CanRedo(const History *history);
+
+#endif
@@ -0,0 +1,322 @@
+#include <string.h>
+
+#include "inflate.h"
+
+#define INFLATE_MAX_BITS 15
+#define INFLATE_FAST_BITS 10 // Codes up to this long are decoded with a single table lookup
+#define INFLATE_LITERAL_COUNT 288
+#define INFLATE_DISTANCE_COUNT 30
+#define INFLATE_CODE_LENGTH_COUNT 19
+#define INFLATE_END_OF_BLOCK 256
+
+
+// A canonical Huffman code, see RFC 1951 3.2.2
+typedef struct Inflate_huffman {
+    u16 fast[1 << INFLATE_FAST_BITS]; // Indexed by the next bits: symbol << 4 | code length, 0 if the code is longer
+    u16 counts[INFLATE_MAX_BITS + 1]; // Codes of each length
+    u16 symbols[INFLATE_LITERAL_COUNT]; // Ordered by code
+} Inflate_huffman;
+
+// DEFLATE packs bits starting from the least significant one of each byte
+typedef struct Inflate_reader {
+    const u8 *cursor;
+    const u8 *end;
+    u64 bits;
+    i32 bitCount;
+    i32 overrun; // Zero bits made up past the end of the data
+} Inflate_reader;
+
+static const u16 LENGTH_BASES[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const u8 LENGTH_EXTRA_BITS[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const u16 DISTANCE_BASES[INFLATE_DISTANCE_COUNT] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577
+};
+static const u8 DISTANCE_EXTRA_BITS[INFLATE_DISTANCE_COUNT] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static const u8 CODE_LENGTH_ORDER[INFLATE_CODE_LENGTH_COUNT] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+
+// Leaves at least 56 bits buffered, which is enough for a length and a distance with their extra bits. Past the end
+// of the data it makes up zeros, and counts them so that reading them can be caught.
+static void RefillBits(Inflate_reader *reader) {
+    if (reader->end - reader->cursor >= 8) {
+        u64 word;
+        memcpy(&word, reader->cursor, sizeof(word)); // Little-endian, like everything else this game reads and writes
+        reader->bits |= word << reader->bitCount;
+        i32 byteCount = (63 - reader->bitCount) >> 3;
+        reader->cursor += byteCount;
+        reader->bitCount += 8 * byteCount;
+        return;
+    }
+
+    while (reader->bitCount < 56) {
+        if (reader->cursor < reader->end) {
+            reader->bits |= (u64)*reader->cursor++ << reader->bitCount;
+        } else {
+            reader->overrun += 8;
+        }
+        reader->bitCount += 8;
+    }
+}
+
+static void DropBits(Inflate_reader *reader, i32 count) {
+    reader->bits >>= count;
+    reader->bitCount -= count;
+}
+
+static u32 ReadBits(Inflate_reader *reader, i32 count) {
+    if (reader->bitCount < count) {
+        RefillBits(reader);
+    }
+
+    u32 value = (u32)(reader->bits & ((1ull << count) - 1));
+    DropBits(reader, count);
+    return value;
+}
+
+// False if the lengths describe more codes than there are, fewer is allowed (a block may use a single distance)
+static bool BuildHuffman(Inflate_huffman *huffman, const u8 *lengths, i32 count) {
+    memset(huffman->counts, 0, sizeof(huffman->counts));
+    for (i32 i = 0; i < count; ++i) {
+        ++huffman->counts[lengths[i]];
+    }
+    huffman->counts[0] = 0;
+
+    i32 left = 1;
+    u16 offsets[INFLATE_MAX_BITS + 1] = {0};
+    for (i32 length = 1; length <= INFLATE_MAX_BITS; ++length) {
+        left = 2 * left - huffman->counts[length];
+        if (left < 0) {
+            return false;
+        }
+        if (length < INFLATE_MAX_BITS) {
+            offsets[length + 1] = offsets[length] + huffman->counts[length];
+        }
+    }
+
+    for (i32 i = 0; i < count; ++i) {
+        if (lengths[i] != 0) {
+            huffman->symbols[offsets[lengths[i]]++] = (u16)i;
+        }
+    }
+
+    // Codes are sent most significant bit first, so the table is indexed by them reversed
+    memset(huffman->fast, 0, sizeof(huffman->fast));
+    u32 code = 0;
+    i32 index = 0;
+    for (i32 length = 1; length <= INFLATE_MAX_BITS; ++length) {
+        for (i32 i = 0; i < huffman->counts[length]; ++i, ++code) {
+            u16 symbol = huffman->symbols[index++];
+            if (length > INFLATE_FAST_BITS) {
+                continue;
+            }
+
+            u32 reversed = 0;
+            for (i32 bit = 0; bit < length; ++bit) {
+                reversed |= ((code >> bit) & 1) << (length - 1 - bit);
+            }
+            for (u32 fill = reversed; fill < (1u << INFLATE_FAST_BITS); fill += 1u << length) {
+                huffman->fast[fill] = (u16)(symbol << 4 | length);
+            }
+        }
+        code <<= 1;
+    }
+
+    return true;
+}
+
+// -1 for a code that isn't in the table. Needs INFLATE_MAX_BITS bits buffered.
+static i32 DecodeSymbol(Inflate_reader *reader, const Inflate_huffman *huffman) {
+    u32 entry = huffman->fast[reader->bits & ((1u << INFLATE_FAST_BITS) - 1)];
+    if (entry != 0) {
+        DropBits(reader, entry & 15);
+        return entry >> 4;
+    }
+
+    // The longer codes a bit at a time
+    i32 code = 0;
+    i32 first = 0;
+    i32 index = 0;
+    for (i32 length = 1; length <= INFLATE_MAX_BITS; ++length) {
+        code |= (reader->bits >> (length - 1)) & 1;
+        i32 count = huffman->counts[length];
+        if (code - count < first) {
+            DropBits(reader, length);
+            return huffman->symbols[index + code - first];
+        }
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+
+    return -1;
+}
+
+static void BuildFixedHuffman(Inflate_huffman *literals, Inflate_huffman *distances) {
+    u8 lengths[INFLATE_LITERAL_COUNT];
+    memset(lengths, 8, 144);
+    memset(lengths + 144, 9, 256 - 144);
+    memset(lengths + 256, 7, 280 - 256);
+    memset(lengths + 280, 8, INFLATE_LITERAL_COUNT - 280);
+    BuildHuffman(literals, lengths, INFLATE_LITERAL_COUNT);
+
+    memset(lengths, 5, INFLATE_DISTANCE_COUNT);
+    BuildHuffman(distances, lengths, INFLATE_DISTANCE_COUNT);
+}
+
+static bool ReadDynamicHuffman(Inflate_reader *reader, Inflate_huffman *literals, Inflate_huffman *distances) {
+    i32 literalCount = ReadBits(reader, 5) + 257;
+    i32 distanceCount = ReadBits(reader, 5) + 1;
+    i32 codeLengthCount = ReadBits(reader, 4) + 4;
+    if (literalCount > 286 || distanceCount > INFLATE_DISTANCE_COUNT) {
+        return false;
+    }
+
+    // The code lengths are themselves Huffman coded, with a code that borrows the distance table until it's needed
+    u8 codeLengths[INFLATE_CODE_LENGTH_COUNT] = {0};
+    for (i32 i = 0; i < codeLengthCount; ++i) {
+        codeLengths[CODE_LENGTH_ORDER[i]] = (u8)ReadBits(reader, 3);
+    }
+    if (!BuildHuffman(distances, codeLengths, INFLATE_CODE_LENGTH_COUNT)) {
+        return false;
+    }
+
+    u8 lengths[INFLATE_LITERAL_COUNT + INFLATE_DISTANCE_COUNT] = {0};
+    i32 totalCount = literalCount + distanceCount;
+    for (i32 index = 0; index < totalCount;) {
+        RefillBits(reader);
+        i32 symbol = DecodeSymbol(reader, distances);
+        if (symbol < 0) {
+            return false;
+        }
+        if (symbol < 16) {
+            lengths[index++] = (u8)symbol;
+            continue;
+        }
+
+        // 16 repeats the previous length, 17 and 18 are runs of zeros
+        u8 repeated = 0;
+        i32 repeatCount;
+        if (symbol == 16) {
+            if (index == 0) {
+                return false;
+            }
+            repeated = lengths[index - 1];
+            repeatCount = 3 + ReadBits(reader, 2);
+        } else if (symbol == 17) {
+            repeatCount = 3 + ReadBits(reader, 3);
+        } else {
+            repeatCount = 11 + ReadBits(reader, 7);
+        }
+
+        if (index + repeatCount > totalCount) {
+            return false;
+        }
+        memset(lengths + index, repeated, repeatCount);
+        index += repeatCount;
+    }
+
+    return lengths[INFLATE_END_OF_BLOCK] != 0 && BuildHuffman(literals, lengths, literalCount) &&
+        BuildHuffman(distances, lengths + literalCount, distanceCount);
+}
+
+static bool CopyStoredBlock(Inflate_reader *reader, u8 *output, i64 capacity, i64 *size) {
+    DropBits(reader, reader->bitCount & 7);
+    u32 length = ReadBits(reader, 16);
+    u32 lengthComplement = ReadBits(reader, 16);
+    if (length != (~lengthComplement & 0xFFFF) || length > capacity - *size) {
+        return false;
+    }
+
+    for (u32 i = 0; i < length; ++i) {
+        output[(*size)++] = (u8)ReadBits(reader, 8);
+    }
+
+    return true;
+}
+
+static bool InflateBlock(Inflate_reader *reader, const Inflate_huffman *literals, const Inflate_huffman *distances,
+    u8 *output, i64 capacity, i64 *size) {
+    i64 position = *size;
+    for (;;) {
+        RefillBits(reader);
+        i32 symbol = DecodeSymbol(reader, literals);
+        if (symbol < INFLATE_END_OF_BLOCK) {
+            if (symbol < 0 || position == capacity) {
+                return false;
+            }
+            output[position++] = (u8)symbol;
+            continue;
+        }
+        if (symbol == INFLATE_END_OF_BLOCK) {
+            break;
+        }
+
+        symbol -= INFLATE_END_OF_BLOCK + 1;
+        if (symbol >= 29) {
+            return false;
+        }
+        i32 length = LENGTH_BASES[symbol] + ReadBits(reader, LENGTH_EXTRA_BITS[symbol]);
+
+        i32 distanceSymbol = DecodeSymbol(reader, distances);
+        if (distanceSymbol < 0 || distanceSymbol >= INFLATE_DISTANCE_COUNT) {
+            return false;
+        }
+        i64 distance = DISTANCE_BASES[distanceSymbol] + ReadBits(reader, DISTANCE_EXTRA_BITS[distanceSymbol]);
+        if (distance > position || length > capacity - position) {
+            return false;
+        }
+
+        // Byte by byte, as the copy may overlap what it's writing
+        const u8 *from = output + position - distance;
+        u8 *to = output + position;
+        for (i32 i = 0; i < length; ++i) {
+            to[i] = from[i];
+        }
+        position += length;
+    }
+
+    *size = position;
+    return true;
+}
+
+i64 DecompressDataInto(const u8 *data, i64 size, u8 *output, i64 capacity) {
+    Inflate_reader reader = {.cursor = data, .end = data + size};
+    Inflate_huffman literals;
+    Inflate_huffman distances;
+
+    i64 outputSize = 0;
+    bool isFinal = false;
+    while (!isFinal) {
+        isFinal = ReadBits(&reader, 1);
+        u32 type = ReadBits(&reader, 2);
+
+        bool isOk;
+        if (type == 0) {
+            isOk = CopyStoredBlock(&reader, output, capacity, &outputSize);
+        } else if (type == 1) {
+            BuildFixedHuffman(&literals, &distances);
+            isOk = InflateBlock(&reader, &literals, &distances, output, capacity, &outputSize);
+        } else if (type == 2) {
+            isOk = ReadDynamicHuffman(&reader, &literals, &distances) &&
+                InflateBlock(&reader, &literals, &distances, output, capacity, &outputSize);
+        } else {
+            isOk = false;
+        }
+
+        // Reading any of the made up bits means the data was cut short
+        if (!isOk || reader.overrun > reader.bitCount) {
+            return -1;
+        }
+    }
+
+    return outputSize;
+}
@@ -0,0 +1,12 @@
+#ifndef INFLATE_H
+#define INFLATE_H
+
+#include "common.h"
+
+// Raw DEFLATE (RFC 1951, no zlib or gzip wrapper), the format raylib's CompressData writes. Unlike DecompressData it
+// writes into a buffer the caller owns, so it never allocates or logs and can run on any thread.
+//
+// Returns the decompressed size, or -1 if the data is damaged or doesn't fit in capacity bytes.
+i64 DecompressDataInto(const u8 *data, i64 size, u8 *output, i64 capacity);
+
+#endif
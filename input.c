@@ -0,0 +1,60 @@
+#include "input.h"
+
+
+Input_queue CreateInputQueue(f32 moveInterval, i32 fastForwardCount, Latency_histogram *latency) {
+    return (Input_queue){
+        .moveInterval = moveInterval,
+        .fastForwardCount = fastForwardCount,
+        .lastMoveTime = -1.0,
+        .latency = latency
+    };
+}
+
+bool PushInput(Input_queue *queue, Direction direction, f64 time) {
+    if (queue->count == INPUT_QUEUE_CAPACITY) {
+        ++queue->dropped;
+        return false;
+    }
+
+    i32 index = (queue->head + queue->count) % INPUT_QUEUE_CAPACITY;
+    queue->events[index] = (Input_event){
+        .direction = direction,
+        .time = time
+    };
+    ++queue->count;
+
+    return true;
+}
+
+bool PopInput(Input_queue *queue, f64 time, Input_event *event) {
+    if (queue->count == 0) {
+        return false;
+    }
+
+    if (queue->lastMoveTime >= 0.0 && time - queue->lastMoveTime < queue->moveInterval) {
+        return false;
+    }
+
+    *event = queue->events[queue->head];
+    queue->head = (queue->head + 1) % INPUT_QUEUE_CAPACITY;
+    --queue->count;
+
+    queue->lastMoveTime = time;
+
+    return true;
+}
+
+void ClearInputQueue(Input_queue *queue) {
+    queue->head = 0;
+    queue->count = 0;
+}
+
+bool ShouldFastForward(const Input_queue *queue) {
+    return queue->count >= queue->fastForwardCount;
+}
+
+void RecordInputLatency(Input_queue *queue, f64 inputTime, f64 presentTime) {
+    if (queue->latency) {
+        RecordLatency(queue->latency, presentTime > inputTime ? presentTime - inputTime : 0.0);
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include "common.h"
+#include "board.h"
+#include "latency.h"
+
+#define INPUT_QUEUE_CAPACITY 32
+
+
+typedef struct Input_event {
+    Direction direction;
+    f64 time;
+} Input_event;
+
+// Direction presses in the order they came in. Moves are taken out at most once per moveInterval, and once
+// fastForwardCount or more are waiting the caller is expected to cut the running animation short. The time from
+// each press to the frame showing its move goes into latency, unless that is NULL.
+typedef struct Input_queue {
+    Input_event events[INPUT_QUEUE_CAPACITY];
+    i32 head;
+    i32 count;
+    i32 dropped;
+
+    f32 moveInterval;
+    i32 fastForwardCount;
+    f64 lastMoveTime;
+
+    Latency_histogram *latency;
+} Input_queue;
+
+
+Input_queue CreateInputQueue(f32 moveInterval, i32 fastForwardCount, Latency_histogram *latency);
+
+bool PushInput(Input_queue *queue, Direction direction, f64 time);
+bool PopInput(Input_queue *queue, f64 time, Input_event *event);
+void ClearInputQueue(Input_queue *queue);
+
+bool ShouldFastForward(const Input_queue *queue);
+
+void RecordInputLatency(Input_queue *queue, f64 inputTime, f64 presentTime);
+
+#endif
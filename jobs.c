@@ -0,0 +1,410 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "jobs.h"
+#include "platform.h"
+#include "simulate.h"
+#include "stats.h"
+
+#ifdef __linux__
+#include <errno.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#define JOB_SHARD_MAGIC "R2048SHD"
+#define JOB_SHARD_VERSION 1
+#define JOB_PROGRESS_INTERVAL 5.0
+#define JOB_MAX_WORKERS 256
+
+
+typedef struct Shard_header {
+    char magic[8];
+    u32 version;
+    u32 shardIndex;
+    u64 firstSeed;
+    i64 gameCount;
+} Shard_header;
+
+
+static void GetJobPath(const Job *job, const char *name, char *path) {
+    snprintf(path, JOB_PATH_SIZE, "%s/%s", job->directory, name);
+}
+
+static void GetShardPath(const Job *job, i32 shard, const char *extension, char *path) {
+    snprintf(path, JOB_PATH_SIZE, "%s/shard-%06d.%s", job->directory, shard, extension);
+}
+
+static bool FileExists(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file != NULL) {
+        fclose(file);
+    }
+
+    return file != NULL;
+}
+
+static bool IsShardDone(const Job *job, i32 shard) {
+    char path[JOB_PATH_SIZE];
+    GetShardPath(job, shard, "stats", path);
+
+    return FileExists(path);
+}
+
+// Exclusive creation, so exactly one worker gets each shard
+static bool ClaimShard(const Job *job, i32 shard) {
+    char path[JOB_PATH_SIZE];
+    GetShardPath(job, shard, "claim", path);
+
+    FILE *file = fopen(path, "wx");
+    if (file != NULL) {
+        fclose(file);
+    }
+
+    return file != NULL;
+}
+
+#ifdef __linux__
+
+static void WriteLockOwner(FILE *file) {
+    fprintf(file, "%d\n", (i32)getpid());
+}
+
+// Only a lock whose run is known to be gone counts, one that doesn't hold a pid yet may have just been created
+static bool IsJobLockStale(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return false;
+    }
+
+    i32 pid = 0;
+    bool hasPid = fscanf(file, "%d", &pid) == 1 && pid > 0;
+    fclose(file);
+
+    return hasPid && kill(pid, 0) == -1 && errno == ESRCH;
+}
+
+#else
+
+static void WriteLockOwner(FILE *file) {
+    (void)file;
+}
+
+static bool IsJobLockStale(const char *path) {
+    (void)path;
+    return false;
+}
+
+#endif
+
+// Only one run may work on a job at a time, otherwise clearing stale claims would hand a live worker's shard to
+// another one. A lock left behind by a run that was killed is taken over on Linux, elsewhere it has to be deleted.
+static bool LockJob(const Job *job) {
+    char path[JOB_PATH_SIZE];
+    GetJobPath(job, "job.lock", path);
+
+    FILE *file = fopen(path, "wx");
+    if (file == NULL && IsJobLockStale(path)) {
+        remove(path);
+        file = fopen(path, "wx");
+    }
+    if (file == NULL) {
+        return false;
+    }
+
+    WriteLockOwner(file);
+    fclose(file);
+
+    return true;
+}
+
+static void UnlockJob(const Job *job) {
+    char path[JOB_PATH_SIZE];
+    GetJobPath(job, "job.lock", path);
+    remove(path);
+}
+
+static i64 GetShardFirstGame(const Job *job, i32 shard) {
+    return (i64)shard * job->shardSize;
+}
+
+static i32 GetShardGameCount(const Job *job, i32 shard) {
+    i64 remaining = job->gameCount - GetShardFirstGame(job, shard);
+    return (i32)(remaining < job->shardSize ? remaining : job->shardSize);
+}
+
+static i32 CountDoneShards(const Job *job) {
+    i32 count = 0;
+    for (i32 i = 0; i < job->shardCount; ++i) {
+        count += IsShardDone(job, i);
+    }
+
+    return count;
+}
+
+// Like the shards, synced under a temporary name and renamed, so a crash can't leave a torn manifest behind
+static bool WriteJobManifest(const Job *job) {
+    char temporaryPath[JOB_PATH_SIZE];
+    char path[JOB_PATH_SIZE];
+    GetJobPath(job, "job.tmp", temporaryPath);
+    GetJobPath(job, "job.txt", path);
+
+    FILE *file = fopen(temporaryPath, "w");
+    if (file == NULL) {
+        return false;
+    }
+
+    bool isOk = fprintf(file, "first_seed=%llu\ngame_count=%lld\nshard_size=%d\n", (unsigned long long)job->firstSeed,
+        (long long)job->gameCount, job->shardSize) > 0 && SyncFile(file);
+    isOk &= fclose(file) == 0;
+
+    return isOk && RenameFile(temporaryPath, path);
+}
+
+static bool ReadJobManifest(Job *job) {
+    char path[JOB_PATH_SIZE];
+    GetJobPath(job, "job.txt", path);
+
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return false;
+    }
+
+    unsigned long long firstSeed;
+    long long gameCount;
+    bool isOk = fscanf(file, "first_seed=%llu\ngame_count=%lld\nshard_size=%d\n", &firstSeed, &gameCount,
+        &job->shardSize) == 3;
+    fclose(file);
+
+    job->firstSeed = firstSeed;
+    job->gameCount = gameCount;
+
+    return isOk && job->gameCount > 0 && job->shardSize > 0;
+}
+
+// Written and synced under a temporary name and then renamed, so a shard file is either complete or missing, even
+// after a crash
+static bool RunShard(const Job *job, i32 shard, Game_stats *stats) {
+    InitGameStats(stats);
+
+    u64 firstSeed = job->firstSeed + GetShardFirstGame(job, shard);
+    i32 gameCount = GetShardGameCount(job, shard);
+    for (i32 i = 0; i < gameCount; ++i) {
+        Game_result result;
+        PlayRandomGame(firstSeed + i, &result);
+        result.duration = 0.0f; // The only thing that would differ between runs
+        AddGameResult(stats, &result);
+    }
+
+    char temporaryPath[JOB_PATH_SIZE];
+    char path[JOB_PATH_SIZE];
+    GetShardPath(job, shard, "tmp", temporaryPath);
+    GetShardPath(job, shard, "stats", path);
+
+    FILE *file = fopen(temporaryPath, "wb");
+    if (file == NULL) {
+        return false;
+    }
+
+    Shard_header header = {
+        .magic = JOB_SHARD_MAGIC,
+        .version = JOB_SHARD_VERSION,
+        .shardIndex = shard,
+        .firstSeed = firstSeed,
+        .gameCount = gameCount
+    };
+    bool isOk = fwrite(&header, sizeof(header), 1, file) == 1 && WriteGameStats(file, stats) && SyncFile(file);
+    isOk &= fclose(file) == 0;
+
+    return isOk && RenameFile(temporaryPath, path);
+}
+
+static bool ReadShard(const Job *job, i32 shard, Game_stats *stats) {
+    char path[JOB_PATH_SIZE];
+    GetShardPath(job, shard, "stats", path);
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+
+    Shard_header header;
+    bool isOk = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, JOB_SHARD_MAGIC, 8) == 0 &&
+        header.version == JOB_SHARD_VERSION && header.shardIndex == (u32)shard &&
+        header.firstSeed == job->firstSeed + GetShardFirstGame(job, shard) &&
+        header.gameCount == GetShardGameCount(job, shard) && ReadGameStats(file, stats);
+    fclose(file);
+
+    return isOk;
+}
+
+static void RunJobWorker(const Job *job) {
+    Game_stats *stats = TrackedAlloc(sizeof(Game_stats), ALLOC_TAG_STATS);
+
+    for (i32 i = 0; i < job->shardCount; ++i) {
+        if (IsShardDone(job, i) || !ClaimShard(job, i)) {
+            continue;
+        }
+
+        if (!RunShard(job, i, stats)) {
+            fprintf(stderr, "Could not write shard %d\n", i);
+        }
+
+        char path[JOB_PATH_SIZE];
+        GetShardPath(job, i, "claim", path);
+        remove(path);
+    }
+
+    TrackedFree(stats, ALLOC_TAG_STATS);
+}
+
+#ifdef __linux__
+
+static void RunJobWorkers(const Job *job, i32 workerCount) {
+    fflush(stdout);
+
+    i32 runningCount = 0;
+    for (i32 i = 0; i < workerCount; ++i) {
+        pid_t child = fork();
+        if (child == 0) {
+            RunJobWorker(job);
+            _exit(0);
+        }
+        runningCount += child > 0;
+    }
+
+    f64 lastProgress = GetWallTime();
+    while (runningCount > 0) {
+        i32 status;
+        while (runningCount > 0 && waitpid(-1, &status, WNOHANG) > 0) {
+            --runningCount;
+        }
+
+        f64 now = GetWallTime();
+        if (now - lastProgress >= JOB_PROGRESS_INTERVAL) {
+            printf("%d/%d shards done\n", CountDoneShards(job), job->shardCount);
+            fflush(stdout);
+            lastProgress = now;
+        }
+
+        SleepSeconds(0.1);
+    }
+}
+
+#else
+
+static void RunJobWorkers(const Job *job, i32 workerCount) {
+    RunJobWorker(job);
+}
+
+#endif
+
+static bool MergeShards(const Job *job) {
+    Game_stats *total = TrackedAlloc(sizeof(Game_stats), ALLOC_TAG_STATS);
+    Game_stats *shard = TrackedAlloc(sizeof(Game_stats), ALLOC_TAG_STATS);
+    InitGameStats(total);
+
+    bool isOk = true;
+    for (i32 i = 0; i < job->shardCount && isOk; ++i) {
+        isOk = ReadShard(job, i, shard);
+        if (!isOk) {
+            fprintf(stderr, "Shard %d is corrupt, delete it and run the job again\n", i);
+            break;
+        }
+        MergeGameStats(total, shard);
+    }
+
+    if (isOk) {
+        char path[JOB_PATH_SIZE];
+        GetJobPath(job, "summary.csv", path);
+        isOk &= WriteGameStatsSummary(total, path);
+        GetJobPath(job, "histograms.csv", path);
+        isOk &= WriteGameStatsHistograms(total, path);
+
+        PrintGameStats(total);
+    }
+
+    TrackedFree(total, ALLOC_TAG_STATS);
+    TrackedFree(shard, ALLOC_TAG_STATS);
+
+    return isOk;
+}
+
+i32 RunJob(const char *directory, i32 workerCount, i64 gameCount, u64 firstSeed, i32 shardSize) {
+    Job job = {0};
+    snprintf(job.directory, sizeof(job.directory), "%s", directory);
+
+    if (!MakeDirectory(job.directory)) {
+        fprintf(stderr, "Could not create %s\n", job.directory);
+        return 1;
+    }
+
+    if (!LockJob(&job)) {
+        fprintf(stderr, "Another run is working on %s, delete its job.lock if there isn't one\n", job.directory);
+        return 1;
+    }
+
+    Job existing = job;
+    if (ReadJobManifest(&existing)) {
+        if (gameCount > 0 && (existing.gameCount != gameCount || existing.firstSeed != firstSeed ||
+            (shardSize > 0 && existing.shardSize != shardSize))) {
+            fprintf(stderr, "%s holds a job with different settings\n", job.directory);
+            UnlockJob(&job);
+            return 1;
+        }
+        job = existing;
+    } else {
+        if (gameCount <= 0) {
+            fprintf(stderr, "%s holds no job to resume\n", job.directory);
+            UnlockJob(&job);
+            return 1;
+        }
+
+        job.gameCount = gameCount;
+        job.firstSeed = firstSeed;
+        job.shardSize = shardSize > 0 ? shardSize : JOB_DEFAULT_SHARD_SIZE;
+        if (!WriteJobManifest(&job)) {
+            fprintf(stderr, "Could not write the settings to %s\n", job.directory);
+            UnlockJob(&job);
+            return 1;
+        }
+    }
+    job.shardCount = (i32)((job.gameCount + job.shardSize - 1) / job.shardSize);
+
+    if (workerCount <= 0) {
+        workerCount = GetProcessorCount();
+    }
+    workerCount = MinI32(workerCount, JOB_MAX_WORKERS);
+
+    // The lock keeps other runs out, so any claim left is from a worker that died
+    for (i32 i = 0; i < job.shardCount; ++i) {
+        char path[JOB_PATH_SIZE];
+        GetShardPath(&job, i, "claim", path);
+        remove(path);
+    }
+
+    i32 doneCount = CountDoneShards(&job);
+    printf("Job %s: %lld games from seed %llu in %d shards, %d already done, %d workers\n", job.directory,
+        (long long)job.gameCount, (unsigned long long)job.firstSeed, job.shardCount, doneCount, workerCount);
+
+    f64 start = GetWallTime();
+    if (doneCount < job.shardCount) {
+        RunJobWorkers(&job, workerCount);
+    }
+
+    doneCount = CountDoneShards(&job);
+    if (doneCount < job.shardCount) {
+        fprintf(stderr, "%d shards did not finish, run the job again to resume\n", job.shardCount - doneCount);
+        UnlockJob(&job);
+        return 1;
+    }
+
+    printf("Played the remaining shards in %.1f s\n", GetWallTime() - start);
+
+    bool isOk = MergeShards(&job);
+    UnlockJob(&job);
+
+    return isOk ? 0 : 1;
+}
@@ -0,0 +1,35 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include "common.h"
+
+#define JOB_DEFAULT_SHARD_SIZE 10000
+#define JOB_DIRECTORY_SIZE 256
+#define JOB_PATH_SIZE (JOB_DIRECTORY_SIZE + 64)
+
+// A long simulation run kept in a directory. The seed range is split into fixed shards of shardSize games and
+// worker processes claim shards one at a time. A finished shard's aggregates go to its own file, which doubles as the
+// checkpoint: running the job again skips every shard that has a file and only plays the rest. The shards are
+// merged in shard order at the end, and game durations are left out, so the result only depends on the job's
+// settings and not on the worker count or on how often it was interrupted.
+//
+// The directory holds:
+//   job.txt               The settings, written on the first run
+//   job.lock              Held by the run working on the job, with its pid
+//   shard-NNNNNN.stats    A finished shard (see WriteGameStats)
+//   shard-NNNNNN.claim    A shard some worker is playing, stale ones are removed on start
+//   summary.csv, histograms.csv   The merged result
+typedef struct Job {
+    char directory[JOB_DIRECTORY_SIZE];
+    u64 firstSeed;
+    i64 gameCount;
+    i32 shardSize;
+    i32 shardCount;
+} Job;
+
+// gameCount 0 resumes an existing job with its own settings, and shardSize 0 takes the existing job's or
+// JOB_DEFAULT_SHARD_SIZE for a new one. Worker processes are only forked on Linux, elsewhere
+// the shards are played in this process.
+i32 RunJob(const char *directory, i32 workerCount, i64 gameCount, u64 firstSeed, i32 shardSize);
+
+#endif
@@ -0,0 +1,30 @@
+#include "latency.h"
+
+
+void RecordLatency(Latency_histogram *histogram, f64 latency) {
+    ++histogram->count;
+    histogram->total += latency;
+    if (latency > histogram->max) {
+        histogram->max = latency;
+    }
+
+    i64 bucket = latency * 1e6;
+    ++histogram->buckets[bucket < LATENCY_BUCKET_COUNT ? bucket : LATENCY_BUCKET_COUNT - 1];
+}
+
+f64 GetLatencyPercentile(const Latency_histogram *histogram, f64 percentile) {
+    i64 target = histogram->count * percentile;
+    i64 seen = 0;
+    for (i32 i = 0; i < LATENCY_BUCKET_COUNT; ++i) {
+        seen += histogram->buckets[i];
+        if (seen > target) {
+            return i == LATENCY_BUCKET_COUNT - 1 ? histogram->max : (i + 1) / 1e6;
+        }
+    }
+
+    return histogram->max;
+}
+
+f64 GetLatencyMean(const Latency_histogram *histogram) {
+    return histogram->count > 0 ? histogram->total / histogram->count : 0.0;
+}
@@ -0,0 +1,20 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include "common.h"
+
+#define LATENCY_BUCKET_COUNT 65536 // 1 us each, the last one collects everything slower
+
+// Fixed-size, so recording never allocates. Zero-initialise before use.
+typedef struct Latency_histogram {
+    i64 buckets[LATENCY_BUCKET_COUNT];
+    i64 count;
+    f64 total;
+    f64 max;
+} Latency_histogram;
+
+void RecordLatency(Latency_histogram *histogram, f64 latency); // In seconds
+f64 GetLatencyPercentile(const Latency_histogram *histogram, f64 percentile); // percentile in [0, 1]
+f64 GetLatencyMean(const Latency_histogram *histogram);
+
+#endif
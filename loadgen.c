@@ -0,0 +1,250 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "latency.h"
+#include "net.h"
+#include "platform.h"
+#include "protocol.h"
+#include "server.h"
+
+#ifdef __linux__
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#define LOADGEN_MAX_CONNECTIONS 32
+#define LOADGEN_READ_BUFFER_SIZE (64 * 1024)
+
+const i32 LOADGEN_SESSION_COUNTS[] = {1, 16, 256, 1024, 4096, 16384};
+
+
+// Every session has exactly one request in flight. The server answers in order, so the send times and types of a
+// connection form a FIFO.
+typedef struct Load_connection {
+    i32 socket;
+    i32 sessionCount;
+
+    f64 *sendTimes;
+    u8 *sendTypes;
+    i32 sendHead;
+    i32 sendCount;
+
+    u8 readBuffer[LOADGEN_READ_BUFFER_SIZE];
+    i32 readLength;
+} Load_connection;
+
+
+#ifdef __linux__
+
+static bool SendRequest(Load_connection *connection, Request_header *header, f64 time) {
+    if (write(connection->socket, header, sizeof(*header)) != sizeof(*header)) {
+        return false;
+    }
+
+    i32 index = (connection->sendHead + connection->sendCount) % connection->sessionCount;
+    connection->sendTimes[index] = time;
+    connection->sendTypes[index] = header->type;
+    ++connection->sendCount;
+
+    return true;
+}
+
+// Copies out every complete response along with how long it took and the type of request it answers
+static i32 ReadResponses(Load_connection *connection, Response *responses, f64 *latencies, u8 *types, i32 maxCount) {
+    i64 received = read(connection->socket, connection->readBuffer + connection->readLength, 
+        LOADGEN_READ_BUFFER_SIZE - connection->readLength);
+    if (received <= 0) {
+        return received == -1 && errno == EAGAIN ? 0 : -1;
+    }
+    connection->readLength += received;
+
+    f64 now = GetWallTime();
+    i32 count = 0;
+    i32 offset = 0;
+    while (count < maxCount && connection->readLength - offset >= (i32)sizeof(Response)) {
+        memcpy(&responses[count], connection->readBuffer + offset, sizeof(Response));
+        latencies[count] = now - connection->sendTimes[connection->sendHead];
+        types[count] = connection->sendTypes[connection->sendHead];
+        connection->sendHead = (connection->sendHead + 1) % connection->sessionCount;
+        --connection->sendCount;
+
+        offset += sizeof(Response);
+        ++count;
+    }
+
+    memmove(connection->readBuffer, connection->readBuffer + offset, connection->readLength - offset);
+    connection->readLength -= offset;
+
+    return count;
+}
+
+static u64 NextSeed(u64 *seed) {
+    Rng rng = CreateRng(*seed);
+    *seed = NextRandom(&rng);
+    return *seed;
+}
+
+// Sends the first request of every session, then answers each response with the next request for that session
+// until the time is up, then closes every session and waits for the closes to be answered
+static bool RunLevel(const char *address, i32 sessionCount, f64 seconds, u64 *seed) {
+    i32 connectionCount = MinI32(sessionCount, LOADGEN_MAX_CONNECTIONS);
+    Load_connection *connections = TrackedAlloc(connectionCount * sizeof(Load_connection), ALLOC_TAG_SERVER);
+    Latency_histogram *histogram = TrackedAlloc(sizeof(Latency_histogram), ALLOC_TAG_SERVER);
+    Response *responses = TrackedAlloc(sessionCount * sizeof(Response), ALLOC_TAG_SERVER);
+    f64 *latencies = TrackedAlloc(sessionCount * sizeof(f64), ALLOC_TAG_SERVER);
+    u8 *types = TrackedAlloc(sessionCount * sizeof(u8), ALLOC_TAG_SERVER);
+    memset(histogram, 0, sizeof(*histogram));
+
+    i32 epoll = epoll_create1(0);
+    bool isOk = true;
+
+    for (i32 i = 0; i < connectionCount; ++i) {
+        Load_connection *connection = &connections[i];
+        connection->socket = ConnectToAddress(address);
+        connection->sessionCount = sessionCount / connectionCount + (i < sessionCount % connectionCount);
+        connection->sendTimes = TrackedAlloc(connection->sessionCount * sizeof(f64), ALLOC_TAG_SERVER);
+        connection->sendTypes = TrackedAlloc(connection->sessionCount * sizeof(u8), ALLOC_TAG_SERVER);
+        connection->sendHead = 0;
+        connection->sendCount = 0;
+        connection->readLength = 0;
+
+        if (connection->socket == -1) {
+            isOk = false;
+            continue;
+        }
+
+        struct epoll_event event = {.events = EPOLLIN, .data.u32 = i};
+        epoll_ctl(epoll, EPOLL_CTL_ADD, connection->socket, &event);
+
+        for (i32 j = 0; j < connection->sessionCount; ++j) {
+            Request_header header = {.type = REQUEST_NEW_GAME, .session = SESSION_NONE, .seed = NextSeed(seed)};
+            isOk &= SendRequest(connection, &header, GetWallTime());
+        }
+    }
+
+    Rng directions = CreateRng(*seed);
+    f64 start = GetWallTime();
+    f64 end = start + seconds;
+    i64 requestCount = 0;
+    i32 inFlight = sessionCount;
+    bool isMeasuring = false;
+    f64 elapsed = 0;
+
+    struct epoll_event events[LOADGEN_MAX_CONNECTIONS];
+    while (isOk && inFlight > 0) {
+        i32 eventCount = epoll_wait(epoll, events, LOADGEN_MAX_CONNECTIONS, 1000);
+        f64 now = GetWallTime();
+        bool isDraining = now >= end;
+        if (isDraining && isMeasuring) {
+            isMeasuring = false;
+            elapsed = now - start;
+        }
+
+        for (i32 i = 0; i < eventCount && isOk; ++i) {
+            Load_connection *connection = &connections[events[i].data.u32];
+
+            i32 count = ReadResponses(connection, responses, latencies, types, sessionCount);
+            if (count < 0) {
+                isOk = false;
+                break;
+            }
+
+            for (i32 j = 0; j < count; ++j) {
+                Response *response = &responses[j];
+                if (response->status != STATUS_OK) {
+                    fprintf(stderr, "Request failed with status %d\n", response->status);
+                    isOk = false;
+                    break;
+                }
+
+                // The session is gone once its close is answered, and closes aren't part of the measurement
+                if (types[j] == REQUEST_CLOSE) {
+                    --inFlight;
+                    continue;
+                }
+
+                if (isMeasuring) {
+                    RecordLatency(histogram, latencies[j]);
+                    ++requestCount;
+                }
+
+                Request_header header = {.session = response->session};
+                if (isDraining) {
+                    header.type = REQUEST_CLOSE;
+                } else if (response->flags & RESPONSE_FLAG_GAME_OVER) {
+                    header.type = REQUEST_NEW_GAME;
+                    header.seed = NextSeed(seed);
+                } else {
+                    header.type = REQUEST_MOVE;
+                    header.direction = RandomRange(&directions, 0, DIRECTION_COUNT - 1);
+                }
+                isOk &= SendRequest(connection, &header, now);
+            }
+        }
+
+        // The session setup isn't part of the measurement
+        if (!isMeasuring && !isDraining && now - start > 0.1 * seconds) {
+            isMeasuring = true;
+            start = now;
+        }
+    }
+
+    if (isOk && histogram->count > 0) {
+        printf("%8d sessions  %10.0f req/s  mean %7.1f us  p50 %7.1f us  p99 %7.1f us  max %8.1f us\n", sessionCount, 
+            requestCount / elapsed, 1e6 * GetLatencyMean(histogram), 1e6 * GetLatencyPercentile(histogram, 0.5), 
+            1e6 * GetLatencyPercentile(histogram, 0.99), 1e6 * histogram->max);
+    }
+
+    // Gives the server a moment to process the closes before the sockets go away
+    for (i32 i = 0; i < connectionCount; ++i) {
+        if (connections[i].socket == -1) {
+            TrackedFree(connections[i].sendTimes, ALLOC_TAG_SERVER);
+            TrackedFree(connections[i].sendTypes, ALLOC_TAG_SERVER);
+            continue;
+        }
+
+        shutdown(connections[i].socket, SHUT_WR);
+        while (read(connections[i].socket, connections[i].readBuffer, LOADGEN_READ_BUFFER_SIZE) > 0) {
+        }
+        close(connections[i].socket);
+        TrackedFree(connections[i].sendTimes, ALLOC_TAG_SERVER);
+        TrackedFree(connections[i].sendTypes, ALLOC_TAG_SERVER);
+    }
+    close(epoll);
+
+    TrackedFree(connections, ALLOC_TAG_SERVER);
+    TrackedFree(histogram, ALLOC_TAG_SERVER);
+    TrackedFree(responses, ALLOC_TAG_SERVER);
+    TrackedFree(latencies, ALLOC_TAG_SERVER);
+    TrackedFree(types, ALLOC_TAG_SERVER);
+
+    return isOk;
+}
+
+i32 RunLoadGenerator(const char *address, f64 secondsPerLevel) {
+    u64 seed = 2048;
+
+    printf("Load testing %s, %.1f s per level\n", address, secondsPerLevel);
+
+    i32 levelCount = sizeof(LOADGEN_SESSION_COUNTS) / sizeof(LOADGEN_SESSION_COUNTS[0]);
+    for (i32 i = 0; i < levelCount; ++i) {
+        if (!RunLevel(address, LOADGEN_SESSION_COUNTS[i], secondsPerLevel, &seed)) {
+            fprintf(stderr, "Load test failed at %d sessions\n", LOADGEN_SESSION_COUNTS[i]);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+#else
+
+i32 RunLoadGenerator(const char *address, f64 secondsPerLevel) {
+    fprintf(stderr, "The load generator is only available on Linux\n");
+    return 1;
+}
+
+#endif
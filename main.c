@@ -1,16 +1,40 @@
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include "cJSON.h"
 #include "raylib.h"
+#include "rlgl.h"
 
 #include "common.h"
+#include "adversary.h"
+#include "allocator.h"
+#include "analysis.h"
+#include "arena.h"
+#include "batch_env.h"
+#include "board.h"
+#include "book.h"
+#include "corpus.h"
+#include "fuzz.h"
+#include "history.h"
+#include "input.h"
+#include "jobs.h"
+#include "mcts.h"
+#include "move_tables.h"
+#include "net.h"
+#include "perf.h"
+#include "results.h"
+#include "search.h"
+#include "server.h"
+#include "shm_env.h"
+#include "simulate.h"
+#include "solver.h"
+#include "spectator.h"
+#include "timeline.h"
 
 
-#define TILE_COUNT_X 4
-#define TILE_COUNT_Y 4
-#define TILE_COUNT (TILE_COUNT_X * TILE_COUNT_Y)
-
 #define TILE_SIZE 100
 #define TILE_SPACING 15.0f
 #define BOARD_PADDING 20.0f
@@ -47,7 +71,7 @@
 #define BUTTONS_KEYBINDS_TEXT_MARGIN 10.0f
 #define BUTTONS_KEYBINDS_HEIGHT 43.0f
 
-#define OPTIONS_TIMER_DURATION 0.2f
+#define OPTIONS_FADE_DURATION 0.2f
 #define KEY_BINDINGS_COUNT 4
 #define OPTIONS_VOLUME_SLIDER_X (BOARD_BACKGROUND.x + 2 * TILE_SPACING + TILE_SIZE)
 #define OPTIONS_VOLUME_SLIDER_Y (BOARD_BACKGROUND.y + 3 * TILE_SPACING + 2.5f * TILE_SIZE)
@@ -64,10 +88,47 @@
 #define TILE_COMBINE_DURATION 0.1f
 #define TILE_COMBINE_DELTA_SIZE 20.0f
 
+#define SIMULATION_STEP (1.0f / 240.0f)
+#define SIMULATION_MAX_FRAME_TIME 0.25f // Longer frames are treated as this long instead of catching up on every step
+#define IDLE_FRAME_RATE 30 // While nothing is animating, frames are drawn at this rate instead of the monitor's
+#define IDLE_POLL_INTERVAL 0.002 // Seconds between input checks in the rest of an idle frame
+
+#define KEY_UNDO KEY_Z // Together with ctrl
+#define KEY_REDO KEY_Y
+#define KEY_HINT KEY_H
+
+#define HINT_LABEL_TEXT_SIZE 20.0f
+#define HINT_TEXT_SIZE 30.0f
+
+#define SPECTATOR_WINDOW_WIDTH 1280
+#define SPECTATOR_WINDOW_HEIGHT 960
+#define SPECTATOR_HEADER_HEIGHT 32.0f
+#define SPECTATOR_TEXT_SIZE 20.0f
+#define SPECTATOR_BOARD_MARGIN 0.05f // Around each board, as a share of its grid cell
+
+#define ATLAS_PADDING 8 // Each cell's colour carries on around it, so filtering (down to the smaller mipmaps) doesn't pick up a neighbour
+#define ATLAS_CELL_STRIDE (TILE_SIZE + 2 * ATLAS_PADDING)
+#define ATLAS_COLUMNS 6
+#define ATLAS_CELL_BOARD 16 // Cells before this are the tiles, by exponent
+#define ATLAS_CELL_OVERLAY 17
+#define ATLAS_CELL_COUNT 18
+
+#define TIMELINE_HEIGHT 50.0f
+#define TIMELINE_MARGIN 25.0f // From the sides and bottom of the board
+#define TIMELINE_TEXT_SIZE 20.0f
+
+#define INPUT_MOVE_INTERVAL 0.0f // Minimum time between two queued moves being applied
+#define INPUT_FAST_FORWARD_COUNT 2 // Queued moves at which the running move animation is cut short
+
 #define COLOUR_TILES_COUNT 13
 
 #define FONT_SIZE 80.0f
 
+#define TILE_STRING_COUNT 32
+#define TILE_STRING_LENGTH 12
+#define UNDEFINED_KEY_STRING_COUNT 512
+#define UNDEFINED_KEY_STRING_LENGTH 16
+
 #define INITIAL_VOLUME 0.75f
 #define MUSIC_VOLUME 0.75f
 #define SFX_MOVE_TILES 0.5f
@@ -75,6 +136,14 @@
 #define SFX_BUTTON_PRESS 0.3f
 #define SFX_GAME_OVER 1.0f
 
+// 12-ET
+const f32 SFX_MOVE_TILES_PITCH[DIRECTION_COUNT] = {
+    [DIRECTION_UP] = 0.79370f,
+    [DIRECTION_DOWN] = 0.89090f,
+    [DIRECTION_LEFT] = 1.00000f,
+    [DIRECTION_RIGHT] = 1.12246f
+};
+
 
 const Color COLOUR_BACKGROUND = {.r = 250, .g = 248, .b = 239, .a = 255};
 const Color COLOUR_BOARD_BACKGROUND = {.r = 187, .g = 173, .b = 160, .a = 255};
@@ -96,6 +165,7 @@ const Color COLOUR_TILES[] = {
     {.r = 232, .g = 190, .b = 78,  .a = 255}, // 2048
     {.r = 60,  .g = 58,  .b = 50,  .a = 255}  //...
 };
+const Color COLOUR_TIMELINE_LOSS = {.r = 247, .g = 124, .b = 95,  .a = 255};
 const Color COLOUR_GAME_OVER_OVERLAY = {.r = 245, .g = 235, .b = 225, .a = 170};
 const Color COLOUR_BUTTON_NONE = {.r = 119, .g = 110, .b = 101, .a = 255};
 const Color COLOUR_BUTTON_HOVER = {.r = 99, .g = 92, .b = 84, .a = 255};
@@ -109,21 +179,6 @@ const Rectangle BOARD_BACKGROUND = {
 };
 
 
-typedef struct Moving_tiles {
-    i32 startIndices[TILE_COUNT];
-    i32 endIndices[TILE_COUNT];
-    i32 count;
-    f32 timer;
-} Moving_tiles;
-
-typedef struct Board {
-    i32 board[TILE_COUNT];
-    Moving_tiles movingTiles;
-    bool combinedTiles[TILE_COUNT];
-    f32 combinedTimer;
-    i32 newTile;
-} Board;
-
 typedef enum Button_state {
     BUTTON_STATE_NONE,
     BUTTON_STATE_HOVER,
@@ -163,6 +218,19 @@ typedef struct Keybinds {
     };
 } Keybinds;
 
+// Drawn from the events of the last move, the board itself only holds where the tiles ended up. How far along it is
+// is up to the timeline's TWEEN_MOVE and TWEEN_COMBINE.
+typedef struct Tile_animation {
+    Tile_events events;
+} Tile_animation;
+
+typedef enum Tween_id {
+    TWEEN_MOVE,
+    TWEEN_COMBINE,
+    TWEEN_OPTIONS, // 1 with the options menu open
+    TWEEN_GAME_OVER
+} Tween_id;
+
 
 static Color GetButtonColour(Button *button, bool getTextColour) {
     if (getTextColour) {
@@ -190,45 +258,31 @@ static Color GetButtonColour(Button *button, bool getTextColour) {
     }
 }
 
-static u32 PowerOf2(i32 exponent) {
-    if (exponent < 0 || exponent > 32) {
-        return 0;
-    }
-
-    u32 result = 1;
-    while (exponent--) {
-        result *= 2;
-    }
-
-    return result;
+static bool IsControlDown(void) {
+    return IsKeyDown(KEY_LEFT_CONTROL) || IsKeyDown(KEY_RIGHT_CONTROL);
 }
 
-static bool IsBoardFull(i32 *board) {
-    for (i32 i = 0; i < TILE_COUNT; ++i) {
-        if (board[i] == 0) {
-            return false;
+// GetKeyPressed hands out every press of the frame in order, unlike IsKeyPressed which only knows whether a key went down
+static void PollDirectionPresses(Input_queue *queue, Keybinds *keybinds, f64 time) {
+    i32 key = 0;
+    while ((key = GetKeyPressed()) != 0) {
+        for (i32 i = 0; i < KEY_BINDINGS_COUNT; ++i) {
+            if (keybinds->binds[i] == key) {
+                PushInput(queue, (Direction)i, time);
+                break;
+            }
         }
     }
-
-    return true;
 }
 
-static i32 GetRandomFreeTile(i32 *board) {
-    if (IsBoardFull(board)) {
-        return -1;
+// Any press or click, without taking anything out of the frame's input
+static bool IsInputPending(void) {
+    if (WindowShouldClose() || IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
+        return true;
     }
 
-    i32 index;
-    do {
-        index = GetRandomValue(0, TILE_COUNT - 1);
-    } while (board[index] != 0);
-
-    return index;
-}
-
-static bool IsTileMoving(i32 index, Moving_tiles *tiles) {
-    for (i32 i = 0; i < tiles->count; ++i) {
-        if (tiles->endIndices[i] == index) {
+    for (i32 key = 1; key <= KEY_KB_MENU; ++key) {
+        if (IsKeyPressed(key)) {
             return true;
         }
     }
@@ -236,131 +290,62 @@ static bool IsTileMoving(i32 index, Moving_tiles *tiles) {
     return false;
 }
 
-static bool CanMove(i32 *board) {
-    if (!IsBoardFull(board)) {
-        return true;
-    }
-
-    for (i32 y = 0; y < TILE_COUNT_Y; ++y) {
-        for (i32 x = 0; x < TILE_COUNT_X; ++x) {
-            i32 index = y * TILE_COUNT_X + x;
-            if ((y > 0 && board[index] == board[index - TILE_COUNT_X]) || (y < TILE_COUNT_Y - 1 && board[index] == board[index + TILE_COUNT_X]) ||
-                (x > 0 && board[index] == board[index - 1]) || (x < TILE_COUNT_X - 1 && board[index] == board[index + 1])) {
-                return true;
-            }
-        }
+// Sleeps until endTime, checking for input every IDLE_POLL_INTERVAL, so that a press is acted on straight away rather
+// than on the next idle frame. Polling again throws away the last poll's presses, so it stops at the first one.
+static void WaitForIdleFrame(f64 endTime) {
+    while (!IsInputPending() && GetTime() < endTime) {
+        WaitTime(IDLE_POLL_INTERVAL);
+        PollInputEvents();
     }
-
-    return false;
 }
 
-static bool HandleMovement_Up(i32 index) {
-    return index >= TILE_COUNT_X;
-}
+// mergedCells is kept around afterwards for DisplayCombinedTiles
+static void FinishMoveAnimation(Tile_animation *animation, Timeline *timeline, Sound sfxCombineTiles) {
+    SetTween(timeline, TWEEN_MOVE, 1.0f);
 
-static bool HandleMovement_Down(i32 index) {
-    return index < TILE_COUNT - TILE_COUNT_X;
-}
-
-static bool HandleMovement_Left(i32 index) {
-    return index % TILE_COUNT_X != 0;
-}
-
-static bool HandleMovement_Right(i32 index) {
-    return index % TILE_COUNT_X != (TILE_COUNT_X - 1);
-}
-
-static void HandleMovement(Board *board, i32 index, i32 offset, bool (*condition)(i32), bool *didMove, i32 *score) {
-    board->movingTiles.startIndices[board->movingTiles.count] = index;
-
-    while ((*condition)(index) && board->board[index] != 0 && !board->combinedTiles[index + offset] && 
-        (board->board[index + offset] == 0 || board->board[index + offset] == board->board[index])) {
-        *didMove = true;
-        index += offset;
-
-        if (board->board[index] > 0) {
-            *score += PowerOf2(board->board[index] + 1);
-            board->board[index] += 1;
-            board->board[index - offset] = 0;
-
-            board->combinedTiles[index] = true;
-
-            break;
-        }
-
-        board->board[index] = board->board[index - offset];
-        board->board[index - offset] = 0;
+    if (animation->events.count > 0 && animation->events.mergedCells != 0) {
+        PlayTween(timeline, TWEEN_COMBINE, TILE_COMBINE_DURATION, EASING_BUMP);
+        PlaySound(sfxCombineTiles);
     }
 
-    if (board->movingTiles.startIndices[board->movingTiles.count] != index) {
-        board->movingTiles.endIndices[board->movingTiles.count] = index;
-        ++board->movingTiles.count;
-    }
-}
-
-static void MoveUp(Board *board, bool *didMove, i32 *score) {
-    for (i32 y = 1; y < TILE_COUNT_Y; ++y) {
-        for (i32 x = 0; x < TILE_COUNT_X; ++x) {
-            i32 index = y * TILE_COUNT_X + x;
-            HandleMovement(board, index, -TILE_COUNT_X, &HandleMovement_Up, didMove, score);
-        }
-    }
+    animation->events.count = 0;
+    animation->events.slidCells = 0;
+    animation->events.spawnedCells = 0;
 }
 
-static void MoveDown(Board *board, bool *didMove, i32 *score) {
-    for (i32 y = TILE_COUNT_Y - 2; y >= 0; --y) {
-        for (i32 x = 0; x < TILE_COUNT_X; ++x) {
-            i32 index = y * TILE_COUNT_X + x;
-            HandleMovement(board, index, TILE_COUNT_X, &HandleMovement_Down, didMove, score);
-        }
-    }
+static void ResetTileAnimation(Tile_animation *animation, Timeline *timeline) {
+    *animation = (Tile_animation){0};
+    SetTween(timeline, TWEEN_MOVE, 1.0f);
+    SetTween(timeline, TWEEN_COMBINE, 0.0f);
 }
 
-static void MoveLeft(Board *board, bool *didMove, i32 *score) {
-    for (i32 x = 1; x < TILE_COUNT_X; ++x) {
-        for (i32 y = 0; y < TILE_COUNT_Y; ++y) {
-            i32 index = y * TILE_COUNT_X + x;
-            HandleMovement(board, index, -1, &HandleMovement_Left, didMove, score);
-        }
+static void LogInputLatencyStats(Input_queue *queue) {
+    Latency_histogram *histogram = queue->latency;
+    if (histogram == NULL || histogram->count == 0) {
+        return;
     }
-}
 
-static void MoveRight(Board *board, bool *didMove, i32 *score) {
-    for (i32 x = TILE_COUNT_X - 2; x >= 0; --x) {
-        for (i32 y = 0; y < TILE_COUNT_Y; ++y) {
-            i32 index = y * TILE_COUNT_X + x;
-            HandleMovement(board, index, 1, &HandleMovement_Right, didMove, score);
-        }
-    }
+    TraceLog(LOG_INFO, "INPUT: %lld moves, latency mean %.1f ms, p50 %.1f ms, p99 %.1f ms, max %.1f ms, %d dropped", 
+        (long long)histogram->count, 1000.0 * GetLatencyMean(histogram), 1000.0 * GetLatencyPercentile(histogram, 0.5), 
+        1000.0 * GetLatencyPercentile(histogram, 0.99), 1000.0 * histogram->max, queue->dropped);
 }
 
-static bool Move(Board *board, Keybinds *keybinds, i32 *score) {
-    bool didMove = false;
-
-    Board newBoard = {.movingTiles.timer = TILE_MOVE_DURATION};
-    for (i32 i = 0; i < TILE_COUNT; ++i) {
-        newBoard.board[i] = board->board[i];
-    }
-
-    if (IsKeyPressed(keybinds->up)) {
-        MoveUp(&newBoard, &didMove, score);
-    } else if (IsKeyPressed(keybinds->down)) {
-        MoveDown(&newBoard, &didMove, score);
-    } else if (IsKeyPressed(keybinds->left)) {
-        MoveLeft(&newBoard, &didMove, score);
-    } else if (IsKeyPressed(keybinds->right)) {
-        MoveRight(&newBoard, &didMove, score);
-    } 
+// Formatted once so that drawing tiles doesn't go through TextFormat's ring buffer every frame
+static const char *GetTileString(i32 tile) {
+    static char strings[TILE_STRING_COUNT][TILE_STRING_LENGTH];
+    static bool isInitialized = false;
 
-    if (didMove) {
-        *board = newBoard;
+    if (!isInitialized) {
+        for (i32 i = 0; i < TILE_STRING_COUNT; ++i) {
+            snprintf(strings[i], TILE_STRING_LENGTH, "%u", PowerOf2(i));
+        }
+        isInitialized = true;
     }
 
-    return didMove;
+    return strings[MinI32(MaxI32(tile, 0), TILE_STRING_COUNT - 1)];
 }
 
-static DrawTileNumber(i32 tile, f32 tileX, f32 tileY, Font font) {
-    u32 value = PowerOf2(tile);
+static void DrawTileNumber(i32 tile, f32 tileX, f32 tileY, Font font) {
     Color colour = tile > 2 ? COLOUR_TEXT_ALT : COLOUR_TEXT;
     f32 size = 
         tile < 7 ? // 2 digits
@@ -371,7 +356,7 @@ static DrawTileNumber(i32 tile, f32 tileX, f32 tileY, Font font) {
                     TEXT_SIZE_TILE_2 : 
                     TEXT_SIZE_TILE_3; // 5+ digits
 
-    const char *str = TextFormat("%d", value);
+    const char *str = GetTileString(tile);
     Vector2 strSize = MeasureTextEx(font, str, size, 0);
     Vector2 strPos = {
         .x = tileX + TILE_SIZE / 2 - strSize.x / 2, 
@@ -381,7 +366,7 @@ static DrawTileNumber(i32 tile, f32 tileX, f32 tileY, Font font) {
     DrawTextEx(font, str, strPos, size, 0, colour);
 }
 
-static void DisplayBoard(Board *board, Font font) {
+static void DisplayBoard(Board *board, u32 hiddenCells, Font font) {
     DrawRectangleRounded(BOARD_BACKGROUND, 0.04f, 4, COLOUR_BOARD_BACKGROUND);
 
     f32 tileY = BOARD_BACKGROUND.y + TILE_SPACING;
@@ -389,7 +374,7 @@ static void DisplayBoard(Board *board, Font font) {
         f32 tileX = BOARD_BACKGROUND.x + TILE_SPACING;
         for (i32 x = 0; x < TILE_COUNT_X; ++x) {
             i32 tileIndex = y * TILE_COUNT_X + x;
-            if (IsTileMoving(tileIndex, &board->movingTiles) || tileIndex == board->newTile) {
+            if (hiddenCells & CELL_BIT(tileIndex)) {
                 DrawRectangle(tileX, tileY, TILE_SIZE, TILE_SIZE, COLOUR_TILES[0]);
                 tileX += TILE_SIZE + TILE_SPACING;
                 continue;
@@ -409,33 +394,40 @@ static void DisplayBoard(Board *board, Font font) {
     }
 }
 
-static void DisplayNewTile(Board *board) {
-    f32 t = (TILE_MOVE_DURATION - board->movingTiles.timer) / TILE_MOVE_DURATION;
-
+static void DisplayNewTiles(Tile_animation *animation, f32 t) {
     f32 size = TILE_SIZE * t;
 
-    i32 indexX = board->newTile % TILE_COUNT_X;
-    i32 indexY = board->newTile / TILE_COUNT_X;
+    for (i32 i = 0; i < animation->events.count; ++i) {
+        Tile_event *event = &animation->events.events[i];
+        if (event->type != TILE_EVENT_SPAWN) {
+            continue;
+        }
 
-    f32 x = BOARD_BACKGROUND.x + TILE_SPACING + indexX * (TILE_SIZE + TILE_SPACING) + TILE_SIZE / 2 - size / 2;
-    f32 y = BOARD_BACKGROUND.y + TILE_SPACING + indexY * (TILE_SIZE + TILE_SPACING) + TILE_SIZE / 2 - size / 2;
+        i32 indexX = event->to % TILE_COUNT_X;
+        i32 indexY = event->to / TILE_COUNT_X;
 
-    i32 tile = board->board[board->newTile];
+        f32 x = BOARD_BACKGROUND.x + TILE_SPACING + indexX * (TILE_SIZE + TILE_SPACING) + TILE_SIZE / 2 - size / 2;
+        f32 y = BOARD_BACKGROUND.y + TILE_SPACING + indexY * (TILE_SIZE + TILE_SPACING) + TILE_SIZE / 2 - size / 2;
 
-    DrawRectangle(x, y, size, size, COLOUR_TILES[tile]);
+        DrawRectangle(x, y, size, size, COLOUR_TILES[event->value]);
+    }
 }
 
-static void DisplayMovingTiles(Board *board, Font font) {
-    f32 t = (TILE_MOVE_DURATION - board->movingTiles.timer) / TILE_MOVE_DURATION;
-    for (i32 i = 0; i < board->movingTiles.count; ++i) {
-        i32 startIndexX = board->movingTiles.startIndices[i] % TILE_COUNT_X;
-        i32 startIndexY = board->movingTiles.startIndices[i] / TILE_COUNT_X;
+static void DisplayMovingTiles(Tile_animation *animation, f32 t, Font font) {
+    for (i32 i = 0; i < animation->events.count; ++i) {
+        Tile_event *event = &animation->events.events[i];
+        if (event->type == TILE_EVENT_SPAWN) {
+            continue;
+        }
+
+        i32 startIndexX = event->from % TILE_COUNT_X;
+        i32 startIndexY = event->from / TILE_COUNT_X;
 
         f32 startX = BOARD_BACKGROUND.x + TILE_SPACING + startIndexX * (TILE_SIZE + TILE_SPACING);
         f32 startY = BOARD_BACKGROUND.y + TILE_SPACING + startIndexY * (TILE_SIZE + TILE_SPACING);
 
-        i32 endIndexX = board->movingTiles.endIndices[i] % TILE_COUNT_X;
-        i32 endIndexY = board->movingTiles.endIndices[i] / TILE_COUNT_X;
+        i32 endIndexX = event->to % TILE_COUNT_X;
+        i32 endIndexY = event->to / TILE_COUNT_X;
 
         f32 endX = BOARD_BACKGROUND.x + TILE_SPACING + endIndexX * (TILE_SIZE + TILE_SPACING);
         f32 endY = BOARD_BACKGROUND.y + TILE_SPACING + endIndexY * (TILE_SIZE + TILE_SPACING);
@@ -443,24 +435,18 @@ static void DisplayMovingTiles(Board *board, Font font) {
         f32 tileX = startX + t * (endX - startX);
         f32 tileY = startY + t * (endY - startY);
 
-        i32 tile = board->board[board->movingTiles.endIndices[i]];
+        i32 tile = event->value;
 
         Color colour1 = COLOUR_TILES[MinI32(tile, COLOUR_TILES_COUNT - 1)];
         Color colour2 = colour1;
 
+        // The tile that stays put in a merge isn't an event of its own, so it's drawn here unless the other half
+        // of the merge slid in too
         bool shouldRender = false;
-        if (board->combinedTiles[board->movingTiles.endIndices[i]]) {
-            tile -= 1;
+        if (animation->events.mergedCells & CELL_BIT(event->to)) {
+            colour2 = COLOUR_TILES[MinI32(tile + 1, COLOUR_TILES_COUNT - 1)];
 
-            colour1 = COLOUR_TILES[MinI32(tile, COLOUR_TILES_COUNT - 1)];
-
-            shouldRender = true;
-            for (i32 j = 0; j < board->movingTiles.count; ++j) {
-                if (j != i && board->movingTiles.endIndices[j] == board->movingTiles.endIndices[i]) {
-                    shouldRender = false;
-                    break;
-                }
-            }
+            shouldRender = !(animation->events.slidCells & CELL_BIT(event->to));
         }
 
         Color colour = {
@@ -488,9 +474,7 @@ static Vector2 GetTextPositionCentred(Rectangle rect, Font font, const char *tex
     };
 }
 
-static void DisplayGameOver(Font font, f32 timer, Button *buttonTryAgain) {
-    f32 t = (GAME_OVER_FADE_IN_DURATION - timer) / GAME_OVER_FADE_IN_DURATION;
-
+static void DisplayGameOver(Font font, f32 t, Button *buttonTryAgain) {
     Color colourOverlay = COLOUR_GAME_OVER_OVERLAY;
     colourOverlay.a *= t;
     Color colourText = COLOUR_TEXT;
@@ -514,8 +498,73 @@ static void DisplayGameOver(Font font, f32 timer, Button *buttonTryAgain) {
     DrawTextEx(buttonTryAgain->font, buttonTryAgain->text, buttonTryAgain->textPosition, buttonTryAgain->textSize, 0.0f, colourButtonText);
 }
 
+// A strip along the bottom of the board with a column per move, or per few moves in a long game, as tall as the
+// worst loss among them
+static void DisplayGameAnalysis(Font font, Game_analysis *analysis, f32 t) {
+    if (analysis->moves == NULL) {
+        return;
+    }
+
+    Color colourText = COLOUR_TEXT;
+    colourText.a *= t;
+    Color colourStrip = COLOUR_TILES[0];
+    colourStrip.a *= t;
+    Color colourLoss = COLOUR_TIMELINE_LOSS;
+    colourLoss.a *= t;
+
+    Rectangle strip = {
+        .x = BOARD_BACKGROUND.x + TIMELINE_MARGIN,
+        .y = BOARD_BACKGROUND.y + BOARD_BACKGROUND.height - TIMELINE_MARGIN - TIMELINE_HEIGHT,
+        .width = BOARD_BACKGROUND.width - 2 * TIMELINE_MARGIN,
+        .height = TIMELINE_HEIGHT
+    };
+    Vector2 labelPos = {
+        .x = strip.x,
+        .y = strip.y - TIMELINE_TEXT_SIZE - 4.0f
+    };
+
+    DrawRectangleRec(strip, colourStrip);
+
+    if (!AtomicLoadI32(&analysis->isDone)) {
+        DrawTextEx(font, "ANALYSING...", labelPos, TIMELINE_TEXT_SIZE, 0.0f, colourText);
+        return;
+    }
+
+    char label[64];
+    snprintf(label, sizeof(label), "BEST MOVE %.0f%% OF THE TIME", 100.0f * analysis->accuracy);
+    DrawTextEx(font, label, labelPos, TIMELINE_TEXT_SIZE, 0.0f, colourText);
+
+    if (analysis->maxLoss <= 0.0f) {
+        return;
+    }
+
+    i64 moveCount = analysis->replay.moveCount;
+    i32 columnCount = (i32)strip.width;
+    f32 columnWidth = 1.0f;
+    if (moveCount < columnCount) {
+        columnCount = moveCount;
+        columnWidth = strip.width / moveCount;
+    }
+
+    for (i32 i = 0; i < columnCount; ++i) {
+        i64 first = i * moveCount / columnCount;
+        i64 last = (i + 1) * moveCount / columnCount;
+
+        f32 loss = 0.0f;
+        for (i64 j = first; j < last; ++j) {
+            loss = MaxF32(loss, analysis->moves[j].loss);
+        }
+
+        // Square root, so that small slips still show next to a game-losing move
+        f32 height = strip.height * sqrtf(loss / analysis->maxLoss);
+        DrawRectangleRec((Rectangle){strip.x + i * columnWidth, strip.y + strip.height - height, columnWidth, height}, 
+            colourLoss);
+    }
+}
+
 static void DisplayScores(Font font, i32 score, i32 highscore) {
-    const char *highscoreStr = TextFormat("%d", highscore);
+    char highscoreStr[TILE_STRING_LENGTH];
+    snprintf(highscoreStr, sizeof(highscoreStr), "%d", highscore);
 
     f32 highscoreStrWidth = MeasureTextEx(font, highscoreStr, SCORE_DISPLAY_NUMBER_HEIGHT, 0.0f).x;
 
@@ -540,7 +589,8 @@ static void DisplayScores(Font font, i32 score, i32 highscore) {
     DrawTextEx(font, highscoreStr, highscoreStrPos, SCORE_DISPLAY_NUMBER_HEIGHT, 0.0f, COLOUR_TEXT_ALT);
     DrawTextEx(font, "BEST", highscoreLabelPos, SCORE_DISPLAY_TEXT_HEIGHT, 0.0f, COLOUR_TEXT_DISPLAY);
 
-    const char *scoreStr = TextFormat("%d", score);
+    char scoreStr[TILE_STRING_LENGTH];
+    snprintf(scoreStr, sizeof(scoreStr), "%d", score);
 
     f32 scoreStrWidth = MeasureTextEx(font, scoreStr, SCORE_DISPLAY_NUMBER_HEIGHT, 0.0f).x;
 
@@ -566,18 +616,32 @@ static void DisplayScores(Font font, i32 score, i32 highscore) {
     DrawTextEx(font, "SCORE", scoreLabelPos, SCORE_DISPLAY_TEXT_HEIGHT, 0.0f, COLOUR_TEXT_DISPLAY);
 }
 
-static void DisplayButtons(Button *newGame, Button *options, Texture2D *optionsSymbol, f32 optionsTimer) {
+// Next to the buttons, until the board changes
+static void DisplayHint(Font font, Direction hint, bool isFromBook) {
+    Vector2 labelPos = {
+        .x = BOARD_BACKGROUND.x + BUTTON_NEW_GAME_WIDTH + BUTTON_NEW_GAME_HEIGHT + 2 * SCORE_DISPLAY_SPACING,
+        .y = BOARD_PADDING + 4.0f
+    };
+    Vector2 hintPos = {
+        .x = labelPos.x,
+        .y = labelPos.y + HINT_LABEL_TEXT_SIZE
+    };
+
+    DrawTextEx(font, isFromBook ? "HINT (BOOK)" : "HINT", labelPos, HINT_LABEL_TEXT_SIZE, 0.0f, COLOUR_TEXT);
+    DrawTextEx(font, GetDirectionName(hint), hintPos, HINT_TEXT_SIZE, 0.0f, COLOUR_TEXT);
+}
+
+static void DisplayButtons(Button *newGame, Button *options, Texture2D *optionsSymbol, f32 optionsFade) {
     DrawRectangleRounded(newGame->rectangle, 0.3f, 4, GetButtonColour(newGame, false));
     DrawTextEx(newGame->font, newGame->text, newGame->textPosition, newGame->textSize, 0.0f, GetButtonColour(newGame, true));
 
     DrawRectangleRounded(options->rectangle, 0.3f, 4, GetButtonColour(options, false));
 
-    if (optionsTimer == 0.0f || optionsTimer == OPTIONS_TIMER_DURATION) {
+    if (optionsFade == 0.0f || optionsFade == 1.0f) {
         DrawTexture(*optionsSymbol, options->rectangle.x + options->rectangle.width / 2.0f - optionsSymbol->width / 2.0f, 
             options->rectangle.y + options->rectangle.height / 2.0f - optionsSymbol->height / 2.0f, WHITE);
     } else {
-        f32 t = (OPTIONS_TIMER_DURATION - optionsTimer) / OPTIONS_TIMER_DURATION;
-        f32 rotation = 60.0f * t;
+        f32 rotation = 60.0f * optionsFade;
 
         Rectangle symbolSrc = {
             .x = 0.0f,
@@ -599,14 +663,12 @@ static void DisplayButtons(Button *newGame, Button *options, Texture2D *optionsS
     }
 }
 
-static void DisplayCombinedTiles(Board *board, Font font) {
-    f32 t = (TILE_COMBINE_DURATION - board->combinedTimer) / TILE_COMBINE_DURATION;
-    t = -4.0f * t * (t - 1.0f);
+static void DisplayCombinedTiles(Board *board, Tile_animation *animation, f32 t, Font font) {
     f32 deltaSize = TILE_COMBINE_DELTA_SIZE * t;
     for (i32 y = 0; y < TILE_COUNT_Y; ++y) {
         for (i32 x = 0; x < TILE_COUNT_X; ++x) {
             i32 index = y * TILE_COUNT_X + x;
-            if (board->combinedTiles[index]) {
+            if (animation->events.mergedCells & CELL_BIT(index)) {
                 i32 tile = board->board[index];
 
                 f32 tileX = BOARD_BACKGROUND.x + TILE_SPACING + x * (TILE_SIZE + TILE_SPACING);
@@ -614,7 +676,6 @@ static void DisplayCombinedTiles(Board *board, Font font) {
 
                 DrawRectangle(tileX  - deltaSize / 2, tileY  - deltaSize / 2, TILE_SIZE + deltaSize, TILE_SIZE + deltaSize, COLOUR_TILES[tile]);
 
-                u32 value = PowerOf2(tile);
                 Color colour = tile > 2 ? COLOUR_TEXT_ALT : COLOUR_TEXT;
                 f32 size = 
                     tile < 7 ? // 2 digits
@@ -626,7 +687,7 @@ static void DisplayCombinedTiles(Board *board, Font font) {
                     TEXT_SIZE_TILE_3; // 5+ digits
                 size += deltaSize;
 
-                const char *str = TextFormat("%d", value);
+                const char *str = GetTileString(tile);
                 Vector2 strSize = MeasureTextEx(font, str, size, 0);
                 Vector2 strPos = {
                     .x = tileX + TILE_SIZE / 2 - strSize.x / 2, 
@@ -639,9 +700,7 @@ static void DisplayCombinedTiles(Board *board, Font font) {
     }
 }
 
-static void DisplayOptions(Button *buttonsKeybinds, f32 optionsTimer, i32 buttonToBindIndex, Button *buttonVolumeSlider, Button *buttonMusicSlider) {
-    f32 t = (OPTIONS_TIMER_DURATION - optionsTimer) / OPTIONS_TIMER_DURATION;
-
+static void DisplayOptions(Button *buttonsKeybinds, f32 t, i32 buttonToBindIndex, Button *buttonVolumeSlider, Button *buttonMusicSlider) {
     Color colourOverlay = COLOUR_GAME_OVER_OVERLAY;
     colourOverlay.a *= t;
 
@@ -732,35 +791,41 @@ static i32 LoadHighscore(const char *path) {
     }
 
     cJSON *player = cJSON_GetObjectItem(json, "player");
-    i32 highscore = cJSON_GetObjectItem(player, "highscore")->valueint;
+    cJSON *highscoreItem = cJSON_GetObjectItem(player, "highscore");
+    i32 highscore = highscoreItem != NULL ? highscoreItem->valueint : 0;
 
-    free(json);
+    cJSON_Delete(json);
 
     return highscore;
 }
 
-// TODO: Also save keybinds and volume?
-static bool SaveHighscore(const char *path, i32 val) {
-    cJSON *json = LoadJSON(path);
-    if (json == NULL) {
-        return false;
+// A game ends when it's lost, when a new one replaces it or when the window closes. The results store keeps it unless
+// it never got a move.
+static void RecordGameResult(Results_store *results, History *history, const Board *board, u64 seed, i32 score, 
+    f64 duration) {
+    i64 moveCount = GetHistoryLength(history) - 1;
+    if (moveCount <= 0) {
+        return;
     }
 
-    cJSON *player = cJSON_GetObjectItem(json, "player");
-    cJSON *highscore = cJSON_GetObjectItem(player, "highscore");
-    cJSON_SetIntValue(highscore, val);
-
-    char *str = cJSON_Print(json);
-
-    free(json);
-
-    if (!SaveFileText(path, str)) {
-        return false;
+    i32 maxTile = 0;
+    for (i32 i = 0; i < TILE_COUNT; ++i) {
+        maxTile = MaxI32(maxTile, board->board[i]);
     }
 
-    free(str);
-
-    return true;
+    Result_row row = {
+        .seed = seed,
+        .time = (i64)time(NULL),
+        .score = score,
+        .moveCount = (u32)moveCount,
+        .duration = (f32)duration,
+        .maxTile = (u8)maxTile,
+        .boardSize = TILE_COUNT_X,
+        .policy = RESULT_POLICY_HUMAN
+    };
+    if (!AddResult(results, &row)) {
+        TraceLog(LOG_WARNING, "Could not record the game in %s.log", RESULTS_DEFAULT_PATH);
+    }
 }
 
 static const char *KeyCodeToString(i32 key) {
@@ -869,9 +934,46 @@ static const char *KeyCodeToString(i32 key) {
         case(KEY_KP_ENTER):      return "Keypad enter"; // Keypad Enter
         case(KEY_KP_EQUAL):      return "Keypad equal"; // Keypad Equal
 
-        default:                 return TextFormat("Undefined: %d", key);
+        default:                 break;
+    }
+
+    // The result is kept around as button text, so it can't live in TextFormat's ring buffer
+    static char undefinedStrings[UNDEFINED_KEY_STRING_COUNT][UNDEFINED_KEY_STRING_LENGTH];
+    if (key < 0 || key >= UNDEFINED_KEY_STRING_COUNT) {
+        return "Undefined";
     }
+
+    if (undefinedStrings[key][0] == '\0') {
+        snprintf(undefinedStrings[key], UNDEFINED_KEY_STRING_LENGTH, "Undefined: %d", key);
+    }
+
+    return undefinedStrings[key];
+}
+
+static void LogAllocStats(Alloc_stats *stats) {
+    if (stats->total.allocs == 0 && stats->total.frees == 0) {
+        return;
+    }
+
+    for (i32 i = 0; i < ALLOC_TAG_COUNT; ++i) {
+        if (stats->tags[i].allocs != 0 || stats->tags[i].frees != 0) {
+            TraceLog(LOG_INFO, "ALLOC: %s: %d allocs, %d frees, %lld bytes this frame", GetAllocTagName(i), 
+                stats->tags[i].allocs, stats->tags[i].frees, (long long)stats->tags[i].bytes);
+        }
+    }
+}
+
+#ifdef _DEBUG
+static void DisplayAllocStats(Alloc_stats *stats, Font font) {
+    Alloc_stats totals = GetAllocTotals();
+
+    char str[64];
+    snprintf(str, sizeof(str), "allocs/frame: %d  live: %lld B", stats->total.allocs, (long long)totals.total.bytes);
+
+    Vector2 strPos = {.x = BOARD_PADDING, .y = 2.0f};
+    DrawTextEx(font, str, strPos, 16.0f, 0.0f, stats->total.allocs > 0 ? COLOUR_BUTTON_HELD : COLOUR_TEXT);
 }
+#endif
 
 static void UpdateButtonState(Button *button) {
     if (!button->isActive) {
@@ -908,7 +1010,372 @@ static void UpdateButtonState(Button *button) {
     }
 }
 
-int main() {
+typedef struct Wall_stats {
+    i32 quadCount;
+    i32 drawCount;
+} Wall_stats;
+
+// Every tile the wall can show, the board background and the game over overlay, drawn once with the game's own
+// colours and font. The render texture comes out upside down, so it's copied into a plain texture the right way up.
+static Texture2D BuildTileAtlas(Font font) {
+    i32 rowCount = (ATLAS_CELL_COUNT + ATLAS_COLUMNS - 1) / ATLAS_COLUMNS;
+    RenderTexture2D target = LoadRenderTexture(ATLAS_COLUMNS * ATLAS_CELL_STRIDE, rowCount * ATLAS_CELL_STRIDE);
+
+    BeginTextureMode(target);
+    ClearBackground(BLANK);
+    for (i32 i = 0; i < ATLAS_CELL_COUNT; ++i) {
+        i32 x = (i % ATLAS_COLUMNS) * ATLAS_CELL_STRIDE;
+        i32 y = (i / ATLAS_COLUMNS) * ATLAS_CELL_STRIDE;
+
+        // The overlay is stored opaque and gets its alpha from the tint it's drawn with
+        Color colour = 
+            i == ATLAS_CELL_BOARD ? 
+                COLOUR_BOARD_BACKGROUND : 
+                i == ATLAS_CELL_OVERLAY ? 
+                    (Color){COLOUR_GAME_OVER_OVERLAY.r, COLOUR_GAME_OVER_OVERLAY.g, COLOUR_GAME_OVER_OVERLAY.b, 255} : 
+                    COLOUR_TILES[MinI32(i, COLOUR_TILES_COUNT - 1)];
+        DrawRectangle(x, y, ATLAS_CELL_STRIDE, ATLAS_CELL_STRIDE, colour);
+
+        if (i > 0 && i < ATLAS_CELL_BOARD) {
+            DrawTileNumber(i, x + ATLAS_PADDING, y + ATLAS_PADDING, font);
+        }
+    }
+    EndTextureMode();
+
+    Image image = LoadImageFromTexture(target.texture);
+    ImageFlipVertical(&image);
+    Texture2D atlas = LoadTextureFromImage(image);
+    UnloadImage(image);
+    UnloadRenderTexture(target);
+
+    // Tiles on a full wall are a fraction of their size in the atlas
+    GenTextureMipmaps(&atlas);
+    SetTextureFilter(atlas, TEXTURE_FILTER_TRILINEAR);
+
+    return atlas;
+}
+
+static void DrawAtlasCell(Texture2D atlas, i32 cell, Rectangle destination, Color tint, Wall_stats *stats) {
+    // With one texture for the whole wall, a full batch is the only thing that costs another draw call
+    if (rlCheckRenderBatchLimit(4)) {
+        ++stats->drawCount;
+    }
+
+    Rectangle source = {
+        .x = (cell % ATLAS_COLUMNS) * ATLAS_CELL_STRIDE + ATLAS_PADDING,
+        .y = (cell / ATLAS_COLUMNS) * ATLAS_CELL_STRIDE + ATLAS_PADDING,
+        .width = TILE_SIZE,
+        .height = TILE_SIZE
+    };
+    DrawTexturePro(atlas, source, destination, (Vector2){0}, 0.0f, tint);
+    ++stats->quadCount;
+}
+
+// The games in a grid as close to square as the window allows, each board laid out like BOARD_BACKGROUND scaled down.
+// Everything is a quad from the atlas, so rlgl batches the whole wall together.
+static Wall_stats DisplaySpectatorWall(const Spectator *spectator, Texture2D atlas) {
+    Wall_stats stats = {0};
+
+    f32 width = GetScreenWidth();
+    f32 height = GetScreenHeight() - SPECTATOR_HEADER_HEIGHT;
+    i32 columnCount = MinI32(MaxI32((i32)ceilf(sqrtf(spectator->gameCount * width / height)), 1), spectator->gameCount);
+    i32 rowCount = (spectator->gameCount + columnCount - 1) / columnCount;
+
+    f32 cellSize = MinF32(width / columnCount, height / rowCount);
+    f32 margin = cellSize * SPECTATOR_BOARD_MARGIN;
+    f32 scale = (cellSize - 2 * margin) / BOARD_BACKGROUND.width;
+    f32 tileSize = TILE_SIZE * scale;
+    f32 tileSpacing = TILE_SPACING * scale;
+    Vector2 origin = {
+        .x = (width - columnCount * cellSize) / 2,
+        .y = SPECTATOR_HEADER_HEIGHT + (height - rowCount * cellSize) / 2
+    };
+
+    for (i32 i = 0; i < spectator->gameCount; ++i) {
+        const Spectator_game *game = &spectator->games[i];
+        Rectangle board = {
+            .x = origin.x + (i % columnCount) * cellSize + margin,
+            .y = origin.y + (i / columnCount) * cellSize + margin,
+            .width = BOARD_BACKGROUND.width * scale,
+            .height = BOARD_BACKGROUND.height * scale
+        };
+        DrawAtlasCell(atlas, ATLAS_CELL_BOARD, board, WHITE, &stats);
+
+        for (i32 j = 0; j < TILE_COUNT; ++j) {
+            Rectangle tile = {
+                .x = board.x + tileSpacing + (j % TILE_COUNT_X) * (tileSize + tileSpacing),
+                .y = board.y + tileSpacing + (j / TILE_COUNT_X) * (tileSize + tileSpacing),
+                .width = tileSize,
+                .height = tileSize
+            };
+            i32 exponent = (game->board >> (PACKED_TILE_BITS * j)) & PACKED_TILE_MASK;
+            DrawAtlasCell(atlas, exponent, tile, WHITE, &stats);
+        }
+
+        if (game->isOver) {
+            DrawAtlasCell(atlas, ATLAS_CELL_OVERLAY, board, (Color){255, 255, 255, COLOUR_GAME_OVER_OVERLAY.a}, &stats);
+        }
+    }
+
+    // The wall's last batch goes now, before the header's text switches texture
+    rlDrawRenderBatchActive();
+    ++stats.drawCount;
+
+    return stats;
+}
+
+// Opens its own window, with as many games as asked for (up to SPECTATOR_MAX_GAMES) played by bots
+static i32 RunSpectator(i32 gameCount, f64 movesPerSecond) {
+    SetConfigFlags(FLAG_WINDOW_RESIZABLE);
+    InitWindow(SPECTATOR_WINDOW_WIDTH, SPECTATOR_WINDOW_HEIGHT, "2048 spectator");
+    SetTargetFPS(GetMonitorRefreshRate(GetCurrentMonitor()));
+
+    Font font = LoadFontEx("assets/fonts/ClearSans-Bold.ttf", FONT_SIZE, NULL, 0);
+    SetTextureFilter(font.texture, TEXTURE_FILTER_BILINEAR);
+    Texture2D atlas = BuildTileAtlas(font);
+
+    Book book;
+    OpenBook(&book, BOOK_DEFAULT_PATH);
+
+    Spectator *spectator = TrackedAlloc(sizeof(Spectator), ALLOC_TAG_GAME);
+    InitSpectator(spectator, gameCount, movesPerSecond, time(NULL), GetTime(), &book);
+
+    // Moves/s over the last whole second
+    f64 rateStart = GetTime();
+    i64 rateMoveCount = 0;
+    f64 moveRate = 0.0;
+
+    while (!WindowShouldClose()) {
+        StepSpectator(spectator, GetTime());
+
+        if (GetTime() - rateStart >= 1.0) {
+            moveRate = (spectator->moveCount - rateMoveCount) / (GetTime() - rateStart);
+            rateStart = GetTime();
+            rateMoveCount = spectator->moveCount;
+        }
+
+        BeginDrawing();
+        ClearBackground(COLOUR_BACKGROUND);
+
+        Wall_stats stats = DisplaySpectatorWall(spectator, atlas);
+
+        // The header is one more draw call, for the font's texture
+        char header[128];
+        snprintf(header, sizeof(header), "%d games   %d quads in %d draw calls   %d fps (%.1f ms)   %.0f moves/s", 
+            spectator->gameCount, stats.quadCount, stats.drawCount + 1, GetFPS(), 1000.0f * GetFrameTime(), moveRate);
+        Vector2 headerPos = {
+            .x = (SPECTATOR_HEADER_HEIGHT - SPECTATOR_TEXT_SIZE) / 2,
+            .y = (SPECTATOR_HEADER_HEIGHT - SPECTATOR_TEXT_SIZE) / 2
+        };
+        DrawTextEx(font, header, headerPos, SPECTATOR_TEXT_SIZE, 0.0f, COLOUR_TEXT);
+
+        EndDrawing();
+    }
+
+    TrackedFree(spectator, ALLOC_TAG_GAME);
+    CloseBook(&book);
+    UnloadTexture(atlas);
+    UnloadFont(font);
+    CloseWindow();
+
+    return 0;
+}
+
+static void PrintUsage(const char *program) {
+    fprintf(stderr, "Usage:\n");
+    fprintf(stderr, "  %s                                    Play the game\n", program);
+    fprintf(stderr, "  %s --server [address] [maxSessions]   Run a headless game server\n", program);
+    fprintf(stderr, "  %s --loadgen [address] [seconds]      Load test a running server\n", program);
+    fprintf(stderr, "  %s --bench-env [games] [seconds]      Benchmark the batch environment\n", program);
+    fprintf(stderr, "  %s --shm-env [name] [games]           Serve games to a trainer through shared memory\n", program);
+    fprintf(stderr, "  %s --shm-client [name] [seconds]      Test client for --shm-env\n", program);
+    fprintf(stderr, "  %s --bench-shm [games] [seconds]      Compare shared memory with a socket round trip\n", program);
+    fprintf(stderr, "  %s --fuzz [boards] [threads] [seed]   Check the move engines against MoveBoard\n", program);
+    fprintf(stderr, "  %s --simulate [games] [threads] [seed] [prefix] [results]  Play random games and collect statistics\n", program);
+    fprintf(stderr, "  %s --stats <games.bin>                Statistics of a --simulate run\n", program);
+    fprintf(stderr, "  %s --results-top [count] [results]    Best games in a results store\n", program);
+    fprintf(stderr, "  %s --results-seed <seed> [results]    Games of a seed in a results store\n", program);
+    fprintf(stderr, "  %s --results-time <from> <to> [results]  Games that ended between two Unix times\n", program);
+    fprintf(stderr, "  %s --results-index [results]          Index the games appended since the last time\n", program);
+    fprintf(stderr, "  %s --bench-results [rows] [results]   Append, index and query speed of a results store\n", program);
+    fprintf(stderr, "  %s --job <directory> [workers] [games] [seed] [shardSize]  Run or resume a sharded simulation\n", program);
+    fprintf(stderr, "  %s --build-book [moves] [depth] [threads] [path]  Search the first moves of every game into a book\n", program);
+    fprintf(stderr, "  %s --bench-book [path]                Lookup latency of a book\n", program);
+    fprintf(stderr, "  %s --bench-cache [games] [depth]      Search cache hit rate with and without symmetry\n", program);
+    fprintf(stderr, "  %s --bench-perf [calls]               Hardware counters of the move engines, CanMove and spawns\n", program);
+    fprintf(stderr, "  %s --build-tables [path]              Write the move tables (part of the build)\n", program);
+    fprintf(stderr, "  %s --bench-tables [processes] [path]  Load time and per-process memory of the move tables\n", program);
+    fprintf(stderr, "  %s --solve [size] [target] [threads] [path]  Solve a 2x2 or 3x3 board exactly\n", program);
+    fprintf(stderr, "  %s --record-game <replay> [depth] [random%%] [seed]  Play a game with the search and save its replay\n", program);
+    fprintf(stderr, "  %s --analyse <replay> [report] [threads] [depth]  Rate every move of a replay against the search\n", program);
+    fprintf(stderr, "  %s --arena [games] [threads] [seed] [json] [policies]  Compare the bots on the same games\n", program);
+    fprintf(stderr, "  %s --bench-mcts [games] [iterations] [threads] [tree|root] [random|greedy]  Play with MCTS\n", program);
+    fprintf(stderr, "  %s --spectate [games] [moves/s]         Watch up to %d bots play at once\n", program, SPECTATOR_MAX_GAMES);
+    fprintf(stderr, "  %s --adversary [seconds] [threads] [board]  Tile guaranteed against the worst spawns (board in hex)\n", program);
+    fprintf(stderr, "  %s --bench-corpus [games] [threads] [seed] [path]  Size and decode speed of a compressed game corpus\n", program);
+    fprintf(stderr, "  %s --corpus-game <id> [path]          Print one game of a corpus\n", program);
+    fprintf(stderr, "Addresses are either [host:]port or unix:path, the default is %s\n", DEFAULT_SERVER_ADDRESS);
+}
+
+// The headless modes run without a window. Returns the exit code, or -1 to start the game.
+static i32 RunCommandLine(i32 argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "--build-tables") == 0) {
+        return WriteMoveTables(argc > 2 ? argv[2] : MOVE_TABLES_DEFAULT_PATH);
+    }
+
+    // Before any mode starts threads or worker processes, which then all use this one mapping
+    GetMoveTables();
+
+    if (argc < 2) {
+        return -1;
+    }
+
+    // raylib logs every CompressData call at LOG_INFO, which the headless modes would otherwise print and time
+    SetTraceLogLevel(LOG_WARNING);
+
+    if (strcmp(argv[1], "--server") == 0) {
+        return RunServer(argc > 2 ? argv[2] : DEFAULT_SERVER_ADDRESS, argc > 3 ? atoi(argv[3]) : SERVER_DEFAULT_MAX_SESSIONS);
+    }
+
+    if (strcmp(argv[1], "--loadgen") == 0) {
+        return RunLoadGenerator(argc > 2 ? argv[2] : DEFAULT_SERVER_ADDRESS, argc > 3 ? atof(argv[3]) : 5.0);
+    }
+
+    if (strcmp(argv[1], "--bench-env") == 0) {
+        return RunBatchEnvBenchmark(argc > 2 ? atoi(argv[2]) : 4096, argc > 3 ? atof(argv[3]) : 2.0);
+    }
+
+    if (strcmp(argv[1], "--shm-env") == 0) {
+        return RunShmEnv(argc > 2 ? argv[2] : SHM_ENV_DEFAULT_NAME, argc > 3 ? atoi(argv[3]) : 256);
+    }
+
+    if (strcmp(argv[1], "--shm-client") == 0) {
+        return RunShmClient(argc > 2 ? argv[2] : SHM_ENV_DEFAULT_NAME, argc > 3 ? atof(argv[3]) : 5.0);
+    }
+
+    if (strcmp(argv[1], "--bench-shm") == 0) {
+        return RunShmBenchmark(argc > 2 ? atoi(argv[2]) : 256, argc > 3 ? atof(argv[3]) : 2.0);
+    }
+
+    if (strcmp(argv[1], "--fuzz") == 0) {
+        return RunFuzzer(argc > 2 ? atoll(argv[2]) : 100000000, argc > 3 ? atoi(argv[3]) : 0, 
+            argc > 4 ? strtoull(argv[4], NULL, 10) : (u64)time(NULL));
+    }
+
+    if (strcmp(argv[1], "--simulate") == 0) {
+        return RunSimulation(argc > 2 ? atoll(argv[2]) : 1000000, argc > 3 ? atoi(argv[3]) : 0, 
+            argc > 4 ? strtoull(argv[4], NULL, 10) : 0, argc > 5 ? argv[5] : "", argc > 6 ? argv[6] : NULL);
+    }
+
+    if (strcmp(argv[1], "--stats") == 0 && argc > 2) {
+        return RunStatsFromColumns(argv[2]);
+    }
+
+    if (strcmp(argv[1], "--results-top") == 0) {
+        return RunResultsTop(argc > 3 ? argv[3] : RESULTS_DEFAULT_PATH, argc > 2 ? atoi(argv[2]) : 10);
+    }
+
+    if (strcmp(argv[1], "--results-seed") == 0 && argc > 2) {
+        return RunResultsSeed(argc > 3 ? argv[3] : RESULTS_DEFAULT_PATH, strtoull(argv[2], NULL, 10));
+    }
+
+    if (strcmp(argv[1], "--results-time") == 0 && argc > 3) {
+        return RunResultsTime(argc > 4 ? argv[4] : RESULTS_DEFAULT_PATH, atoll(argv[2]), atoll(argv[3]));
+    }
+
+    if (strcmp(argv[1], "--results-index") == 0) {
+        return RunResultsIndex(argc > 2 ? argv[2] : RESULTS_DEFAULT_PATH);
+    }
+
+    if (strcmp(argv[1], "--bench-results") == 0) {
+        return RunResultsBenchmark(argc > 3 ? argv[3] : "results_bench", argc > 2 ? atoll(argv[2]) : 1000000);
+    }
+
+    if (strcmp(argv[1], "--job") == 0 && argc > 2) {
+        return RunJob(argv[2], argc > 3 ? atoi(argv[3]) : 0, argc > 4 ? atoll(argv[4]) : 0, 
+            argc > 5 ? strtoull(argv[5], NULL, 10) : 0, argc > 6 ? atoi(argv[6]) : 0);
+    }
+
+    if (strcmp(argv[1], "--build-book") == 0) {
+        return BuildBook(argc > 5 ? argv[5] : BOOK_DEFAULT_PATH, argc > 2 ? atoi(argv[2]) : BOOK_DEFAULT_MOVE_COUNT, 
+            argc > 3 ? atoi(argv[3]) : BOOK_DEFAULT_SEARCH_DEPTH, argc > 4 ? atoi(argv[4]) : 0);
+    }
+
+    if (strcmp(argv[1], "--bench-tables") == 0) {
+        return RunMoveTablesBenchmark(argc > 3 ? argv[3] : MOVE_TABLES_DEFAULT_PATH, argc > 2 ? atoi(argv[2]) : 8);
+    }
+
+    if (strcmp(argv[1], "--bench-book") == 0) {
+        return RunBookBenchmark(argc > 2 ? argv[2] : BOOK_DEFAULT_PATH);
+    }
+
+    if (strcmp(argv[1], "--bench-perf") == 0) {
+        return RunPerfBenchmark(argc > 2 ? atoll(argv[2]) : PERF_BENCHMARK_DEFAULT_COUNT);
+    }
+
+    if (strcmp(argv[1], "--bench-cache") == 0) {
+        return RunSearchCacheBenchmark(argc > 2 ? atoi(argv[2]) : SEARCH_BENCHMARK_GAMES, 
+            argc > 3 ? atoi(argv[3]) : SEARCH_DEFAULT_DEPTH);
+    }
+
+    if (strcmp(argv[1], "--solve") == 0) {
+        return RunSolver(argc > 2 ? atoi(argv[2]) : 3, argc > 3 ? atoi(argv[3]) : 0, argc > 4 ? atoi(argv[4]) : 0, 
+            argc > 5 ? argv[5] : SOLVER_DEFAULT_PATH);
+    }
+
+    if (strcmp(argv[1], "--record-game") == 0 && argc > 2) {
+        return RecordGame(argv[2], argc > 3 ? atoi(argv[3]) : ANALYSIS_DEFAULT_DEPTH, argc > 4 ? atoi(argv[4]) : 0, 
+            argc > 5 ? strtoull(argv[5], NULL, 10) : (u64)time(NULL));
+    }
+
+    if (strcmp(argv[1], "--analyse") == 0 && argc > 2) {
+        return RunAnalysis(argv[2], argc > 3 ? argv[3] : ANALYSIS_DEFAULT_REPORT_PATH, argc > 4 ? atoi(argv[4]) : 0, 
+            argc > 5 ? atoi(argv[5]) : ANALYSIS_DEFAULT_DEPTH);
+    }
+
+    if (strcmp(argv[1], "--arena") == 0) {
+        return RunArena(argc > 2 ? atoll(argv[2]) : ARENA_DEFAULT_GAMES, argc > 3 ? atoi(argv[3]) : 0, 
+            argc > 4 ? strtoull(argv[4], NULL, 10) : 0, argc > 5 ? argv[5] : ARENA_DEFAULT_JSON_PATH, 
+            argc > 6 ? argv[6] : NULL);
+    }
+
+    if (strcmp(argv[1], "--bench-mcts") == 0) {
+        return RunMctsBenchmark(argc > 2 ? atoi(argv[2]) : MCTS_BENCHMARK_GAMES, 
+            argc > 3 ? atoi(argv[3]) : MCTS_DEFAULT_ITERATIONS, argc > 4 ? atoi(argv[4]) : 0, 
+            argc > 5 ? argv[5] : NULL, argc > 6 ? argv[6] : NULL);
+    }
+
+    if (strcmp(argv[1], "--spectate") == 0) {
+        return RunSpectator(argc > 2 ? atoi(argv[2]) : SPECTATOR_DEFAULT_GAMES, 
+            argc > 3 ? atof(argv[3]) : SPECTATOR_DEFAULT_MOVE_RATE);
+    }
+
+    if (strcmp(argv[1], "--adversary") == 0) {
+        return RunAdversary(argc > 2 ? atof(argv[2]) : ADVERSARY_DEFAULT_SECONDS, argc > 3 ? atoi(argv[3]) : 0, 
+            argc > 4 ? strtoull(argv[4], NULL, 16) : 0);
+    }
+
+    if (strcmp(argv[1], "--bench-corpus") == 0) {
+        return RunCorpusBenchmark(argc > 5 ? argv[5] : CORPUS_DEFAULT_PATH, argc > 2 ? atoll(argv[2]) : CORPUS_DEFAULT_GAMES, 
+            argc > 3 ? atoi(argv[3]) : 0, argc > 4 ? strtoull(argv[4], NULL, 10) : CORPUS_DEFAULT_SEED);
+    }
+
+    if (strcmp(argv[1], "--corpus-game") == 0 && argc > 2) {
+        return RunCorpusGame(argc > 3 ? argv[3] : CORPUS_DEFAULT_PATH, strtoull(argv[2], NULL, 10));
+    }
+
+    PrintUsage(argv[0]);
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    InitJSONAllocHooks();
+
+    i32 exitCode = RunCommandLine(argc, argv);
+    if (exitCode >= 0) {
+        return exitCode;
+    }
+
     //SetConfigFlags(FLAG_MSAA_4X_HINT); // Doesn't do anything?
     InitWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "2048");
     SetTargetFPS(GetMonitorRefreshRate(GetCurrentMonitor()));
@@ -946,18 +1413,50 @@ int main() {
     // TODO: Change combine sfx to match number of combined tiles AND/OR highest tile value
     // TODO: 2048 win condition? Maybe just a sound effect or something idk
 
-    Board board = {.newTile = -1};
-    board.board[GetRandomFreeTile(&board.board)] = 1;
-    board.board[GetRandomFreeTile(&board.board)] = 1;
+    Rng rng = CreateRng(time(NULL));
+
+    Board board;
+    Tile_animation animation = {0};
+    Timeline timeline;
+    InitTimeline(&timeline);
+
+    // What a game's result is recorded under, ResetBoard from CreateRng(gameSeed) starts it again
+    u64 gameSeed = rng.state;
+    f64 gameStartTime = GetTime();
+    bool isGameRecorded = false;
+    ResetBoard(&board, &rng);
+
+    Successors successors;
+    ComputeSuccessors(&board, &successors, true);
 
     i32 score = 0;
-    i32 highscore = LoadHighscore("assets/data.json");
 
-    bool isGameOver = false;
-    f32 gameOverFadeInTimer = GAME_OVER_FADE_IN_DURATION;
+    History history;
+    InitHistory(&history);
+    PushHistory(&history, &board, &rng, score);
+
+    // BEST is the best game in the results store, or in data.json from before there was a store
+    Results_store results;
+    if (!OpenResultsStore(&results, RESULTS_DEFAULT_PATH)) {
+        TraceLog(LOG_WARNING, "Could not open the results in %s.log, games won't be recorded", RESULTS_DEFAULT_PATH);
+    }
+    i32 legacyHighscore = LoadHighscore("assets/data.json");
+    i32 highscore = MaxI32(legacyHighscore, GetBestScore(&results));
 
+    // Hints come from the book when it has the position (the file is optional) and from a search otherwise
+    Book book;
+    OpenBook(&book, BOOK_DEFAULT_PATH);
+    Search hintSearch;
+    InitSearch(&hintSearch, SEARCH_DEFAULT_DEPTH);
+
+    Packed_board hintBoard = 0;
+    Direction hint = DIRECTION_NONE;
+    bool isHintFromBook = false;
+
+    Game_analysis gameAnalysis = {0};
+
+    bool isGameOver = false;
     bool isOptionsMenuOpen = false;
-    f32 optionsTimer = OPTIONS_TIMER_DURATION;
 
     Button buttonTryAgain = {
         .rectangle = {
@@ -1100,7 +1599,21 @@ int main() {
             buttonsKeybinds[i].text, buttonsKeybinds[i].textSize);
     }
 
+    Alloc_stats allocStats = {0};
+
+    // Too big for the stack. Without it the game still runs, the latencies just aren't logged.
+    Latency_histogram *inputLatency = TrackedAlloc(sizeof(Latency_histogram), ALLOC_TAG_GAME);
+    if (inputLatency) {
+        memset(inputLatency, 0, sizeof(*inputLatency));
+    }
+    Input_queue inputQueue = CreateInputQueue(INPUT_MOVE_INTERVAL, INPUT_FAST_FORWARD_COUNT, inputLatency);
+
+    f32 simulationAccumulator = 0.0f;
+
     while (!WindowShouldClose()) {
+        BeginAllocFrame();
+        f64 frameStartTime = GetTime();
+
         UpdateMusicStream(testMusicIntro);
         UpdateMusicStream(testMusicLoop);
         if (!IsMusicStreamPlaying(testMusicIntro) && !IsMusicStreamPlaying(testMusicLoop)) {
@@ -1118,6 +1631,7 @@ int main() {
 
         if (buttonOptions.state == BUTTON_STATE_PRESSED && !isGameOver) {
             isOptionsMenuOpen = !isOptionsMenuOpen;
+            TweenTo(&timeline, TWEEN_OPTIONS, isOptionsMenuOpen ? 1.0f : 0.0f, OPTIONS_FADE_DURATION, EASING_LINEAR);
 
             if (isOptionsMenuOpen) {
                 for (i32 i = 0; i < KEY_BINDINGS_COUNT; ++i) {
@@ -1148,11 +1662,6 @@ int main() {
         }
 
         if (isOptionsMenuOpen) {
-            optionsTimer -= GetFrameTime();
-            if (optionsTimer < 0.0f) {
-                optionsTimer = 0.0f;
-            }
-
             for (i32 i = 0; i < KEY_BINDINGS_COUNT; ++i) {
                 if (buttonsKeybinds[i].state == BUTTON_STATE_PRESSED) {
                     buttonToBindIndex = i;
@@ -1205,74 +1714,61 @@ int main() {
                 SetMusicVolume(testMusicIntro, volume);
                 SetMusicVolume(testMusicLoop, volume);
             }
-        } else {
-            optionsTimer += GetFrameTime();
-            if (optionsTimer > OPTIONS_TIMER_DURATION) {
-                optionsTimer = OPTIONS_TIMER_DURATION;
-            }
         }
 
-        board.movingTiles.timer -= GetFrameTime();
-        if (board.movingTiles.timer <= 0.0f) {
-            board.movingTiles.timer = 0.0f;
-            board.movingTiles.count = 0;
-
-            if (board.newTile != -1) {
-                bool didAnyTilesCombine = false;
-                for (i32 i = 0; i < TILE_COUNT; ++i) {
-                    if (board.combinedTiles[i]) {
-                        didAnyTilesCombine = true;
-                        break;
-                    }
-                }
-                if (didAnyTilesCombine) {
-                    board.combinedTimer = TILE_COMBINE_DURATION;
-                    PlaySound(sfxCombineTiles);
-                }
+        simulationAccumulator += MinF32(GetFrameTime(), SIMULATION_MAX_FRAME_TIME);
+        while (simulationAccumulator >= SIMULATION_STEP) {
+            // Tweens only move in SIMULATION_STEP increments, never by the frame time directly, so animations and the
+            // sounds tied to them come out the same no matter how the frames are spaced
+            u32 finishedTweens = StepTimeline(&timeline, SIMULATION_STEP);
+            if (finishedTweens & TWEEN_BIT(TWEEN_MOVE)) {
+                FinishMoveAnimation(&animation, &timeline, sfxCombineTiles);
             }
 
-            board.newTile = -1;
+            simulationAccumulator -= SIMULATION_STEP;
         }
 
-        board.combinedTimer -= GetFrameTime();
-        if (board.combinedTimer < 0.0f) {
-            board.combinedTimer = -1.0f;
-        }
-
-        if (isGameOver) {
-            gameOverFadeInTimer -= GetFrameTime();
-            if (gameOverFadeInTimer < 0.0f) {
-                gameOverFadeInTimer = 0.0f;
+        if (buttonNewGame.state == BUTTON_STATE_PRESSED && !(isGameOver && IsTweenActive(&timeline, TWEEN_GAME_OVER))) {
+            if (!isGameRecorded) {
+                RecordGameResult(&results, &history, &board, gameSeed, score, GetTime() - gameStartTime);
+                highscore = MaxI32(legacyHighscore, GetBestScore(&results));
             }
-        }
 
-        if (buttonNewGame.state == BUTTON_STATE_PRESSED && !(isGameOver && gameOverFadeInTimer > 0.0f)) {
-            board = (Board){0};
-            board.board[GetRandomFreeTile(&board.board)] = 1;
-            board.board[GetRandomFreeTile(&board.board)] = 1;
+            ResetTileAnimation(&animation, &timeline);
+            gameSeed = rng.state;
+            gameStartTime = GetTime();
+            isGameRecorded = false;
+            ResetBoard(&board, &rng);
+            ComputeSuccessors(&board, &successors, true);
 
-            if (score > highscore) {
-                SaveHighscore("assets/data.json", score);
-                highscore = score;
-            }
             score = 0;
 
-            gameOverFadeInTimer = GAME_OVER_FADE_IN_DURATION;
+            ClearHistory(&history);
+            PushHistory(&history, &board, &rng, score);
+
+            SetTween(&timeline, TWEEN_GAME_OVER, 0.0f);
 
             isGameOver = false;
 
             PlaySound(sfxButtonPress);
         }
 
-        if ((buttonTryAgain.state == BUTTON_STATE_PRESSED || IsKeyPressed(KEY_ENTER)) && gameOverFadeInTimer == 0.0f) {
-            board = (Board){0};
-            board.board[GetRandomFreeTile(&board.board)] = 1;
-            board.board[GetRandomFreeTile(&board.board)] = 1;
+        if ((buttonTryAgain.state == BUTTON_STATE_PRESSED || IsKeyPressed(KEY_ENTER)) && isGameOver && 
+            !IsTweenActive(&timeline, TWEEN_GAME_OVER)) {
+            // Recorded when it was lost
+            ResetTileAnimation(&animation, &timeline);
+            gameSeed = rng.state;
+            gameStartTime = GetTime();
+            isGameRecorded = false;
+            ResetBoard(&board, &rng);
+            ComputeSuccessors(&board, &successors, true);
 
-            highscore = MaxI32(score, highscore);
             score = 0;
 
-            gameOverFadeInTimer = GAME_OVER_FADE_IN_DURATION;
+            ClearHistory(&history);
+            PushHistory(&history, &board, &rng, score);
+
+            SetTween(&timeline, TWEEN_GAME_OVER, 0.0f);
 
             isGameOver = false;
 
@@ -1281,74 +1777,170 @@ int main() {
             PlaySound(sfxButtonPress);
         }
 
-        if (!isGameOver && !isOptionsMenuOpen && Move(&board, &keybinds, &score)) {
-            board.newTile = GetRandomFreeTile(board.board);
-            board.board[board.newTile] = GetRandomValue(1, 2);
-            if (IsBoardFull(&board.board) && !CanMove(&board.board)) {
+        bool didUndo = false;
+        if (!isOptionsMenuOpen && IsControlDown()) {
+            if (IsKeyPressed(KEY_UNDO)) {
+                didUndo = UndoHistory(&history, &board, &rng, &score);
+            } else if (IsKeyPressed(KEY_REDO)) {
+                didUndo = RedoHistory(&history, &board, &rng, &score);
+            }
+        }
+
+        if (didUndo) {
+            ResetTileAnimation(&animation, &timeline);
+
+            ComputeSuccessors(&board, &successors, true);
+            ClearInputQueue(&inputQueue);
+
+            // Redo can land on the final position again
+            isGameOver = !successors.canMove;
+            buttonTryAgain.isActive = isGameOver;
+            SetTween(&timeline, TWEEN_GAME_OVER, isGameOver ? 1.0f : 0.0f);
+
+            PlaySound(sfxButtonPress);
+        }
+
+        if (!isGameOver && !isOptionsMenuOpen && !IsControlDown() && IsKeyPressed(KEY_HINT) && CanPackBoard(&board)) {
+            hintBoard = PackBoard(&board);
+            hint = SuggestMove(&book, &hintSearch, hintBoard, &isHintFromBook);
+        }
+
+        if (isGameOver || isOptionsMenuOpen || IsControlDown()) {
+            ClearInputQueue(&inputQueue);
+        } else {
+            PollDirectionPresses(&inputQueue, &keybinds, GetTime());
+        }
+
+        // Moves wait for the previous animation unless they are piling up, in which case it is skipped to the end
+        if (IsTweenActive(&timeline, TWEEN_MOVE) && ShouldFastForward(&inputQueue)) {
+            FinishMoveAnimation(&animation, &timeline, sfxCombineTiles);
+        }
+
+        Input_event input;
+        bool didApplyInput = !IsTweenActive(&timeline, TWEEN_MOVE) && PopInput(&inputQueue, GetTime(), &input);
+        Direction direction = didApplyInput ? input.direction : DIRECTION_NONE;
+        if (direction != DIRECTION_NONE && successors.moves[direction].didMove) {
+            board = successors.moves[direction].board;
+            score += successors.moves[direction].scoreDelta;
+
+            animation.events = successors.moves[direction].events;
+            PlayTween(&timeline, TWEEN_MOVE, TILE_MOVE_DURATION, EASING_LINEAR);
+            SetTween(&timeline, TWEEN_COMBINE, 0.0f);
+
+            i32 newTile = SpawnTile(&board, &rng);
+            AddSpawnEvent(&animation.events, newTile, board.board[newTile]);
+
+            PushHistory(&history, &board, &rng, score);
+
+            // Done now rather than on the next keypress, which then only has to pick one of them
+            ComputeSuccessors(&board, &successors, true);
+            if (!successors.canMove) {
                 isGameOver = true;
+                PlayTween(&timeline, TWEEN_GAME_OVER, GAME_OVER_FADE_IN_DURATION, EASING_LINEAR);
 
-                board.movingTiles.timer = 0.0f;
+                // No slide into the final position, straight to the merges
+                FinishMoveAnimation(&animation, &timeline, sfxCombineTiles);
 
                 buttonTryAgain.isActive = true;
 
-                if (score > highscore) {
-                    SaveHighscore("assets/data.json", score);
+                // Once per game, losing again after an undo doesn't add another row for the same seed
+                if (!isGameRecorded) {
+                    RecordGameResult(&results, &history, &board, gameSeed, score, GetTime() - gameStartTime);
+                    highscore = MaxI32(legacyHighscore, GetBestScore(&results));
+                    isGameRecorded = true;
                 }
 
                 PlaySound(sfxGameOver);
             } else {
-                // 12-ET
-                if (IsKeyPressed(keybinds.up)) {
-                    SetSoundPitch(sfxMoveTiles, 0.79370f);
-                } else if (IsKeyPressed(keybinds.down)) {
-                    SetSoundPitch(sfxMoveTiles, 0.89090f);
-                } else if (IsKeyPressed(keybinds.left)) {
-                    SetSoundPitch(sfxMoveTiles, 1.00000f);
-                } else if (IsKeyPressed(keybinds.right)) {
-                    SetSoundPitch(sfxMoveTiles, 1.12246f);
-                } 
-                
+                SetSoundPitch(sfxMoveTiles, SFX_MOVE_TILES_PITCH[direction]);
                 PlaySound(sfxMoveTiles);
             }
         }
 
+        // The finished game is analysed in the background for as long as the game over screen is up
+        if (isGameOver && !gameAnalysis.isStarted) {
+            StartGameAnalysis(&gameAnalysis, &history);
+        } else if (!isGameOver && gameAnalysis.isStarted) {
+            StopGameAnalysis(&gameAnalysis);
+        }
+
+        // Sliders are dragged without any tween running, they get the full frame rate too
+        bool isIdle = !IsTimelineActive(&timeline) && buttonVolumeSlider.state != BUTTON_STATE_HELD && 
+            buttonMusicSlider.state != BUTTON_STATE_HELD;
+
         // Render
 
+        f32 alpha = simulationAccumulator / SIMULATION_STEP;
+        f32 gameOverFade = GetTweenValue(&timeline, TWEEN_GAME_OVER, alpha);
+        f32 optionsFade = GetTweenValue(&timeline, TWEEN_OPTIONS, alpha);
+
         BeginDrawing();
 
         ClearBackground(COLOUR_BACKGROUND);
 
-        DisplayBoard(&board, font);
+        u32 hiddenCells = 0;
+        if (IsTweenActive(&timeline, TWEEN_MOVE)) {
+            hiddenCells = animation.events.slidCells | animation.events.mergedCells | animation.events.spawnedCells;
+        }
 
-        if (board.combinedTimer > 0.0f) {
-            DisplayCombinedTiles(&board, font);
-        } else {
-            if (board.newTile != -1) {
-                DisplayNewTile(&board);
-            }
+        DisplayBoard(&board, hiddenCells, font);
 
-            DisplayMovingTiles(&board, font);
+        if (IsTweenActive(&timeline, TWEEN_COMBINE)) {
+            DisplayCombinedTiles(&board, &animation, GetTweenValue(&timeline, TWEEN_COMBINE, alpha), font);
+        } else {
+            f32 moveProgress = GetTweenValue(&timeline, TWEEN_MOVE, alpha);
+            DisplayNewTiles(&animation, moveProgress);
+            DisplayMovingTiles(&animation, moveProgress, font);
         }
 
         if (isGameOver) {
-            DisplayGameOver(font, gameOverFadeInTimer, &buttonTryAgain);
+            DisplayGameOver(font, gameOverFade, &buttonTryAgain);
+            DisplayGameAnalysis(font, &gameAnalysis, gameOverFade);
         }
 
         DisplayScores(font, score, highscore);
 
-        DisplayButtons(&buttonNewGame, &buttonOptions, &optionsSymbol, optionsTimer);
+        if (hint != DIRECTION_NONE && !isGameOver && CanPackBoard(&board) && PackBoard(&board) == hintBoard) {
+            DisplayHint(font, hint, isHintFromBook);
+        }
+
+        DisplayButtons(&buttonNewGame, &buttonOptions, &optionsSymbol, optionsFade);
 
         // TODO: Custom symbols for some keys? (like the arrow keys, etc.)
-        if (optionsTimer < OPTIONS_TIMER_DURATION) {
-            DisplayOptions(buttonsKeybinds, optionsTimer, buttonToBindIndex, &buttonVolumeSlider, &buttonMusicSlider);
+        if (optionsFade > 0.0f) {
+            DisplayOptions(buttonsKeybinds, optionsFade, buttonToBindIndex, &buttonVolumeSlider, &buttonMusicSlider);
         }
 
+#ifdef _DEBUG
+        DisplayAllocStats(&allocStats, font);
+#endif
+
         EndDrawing();
+
+        if (didApplyInput) {
+            RecordInputLatency(&inputQueue, input.time, GetTime());
+        }
+
+        if (isIdle) {
+            WaitForIdleFrame(frameStartTime + 1.0 / IDLE_FRAME_RATE);
+        }
+
+        allocStats = EndAllocFrame();
+        LogAllocStats(&allocStats);
     }
 
-    if (score > highscore) {
-        SaveHighscore("assets/data.json", score);
+    LogInputLatencyStats(&inputQueue);
+    TrackedFree(inputLatency, ALLOC_TAG_GAME);
+
+    if (!isGameRecorded) {
+        RecordGameResult(&results, &history, &board, gameSeed, score, GetTime() - gameStartTime);
     }
+    CloseResultsStore(&results);
+
+    StopGameAnalysis(&gameAnalysis);
+    FreeHistory(&history);
+    FreeSearch(&hintSearch);
+    CloseBook(&book);
 
     CloseAudioDevice();
 
@@ -0,0 +1,527 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "mcts.h"
+#include "platform.h"
+
+#define MCTS_EXPAND_VISITS 1 // Visits before the one that expands a node
+#define MCTS_MAX_PATH 512 // Nodes on the way down, well past what a search reaches
+#define MCTS_MAX_CHILDREN (2 * TILE_COUNT)
+#define MCTS_MAX_POOL_NODES (1ll << 30) // Indices are i32
+#define MCTS_BENCHMARK_SEED 1
+#define MCTS_STOP_TILE_BITS 0x1111111111111111ull
+
+
+typedef enum Mcts_node_state {
+    MCTS_NODE_LEAF,
+    MCTS_NODE_EXPANDING, // A thread is filling in its children
+    MCTS_NODE_EXPANDED,
+    MCTS_NODE_TERMINAL // No move left
+} Mcts_node_state;
+
+typedef struct Mcts_worker {
+    Mcts *mcts;
+    Mcts_tree *tree;
+    Rng *rng;
+    volatile i64 *nextIteration;
+    i64 rolloutCount;
+    i64 rolloutMoveCount;
+} Mcts_worker;
+
+static const char *PARALLELISM_NAMES[] = {
+    [MCTS_PARALLEL_TREE] = "tree",
+    [MCTS_PARALLEL_ROOT] = "root"
+};
+
+static const char *ROLLOUT_NAMES[] = {
+    [MCTS_ROLLOUT_RANDOM] = "random",
+    [MCTS_ROLLOUT_GREEDY] = "greedy"
+};
+
+
+void InitMcts(Mcts *mcts, i32 iterations, i32 threadCount, Mcts_parallelism parallelism, i64 poolBytes, u64 seed) {
+    *mcts = (Mcts){0};
+    mcts->threadCount = MinI32(threadCount > 0 ? threadCount : GetProcessorCount(), MCTS_MAX_THREADS);
+    mcts->treeCount = parallelism == MCTS_PARALLEL_ROOT ? mcts->threadCount : 1;
+    mcts->iterations = MaxI32(iterations, 1);
+    mcts->parallelism = parallelism;
+    mcts->rollout = MCTS_ROLLOUT_RANDOM;
+    mcts->exploration = MCTS_DEFAULT_EXPLORATION;
+    mcts->tables = GetMoveTables();
+
+    i64 capacity = poolBytes / (2 * mcts->treeCount * (i64)sizeof(Mcts_node));
+    capacity = capacity < MCTS_MAX_POOL_NODES ? capacity : MCTS_MAX_POOL_NODES;
+    capacity = capacity > 1 ? capacity : 1;
+
+    for (i32 i = 0; i < mcts->treeCount; ++i) {
+        Mcts_tree *tree = &mcts->trees[i];
+        tree->nodes = TrackedAlloc(capacity * sizeof(Mcts_node), ALLOC_TAG_SEARCH);
+        tree->spare = TrackedAlloc(capacity * sizeof(Mcts_node), ALLOC_TAG_SEARCH);
+        tree->capacity = capacity;
+        tree->count = 0;
+        tree->lastMove = DIRECTION_NONE;
+    }
+
+    for (i32 i = 0; i < mcts->threadCount; ++i) {
+        mcts->rngs[i] = CreateRng(seed + i);
+    }
+}
+
+void FreeMcts(Mcts *mcts) {
+    for (i32 i = 0; i < mcts->treeCount; ++i) {
+        TrackedFree(mcts->trees[i].nodes, ALLOC_TAG_SEARCH);
+        TrackedFree(mcts->trees[i].spare, ALLOC_TAG_SEARCH);
+        mcts->trees[i] = (Mcts_tree){0};
+    }
+}
+
+// A failed allocation leaves count past the capacity, so every one after it fails too
+static i32 AllocateNodes(Mcts_tree *tree, i32 count) {
+    i64 end = AtomicAddI64(&tree->count, count);
+    return end <= tree->capacity ? (i32)(end - count) : -1;
+}
+
+static i64 GetUsedNodeCount(const Mcts_tree *tree) {
+    return tree->count < tree->capacity ? tree->count : tree->capacity;
+}
+
+// Children are written before the state says they're there, which the other threads read first
+static Mcts_node_state PublishChildren(Mcts_tree *tree, Mcts_node *node, const Mcts_node *children, i32 childCount) {
+    if (childCount == 0) {
+        AtomicStoreI32(&node->state, MCTS_NODE_TERMINAL);
+        return MCTS_NODE_TERMINAL;
+    }
+
+    i32 first = AllocateNodes(tree, childCount);
+    if (first < 0) {
+        AtomicStoreI32(&node->state, MCTS_NODE_LEAF);
+        return MCTS_NODE_LEAF;
+    }
+
+    memcpy(&tree->nodes[first], children, childCount * sizeof(Mcts_node));
+    node->firstChild = first;
+    node->childCount = (u8)childCount;
+    AtomicStoreI32(&node->state, MCTS_NODE_EXPANDED);
+
+    return MCTS_NODE_EXPANDED;
+}
+
+static Mcts_node_state ExpandPlayerNode(const Mcts *mcts, Mcts_tree *tree, Mcts_node *node) {
+    Mcts_node children[DIRECTION_COUNT];
+    i32 childCount = 0;
+
+    for (i32 direction = 0; direction < DIRECTION_COUNT; ++direction) {
+        i32 score = 0;
+        Packed_board moved = MoveWithTables(mcts->tables, node->board, direction, &score);
+        if (moved != node->board) {
+            children[childCount++] = (Mcts_node){.board = moved, .score = score, .move = (u8)direction};
+        }
+    }
+
+    return PublishChildren(tree, node, children, childCount);
+}
+
+// A 2 and a 4 for every empty cell, side by side
+static Mcts_node_state ExpandChanceNode(Mcts_tree *tree, Mcts_node *node) {
+    Mcts_node children[MCTS_MAX_CHILDREN];
+    i32 childCount = 0;
+
+    for (i32 i = 0; i < TILE_COUNT; ++i) {
+        if (((node->board >> (PACKED_TILE_BITS * i)) & PACKED_TILE_MASK) != 0) {
+            continue;
+        }
+
+        for (u64 exponent = 1; exponent <= 2; ++exponent) {
+            children[childCount++] = (Mcts_node){.board = node->board | (exponent << (PACKED_TILE_BITS * i))};
+        }
+    }
+
+    return PublishChildren(tree, node, children, childCount);
+}
+
+// The counts and sums are read while other threads update them, which only makes the choice a little out of date
+static i32 SelectMove(const Mcts *mcts, const Mcts_tree *tree, const Mcts_node *node) {
+    i32 visitCount = node->visitCount;
+    f64 mean = (f64)node->rewardSum / visitCount;
+    f64 scale = mcts->exploration * (mean > 1.0 ? mean : 1.0);
+    f64 logVisits = log((f64)visitCount);
+
+    i32 best = node->firstChild;
+    f64 bestValue = -1.0;
+    for (i32 i = node->firstChild; i < node->firstChild + node->childCount; ++i) {
+        const Mcts_node *child = &tree->nodes[i];
+        i32 childVisits = child->visitCount;
+        if (childVisits == 0) {
+            return i;
+        }
+
+        f64 value = child->score + (f64)child->rewardSum / childVisits + scale * sqrt(logVisits / childVisits);
+        if (value > bestValue) {
+            bestValue = value;
+            best = i;
+        }
+    }
+
+    return best;
+}
+
+static bool HasStopTile(Packed_board board) {
+    return (board & (board >> 1) & (board >> 2) & (board >> 3) & MCTS_STOP_TILE_BITS) != 0;
+}
+
+static Packed_board SpawnPackedTile(Packed_board board, Rng *rng) {
+    i32 emptyCells[TILE_COUNT];
+    i32 emptyCount = 0;
+    for (i32 i = 0; i < TILE_COUNT; ++i) {
+        if (((board >> (PACKED_TILE_BITS * i)) & PACKED_TILE_MASK) == 0) {
+            emptyCells[emptyCount++] = i;
+        }
+    }
+
+    if (emptyCount == 0) {
+        return board;
+    }
+
+    i32 cell = emptyCells[RandomRange(rng, 0, emptyCount - 1)];
+    return board | ((u64)RandomRange(rng, 1, 2) << (PACKED_TILE_BITS * cell));
+}
+
+// Plays on from board until the game is over (or makes the 32768 tile, where the packed engine stops), returning the
+// score it made
+static i64 Rollout(Mcts_worker *worker, Packed_board board, bool isSpawnNext) {
+    const Mcts *mcts = worker->mcts;
+    if (isSpawnNext) {
+        board = SpawnPackedTile(board, worker->rng);
+    }
+
+    i64 score = 0;
+    while (!HasStopTile(board)) {
+        Packed_board moves[DIRECTION_COUNT];
+        i32 scores[DIRECTION_COUNT];
+        i32 legalCount = 0;
+        i32 bestScore = -1;
+        for (i32 direction = 0; direction < DIRECTION_COUNT; ++direction) {
+            i32 moveScore = 0;
+            Packed_board moved = MoveWithTables(mcts->tables, board, direction, &moveScore);
+            if (moved == board || (mcts->rollout == MCTS_ROLLOUT_GREEDY && moveScore < bestScore)) {
+                continue;
+            }
+
+            if (mcts->rollout == MCTS_ROLLOUT_GREEDY && moveScore > bestScore) {
+                bestScore = moveScore;
+                legalCount = 0;
+            }
+            moves[legalCount] = moved;
+            scores[legalCount++] = moveScore;
+        }
+
+        if (legalCount == 0) {
+            break;
+        }
+
+        i32 choice = RandomRange(worker->rng, 0, legalCount - 1);
+        score += scores[choice];
+        board = SpawnPackedTile(moves[choice], worker->rng);
+        ++worker->rolloutMoveCount;
+    }
+
+    ++worker->rolloutCount;
+    return score;
+}
+
+// Player nodes are at even depths, chance nodes at odd ones, and the root is always node 0
+static void RunIteration(Mcts_worker *worker) {
+    Mcts_tree *tree = worker->tree;
+    i32 path[MCTS_MAX_PATH];
+    i32 length = 0;
+
+    i32 index = 0;
+    for (;;) {
+        Mcts_node *node = &tree->nodes[index];
+        i32 visitCount = AtomicAddI32(&node->visitCount, 1);
+        bool isChance = length % 2 == 1;
+        path[length++] = index;
+
+        i32 state = AtomicLoadI32(&node->state);
+        if (state == MCTS_NODE_LEAF && visitCount > MCTS_EXPAND_VISITS &&
+            AtomicCompareExchangeI32(&node->state, MCTS_NODE_LEAF, MCTS_NODE_EXPANDING)) {
+            state = isChance ? ExpandChanceNode(tree, node) : ExpandPlayerNode(worker->mcts, tree, node);
+        }
+
+        if (state != MCTS_NODE_EXPANDED || length == MCTS_MAX_PATH) {
+            break;
+        }
+
+        index = isChance ? node->firstChild + RandomRange(worker->rng, 0, node->childCount - 1) :
+            SelectMove(worker->mcts, tree, node);
+    }
+
+    const Mcts_node *leaf = &tree->nodes[path[length - 1]];
+    bool isSpawnNext = (length - 1) % 2 == 1;
+    i64 reward = leaf->state == MCTS_NODE_TERMINAL ? 0 : Rollout(worker, leaf->board, isSpawnNext);
+
+    // Each node's reward is the score from its own board on, so a chance node adds its move's score for its parent
+    for (i32 i = length - 1; i >= 0; --i) {
+        Mcts_node *node = &tree->nodes[path[i]];
+        AtomicAddI64(&node->rewardSum, reward);
+        if (i % 2 == 1) {
+            reward += node->score;
+        }
+    }
+}
+
+static void RunMctsWorker(void *data) {
+    Mcts_worker *worker = data;
+
+    while (AtomicAddI64(worker->nextIteration, 1) <= worker->mcts->iterations) {
+        RunIteration(worker);
+    }
+}
+
+// Copies the subtree under newRoot to the front of the spare pool, breadth first with the copied nodes as the queue,
+// and swaps the pools
+static void CompactTree(Mcts_tree *tree, i32 newRoot) {
+    Mcts_node *from = tree->nodes;
+    Mcts_node *to = tree->spare;
+
+    to[0] = from[newRoot];
+    i64 count = 1;
+    for (i64 scan = 0; scan < count; ++scan) {
+        Mcts_node *node = &to[scan];
+        if (node->state != MCTS_NODE_EXPANDED) {
+            continue;
+        }
+
+        memcpy(&to[count], &from[node->firstChild], node->childCount * sizeof(Mcts_node));
+        node->firstChild = (i32)count;
+        count += node->childCount;
+    }
+
+    tree->nodes = to;
+    tree->spare = from;
+    tree->count = count;
+}
+
+// The new root is the grandchild of the old one through lastMove with board on it, if the tree got that far
+static i32 FindNewRoot(const Mcts_tree *tree, Packed_board board) {
+    const Mcts_node *root = &tree->nodes[0];
+    if (tree->lastMove == DIRECTION_NONE || tree->count == 0 || root->state != MCTS_NODE_EXPANDED) {
+        return -1;
+    }
+
+    for (i32 i = root->firstChild; i < root->firstChild + root->childCount; ++i) {
+        const Mcts_node *chance = &tree->nodes[i];
+        if (chance->move != tree->lastMove || chance->state != MCTS_NODE_EXPANDED) {
+            continue;
+        }
+
+        for (i32 j = chance->firstChild; j < chance->firstChild + chance->childCount; ++j) {
+            if (tree->nodes[j].board == board) {
+                return j;
+            }
+        }
+    }
+
+    return -1;
+}
+
+// Returns the nodes carried over
+static i64 PrepareTree(Mcts *mcts, Mcts_tree *tree, Packed_board board) {
+    i64 keptCount = 0;
+
+    i32 newRoot = FindNewRoot(tree, board);
+    if (newRoot >= 0) {
+        CompactTree(tree, newRoot);
+        keptCount = tree->count;
+    } else {
+        tree->nodes[0] = (Mcts_node){.board = board};
+        tree->count = 1;
+    }
+
+    // So there is always a move to choose from, however few iterations there are
+    Mcts_node *root = &tree->nodes[0];
+    if (root->state == MCTS_NODE_LEAF) {
+        ExpandPlayerNode(mcts, tree, root);
+    }
+
+    return keptCount;
+}
+
+Direction ChooseMctsMove(Mcts *mcts, Packed_board board) {
+    // The trees don't go on past a move they didn't search
+    Direction bookMove;
+    f32 bookValue;
+    if (LookUpBook(mcts->book, board, &bookMove, &bookValue)) {
+        for (i32 i = 0; i < mcts->treeCount; ++i) {
+            mcts->trees[i].lastMove = DIRECTION_NONE;
+        }
+        return bookMove;
+    }
+
+    f64 start = GetWallTime();
+
+    i64 startCount = 0;
+    for (i32 i = 0; i < mcts->treeCount; ++i) {
+        mcts->keptNodeCount += PrepareTree(mcts, &mcts->trees[i], board);
+        startCount += GetUsedNodeCount(&mcts->trees[i]);
+    }
+
+    if (mcts->trees[0].nodes[0].state == MCTS_NODE_TERMINAL) {
+        for (i32 i = 0; i < mcts->treeCount; ++i) {
+            mcts->trees[i].lastMove = DIRECTION_NONE;
+        }
+        return DIRECTION_NONE;
+    }
+
+    volatile i64 nextIteration = 1;
+    Mcts_worker workers[MCTS_MAX_THREADS];
+    for (i32 i = 0; i < mcts->threadCount; ++i) {
+        workers[i] = (Mcts_worker){
+            .mcts = mcts,
+            .tree = &mcts->trees[mcts->parallelism == MCTS_PARALLEL_ROOT ? i : 0],
+            .rng = &mcts->rngs[i],
+            .nextIteration = &nextIteration
+        };
+    }
+
+    // The calling thread is worker 0
+    Thread threads[MCTS_MAX_THREADS];
+    i32 startedCount = 1;
+    while (startedCount < mcts->threadCount &&
+        StartThread(&threads[startedCount], &RunMctsWorker, &workers[startedCount])) {
+        ++startedCount;
+    }
+    RunMctsWorker(&workers[0]);
+    for (i32 i = 1; i < startedCount; ++i) {
+        JoinThread(&threads[i]);
+    }
+
+    // The most visited move, summed over the trees, with the higher mean score breaking ties
+    i64 visits[DIRECTION_COUNT] = {0};
+    i64 rewards[DIRECTION_COUNT] = {0};
+    i64 endCount = 0;
+    for (i32 i = 0; i < mcts->treeCount; ++i) {
+        const Mcts_tree *tree = &mcts->trees[i];
+        const Mcts_node *root = &tree->nodes[0];
+        for (i32 j = root->firstChild; j < root->firstChild + root->childCount; ++j) {
+            const Mcts_node *child = &tree->nodes[j];
+            visits[child->move] += child->visitCount;
+            rewards[child->move] += child->rewardSum + (i64)child->score * child->visitCount;
+        }
+        endCount += GetUsedNodeCount(tree);
+    }
+
+    for (i32 i = 0; i < mcts->threadCount; ++i) {
+        mcts->rolloutCount += workers[i].rolloutCount;
+        mcts->rolloutMoveCount += workers[i].rolloutMoveCount;
+    }
+
+    Direction best = DIRECTION_NONE;
+    const Mcts_node *root = &mcts->trees[0].nodes[0];
+    for (i32 i = root->firstChild; i < root->firstChild + root->childCount; ++i) {
+        Direction move = mcts->trees[0].nodes[i].move;
+        if (best == DIRECTION_NONE || visits[move] > visits[best] ||
+            (visits[move] == visits[best] && rewards[move] * visits[best] > rewards[best] * visits[move])) {
+            best = move;
+        }
+    }
+
+    for (i32 i = 0; i < mcts->treeCount; ++i) {
+        mcts->trees[i].lastMove = best;
+    }
+
+    mcts->nodeCount += endCount - startCount;
+    mcts->peakNodeCount = endCount > mcts->peakNodeCount ? endCount : mcts->peakNodeCount;
+    mcts->searchTime += GetWallTime() - start;
+
+    return best;
+}
+
+// The index of name in names, all of them (-1) for NULL, or -2 if it isn't there
+static i32 FindName(const char *name, const char **names, i32 count) {
+    if (name == NULL) {
+        return -1;
+    }
+
+    for (i32 i = 0; i < count; ++i) {
+        if (strcmp(name, names[i]) == 0) {
+            return i;
+        }
+    }
+
+    fprintf(stderr, "Unknown option \"%s\"\n", name);
+    return -2;
+}
+
+i32 RunMctsBenchmark(i32 gameCount, i32 iterations, i32 threadCount, const char *parallelism, const char *rollout) {
+    i32 parallelismChoice = FindName(parallelism, PARALLELISM_NAMES, 2);
+    i32 rolloutChoice = FindName(rollout, ROLLOUT_NAMES, 2);
+    if (parallelismChoice == -2 || rolloutChoice == -2) {
+        return 1;
+    }
+
+    gameCount = gameCount > 0 ? gameCount : MCTS_BENCHMARK_GAMES;
+    iterations = iterations > 0 ? iterations : MCTS_DEFAULT_ITERATIONS;
+    threadCount = MinI32(threadCount > 0 ? threadCount : GetProcessorCount(), MCTS_MAX_THREADS);
+
+    Book book;
+    OpenBook(&book, BOOK_DEFAULT_PATH);
+
+    printf("%d games each, %d iterations a move on %d threads, %.0f MB of nodes, seeds from %d, %s\n", gameCount,
+        iterations, threadCount, MCTS_DEFAULT_POOL_BYTES / 1e6, MCTS_BENCHMARK_SEED,
+        book.entries != NULL ? "openings from the book" : "no book");
+    printf("%-6s %-7s %9s %5s %7s %11s %13s %11s %7s %9s\n", "Tree", "Rollout", "Score", "Tile", "Moves", "Rollouts/s",
+        "Rollout mv/s", "Nodes/s", "Kept/mv", "Peak MB");
+
+    for (i32 p = 0; p < 2; ++p) {
+        for (i32 r = 0; r < 2; ++r) {
+            if ((parallelismChoice >= 0 && p != parallelismChoice) || (rolloutChoice >= 0 && r != rolloutChoice)) {
+                continue;
+            }
+
+            Mcts mcts;
+            InitMcts(&mcts, iterations, threadCount, p, MCTS_DEFAULT_POOL_BYTES, MCTS_BENCHMARK_SEED);
+            mcts.rollout = r;
+            mcts.book = &book;
+
+            i64 scoreSum = 0;
+            i64 moveCount = 0;
+            i32 bestTile = 0;
+            for (i32 game = 0; game < gameCount; ++game) {
+                Rng rng = CreateRng(MCTS_BENCHMARK_SEED + game);
+                Board board;
+                ResetBoard(&board, &rng);
+
+                i32 score = 0;
+                while (!HasStopTile(PackBoard(&board))) {
+                    Direction move = ChooseMctsMove(&mcts, PackBoard(&board));
+                    if (move == DIRECTION_NONE) {
+                        break;
+                    }
+
+                    MoveBoard(&board, move, &score, NULL);
+                    SpawnTile(&board, &rng);
+                    ++moveCount;
+                }
+
+                scoreSum += score;
+                bestTile = MaxI32(bestTile, GetPackedMaxTile(PackBoard(&board)));
+            }
+
+            f64 time = mcts.searchTime > 0.0 ? mcts.searchTime : 1.0;
+            printf("%-6s %-7s %9.0f %5u %7lld %11.0f %13.0f %11.0f %7lld %9.2f\n", PARALLELISM_NAMES[p],
+                ROLLOUT_NAMES[r], (f64)scoreSum / gameCount, PowerOf2(bestTile), (long long)moveCount,
+                mcts.rolloutCount / time, mcts.rolloutMoveCount / time, mcts.nodeCount / time,
+                (long long)(moveCount > 0 ? mcts.keptNodeCount / moveCount : 0),
+                mcts.peakNodeCount * sizeof(Mcts_node) / 1e6);
+
+            FreeMcts(&mcts);
+        }
+    }
+
+    CloseBook(&book);
+
+    return 0;
+}
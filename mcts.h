@@ -0,0 +1,92 @@
+#ifndef MCTS_H
+#define MCTS_H
+
+#include "common.h"
+#include "board.h"
+#include "book.h"
+#include "move_tables.h"
+
+#define MCTS_MAX_THREADS 64
+#define MCTS_DEFAULT_ITERATIONS 1000 // Per move, over all threads
+#define MCTS_DEFAULT_POOL_BYTES (64ll << 20)
+#define MCTS_DEFAULT_EXPLORATION 1.0f
+#define MCTS_BENCHMARK_GAMES 2
+
+// Monte Carlo tree search with a chance node for every move, whose children are the boards its spawn can make. Player
+// nodes pick a move by UCT, on the mean score that followed it with the exploration term scaled by the node's own
+// mean, and chance nodes pick a spawn at random, all of them being equally likely (see SpawnTile). A node is expanded
+// the second time it is reached, and each iteration ends with a rollout from the node it stopped at.
+//
+// Nodes come from a pool allocated once and handed out by bumping a count, a node's children always side by side.
+// After a move the subtree of the new position is copied to the front of a second pool (and the rest dropped with the
+// old one), so the tree carries over from move to move in as much memory as it keeps. A full pool stops the tree
+// growing, not the search.
+//
+// With tree parallelism every thread works on the one tree. A thread counts its visit on the way down and adds the
+// reward on the way back, so the nodes it is in look worse until then and the others spread out (a virtual loss).
+// With root parallelism each thread has a tree of its own, and the root's visits are summed across them to choose.
+
+typedef enum Mcts_parallelism {
+    MCTS_PARALLEL_TREE,
+    MCTS_PARALLEL_ROOT
+} Mcts_parallelism;
+
+typedef enum Mcts_rollout {
+    MCTS_ROLLOUT_RANDOM,
+    MCTS_ROLLOUT_GREEDY // The move that scores the most, ties broken at random
+} Mcts_rollout;
+
+typedef struct Mcts_node {
+    Packed_board board; // Before the spawn for chance nodes
+    volatile i64 rewardSum; // Score gained from board on, over the visits that have finished
+    volatile i32 visitCount; // Including the ones still under way
+    volatile i32 state; // Mcts_node_state, in mcts.c
+    i32 firstChild; // In the pool
+    i32 score; // What the move to a chance node scored
+    u8 childCount;
+    u8 move; // Direction, for chance nodes
+} Mcts_node;
+
+typedef struct Mcts_tree {
+    Mcts_node *nodes;
+    Mcts_node *spare; // Where the next move's subtree is copied to
+    i64 capacity; // Of each
+    volatile i64 count;
+    Direction lastMove; // Made from the root, DIRECTION_NONE if the tree can't be carried over
+} Mcts_tree;
+
+typedef struct Mcts {
+    Mcts_tree trees[MCTS_MAX_THREADS]; // One for tree parallelism
+    Rng rngs[MCTS_MAX_THREADS];
+    i32 treeCount;
+    i32 threadCount;
+    i32 iterations;
+    Mcts_parallelism parallelism;
+    Mcts_rollout rollout;
+    f32 exploration;
+    const Move_tables_data *tables;
+    const Book *book; // Positions it has are played from it without a search. NULL from InitMcts.
+
+    // Since InitMcts
+    volatile i64 rolloutCount;
+    volatile i64 rolloutMoveCount;
+    i64 nodeCount; // Allocated from the pools, counting each node once however many moves it is carried over
+    i64 keptNodeCount; // Carried over to the next move
+    i64 peakNodeCount; // Most nodes in the pools at once
+    f64 searchTime; // Wall seconds in ChooseMctsMove
+} Mcts;
+
+
+// poolBytes is the memory for nodes, split over both pools of every tree. All of it is allocated here.
+void InitMcts(Mcts *mcts, i32 iterations, i32 threadCount, Mcts_parallelism parallelism, i64 poolBytes, u64 seed);
+void FreeMcts(Mcts *mcts);
+
+// Keeps the part of the tree under board if board follows from the last move this chose, and starts afresh otherwise.
+// DIRECTION_NONE if the game is over.
+Direction ChooseMctsMove(Mcts *mcts, Packed_board board);
+
+// Plays games with each parallelism and rollout (or just the ones named, which may be NULL) and prints their scores,
+// rollouts/s, nodes/s and peak memory
+i32 RunMctsBenchmark(i32 gameCount, i32 iterations, i32 threadCount, const char *parallelism, const char *rollout);
+
+#endif
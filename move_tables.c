@@ -0,0 +1,350 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "move_tables.h"
+
+#ifdef __linux__
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// Weights from trial and error, the same shape as most 2048 heuristics
+// Lifts the usual lines above 0. Lines of big tiles out of order still go far below it (about -2.6M for the worst),
+// which is why the search scores a lost game as SEARCH_LOST_VALUE rather than 0.
+#define HEURISTIC_BASE 200000.0f
+#define HEURISTIC_EMPTY_WEIGHT 270.0f
+#define HEURISTIC_MERGE_WEIGHT 700.0f
+#define HEURISTIC_MONOTONICITY_WEIGHT 47.0f
+#define HEURISTIC_MONOTONICITY_POWER 4.0f
+#define HEURISTIC_SUM_WEIGHT 11.0f
+#define HEURISTIC_SUM_POWER 3.5f
+
+#define MOVE_TABLES_BENCHMARK_LOOKUPS 4000000
+#define MOVE_TABLES_MAX_PROCESSES 64
+#define MOVE_TABLES_SMAPS_LINE_SIZE 512
+
+
+static Move_tables processTables;
+static bool isProcessTablesLoaded;
+
+
+static f32 EvaluateLine(u16 line) {
+    i32 values[4];
+    for (i32 i = 0; i < 4; ++i) {
+        values[i] = (line >> (PACKED_TILE_BITS * i)) & PACKED_TILE_MASK;
+    }
+
+    f32 sum = 0.0f;
+    i32 emptyCount = 0;
+    i32 mergeCount = 0;
+    i32 previous = 0;
+    i32 runLength = 0;
+    for (i32 i = 0; i < 4; ++i) {
+        sum += powf(values[i], HEURISTIC_SUM_POWER);
+
+        if (values[i] == 0) {
+            ++emptyCount;
+            continue;
+        }
+
+        // Equal tiles next to each other, with nothing between them
+        if (values[i] == previous) {
+            ++runLength;
+        } else if (runLength > 0) {
+            mergeCount += 1 + runLength;
+            runLength = 0;
+        }
+        previous = values[i];
+    }
+    if (runLength > 0) {
+        mergeCount += 1 + runLength;
+    }
+
+    // How far the line is from increasing or decreasing, whichever is closer
+    f32 increasing = 0.0f;
+    f32 decreasing = 0.0f;
+    for (i32 i = 1; i < 4; ++i) {
+        f32 a = powf(values[i - 1], HEURISTIC_MONOTONICITY_POWER);
+        f32 b = powf(values[i], HEURISTIC_MONOTONICITY_POWER);
+        if (values[i - 1] > values[i]) {
+            increasing += a - b;
+        } else {
+            decreasing += b - a;
+        }
+    }
+
+    return HEURISTIC_BASE + HEURISTIC_EMPTY_WEIGHT * emptyCount + HEURISTIC_MERGE_WEIGHT * mergeCount -
+        HEURISTIC_MONOTONICITY_WEIGHT * MinF32(increasing, decreasing) - HEURISTIC_SUM_WEIGHT * sum;
+}
+
+// A row on its own in the bottom row of a board, so MovePackedBoard is the reference for the tables
+static void GenerateMoveTables(Move_tables_data *data) {
+    for (i32 row = 0; row < MOVE_TABLES_ROW_COUNT; ++row) {
+        i32 score = 0;
+        data->leftRows[row] = MovePackedBoard(row, DIRECTION_LEFT, &score) & 0xFFFF;
+        data->scores[row] = score;
+        data->rightRows[row] = MovePackedBoard(row, DIRECTION_RIGHT, &score) & 0xFFFF;
+        data->heuristics[row] = EvaluateLine(row);
+    }
+}
+
+static u64 ChecksumMoveTables(const Move_tables_data *data) {
+    const u64 *words = (const u64 *)data;
+
+    // FNV-1a a word at a time
+    u64 hash = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < sizeof(Move_tables_data) / sizeof(u64); ++i) {
+        hash = (hash ^ words[i]) * 0x100000001B3ull;
+    }
+
+    return hash;
+}
+
+static bool IsMoveTablesFileValid(const Mapped_file *file) {
+    const Move_tables_file *tables = file->data;
+    return file->size == (i64)sizeof(Move_tables_file) && memcmp(tables->magic, MOVE_TABLES_MAGIC, 8) == 0 &&
+        tables->version == MOVE_TABLES_VERSION && tables->checksum == ChecksumMoveTables(&tables->data);
+}
+
+bool LoadMoveTables(Move_tables *tables, const char *path) {
+    *tables = (Move_tables){0};
+
+    if (MapFile(&tables->file, path)) {
+        if (IsMoveTablesFileValid(&tables->file)) {
+            tables->data = &((const Move_tables_file *)tables->file.data)->data;
+            return true;
+        }
+
+        fprintf(stderr, "%s is from another version or corrupt, generating the move tables\n", path);
+        UnmapFile(&tables->file);
+    }
+
+    tables->generated = TrackedAlloc(sizeof(Move_tables_file), ALLOC_TAG_TABLES);
+    GenerateMoveTables(&tables->generated->data);
+    tables->data = &tables->generated->data;
+
+    return false;
+}
+
+void FreeMoveTables(Move_tables *tables) {
+    if (tables->generated != NULL) {
+        TrackedFree(tables->generated, ALLOC_TAG_TABLES);
+    }
+    UnmapFile(&tables->file);
+    *tables = (Move_tables){0};
+}
+
+const Move_tables_data *GetMoveTables(void) {
+    if (!isProcessTablesLoaded) {
+        LoadMoveTables(&processTables, MOVE_TABLES_DEFAULT_PATH);
+        isProcessTablesLoaded = true;
+    }
+
+    return processTables.data;
+}
+
+Packed_board MoveWithTables(const Move_tables_data *tables, Packed_board board, Direction direction, i32 *score) {
+    bool isVertical = direction == DIRECTION_UP || direction == DIRECTION_DOWN;
+    const u16 *movedRows = (direction == DIRECTION_DOWN || direction == DIRECTION_RIGHT) ? tables->rightRows :
+        tables->leftRows;
+
+    Packed_board rows = isVertical ? TransposePackedBoard(board) : board;
+    Packed_board result = 0;
+
+    for (i32 y = 0; y < 4; ++y) {
+        u16 row = rows >> (16 * y);
+        result |= (u64)movedRows[row] << (16 * y);
+        *score += tables->scores[row];
+    }
+
+    return isVertical ? TransposePackedBoard(result) : result;
+}
+
+Packed_board MovePackedBoardWithTables(Packed_board board, Direction direction, i32 *score) {
+    return MoveWithTables(GetMoveTables(), board, direction, score);
+}
+
+i32 WriteMoveTables(const char *path) {
+    Move_tables_file *tables = TrackedAlloc(sizeof(Move_tables_file), ALLOC_TAG_TABLES);
+
+    *tables = (Move_tables_file){
+        .magic = MOVE_TABLES_MAGIC,
+        .version = MOVE_TABLES_VERSION
+    };
+    GenerateMoveTables(&tables->data);
+    tables->checksum = ChecksumMoveTables(&tables->data);
+
+    FILE *file = fopen(path, "wb");
+    bool isOk = file != NULL && fwrite(tables, sizeof(Move_tables_file), 1, file) == 1;
+    if (file != NULL) {
+        isOk &= fclose(file) == 0;
+    }
+
+    if (isOk) {
+        printf("Wrote %s (version %d, %.0f KB)\n", path, MOVE_TABLES_VERSION, sizeof(Move_tables_file) / 1024.0);
+    } else {
+        fprintf(stderr, "Could not write %s\n", path);
+    }
+
+    TrackedFree(tables, ALLOC_TAG_TABLES);
+
+    return isOk ? 0 : 1;
+}
+
+// Reads every table at random, so that all their pages are resident
+static f64 TouchMoveTables(const Move_tables_data *tables) {
+    Rng rng = CreateRng(1);
+
+    f64 sum = 0.0;
+    for (i32 i = 0; i < MOVE_TABLES_BENCHMARK_LOOKUPS; ++i) {
+        u16 row = NextRandom(&rng);
+        sum += tables->leftRows[row] + tables->rightRows[row] + tables->scores[row] + tables->heuristics[row];
+    }
+
+    return sum;
+}
+
+#ifdef __linux__
+
+// Resident, proportional (shared pages split between the processes mapping them) and private kilobytes of the
+// mapping of path
+static bool GetMappingMemory(const char *path, i64 *residentKb, i64 *proportionalKb, i64 *privateKb) {
+    FILE *file = fopen("/proc/self/smaps", "r");
+    if (file == NULL) {
+        return false;
+    }
+
+    const char *name = strrchr(path, '/') != NULL ? strrchr(path, '/') + 1 : path;
+    *residentKb = *proportionalKb = *privateKb = 0;
+
+    char line[MOVE_TABLES_SMAPS_LINE_SIZE];
+    bool isInMapping = false;
+    bool isFound = false;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        long long kb;
+        unsigned long long mappingStart, mappingEnd;
+
+        // Mapping headers start with an address range, the fields under them with a name and a colon
+        if (sscanf(line, "%llx-%llx", &mappingStart, &mappingEnd) == 2) {
+            isInMapping = strstr(line, name) != NULL;
+            isFound |= isInMapping;
+        } else if (!isInMapping) {
+            continue;
+        } else if (sscanf(line, "Rss: %lld kB", &kb) == 1) {
+            *residentKb += kb;
+        } else if (sscanf(line, "Pss: %lld kB", &kb) == 1) {
+            *proportionalKb += kb;
+        } else if (sscanf(line, "Private_Clean: %lld kB", &kb) == 1 || sscanf(line, "Private_Dirty: %lld kB", &kb) == 1) {
+            *privateKb += kb;
+        }
+    }
+    fclose(file);
+
+    return isFound;
+}
+
+// Every process maps the file and reads all of it, then they all measure at once, so that each one's share of the
+// pages is split between all of them, and wait again so that none exits before the others have measured
+static void RunMoveTablesProcesses(const char *path, i32 processCount) {
+    i32 readyPipe[2];
+    i32 measurePipe[2];
+    i32 exitPipe[2];
+    if (pipe(readyPipe) != 0 || pipe(measurePipe) != 0 || pipe(exitPipe) != 0) {
+        fprintf(stderr, "Could not create pipes\n");
+        return;
+    }
+
+    fflush(stdout);
+    for (i32 i = 0; i < processCount; ++i) {
+        if (fork() != 0) {
+            continue;
+        }
+
+        close(measurePipe[1]);
+        close(exitPipe[1]);
+
+        f64 start = GetWallTime();
+        Move_tables tables;
+        bool isMapped = LoadMoveTables(&tables, path);
+        f64 loadTime = GetWallTime() - start;
+        volatile f64 sum = TouchMoveTables(tables.data);
+        (void)sum;
+
+        // Reads return once the parent closes its end
+        char byte = 0;
+        write(readyPipe[1], &byte, 1);
+        read(measurePipe[0], &byte, 1);
+
+        i64 residentKb, proportionalKb, privateKb;
+        bool isMeasured = isMapped && GetMappingMemory(path, &residentKb, &proportionalKb, &privateKb);
+
+        write(readyPipe[1], &byte, 1);
+        read(exitPipe[0], &byte, 1);
+
+        if (isMeasured) {
+            printf("  process %2d: loaded in %6.3f ms, %lld KB resident, %lld KB proportional, %lld KB private\n", i,
+                loadTime * 1e3, (long long)residentKb, (long long)proportionalKb, (long long)privateKb);
+        } else {
+            printf("  process %2d: generated the tables in %6.3f ms\n", i, loadTime * 1e3);
+        }
+        fflush(stdout);
+        _exit(0);
+    }
+
+    close(measurePipe[0]);
+    close(exitPipe[0]);
+
+    char byte;
+    for (i32 i = 0; i < processCount; ++i) {
+        read(readyPipe[0], &byte, 1);
+    }
+    close(measurePipe[1]);
+
+    for (i32 i = 0; i < processCount; ++i) {
+        read(readyPipe[0], &byte, 1);
+    }
+    close(exitPipe[1]);
+
+    while (wait(NULL) > 0) {
+    }
+    close(readyPipe[0]);
+    close(readyPipe[1]);
+}
+
+#else
+
+static void RunMoveTablesProcesses(const char *path, i32 processCount) {
+    printf("The per-process memory report is only available on Linux\n");
+}
+
+#endif
+
+i32 RunMoveTablesBenchmark(const char *path, i32 processCount) {
+    f64 start = GetWallTime();
+    Move_tables_file *generated = TrackedAlloc(sizeof(Move_tables_file), ALLOC_TAG_TABLES);
+    GenerateMoveTables(&generated->data);
+    f64 generateTime = GetWallTime() - start;
+    TrackedFree(generated, ALLOC_TAG_TABLES);
+
+    start = GetWallTime();
+    Move_tables tables;
+    bool isMapped = LoadMoveTables(&tables, path);
+    f64 loadTime = GetWallTime() - start;
+    FreeMoveTables(&tables);
+
+    if (!isMapped) {
+        fprintf(stderr, "Could not use %s, write it with --build-tables first\n", path);
+        return 1;
+    }
+
+    printf("Move tables: %.0f KB, generated in %.2f ms, mapped and checked in %.3f ms\n",
+        sizeof(Move_tables_file) / 1024.0, generateTime * 1e3, loadTime * 1e3);
+
+    processCount = MinI32(MaxI32(processCount, 1), MOVE_TABLES_MAX_PROCESSES);
+    printf("%d processes using the mapped file:\n", processCount);
+    RunMoveTablesProcesses(path, processCount);
+
+    return 0;
+}
@@ -0,0 +1,58 @@
+#ifndef MOVE_TABLES_H
+#define MOVE_TABLES_H
+
+#include "common.h"
+#include "board.h"
+#include "platform.h"
+
+#define MOVE_TABLES_MAGIC "R2048TBL"
+#define MOVE_TABLES_VERSION 1 // Bump whenever a table's contents change, the heuristic weights included
+#define MOVE_TABLES_DEFAULT_PATH "assets/move_tables.bin"
+#define MOVE_TABLES_ROW_COUNT 65536
+
+// The result of every move and heuristic on every possible row (4 cells, lowest nibble first as in a Packed_board),
+// indexed by the row itself, so a move is 4 lookups and a transpose.
+typedef struct Move_tables_data {
+    u16 leftRows[MOVE_TABLES_ROW_COUNT]; // The row moved towards its lowest nibble
+    u16 rightRows[MOVE_TABLES_ROW_COUNT];
+    u32 scores[MOVE_TABLES_ROW_COUNT]; // The same both ways, tiles only merge within a run of equal tiles
+    f32 heuristics[MOVE_TABLES_ROW_COUNT]; // See EvaluatePackedBoard
+} Move_tables_data;
+
+// The layout of MOVE_TABLES_DEFAULT_PATH, which the build writes with --build-tables. Mapped read-only, so every
+// process using it shares one copy in the page cache.
+typedef struct Move_tables_file {
+    char magic[8];
+    u32 version;
+    u32 reserved;
+    u64 checksum; // Of data
+    Move_tables_data data;
+} Move_tables_file;
+
+typedef struct Move_tables {
+    const Move_tables_data *data;
+    Mapped_file file;
+    Move_tables_file *generated; // Only when the file couldn't be used
+} Move_tables;
+
+
+// Maps the file if it's there and has the right version and checksum, otherwise generates the tables in memory.
+// Returns true if they were mapped.
+bool LoadMoveTables(Move_tables *tables, const char *path);
+void FreeMoveTables(Move_tables *tables);
+
+// The process-wide tables, loaded from MOVE_TABLES_DEFAULT_PATH on the first call. main makes that call at startup,
+// before any thread or worker process starts, so forked workers inherit the mapping rather than loading anything.
+const Move_tables_data *GetMoveTables(void);
+
+// Same results as MovePackedBoard
+Packed_board MoveWithTables(const Move_tables_data *tables, Packed_board board, Direction direction, i32 *score);
+Packed_board MovePackedBoardWithTables(Packed_board board, Direction direction, i32 *score); // With GetMoveTables
+
+i32 WriteMoveTables(const char *path);
+
+// Load time of the mapped file against generating the tables, and on Linux the memory each of processCount processes
+// using the mapping adds
+i32 RunMoveTablesBenchmark(const char *path, i32 processCount);
+
+#endif
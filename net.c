@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "net.h"
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+
+#ifdef __linux__
+
+typedef struct Socket_address {
+    union {
+        struct sockaddr_in inet;
+        struct sockaddr_un local;
+    };
+    socklen_t length;
+    i32 family;
+} Socket_address;
+
+static bool ParseAddress(const char *address, Socket_address *result) {
+    *result = (Socket_address){0};
+
+    if (strncmp(address, "unix:", 5) == 0) {
+        const char *path = address + 5;
+        if (strlen(path) >= sizeof(result->local.sun_path)) {
+            fprintf(stderr, "Unix socket path too long: %s\n", path);
+            return false;
+        }
+
+        result->local.sun_family = AF_UNIX;
+        strcpy(result->local.sun_path, path);
+        result->length = sizeof(result->local);
+        result->family = AF_UNIX;
+
+        return true;
+    }
+
+    char host[64] = "127.0.0.1";
+    const char *port = address;
+    const char *colon = strrchr(address, ':');
+    if (colon != NULL) {
+        i32 hostLength = colon - address;
+        if (hostLength >= (i32)sizeof(host)) {
+            return false;
+        }
+        memcpy(host, address, hostLength);
+        host[hostLength] = '\0';
+        port = colon + 1;
+    }
+
+    result->inet.sin_family = AF_INET;
+    result->inet.sin_port = htons(atoi(port));
+    if (inet_pton(AF_INET, host, &result->inet.sin_addr) != 1) {
+        fprintf(stderr, "Invalid address: %s\n", address);
+        return false;
+    }
+    result->length = sizeof(result->inet);
+    result->family = AF_INET;
+
+    return true;
+}
+
+bool SetNonBlocking(i32 socket) {
+    i32 flags = fcntl(socket, F_GETFL, 0);
+    return flags != -1 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+
+// Fails harmlessly on unix sockets
+void SetNoDelay(i32 socket) {
+    i32 enable = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+}
+
+i32 ListenOnAddress(const char *address) {
+    Socket_address socketAddress;
+    if (!ParseAddress(address, &socketAddress)) {
+        return -1;
+    }
+
+    i32 listener = socket(socketAddress.family, SOCK_STREAM, 0);
+    if (listener == -1) {
+        perror("socket");
+        return -1;
+    }
+
+    if (socketAddress.family == AF_UNIX) {
+        unlink(socketAddress.local.sun_path);
+    } else {
+        i32 enable = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    }
+
+    if (bind(listener, (struct sockaddr *)&socketAddress, socketAddress.length) == -1 || listen(listener, SOMAXCONN) == -1 || 
+        !SetNonBlocking(listener)) {
+        perror("listen");
+        close(listener);
+        return -1;
+    }
+
+    return listener;
+}
+
+i32 ConnectToAddress(const char *address) {
+    Socket_address socketAddress;
+    if (!ParseAddress(address, &socketAddress)) {
+        return -1;
+    }
+
+    i32 connection = socket(socketAddress.family, SOCK_STREAM, 0);
+    if (connection == -1) {
+        perror("socket");
+        return -1;
+    }
+
+    if (connect(connection, (struct sockaddr *)&socketAddress, socketAddress.length) == -1) {
+        perror("connect");
+        close(connection);
+        return -1;
+    }
+
+    SetNoDelay(connection);
+
+    return connection;
+}
+
+bool IsNetworkingSupported(void) {
+    return true;
+}
+
+#else
+
+i32 ListenOnAddress(const char *address) {
+    return -1;
+}
+
+i32 ConnectToAddress(const char *address) {
+    return -1;
+}
+
+bool SetNonBlocking(i32 socket) {
+    return false;
+}
+
+void SetNoDelay(i32 socket) {
+}
+
+bool IsNetworkingSupported(void) {
+    return false;
+}
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef NET_H
+#define NET_H
+
+#include "common.h"
+
+// Socket helpers shared by the server and the load generator. Addresses are either "unix:<path>" or
+// "[host:]port" for TCP, host defaulting to 127.0.0.1. Only implemented for Linux, elsewhere every function fails.
+
+#define DEFAULT_SERVER_ADDRESS "7048"
+
+
+i32 ListenOnAddress(const char *address); // Returns a non-blocking listening socket or -1
+i32 ConnectToAddress(const char *address); // Returns a connected blocking socket or -1
+bool SetNonBlocking(i32 socket);
+void SetNoDelay(i32 socket);
+bool IsNetworkingSupported(void);
+
+#endif
@@ -0,0 +1,332 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "board.h"
+#include "move_tables.h"
+#include "perf.h"
+#include "platform.h"
+
+#ifdef __linux__
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define PERF_BENCHMARK_POSITIONS 4096 // A power of 2, cycled through
+#define PERF_BENCHMARK_SEED 1
+
+
+typedef enum Perf_region {
+    PERF_REGION_MOVE_BOARD,
+    PERF_REGION_MOVE_PACKED,
+    PERF_REGION_MOVE_TABLES,
+    PERF_REGION_CAN_MOVE,
+    PERF_REGION_SPAWN_TILE,
+    PERF_REGION_SUCCESSORS,
+    PERF_REGION_COUNT
+} Perf_region;
+
+
+static const char *PERF_REGION_NAMES[PERF_REGION_COUNT] = {
+    [PERF_REGION_MOVE_BOARD] = "MoveBoard",
+    [PERF_REGION_MOVE_PACKED] = "MovePackedBoard",
+    [PERF_REGION_MOVE_TABLES] = "MoveWithTables",
+    [PERF_REGION_CAN_MOVE] = "CanMove",
+    [PERF_REGION_SPAWN_TILE] = "SpawnTile",
+    [PERF_REGION_SUCCESSORS] = "ComputeSuccessors"
+};
+
+static const char *PERF_EVENT_NAMES[PERF_EVENT_COUNT] = {
+    [PERF_EVENT_CYCLES] = "cycles",
+    [PERF_EVENT_INSTRUCTIONS] = "instructions",
+    [PERF_EVENT_BRANCH_MISSES] = "branch misses",
+    [PERF_EVENT_L1D_MISSES] = "L1D misses",
+    [PERF_EVENT_LLC_MISSES] = "LLC misses"
+};
+
+
+#ifdef __linux__
+
+static i32 OpenPerfEvent(Perf_event event) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.inherit = 1; // The threads started afterwards count too
+    attr.exclude_kernel = 1; // Allowed under the default perf_event_paranoid, and the kernel isn't what we measure
+    attr.exclude_hv = 1;
+
+    switch (event) {
+        case PERF_EVENT_CYCLES:
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case PERF_EVENT_INSTRUCTIONS:
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case PERF_EVENT_BRANCH_MISSES:
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        case PERF_EVENT_L1D_MISSES:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        case PERF_EVENT_LLC_MISSES:
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+        case PERF_EVENT_COUNT:
+            return -1;
+    }
+
+    return (i32)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+bool OpenPerfCounters(Perf_counters *counters) {
+    counters->openCount = 0;
+    i32 error = 0;
+
+    for (i32 i = 0; i < PERF_EVENT_COUNT; ++i) {
+        counters->fds[i] = OpenPerfEvent(i);
+        if (counters->fds[i] >= 0) {
+            ++counters->openCount;
+        } else if (error == 0) {
+            error = errno;
+        }
+    }
+
+    if (counters->openCount == 0) {
+        fprintf(stderr, "No hardware counters (%s), timing only\n", strerror(error));
+    }
+
+    return counters->openCount > 0;
+}
+
+void ClosePerfCounters(Perf_counters *counters) {
+    for (i32 i = 0; i < PERF_EVENT_COUNT; ++i) {
+        if (counters->fds[i] >= 0) {
+            close(counters->fds[i]);
+        }
+        counters->fds[i] = -1;
+    }
+    counters->openCount = 0;
+}
+
+Perf_sample ReadPerfCounters(const Perf_counters *counters) {
+    Perf_sample sample = {0};
+
+    for (i32 i = 0; i < PERF_EVENT_COUNT; ++i) {
+        u64 values[3]; // The count, then time enabled and time running (the read_format above)
+        if (counters->fds[i] < 0 || read(counters->fds[i], values, sizeof(values)) != (ssize_t)sizeof(values)) {
+            continue;
+        }
+
+        sample.values[i] = values[0];
+        sample.enabledTimes[i] = values[1];
+        sample.runningTimes[i] = values[2];
+        sample.isValid[i] = true;
+    }
+
+    sample.time = GetWallTime();
+    return sample;
+}
+
+#else
+
+bool OpenPerfCounters(Perf_counters *counters) {
+    for (i32 i = 0; i < PERF_EVENT_COUNT; ++i) {
+        counters->fds[i] = -1;
+    }
+    counters->openCount = 0;
+
+    fprintf(stderr, "No hardware counters on this platform, timing only\n");
+    return false;
+}
+
+void ClosePerfCounters(Perf_counters *counters) {
+    counters->openCount = 0;
+}
+
+Perf_sample ReadPerfCounters(const Perf_counters *counters) {
+    (void)counters;
+
+    Perf_sample sample = {0};
+    sample.time = GetWallTime();
+    return sample;
+}
+
+#endif
+
+void InitPerfTotal(Perf_sample *total) {
+    *total = (Perf_sample){0};
+    for (i32 i = 0; i < PERF_EVENT_COUNT; ++i) {
+        total->isValid[i] = true;
+    }
+}
+
+void AccumulatePerfSample(Perf_sample *total, const Perf_sample *start, const Perf_sample *end) {
+    for (i32 i = 0; i < PERF_EVENT_COUNT; ++i) {
+        u64 running = end->runningTimes[i] - start->runningTimes[i];
+        bool isIntervalValid = start->isValid[i] && end->isValid[i] && running > 0;
+        total->isValid[i] = total->isValid[i] && isIntervalValid;
+        if (!isIntervalValid) {
+            continue;
+        }
+
+        u64 enabled = end->enabledTimes[i] - start->enabledTimes[i];
+        total->values[i] += (u64)((f64)(end->values[i] - start->values[i]) * enabled / running);
+        total->enabledTimes[i] += enabled;
+        total->runningTimes[i] += running;
+    }
+
+    total->time += end->time - start->time;
+}
+
+void PrintPerfHeader(const char *label) {
+    printf("%-18s %9s %9s %6s %9s %9s %9s %9s\n", label, "ns", "cycles", "IPC", "instrs", "br miss", "L1D miss",
+        "LLC miss");
+}
+
+static void PrintPerfValue(const Perf_sample *total, Perf_event event, i64 operationCount) {
+    if (total->isValid[event]) {
+        printf(" %9.2f", (f64)total->values[event] / operationCount);
+    } else {
+        printf(" %9s", "-");
+    }
+}
+
+void PrintPerfRow(const char *name, const Perf_sample *total, i64 operationCount) {
+    operationCount = operationCount > 0 ? operationCount : 1;
+
+    printf("%-18s %9.2f", name, total->time / operationCount * 1e9);
+    PrintPerfValue(total, PERF_EVENT_CYCLES, operationCount);
+    if (total->isValid[PERF_EVENT_CYCLES] && total->isValid[PERF_EVENT_INSTRUCTIONS] &&
+        total->values[PERF_EVENT_CYCLES] > 0) {
+        printf(" %6.2f", (f64)total->values[PERF_EVENT_INSTRUCTIONS] / total->values[PERF_EVENT_CYCLES]);
+    } else {
+        printf(" %6s", "-");
+    }
+    PrintPerfValue(total, PERF_EVENT_INSTRUCTIONS, operationCount);
+    PrintPerfValue(total, PERF_EVENT_BRANCH_MISSES, operationCount);
+    PrintPerfValue(total, PERF_EVENT_L1D_MISSES, operationCount);
+    PrintPerfValue(total, PERF_EVENT_LLC_MISSES, operationCount);
+    printf("\n");
+}
+
+// Positions from random games, each followed by a random legal move for it
+static void CollectPerfPositions(Board *boards, Direction *moves, i32 count) {
+    Rng rng = CreateRng(PERF_BENCHMARK_SEED);
+    Board board;
+    ResetBoard(&board, &rng);
+
+    for (i32 i = 0; i < count;) {
+        Direction direction = RandomRange(&rng, 0, DIRECTION_COUNT - 1);
+        Board moved = board;
+        i32 score = 0;
+        if (!MoveBoard(&moved, direction, &score, NULL)) {
+            if (!CanMove(board.board) || GetPackedMaxTile(PackBoard(&board)) >= (i32)PACKED_TILE_MASK) {
+                ResetBoard(&board, &rng);
+            }
+            continue;
+        }
+
+        boards[i] = board;
+        moves[i++] = direction;
+        board = moved;
+        SpawnTile(&board, &rng);
+    }
+}
+
+// Returns something that depends on every result, so none of the calls can be left out
+static u64 RunPerfRegion(Perf_region region, const Board *boards, const Packed_board *packed, const Direction *moves,
+    i64 count) {
+    const Move_tables_data *tables = GetMoveTables();
+    Rng rng = CreateRng(PERF_BENCHMARK_SEED);
+    u64 sum = 0;
+    i32 score = 0;
+
+    for (i64 i = 0; i < count; ++i) {
+        i32 index = (i32)(i & (PERF_BENCHMARK_POSITIONS - 1));
+
+        switch (region) {
+            case PERF_REGION_MOVE_BOARD: {
+                Board board = boards[index];
+                MoveBoard(&board, moves[index], &score, NULL);
+                sum += board.board[i & (TILE_COUNT - 1)];
+                break;
+            }
+            case PERF_REGION_MOVE_PACKED:
+                sum += MovePackedBoard(packed[index], moves[index], &score);
+                break;
+            case PERF_REGION_MOVE_TABLES:
+                sum += MoveWithTables(tables, packed[index], moves[index], &score);
+                break;
+            case PERF_REGION_CAN_MOVE:
+                sum += CanMove(boards[index].board);
+                break;
+            case PERF_REGION_SPAWN_TILE: {
+                Board board = boards[index];
+                sum += SpawnTile(&board, &rng);
+                break;
+            }
+            case PERF_REGION_SUCCESSORS: {
+                Successors successors;
+                ComputeSuccessors(&boards[index], &successors, true);
+                sum += successors.moves[moves[index]].events.count;
+                break;
+            }
+            case PERF_REGION_COUNT:
+                break;
+        }
+    }
+
+    return sum + score;
+}
+
+i32 RunPerfBenchmark(i64 count) {
+    count = count > 0 ? count : PERF_BENCHMARK_DEFAULT_COUNT;
+
+    Board *boards = TrackedAlloc(PERF_BENCHMARK_POSITIONS * sizeof(Board), ALLOC_TAG_PERF);
+    Packed_board *packed = TrackedAlloc(PERF_BENCHMARK_POSITIONS * sizeof(Packed_board), ALLOC_TAG_PERF);
+    Direction *moves = TrackedAlloc(PERF_BENCHMARK_POSITIONS * sizeof(Direction), ALLOC_TAG_PERF);
+    CollectPerfPositions(boards, moves, PERF_BENCHMARK_POSITIONS);
+    for (i32 i = 0; i < PERF_BENCHMARK_POSITIONS; ++i) {
+        packed[i] = PackBoard(&boards[i]);
+    }
+
+    Perf_counters counters;
+    OpenPerfCounters(&counters);
+
+    printf("%lld calls each on %d positions from random games\n", (long long)count, PERF_BENCHMARK_POSITIONS);
+    for (i32 i = 0; i < PERF_EVENT_COUNT; ++i) {
+        if (counters.openCount > 0 && counters.fds[i] < 0) {
+            printf("No %s counter\n", PERF_EVENT_NAMES[i]);
+        }
+    }
+    PrintPerfHeader("Per call");
+
+    u64 sink = 0;
+    for (i32 region = 0; region < PERF_REGION_COUNT; ++region) {
+        // A warm-up pass so the tables and positions are in the cache for every region alike
+        sink += RunPerfRegion(region, boards, packed, moves, PERF_BENCHMARK_POSITIONS);
+
+        Perf_sample total;
+        InitPerfTotal(&total);
+        Perf_sample start = ReadPerfCounters(&counters);
+        sink += RunPerfRegion(region, boards, packed, moves, count);
+        Perf_sample end = ReadPerfCounters(&counters);
+        AccumulatePerfSample(&total, &start, &end);
+
+        PrintPerfRow(PERF_REGION_NAMES[region], &total, count);
+    }
+    printf("(checksum %llu)\n", (unsigned long long)(sink & 0xFFFF));
+
+    ClosePerfCounters(&counters);
+    TrackedFree(boards, ALLOC_TAG_PERF);
+    TrackedFree(packed, ALLOC_TAG_PERF);
+    TrackedFree(moves, ALLOC_TAG_PERF);
+
+    return 0;
+}
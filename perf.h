@@ -0,0 +1,57 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include "common.h"
+
+#define PERF_BENCHMARK_DEFAULT_COUNT 4000000
+
+// Hardware counters from perf_event_open, for the calling thread and every thread it starts after opening them (a
+// thread's counts are added once it has been joined). The kernel may refuse any of them (in a container, under a
+// strict perf_event_paranoid, in a VM without a PMU, or off Linux), in which case they're left out of the results:
+// timing still works without them.
+
+typedef enum Perf_event {
+    PERF_EVENT_CYCLES,
+    PERF_EVENT_INSTRUCTIONS,
+    PERF_EVENT_BRANCH_MISSES,
+    PERF_EVENT_L1D_MISSES, // Loads that missed the L1 data cache
+    PERF_EVENT_LLC_MISSES, // Last level cache
+    PERF_EVENT_COUNT
+} Perf_event;
+
+typedef struct Perf_counters {
+    i32 fds[PERF_EVENT_COUNT]; // -1 for the ones that couldn't be opened
+    i32 openCount;
+} Perf_counters;
+
+// Raw readings, or the difference of two with each count scaled up for the time the kernel had it switched out to
+// make room for others
+typedef struct Perf_sample {
+    u64 values[PERF_EVENT_COUNT];
+    u64 enabledTimes[PERF_EVENT_COUNT]; // Nanoseconds
+    u64 runningTimes[PERF_EVENT_COUNT];
+    bool isValid[PERF_EVENT_COUNT];
+    f64 time; // GetWallTime seconds
+} Perf_sample;
+
+
+// False if none of the counters could be opened, with the reason printed once
+bool OpenPerfCounters(Perf_counters *counters);
+void ClosePerfCounters(Perf_counters *counters);
+Perf_sample ReadPerfCounters(const Perf_counters *counters);
+
+// Zeroed, with every counter valid until an interval added to it is missing one
+void InitPerfTotal(Perf_sample *total);
+// Adds what was counted between start and end to total. A counter missing from the interval is left out of the
+// total for good, since the total would undercount it otherwise.
+void AccumulatePerfSample(Perf_sample *total, const Perf_sample *start, const Perf_sample *end);
+
+// A row per measured region, with everything per operation and a - for counters that aren't there
+void PrintPerfHeader(const char *label);
+void PrintPerfRow(const char *name, const Perf_sample *total, i64 operationCount);
+
+// The counters around the move engines (MoveBoard's cell by cell loop, MovePackedBoard and the tables), CanMove,
+// SpawnTile and ComputeSuccessors, count calls of each on positions from random games
+i32 RunPerfBenchmark(i64 count);
+
+#endif
@@ -0,0 +1,276 @@
+#include "platform.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOGDI
+#define NOUSER
+#include <windows.h>
+#include <io.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+
+#ifdef _WIN32
+
+f64 GetWallTime(void) {
+    static LARGE_INTEGER frequency;
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+
+    return (f64)counter.QuadPart / (f64)frequency.QuadPart;
+}
+
+f64 GetThreadCpuTime(void) {
+    FILETIME creation, exit, kernel, user;
+    GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user);
+
+    // 100 ns units
+    u64 kernelTime = ((u64)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime;
+    u64 userTime = ((u64)user.dwHighDateTime << 32) | user.dwLowDateTime;
+    return (kernelTime + userTime) / 1e7;
+}
+
+void SleepSeconds(f64 seconds) {
+    Sleep((DWORD)(seconds * 1000.0));
+}
+
+bool MakeDirectory(const char *path) {
+    return CreateDirectoryA(path, NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+}
+
+bool SyncFile(FILE *file) {
+    return fflush(file) == 0 && _commit(_fileno(file)) == 0;
+}
+
+bool RenameFile(const char *from, const char *to) {
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING);
+}
+
+bool TruncateFile(const char *path, i64 size) {
+    HANDLE handle = CreateFileA(path, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 
+        FILE_ATTRIBUTE_NORMAL, NULL);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER position = {.QuadPart = size};
+    bool isOk = SetFilePointerEx(handle, position, NULL, FILE_BEGIN) && SetEndOfFile(handle);
+    CloseHandle(handle);
+
+    return isOk;
+}
+
+bool MapFile(Mapped_file *file, const char *path) {
+    *file = (Mapped_file){0};
+
+    // Others may keep writing, the results log is mapped while it's open for appending
+    HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 
+        FILE_ATTRIBUTE_NORMAL, NULL);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    HANDLE mapping = NULL;
+    if (GetFileSizeEx(handle, &size) && size.QuadPart > 0) {
+        mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    }
+
+    void *data = mapping != NULL ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (data == NULL) {
+        if (mapping != NULL) {
+            CloseHandle(mapping);
+        }
+        CloseHandle(handle);
+        return false;
+    }
+
+    file->data = data;
+    file->size = size.QuadPart;
+    file->file = handle;
+    file->mapping = mapping;
+
+    return true;
+}
+
+void UnmapFile(Mapped_file *file) {
+    if (file->data != NULL) {
+        UnmapViewOfFile(file->data);
+        CloseHandle(file->mapping);
+        CloseHandle(file->file);
+    }
+    *file = (Mapped_file){0};
+}
+
+i32 AtomicLoadI32(volatile i32 *value) {
+    return InterlockedCompareExchange((volatile LONG *)value, 0, 0);
+}
+
+void AtomicStoreI32(volatile i32 *value, i32 newValue) {
+    InterlockedExchange((volatile LONG *)value, newValue);
+}
+
+i32 AtomicAddI32(volatile i32 *value, i32 amount) {
+    return InterlockedAdd((volatile LONG *)value, amount);
+}
+
+bool AtomicCompareExchangeI32(volatile i32 *value, i32 expected, i32 newValue) {
+    return InterlockedCompareExchange((volatile LONG *)value, newValue, expected) == expected;
+}
+
+i64 AtomicAddI64(volatile i64 *value, i64 amount) {
+    return InterlockedAdd64(value, amount);
+}
+
+static DWORD WINAPI RunThread(LPVOID parameter) {
+    Thread *thread = parameter;
+    thread->function(thread->data);
+    return 0;
+}
+
+bool StartThread(Thread *thread, Thread_function function, void *data) {
+    thread->function = function;
+    thread->data = data;
+    thread->handle = CreateThread(NULL, 0, &RunThread, thread, 0, NULL);
+
+    return thread->handle != NULL;
+}
+
+void JoinThread(Thread *thread) {
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+}
+
+i32 GetProcessorCount(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+
+    return info.dwNumberOfProcessors;
+}
+
+#else
+
+f64 GetWallTime(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+f64 GetThreadCpuTime(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+void SleepSeconds(f64 seconds) {
+    struct timespec duration = {
+        .tv_sec = (time_t)seconds,
+        .tv_nsec = (long)((seconds - (time_t)seconds) * 1e9)
+    };
+    nanosleep(&duration, NULL);
+}
+
+bool MakeDirectory(const char *path) {
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+}
+
+bool SyncFile(FILE *file) {
+    return fflush(file) == 0 && fsync(fileno(file)) == 0;
+}
+
+bool RenameFile(const char *from, const char *to) {
+    return rename(from, to) == 0;
+}
+
+bool TruncateFile(const char *path, i64 size) {
+    return truncate(path, size) == 0;
+}
+
+bool MapFile(Mapped_file *file, const char *path) {
+    *file = (Mapped_file){0};
+
+    i32 descriptor = open(path, O_RDONLY);
+    if (descriptor < 0) {
+        return false;
+    }
+
+    // The mapping stays valid once the descriptor is closed
+    struct stat status;
+    void *data = MAP_FAILED;
+    if (fstat(descriptor, &status) == 0 && status.st_size > 0) {
+        data = mmap(NULL, status.st_size, PROT_READ, MAP_SHARED, descriptor, 0);
+    }
+    close(descriptor);
+
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    file->data = data;
+    file->size = status.st_size;
+
+    return true;
+}
+
+void UnmapFile(Mapped_file *file) {
+    if (file->data != NULL) {
+        munmap((void *)file->data, file->size);
+    }
+    *file = (Mapped_file){0};
+}
+
+i32 AtomicLoadI32(volatile i32 *value) {
+    return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+}
+
+void AtomicStoreI32(volatile i32 *value, i32 newValue) {
+    __atomic_store_n(value, newValue, __ATOMIC_SEQ_CST);
+}
+
+i32 AtomicAddI32(volatile i32 *value, i32 amount) {
+    return __atomic_add_fetch(value, amount, __ATOMIC_SEQ_CST);
+}
+
+bool AtomicCompareExchangeI32(volatile i32 *value, i32 expected, i32 newValue) {
+    return __atomic_compare_exchange_n(value, &expected, newValue, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+i64 AtomicAddI64(volatile i64 *value, i64 amount) {
+    return __atomic_add_fetch(value, amount, __ATOMIC_SEQ_CST);
+}
+
+static void *RunThread(void *parameter) {
+    Thread *thread = parameter;
+    thread->function(thread->data);
+    return NULL;
+}
+
+bool StartThread(Thread *thread, Thread_function function, void *data) {
+    thread->function = function;
+    thread->data = data;
+
+    return pthread_create(&thread->handle, NULL, &RunThread, thread) == 0;
+}
+
+void JoinThread(Thread *thread) {
+    pthread_join(thread->handle, NULL);
+}
+
+i32 GetProcessorCount(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? count : 1;
+}
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <stdio.h>
+
+#include "common.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+// The few OS facilities the headless modes need that raylib doesn't cover (raylib's timer only runs once a window
+// is open)
+
+typedef void (*Thread_function)(void *data);
+
+// Must stay where it is until JoinThread returns, the new thread reads function and data through it
+typedef struct Thread {
+    Thread_function function;
+    void *data;
+#ifdef _WIN32
+    void *handle;
+#else
+    pthread_t handle;
+#endif
+} Thread;
+
+// A whole file mapped read-only, so processes that map the same file share its pages
+typedef struct Mapped_file {
+    const void *data;
+    i64 size;
+#ifdef _WIN32
+    void *file;
+    void *mapping;
+#endif
+} Mapped_file;
+
+f64 GetWallTime(void); // Seconds from an arbitrary monotonic start point
+f64 GetThreadCpuTime(void); // Seconds of CPU the calling thread has used, user and kernel
+
+void SleepSeconds(f64 seconds);
+bool MakeDirectory(const char *path); // Also true if it already exists
+bool SyncFile(FILE *file); // Flushes stdio's buffer and then the OS's, so what was written survives a power cut
+bool RenameFile(const char *from, const char *to); // Replaces to in one step if it exists
+bool TruncateFile(const char *path, i64 size);
+
+bool MapFile(Mapped_file *file, const char *path); // False for empty files too
+void UnmapFile(Mapped_file *file);
+
+// Sequentially consistent, for the little state threads share
+i32 AtomicLoadI32(volatile i32 *value);
+void AtomicStoreI32(volatile i32 *value, i32 newValue);
+i32 AtomicAddI32(volatile i32 *value, i32 amount); // Returns the new value
+// Sets *value to newValue if it is expected, and returns whether it was
+bool AtomicCompareExchangeI32(volatile i32 *value, i32 expected, i32 newValue);
+i64 AtomicAddI64(volatile i64 *value, i64 amount); // Returns the new value
+
+bool StartThread(Thread *thread, Thread_function function, void *data);
+void JoinThread(Thread *thread);
+i32 GetProcessorCount(void);
+
+#endif
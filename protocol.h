@@ -0,0 +1,56 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include "common.h"
+#include "board.h"
+
+// Binary protocol spoken by the headless server (see server.c). Every request is a Request_header, followed by
+// count direction bytes for REQUEST_BATCH. Every request gets exactly one Response back, in order. Fields are in
+// host byte order since both ends are on the same machine.
+
+#define PROTOCOL_MAX_BATCH 1024
+#define PROTOCOL_MAX_REQUEST_SIZE (sizeof(Request_header) + PROTOCOL_MAX_BATCH)
+
+#define SESSION_NONE 0xFFFFFFFFu
+
+
+typedef enum Request_type {
+    REQUEST_NEW_GAME,  // seed; session is SESSION_NONE for a new session or an existing one to restart it
+    REQUEST_MOVE,      // direction
+    REQUEST_GET_STATE,
+    REQUEST_BATCH,     // count directions follow, applied until one of them ends the game
+    REQUEST_CLOSE,
+    REQUEST_TYPE_COUNT
+} Request_type;
+
+typedef enum Response_status {
+    STATUS_OK,
+    STATUS_BAD_REQUEST,
+    STATUS_BAD_SESSION,
+    STATUS_POOL_FULL
+} Response_status;
+
+typedef enum Response_flags {
+    RESPONSE_FLAG_MOVED = 1 << 0,     // The last move changed the board
+    RESPONSE_FLAG_GAME_OVER = 1 << 1
+} Response_flags;
+
+typedef struct Request_header {
+    u8 type;
+    u8 direction;
+    u16 count;
+    u32 session;
+    u64 seed;
+} Request_header;
+
+typedef struct Response {
+    u8 status;
+    u8 flags;
+    u16 movedCount; // Moves of a batch that changed the board
+    u32 session;
+    Packed_board board;
+    i32 score;
+    u32 moveCount; // Moves made in the session since it was (re)started
+} Response;
+
+#endif
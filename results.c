@@ -0,0 +1,621 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "allocator.h"
+#include "board.h"
+#include "results.h"
+
+#define RESULTS_INITIAL_TAIL_CAPACITY 256
+#define RESULTS_MAX_PRINTED 1000
+#define RESULTS_BENCH_QUERY_COUNT 10000
+#define RESULTS_BENCH_ROWS_PER_SECOND 1000 // Of synthetic time, so a one second range finds about this many
+
+#define RESULTS_SCORE_BIAS 0x80000000u
+#define RESULTS_TIME_BIAS 0x8000000000000000ull
+
+
+static const char *const RESULT_POLICY_NAMES[RESULT_POLICY_COUNT] = {"human", "random", "greedy", "corner", "search"};
+
+
+const char *GetResultPolicyName(Result_policy policy) {
+    return policy >= 0 && policy < RESULT_POLICY_COUNT ? RESULT_POLICY_NAMES[policy] : "unknown";
+}
+
+// FNV-1a
+static u32 GetRowChecksum(const Result_row *row) {
+    const u8 *bytes = (const u8 *)row;
+    u32 hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(Result_row, checksum); ++i) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+// The score in the high half, biased so that the keys sort as unsigned, and the row flipped in the low half. Sorted
+// ascending, the keys read from the end give the highest score first and, among equal scores, the earliest row.
+static u64 GetScoreKey(i32 score, u32 row) {
+    return (u64)((u32)score ^ RESULTS_SCORE_BIAS) << 32 | (u32)~row;
+}
+
+static u32 GetScoreKeyRow(u64 key) {
+    return ~(u32)key;
+}
+
+static u64 GetTimeKey(i64 time) {
+    return (u64)time ^ RESULTS_TIME_BIAS;
+}
+
+static i32 CompareScoreKeys(const void *a, const void *b) {
+    u64 keyA = *(const u64 *)a;
+    u64 keyB = *(const u64 *)b;
+    return (keyA > keyB) - (keyA < keyB);
+}
+
+static i32 CompareResultsKeys(const void *a, const void *b) {
+    const Results_key *keyA = a;
+    const Results_key *keyB = b;
+    if (keyA->key != keyB->key) {
+        return keyA->key < keyB->key ? -1 : 1;
+    }
+
+    return (keyA->row > keyB->row) - (keyA->row < keyB->row);
+}
+
+static void GetStorePath(char *storePath, const char *path, const char *extension) {
+    snprintf(storePath, RESULTS_PATH_SIZE, "%s%s", path, extension);
+}
+
+// Creates the log if it's missing or never got its header written, and cuts off rows a crash left half written
+static bool RepairResultsLog(const char *path, i64 *rowCount) {
+    *rowCount = 0;
+
+    Results_header header;
+    FILE *file = fopen(path, "rb");
+    bool hasHeader = file != NULL && fread(&header, sizeof(header), 1, file) == 1;
+    if (file != NULL) {
+        fclose(file);
+    }
+
+    if (!hasHeader) {
+        header = (Results_header){
+            .magic = RESULTS_MAGIC,
+            .version = RESULTS_VERSION,
+            .rowSize = sizeof(Result_row)
+        };
+
+        file = fopen(path, "wb");
+        bool isOk = file != NULL && fwrite(&header, sizeof(header), 1, file) == 1 && SyncFile(file);
+        if (file != NULL) {
+            isOk &= fclose(file) == 0;
+        }
+
+        return isOk;
+    }
+
+    if (memcmp(header.magic, RESULTS_MAGIC, sizeof(header.magic)) != 0 || header.version != RESULTS_VERSION ||
+        header.rowSize != sizeof(Result_row)) {
+        return false;
+    }
+
+    Mapped_file log;
+    if (!MapFile(&log, path)) {
+        return false;
+    }
+
+    // Only the end of the log can be torn, the rows are appended in order
+    const Result_row *rows = (const Result_row *)((const u8 *)log.data + sizeof(Results_header));
+    i64 count = (log.size - (i64)sizeof(Results_header)) / (i64)sizeof(Result_row);
+    while (count > 0 && rows[count - 1].checksum != GetRowChecksum(&rows[count - 1])) {
+        --count;
+    }
+
+    i64 size = log.size;
+    UnmapFile(&log);
+
+    *rowCount = count;
+    i64 validSize = sizeof(Results_header) + count * sizeof(Result_row);
+    if (validSize != size) {
+        fprintf(stderr, "Cut %lld bytes of unfinished rows off %s\n", (long long)(size - validSize), path);
+        return TruncateFile(path, validSize);
+    }
+
+    return true;
+}
+
+bool OpenResultsWriter(Results_writer *writer, const char *path) {
+    *writer = (Results_writer){0};
+    GetStorePath(writer->path, path, ".log");
+
+    if (!RepairResultsLog(writer->path, &writer->rowCount)) {
+        return false;
+    }
+
+    writer->file = fopen(writer->path, "ab");
+    if (writer->file == NULL) {
+        return false;
+    }
+    setvbuf(writer->file, NULL, _IOFBF, RESULTS_WRITE_BUFFER_SIZE);
+
+    return true;
+}
+
+bool AppendResult(Results_writer *writer, Result_row *row) {
+    row->checksum = GetRowChecksum(row);
+    if (fwrite(row, sizeof(Result_row), 1, writer->file) != 1) {
+        return false;
+    }
+
+    ++writer->rowCount;
+    return true;
+}
+
+bool CloseResultsWriter(Results_writer *writer) {
+    if (writer->file == NULL) {
+        return false;
+    }
+
+    bool isOk = SyncFile(writer->file);
+    isOk &= fclose(writer->file) == 0;
+    writer->file = NULL;
+
+    return isOk;
+}
+
+// False unless the file is a whole index of at most rowCount rows
+static bool ReadIndexSections(const Mapped_file *index, i64 rowCount, const u64 **scoreKeys,
+    const Results_key **seedKeys, const Results_key **timeKeys, i64 *indexedCount) {
+    if (index->data == NULL || index->size < (i64)sizeof(Results_index_header)) {
+        return false;
+    }
+
+    const Results_index_header *header = index->data;
+    i64 count = (i64)header->rowCount;
+    if (memcmp(header->magic, RESULTS_INDEX_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != RESULTS_INDEX_VERSION || count > rowCount ||
+        index->size != (i64)(sizeof(Results_index_header) + count * (sizeof(u64) + 2 * sizeof(Results_key)))) {
+        return false;
+    }
+
+    *scoreKeys = (const u64 *)(header + 1);
+    *seedKeys = (const Results_key *)(*scoreKeys + count);
+    *timeKeys = *seedKeys + count;
+    *indexedCount = count;
+
+    return true;
+}
+
+// Writes two sorted runs out as one
+static bool WriteMergedKeys(FILE *file, const void *oldKeys, i64 oldCount, const void *newKeys, i64 newCount,
+    size_t size, i32 (*compare)(const void *a, const void *b)) {
+    const u8 *old = oldKeys;
+    const u8 *new = newKeys;
+    i64 i = 0;
+    i64 j = 0;
+
+    bool isOk = true;
+    while (isOk && (i < oldCount || j < newCount)) {
+        const u8 *next;
+        if (j == newCount || (i < oldCount && compare(old + i * size, new + j * size) <= 0)) {
+            next = old + i++ * size;
+        } else {
+            next = new + j++ * size;
+        }
+
+        isOk = fwrite(next, size, 1, file) == 1;
+    }
+
+    return isOk;
+}
+
+bool UpdateResultsIndex(const char *path) {
+    char logPath[RESULTS_PATH_SIZE];
+    char indexPath[RESULTS_PATH_SIZE];
+    char temporaryPath[RESULTS_PATH_SIZE];
+    GetStorePath(logPath, path, ".log");
+    GetStorePath(indexPath, path, ".idx");
+    GetStorePath(temporaryPath, path, ".idx.tmp");
+
+    i64 rowCount;
+    Mapped_file log;
+    if (!RepairResultsLog(logPath, &rowCount) || !MapFile(&log, logPath)) {
+        return false;
+    }
+    const Result_row *rows = (const Result_row *)((const u8 *)log.data + sizeof(Results_header));
+
+    // Whatever the old index covers is merged with the new rows, a broken one is started over
+    Mapped_file index;
+    const u64 *oldScoreKeys = NULL;
+    const Results_key *oldSeedKeys = NULL;
+    const Results_key *oldTimeKeys = NULL;
+    i64 oldCount = 0;
+    bool isIndexValid = MapFile(&index, indexPath) &&
+        ReadIndexSections(&index, rowCount, &oldScoreKeys, &oldSeedKeys, &oldTimeKeys, &oldCount);
+    if (!isIndexValid) {
+        oldCount = 0;
+    }
+
+    i64 newCount = rowCount - oldCount;
+    if (isIndexValid && newCount == 0) {
+        UnmapFile(&index);
+        UnmapFile(&log);
+        return true;
+    }
+
+    u64 *scoreKeys = TrackedAlloc((newCount > 0 ? newCount : 1) * sizeof(u64), ALLOC_TAG_RESULTS);
+    Results_key *seedKeys = TrackedAlloc((newCount > 0 ? newCount : 1) * sizeof(Results_key), ALLOC_TAG_RESULTS);
+    Results_key *timeKeys = TrackedAlloc((newCount > 0 ? newCount : 1) * sizeof(Results_key), ALLOC_TAG_RESULTS);
+    for (i64 i = 0; i < newCount; ++i) {
+        u32 row = (u32)(oldCount + i);
+        scoreKeys[i] = GetScoreKey(rows[row].score, row);
+        seedKeys[i] = (Results_key){.key = rows[row].seed, .row = row};
+        timeKeys[i] = (Results_key){.key = GetTimeKey(rows[row].time), .row = row};
+    }
+    qsort(scoreKeys, newCount, sizeof(u64), &CompareScoreKeys);
+    qsort(seedKeys, newCount, sizeof(Results_key), &CompareResultsKeys);
+    qsort(timeKeys, newCount, sizeof(Results_key), &CompareResultsKeys);
+
+    Results_index_header header = {
+        .magic = RESULTS_INDEX_MAGIC,
+        .version = RESULTS_INDEX_VERSION,
+        .rowCount = rowCount
+    };
+
+    FILE *file = fopen(temporaryPath, "wb");
+    bool isOk = file != NULL;
+    if (isOk) {
+        setvbuf(file, NULL, _IOFBF, RESULTS_WRITE_BUFFER_SIZE);
+        isOk = fwrite(&header, sizeof(header), 1, file) == 1 &&
+            WriteMergedKeys(file, oldScoreKeys, oldCount, scoreKeys, newCount, sizeof(u64), &CompareScoreKeys) &&
+            WriteMergedKeys(file, oldSeedKeys, oldCount, seedKeys, newCount, sizeof(Results_key),
+                &CompareResultsKeys) &&
+            WriteMergedKeys(file, oldTimeKeys, oldCount, timeKeys, newCount, sizeof(Results_key),
+                &CompareResultsKeys) &&
+            SyncFile(file);
+        isOk &= fclose(file) == 0;
+    }
+
+    TrackedFree(scoreKeys, ALLOC_TAG_RESULTS);
+    TrackedFree(seedKeys, ALLOC_TAG_RESULTS);
+    TrackedFree(timeKeys, ALLOC_TAG_RESULTS);
+    UnmapFile(&index);
+    UnmapFile(&log);
+
+    // Swapped in whole, a crash before this leaves the old index
+    return isOk && RenameFile(temporaryPath, indexPath);
+}
+
+static bool MapResultsIndex(Results_store *store, const char *path) {
+    char indexPath[RESULTS_PATH_SIZE];
+    GetStorePath(indexPath, path, ".idx");
+
+    if (!MapFile(&store->index, indexPath) || !ReadIndexSections(&store->index, store->writer.rowCount,
+        &store->scoreKeys, &store->seedKeys, &store->timeKeys, &store->indexedCount)) {
+        UnmapFile(&store->index);
+        store->indexedCount = 0;
+        return false;
+    }
+
+    return true;
+}
+
+bool OpenResultsStore(Results_store *store, const char *path) {
+    *store = (Results_store){0};
+    if (!OpenResultsWriter(&store->writer, path)) {
+        return false;
+    }
+
+    // A log that got ahead of its index (batch runs don't update it) catches up here, once
+    bool isIndexed = MapResultsIndex(store, path);
+    if (!isIndexed || store->writer.rowCount - store->indexedCount > RESULTS_MAX_TAIL) {
+        UnmapFile(&store->index);
+        if (UpdateResultsIndex(path)) {
+            MapResultsIndex(store, path);
+        }
+    }
+
+    // The rows before this point don't change, so the log is mapped once and the rows added later are kept in tail
+    if (!MapFile(&store->log, store->writer.path)) {
+        CloseResultsStore(store);
+        return false;
+    }
+    const Result_row *rows = (const Result_row *)((const u8 *)store->log.data + sizeof(Results_header));
+    store->rows = rows;
+
+    store->tailCount = store->writer.rowCount - store->indexedCount;
+    store->tailCapacity = store->tailCount > RESULTS_INITIAL_TAIL_CAPACITY ? store->tailCount :
+        RESULTS_INITIAL_TAIL_CAPACITY;
+    store->tail = TrackedAlloc(store->tailCapacity * sizeof(Result_row), ALLOC_TAG_RESULTS);
+    memcpy(store->tail, rows + store->indexedCount, store->tailCount * sizeof(Result_row));
+
+    return true;
+}
+
+void CloseResultsStore(Results_store *store) {
+    if (store->writer.file != NULL) {
+        CloseResultsWriter(&store->writer);
+    }
+    UnmapFile(&store->log);
+    UnmapFile(&store->index);
+    TrackedFree(store->tail, ALLOC_TAG_RESULTS);
+
+    *store = (Results_store){0};
+}
+
+bool AddResult(Results_store *store, Result_row *row) {
+    if (store->writer.file == NULL || !AppendResult(&store->writer, row) || !SyncFile(store->writer.file)) {
+        return false;
+    }
+
+    if (store->tailCount == store->tailCapacity) {
+        store->tailCapacity *= 2;
+        store->tail = TrackedRealloc(store->tail, store->tailCapacity * sizeof(Result_row), ALLOC_TAG_RESULTS);
+    }
+    store->tail[store->tailCount++] = *row;
+
+    return true;
+}
+
+i32 GetTopResults(const Results_store *store, Result_row *rows, i32 count) {
+    i32 found = 0;
+    for (i64 i = store->indexedCount - 1; i >= 0 && found < count; --i) {
+        rows[found++] = store->rows[GetScoreKeyRow(store->scoreKeys[i])];
+    }
+
+    // Tail rows come after every indexed one, so they only go above strictly lower scores
+    for (i64 i = 0; i < store->tailCount; ++i) {
+        const Result_row *row = &store->tail[i];
+        if (found == count && (count == 0 || row->score <= rows[count - 1].score)) {
+            continue;
+        }
+
+        i32 j = found < count ? found++ : count - 1;
+        for (; j > 0 && rows[j - 1].score < row->score; --j) {
+            rows[j] = rows[j - 1];
+        }
+        rows[j] = *row;
+    }
+
+    return found;
+}
+
+static i64 FindFirstKey(const Results_key *keys, i64 count, u64 key) {
+    i64 low = 0;
+    i64 high = count;
+    while (low < high) {
+        i64 middle = low + (high - low) / 2;
+        if (keys[middle].key < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+i32 FindResultsBySeed(const Results_store *store, u64 seed, Result_row *rows, i32 capacity) {
+    i32 found = 0;
+    for (i64 i = FindFirstKey(store->seedKeys, store->indexedCount, seed);
+        i < store->indexedCount && store->seedKeys[i].key == seed && found < capacity; ++i) {
+        rows[found++] = store->rows[store->seedKeys[i].row];
+    }
+
+    for (i64 i = 0; i < store->tailCount && found < capacity; ++i) {
+        if (store->tail[i].seed == seed) {
+            rows[found++] = store->tail[i];
+        }
+    }
+
+    return found;
+}
+
+i64 FindResultsByTime(const Results_store *store, i64 from, i64 to, Result_row *rows, i64 capacity) {
+    i64 found = 0;
+    for (i64 i = FindFirstKey(store->timeKeys, store->indexedCount, GetTimeKey(from));
+        i < store->indexedCount && store->timeKeys[i].key <= GetTimeKey(to) && found < capacity; ++i) {
+        rows[found++] = store->rows[store->timeKeys[i].row];
+    }
+
+    for (i64 i = 0; i < store->tailCount && found < capacity; ++i) {
+        if (store->tail[i].time >= from && store->tail[i].time <= to) {
+            rows[found++] = store->tail[i];
+        }
+    }
+
+    return found;
+}
+
+i32 GetBestScore(const Results_store *store) {
+    Result_row best;
+    return GetTopResults(store, &best, 1) > 0 ? best.score : 0;
+}
+
+static void PrintResultRows(const Result_row *rows, i64 count) {
+    for (i64 i = 0; i < count; ++i) {
+        const Result_row *row = &rows[i];
+
+        char date[32];
+        time_t time = (time_t)row->time;
+        struct tm *local = localtime(&time);
+        if (local == NULL || strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", local) == 0) {
+            snprintf(date, sizeof(date), "%lld", (long long)row->time);
+        }
+
+        printf("  %s  %-6s %9d  %6u tile  %6u moves  %8.1f s  %dx%d  seed %llu\n", date,
+            GetResultPolicyName(row->policy), row->score, PowerOf2(row->maxTile), row->moveCount, row->duration,
+            row->boardSize, row->boardSize, (unsigned long long)row->seed);
+    }
+}
+
+// Opens the store and a buffer for the rows a query returns
+static bool BeginResultsQuery(Results_store *store, const char *path, Result_row **rows) {
+    if (!OpenResultsStore(store, path)) {
+        fprintf(stderr, "Could not open the results in %s.log\n", path);
+        return false;
+    }
+
+    *rows = TrackedAlloc(RESULTS_MAX_PRINTED * sizeof(Result_row), ALLOC_TAG_RESULTS);
+    printf("%lld results, %lld of them indexed\n", (long long)store->writer.rowCount, (long long)store->indexedCount);
+
+    return true;
+}
+
+static void EndResultsQuery(Results_store *store, Result_row *rows, i64 count, f64 time) {
+    PrintResultRows(rows, count);
+    printf("%lld found in %.1f us\n", (long long)count, time * 1e6);
+
+    TrackedFree(rows, ALLOC_TAG_RESULTS);
+    CloseResultsStore(store);
+}
+
+i32 RunResultsTop(const char *path, i32 count) {
+    Results_store store;
+    Result_row *rows;
+    if (!BeginResultsQuery(&store, path, &rows)) {
+        return 1;
+    }
+
+    f64 start = GetWallTime();
+    i32 found = GetTopResults(&store, rows, MinI32(MaxI32(count, 1), RESULTS_MAX_PRINTED));
+    EndResultsQuery(&store, rows, found, GetWallTime() - start);
+
+    return 0;
+}
+
+i32 RunResultsSeed(const char *path, u64 seed) {
+    Results_store store;
+    Result_row *rows;
+    if (!BeginResultsQuery(&store, path, &rows)) {
+        return 1;
+    }
+
+    f64 start = GetWallTime();
+    i32 found = FindResultsBySeed(&store, seed, rows, RESULTS_MAX_PRINTED);
+    EndResultsQuery(&store, rows, found, GetWallTime() - start);
+
+    return 0;
+}
+
+i32 RunResultsTime(const char *path, i64 from, i64 to) {
+    Results_store store;
+    Result_row *rows;
+    if (!BeginResultsQuery(&store, path, &rows)) {
+        return 1;
+    }
+
+    f64 start = GetWallTime();
+    i64 found = FindResultsByTime(&store, from, to, rows, RESULTS_MAX_PRINTED);
+    EndResultsQuery(&store, rows, found, GetWallTime() - start);
+
+    return 0;
+}
+
+i32 RunResultsIndex(const char *path) {
+    f64 start = GetWallTime();
+    if (!UpdateResultsIndex(path)) {
+        fprintf(stderr, "Could not index %s.log\n", path);
+        return 1;
+    }
+
+    printf("Indexed %s.log in %.2f s\n", path, GetWallTime() - start);
+    return 0;
+}
+
+i32 RunResultsBenchmark(const char *path, i64 rowCount) {
+    char logPath[RESULTS_PATH_SIZE];
+    char indexPath[RESULTS_PATH_SIZE];
+    GetStorePath(logPath, path, ".log");
+    GetStorePath(indexPath, path, ".idx");
+
+    // The benchmark deletes its store afterwards, so it must never be pointed at one holding real games
+    FILE *existing = fopen(logPath, "rb");
+    if (existing == NULL) {
+        existing = fopen(indexPath, "rb");
+    }
+    if (existing != NULL) {
+        fclose(existing);
+        fprintf(stderr, "%s already exists, benchmark a path that doesn't\n", path);
+        return 1;
+    }
+
+    Results_writer writer;
+    if (!OpenResultsWriter(&writer, path)) {
+        fprintf(stderr, "Could not create %s\n", logPath);
+        return 1;
+    }
+
+    // Scores spread like a mix of bots, the seeds repeat so that a seed has a few rows
+    Rng rng = CreateRng(1);
+    i64 firstTime = (i64)time(NULL) - rowCount / RESULTS_BENCH_ROWS_PER_SECOND;
+    f64 start = GetWallTime();
+    bool isOk = true;
+    for (i64 i = 0; i < rowCount && isOk; ++i) {
+        Result_row row = {
+            .seed = (u64)(i / 4),
+            .time = firstTime + i / RESULTS_BENCH_ROWS_PER_SECOND,
+            .score = RandomRange(&rng, 0, 1 << RandomRange(&rng, 8, 19)),
+            .moveCount = (u32)RandomRange(&rng, 50, 5000),
+            .duration = 0.001f,
+            .maxTile = (u8)RandomRange(&rng, 5, 15),
+            .boardSize = TILE_COUNT_X,
+            .policy = RESULT_POLICY_RANDOM
+        };
+        isOk = AppendResult(&writer, &row);
+    }
+    isOk &= CloseResultsWriter(&writer);
+    f64 appendTime = GetWallTime() - start;
+
+    start = GetWallTime();
+    isOk &= UpdateResultsIndex(path);
+    f64 indexTime = GetWallTime() - start;
+
+    Results_store store;
+    start = GetWallTime();
+    if (!isOk || !OpenResultsStore(&store, path)) {
+        fprintf(stderr, "Could not write or index %s\n", logPath);
+        remove(logPath);
+        remove(indexPath);
+        return 1;
+    }
+    f64 openTime = GetWallTime() - start;
+
+    printf("%lld rows: appended at %.1f M rows/s, indexed in %.2f s, opened in %.2f ms\n", (long long)rowCount,
+        rowCount / appendTime / 1e6, indexTime, openTime * 1e3);
+
+    Result_row *rows = TrackedAlloc(RESULTS_MAX_PRINTED * sizeof(Result_row), ALLOC_TAG_RESULTS);
+    i64 rowSum = 0;
+
+    start = GetWallTime();
+    for (i32 i = 0; i < RESULTS_BENCH_QUERY_COUNT; ++i) {
+        rowSum += GetTopResults(&store, rows, 10);
+    }
+    f64 topTime = (GetWallTime() - start) / RESULTS_BENCH_QUERY_COUNT;
+
+    start = GetWallTime();
+    for (i32 i = 0; i < RESULTS_BENCH_QUERY_COUNT; ++i) {
+        u64 seed = NextRandom(&rng) % (u64)(rowCount / 4 + 1);
+        rowSum += FindResultsBySeed(&store, seed, rows, RESULTS_MAX_PRINTED);
+    }
+    f64 seedTime = (GetWallTime() - start) / RESULTS_BENCH_QUERY_COUNT;
+
+    start = GetWallTime();
+    for (i32 i = 0; i < RESULTS_BENCH_QUERY_COUNT; ++i) {
+        i64 from = firstTime + (i64)(NextRandom(&rng) % (u64)(rowCount / RESULTS_BENCH_ROWS_PER_SECOND + 1));
+        rowSum += FindResultsByTime(&store, from, from, rows, RESULTS_MAX_PRINTED);
+    }
+    f64 timeTime = (GetWallTime() - start) / RESULTS_BENCH_QUERY_COUNT;
+
+    printf("Top 10: %.2f us, by seed: %.2f us, one second of time: %.2f us (%lld rows returned)\n", topTime * 1e6,
+        seedTime * 1e6, timeTime * 1e6, (long long)rowSum);
+
+    TrackedFree(rows, ALLOC_TAG_RESULTS);
+    CloseResultsStore(&store);
+    remove(logPath);
+    remove(indexPath);
+
+    return 0;
+}
@@ -0,0 +1,123 @@
+#ifndef RESULTS_H
+#define RESULTS_H
+
+#include <stdio.h>
+
+#include "common.h"
+#include "platform.h"
+
+#define RESULTS_MAGIC "R2048RES"
+#define RESULTS_VERSION 1
+#define RESULTS_INDEX_MAGIC "R2048RIX"
+#define RESULTS_INDEX_VERSION 1
+#define RESULTS_DEFAULT_PATH "assets/results" // The log is <path>.log and its index <path>.idx
+#define RESULTS_PATH_SIZE 512
+#define RESULTS_MAX_TAIL 16384 // Rows OpenResultsStore leaves out of the index, more and it updates the index first
+#define RESULTS_WRITE_BUFFER_SIZE (1 << 20)
+
+// Every finished game, appended to a log of fixed-size rows that is never rewritten. A row carries a checksum, so
+// one that a crash left half written is found and cut off the next time the log is opened, and the rows before it
+// are untouched.
+//
+// The index is a separate file with the rows' keys sorted three ways (score, seed and time), mapped and searched in
+// place. It covers the first rows of the log; the ones after it are scanned. Updating it merges the new rows into the
+// sorted keys and replaces the file, so a crash leaves the old one, and a missing or broken index is rebuilt from the
+// log. One process appends at a time.
+
+typedef enum Result_policy {
+    RESULT_POLICY_HUMAN,
+    RESULT_POLICY_RANDOM,
+    RESULT_POLICY_GREEDY,
+    RESULT_POLICY_CORNER,
+    RESULT_POLICY_SEARCH,
+    RESULT_POLICY_COUNT
+} Result_policy;
+
+typedef struct Results_header {
+    char magic[8];
+    u32 version;
+    u32 rowSize;
+} Results_header;
+
+typedef struct Result_row {
+    u64 seed; // The game starts from ResetBoard with CreateRng(seed)
+    i64 time; // Unix seconds when it ended
+    i32 score;
+    u32 moveCount;
+    f32 duration; // Seconds
+    u8 maxTile; // Exponent
+    u8 boardSize; // Tiles along a side
+    u8 policy; // Result_policy
+    u8 reserved;
+    u32 reserved2;
+    u32 checksum; // Of the bytes before it
+} Result_row;
+
+// The index file is a Results_index_header and then rowCount keys in each of the three orders: score (a u64 each,
+// see the comment in results.c), seed and time (a Results_key each)
+typedef struct Results_index_header {
+    char magic[8];
+    u32 version;
+    u32 reserved;
+    u64 rowCount; // The first rowCount rows of the log
+} Results_index_header;
+
+typedef struct Results_key {
+    u64 key;
+    u32 row;
+    u32 reserved;
+} Results_key;
+
+// For batch runs, which only append. Writes are buffered, CloseResultsWriter flushes them to the disk.
+typedef struct Results_writer {
+    FILE *file;
+    i64 rowCount;
+    char path[RESULTS_PATH_SIZE]; // Of the log
+} Results_writer;
+
+typedef struct Results_store {
+    Results_writer writer;
+    Mapped_file log;
+    Mapped_file index;
+    const Result_row *rows; // The indexed ones, in the mapped log
+    const u64 *scoreKeys;
+    const Results_key *seedKeys;
+    const Results_key *timeKeys;
+    i64 indexedCount;
+
+    Result_row *tail; // Rows after the indexed ones, in memory
+    i64 tailCount;
+    i64 tailCapacity;
+} Results_store;
+
+
+bool OpenResultsWriter(Results_writer *writer, const char *path); // Creates the log if there isn't one
+bool AppendResult(Results_writer *writer, Result_row *row); // Fills in the checksum
+bool CloseResultsWriter(Results_writer *writer);
+
+bool OpenResultsStore(Results_store *store, const char *path);
+void CloseResultsStore(Results_store *store);
+// Written through to the disk before it returns, as the GUI only adds a row per game
+bool AddResult(Results_store *store, Result_row *row);
+
+// Merges the rows the index doesn't cover into it. Not for a path with a store open in this process.
+bool UpdateResultsIndex(const char *path);
+
+// Highest score first, ties in the order they were played. Return how many rows were written.
+i32 GetTopResults(const Results_store *store, Result_row *rows, i32 count);
+i32 FindResultsBySeed(const Results_store *store, u64 seed, Result_row *rows, i32 capacity);
+// Ended at from <= time <= to, oldest first for the indexed rows and then the rest in the order they were added
+i64 FindResultsByTime(const Results_store *store, i64 from, i64 to, Result_row *rows, i64 capacity);
+i32 GetBestScore(const Results_store *store); // 0 for an empty store
+
+const char *GetResultPolicyName(Result_policy policy);
+
+// The command line: print queries, bring the index up to date and time a store of rowCount synthetic rows. The
+// benchmark deletes its store when done, so it refuses a path where one exists.
+i32 RunResultsTop(const char *path, i32 count);
+i32 RunResultsSeed(const char *path, u64 seed);
+i32 RunResultsTime(const char *path, i64 from, i64 to);
+i32 RunResultsIndex(const char *path);
+i32 RunResultsBenchmark(const char *path, i64 rowCount);
+
+#endif
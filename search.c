@@ -0,0 +1,214 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "platform.h"
+#include "search.h"
+
+#define SEARCH_CACHE_SIZE (1 << SEARCH_CACHE_BITS)
+#define SEARCH_BENCHMARK_SEED 1
+#define SEARCH_BENCHMARK_MAX_POSITIONS 4096
+
+
+static f32 EvaluateWithTables(const Move_tables_data *tables, Packed_board board) {
+    Packed_board columns = TransposePackedBoard(board);
+
+    f32 value = 0.0f;
+    for (i32 i = 0; i < 4; ++i) {
+        value += tables->heuristics[(u16)(board >> (16 * i))];
+        value += tables->heuristics[(u16)(columns >> (16 * i))];
+    }
+
+    return value;
+}
+
+f32 EvaluatePackedBoard(Packed_board board) {
+    return EvaluateWithTables(GetMoveTables(), board);
+}
+
+void InitSearch(Search *search, i32 depth) {
+    search->depth = MaxI32(depth, 1);
+    search->tables = GetMoveTables();
+    search->cache = TrackedAlloc(SEARCH_CACHE_SIZE * sizeof(Search_cache_entry), ALLOC_TAG_SEARCH);
+    search->isCacheCanonical = false;
+    search->nodeCount = 0;
+    search->cacheProbeCount = 0;
+    search->cacheHitCount = 0;
+}
+
+void FreeSearch(Search *search) {
+    TrackedFree(search->cache, ALLOC_TAG_SEARCH);
+    search->cache = NULL;
+}
+
+static Search_cache_entry *GetCacheEntry(Search *search, Packed_board board) {
+    return &search->cache[HashPackedBoard(board) >> (64 - SEARCH_CACHE_BITS)];
+}
+
+static f32 EvaluateSpawn(Search *search, Packed_board board, i32 depth, f32 probability);
+
+static f32 EvaluateMove(Search *search, Packed_board board, i32 depth, f32 probability) {
+    ++search->nodeCount;
+
+    f32 best = SEARCH_LOST_VALUE;
+    for (i32 direction = 0; direction < DIRECTION_COUNT; ++direction) {
+        i32 score = 0;
+        Packed_board moved = MoveWithTables(search->tables, board, direction, &score);
+        if (moved != board) {
+            best = MaxF32(best, EvaluateSpawn(search, moved, depth - 1, probability));
+        }
+    }
+
+    return best;
+}
+
+static f32 EvaluateSpawn(Search *search, Packed_board board, i32 depth, f32 probability) {
+    ++search->nodeCount;
+
+    if (depth <= 0 || probability < SEARCH_PROBABILITY_CUTOFF) {
+        return EvaluateWithTables(search->tables, board);
+    }
+
+    Packed_board key = board;
+    if (search->isCacheCanonical) {
+        i32 symmetry;
+        key = CanonicalisePackedBoard(board, &symmetry);
+    }
+
+    // A cached value from a deeper search is at least as good as the one this would compute
+    Search_cache_entry *entry = GetCacheEntry(search, key);
+    ++search->cacheProbeCount;
+    if (entry->board == key && entry->depth >= depth) {
+        ++search->cacheHitCount;
+        return entry->value;
+    }
+
+    i32 emptyCount = 0;
+    for (i32 i = 0; i < TILE_COUNT; ++i) {
+        emptyCount += ((board >> (PACKED_TILE_BITS * i)) & PACKED_TILE_MASK) == 0;
+    }
+
+    f32 cellProbability = probability / emptyCount;
+    f32 value = 0.0f;
+    for (i32 i = 0; i < TILE_COUNT; ++i) {
+        if (((board >> (PACKED_TILE_BITS * i)) & PACKED_TILE_MASK) != 0) {
+            continue;
+        }
+
+        for (u64 exponent = 1; exponent <= 2; ++exponent) {
+            Packed_board spawned = board | (exponent << (PACKED_TILE_BITS * i));
+            value += 0.5f * EvaluateMove(search, spawned, depth, 0.5f * cellProbability);
+        }
+    }
+    value /= emptyCount;
+
+    *entry = (Search_cache_entry){
+        .board = key,
+        .value = value,
+        .depth = depth
+    };
+
+    return value;
+}
+
+u32 SearchMoveValues(Search *search, Packed_board board, f32 values[DIRECTION_COUNT]) {
+    memset(search->cache, 0, SEARCH_CACHE_SIZE * sizeof(Search_cache_entry));
+
+    u32 legalMoves = 0;
+    for (i32 direction = 0; direction < DIRECTION_COUNT; ++direction) {
+        values[direction] = SEARCH_LOST_VALUE;
+
+        i32 score = 0;
+        Packed_board moved = MoveWithTables(search->tables, board, direction, &score);
+        if (moved != board) {
+            values[direction] = EvaluateSpawn(search, moved, search->depth - 1, 1.0f);
+            legalMoves |= 1u << direction;
+        }
+    }
+
+    return legalMoves;
+}
+
+f32 SearchBestMove(Search *search, Packed_board board, Direction *bestMove) {
+    f32 values[DIRECTION_COUNT];
+    u32 legalMoves = SearchMoveValues(search, board, values);
+
+    *bestMove = DIRECTION_NONE;
+    f32 best = SEARCH_LOST_VALUE;
+    for (i32 direction = 0; direction < DIRECTION_COUNT; ++direction) {
+        if ((legalMoves & (1u << direction)) && (*bestMove == DIRECTION_NONE || values[direction] > best)) {
+            best = values[direction];
+            *bestMove = direction;
+        }
+    }
+
+    return best;
+}
+
+// The positions before each move of games the search plays itself, from consecutive seeds
+static i32 CollectBenchmarkPositions(Search *search, i32 gameCount, Packed_board *positions) {
+    i32 count = 0;
+
+    for (i32 game = 0; game < gameCount && count < SEARCH_BENCHMARK_MAX_POSITIONS; ++game) {
+        Rng rng = CreateRng(SEARCH_BENCHMARK_SEED + game);
+        Board board;
+        ResetBoard(&board, &rng);
+
+        while (count < SEARCH_BENCHMARK_MAX_POSITIONS && CanPackBoard(&board)) {
+            Packed_board packed = PackBoard(&board);
+            Direction move;
+            SearchBestMove(search, packed, &move);
+            if (move == DIRECTION_NONE) {
+                break;
+            }
+
+            positions[count++] = packed;
+            i32 score = 0;
+            MoveBoard(&board, move, &score, NULL);
+            SpawnTile(&board, &rng);
+        }
+    }
+
+    return count;
+}
+
+i32 RunSearchCacheBenchmark(i32 gameCount, i32 depth) {
+    Packed_board *positions = TrackedAlloc(SEARCH_BENCHMARK_MAX_POSITIONS * sizeof(Packed_board), ALLOC_TAG_SEARCH);
+
+    Search search;
+    InitSearch(&search, depth);
+    i32 positionCount = CollectBenchmarkPositions(&search, MaxI32(gameCount, 1), positions);
+    FreeSearch(&search);
+
+    printf("%d positions from %d games, depth %d\n", positionCount, MaxI32(gameCount, 1), MaxI32(depth, 1));
+    printf("%-10s %12s %12s %9s %12s %12s\n", "Cache key", "Probes", "Hits", "Hit rate", "Nodes", "us/move");
+
+    i64 nodeCounts[2];
+    for (i32 isCanonical = 0; isCanonical <= 1; ++isCanonical) {
+        InitSearch(&search, depth);
+        search.isCacheCanonical = isCanonical;
+
+        f64 start = GetWallTime();
+        for (i32 i = 0; i < positionCount; ++i) {
+            f32 values[DIRECTION_COUNT];
+            SearchMoveValues(&search, positions[i], values);
+        }
+        f64 elapsed = GetWallTime() - start;
+        f64 probeCount = search.cacheProbeCount > 0 ? search.cacheProbeCount : 1;
+
+        printf("%-10s %12lld %12lld %8.2f%% %12lld %12.1f\n", isCanonical ? "canonical" : "board",
+            (long long)search.cacheProbeCount, (long long)search.cacheHitCount,
+            100.0 * search.cacheHitCount / probeCount, (long long)search.nodeCount,
+            elapsed / MaxI32(positionCount, 1) * 1e6);
+
+        nodeCounts[isCanonical] = search.nodeCount;
+        FreeSearch(&search);
+    }
+
+    printf("The canonical key searches %.1f%% fewer nodes\n",
+        100.0 * (nodeCounts[0] - nodeCounts[1]) / (nodeCounts[0] > 0 ? nodeCounts[0] : 1));
+
+    TrackedFree(positions, ALLOC_TAG_SEARCH);
+
+    return 0;
+}
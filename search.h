@@ -0,0 +1,57 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include "common.h"
+#include "board.h"
+#include "move_tables.h"
+
+#define SEARCH_DEFAULT_DEPTH 3
+#define SEARCH_PROBABILITY_CUTOFF 0.0001f // Spawn sequences less likely than this are cut short and evaluated as they are
+#define SEARCH_CACHE_BITS 16
+#define SEARCH_BENCHMARK_GAMES 4
+#define SEARCH_LOST_VALUE -1e8f // A lost game, below any board's heuristic (8 lines of about -2.6M at worst)
+
+// Expectimax on packed boards: the player takes the best move, and a spawn is an average over every empty cell with
+// 2s and 4s equally likely, the same as SpawnTile. Positions at the depth limit are scored by a heuristic (empty cells,
+// merges and monotonic rows), so a value only ranks moves against each other and isn't a score.
+//
+// Everything a search needs is in here and nothing is shared, so each thread gets its own Search.
+
+typedef struct Search_cache_entry {
+    Packed_board board;
+    f32 value;
+    i32 depth;
+} Search_cache_entry;
+
+// The heuristic scores a board and its mirror images the same (up to rounding), so the cache can be keyed by the
+// canonical board and a position reached in any of its 8 orientations searched once. It's off by default: within the
+// search of a single move mirrored positions are rare, and the nodes saved (see RunSearchCacheBenchmark) don't pay
+// for canonicalising every probe.
+typedef struct Search {
+    i32 depth; // Moves to look ahead
+    const Move_tables_data *tables;
+    Search_cache_entry *cache; // Chance nodes, 1 << SEARCH_CACHE_BITS entries, cleared for every move searched
+    bool isCacheCanonical;
+    i64 nodeCount; // Since InitSearch, and the same for the two below
+    i64 cacheProbeCount;
+    i64 cacheHitCount;
+} Search;
+
+void InitSearch(Search *search, i32 depth);
+void FreeSearch(Search *search);
+
+// The value of every move, with a bit per legal one in the result (0 if the game is over). Illegal moves get
+// SEARCH_LOST_VALUE.
+u32 SearchMoveValues(Search *search, Packed_board board, f32 values[DIRECTION_COUNT]);
+
+// Returns the value of the best move, which goes to bestMove (DIRECTION_NONE and SEARCH_LOST_VALUE if the game is
+// over)
+f32 SearchBestMove(Search *search, Packed_board board, Direction *bestMove);
+
+f32 EvaluatePackedBoard(Packed_board board); // The heuristic, a sum over rows and columns from the move tables
+
+// Searches the positions of a few games with the cache keyed by the board as it is and by its canonical form, and
+// prints the hit rate, nodes and time of each
+i32 RunSearchCacheBenchmark(i32 gameCount, i32 depth);
+
+#endif
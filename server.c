@@ -0,0 +1,548 @@
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "net.h"
+#include "protocol.h"
+#include "server.h"
+
+#ifdef __linux__
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#define SERVER_MAX_CONNECTIONS 1024
+#define SERVER_MAX_EVENTS 256
+#define CONNECTION_BUFFER_SIZE (64 * 1024)
+#define LISTENER_EVENT_TAG 0xFFFFFFFFu
+#define SESSION_LIST_END 0xFFFFFFFFu
+
+
+typedef struct Connection Connection;
+
+// Sessions are slots in one array, never separate allocations. A free slot's index sits on freeList. An active one is
+// on the list of the connection that opened it, which closes it when it goes away.
+typedef struct Session {
+    Board board;
+    Rng rng;
+    i32 score;
+    u32 moveCount;
+    u32 generation;
+    bool isActive;
+    bool isGameOver;
+
+    Connection *owner;
+    u32 previousOwned; // SESSION_LIST_END at either end of the owner's list
+    u32 nextOwned;
+} Session;
+
+typedef struct Session_pool {
+    Session *sessions;
+    u32 *freeList;
+    i32 freeCount;
+    i32 capacity;
+} Session_pool;
+
+// Slots are reused, and so are their buffers once allocated
+typedef struct Connection {
+    i32 socket;
+    bool isOpen;
+    bool isPeerClosed; // It won't send anything more, but may still be reading its answers
+    bool isReadDone; // Everything it sent has been read
+    u32 firstSession; // SESSION_LIST_END if it has none open
+
+    u8 *readBuffer;
+    i32 readLength;
+
+    u8 *writeBuffer;
+    i32 writeLength;
+    i32 writeOffset;
+} Connection;
+
+typedef struct Server {
+    Session_pool pool;
+    Connection *connections;
+    i32 epoll;
+    i32 listener;
+
+    i64 requestCount;
+    i64 moveCount;
+} Server;
+
+static volatile sig_atomic_t isServerRunning;
+
+
+static bool InitSessionPool(Session_pool *pool, i32 capacity) {
+    pool->sessions = TrackedAlloc(capacity * sizeof(Session), ALLOC_TAG_SERVER);
+    pool->freeList = TrackedAlloc(capacity * sizeof(u32), ALLOC_TAG_SERVER);
+    if (pool->sessions == NULL || pool->freeList == NULL) {
+        return false;
+    }
+
+    memset(pool->sessions, 0, capacity * sizeof(Session));
+
+    // Handed out lowest index first
+    for (i32 i = 0; i < capacity; ++i) {
+        pool->freeList[i] = capacity - 1 - i;
+    }
+    pool->freeCount = capacity;
+    pool->capacity = capacity;
+
+    return true;
+}
+
+static void FreeSessionPool(Session_pool *pool) {
+    TrackedFree(pool->sessions, ALLOC_TAG_SERVER);
+    TrackedFree(pool->freeList, ALLOC_TAG_SERVER);
+}
+
+static u32 GetSessionId(Session_pool *pool, Session *session) {
+    u32 index = session - pool->sessions;
+    return (session->generation << SESSION_INDEX_BITS) | index;
+}
+
+static Session *FindSession(Session_pool *pool, u32 id) {
+    u32 index = id & (SERVER_MAX_SESSIONS - 1);
+    if (index >= (u32)pool->capacity) {
+        return NULL;
+    }
+
+    Session *session = &pool->sessions[index];
+    if (!session->isActive || GetSessionId(pool, session) != id) {
+        return NULL;
+    }
+
+    return session;
+}
+
+static Session *OpenSession(Session_pool *pool, Connection *owner) {
+    if (pool->freeCount == 0) {
+        return NULL;
+    }
+
+    u32 index = pool->freeList[--pool->freeCount];
+    Session *session = &pool->sessions[index];
+    session->isActive = true;
+
+    session->owner = owner;
+    session->previousOwned = SESSION_LIST_END;
+    session->nextOwned = owner->firstSession;
+    if (owner->firstSession != SESSION_LIST_END) {
+        pool->sessions[owner->firstSession].previousOwned = index;
+    }
+    owner->firstSession = index;
+
+    return session;
+}
+
+static void CloseSession(Session_pool *pool, Session *session) {
+    if (session->previousOwned != SESSION_LIST_END) {
+        pool->sessions[session->previousOwned].nextOwned = session->nextOwned;
+    } else {
+        session->owner->firstSession = session->nextOwned;
+    }
+    if (session->nextOwned != SESSION_LIST_END) {
+        pool->sessions[session->nextOwned].previousOwned = session->previousOwned;
+    }
+    session->owner = NULL;
+
+    session->isActive = false;
+    session->generation = (session->generation + 1) & ((1u << (32 - SESSION_INDEX_BITS)) - 1);
+    pool->freeList[pool->freeCount++] = session - pool->sessions;
+}
+
+static void StartGame(Session *session, u64 seed) {
+    session->rng = CreateRng(seed);
+    ResetBoard(&session->board, &session->rng);
+    session->score = 0;
+    session->moveCount = 0;
+    session->isGameOver = false;
+}
+
+static bool ApplySessionMove(Session *session, Direction direction) {
+    if (session->isGameOver || !MoveBoard(&session->board, direction, &session->score, NULL)) {
+        return false;
+    }
+
+    SpawnTile(&session->board, &session->rng);
+    ++session->moveCount;
+    session->isGameOver = !CanMove(session->board.board);
+
+    return true;
+}
+
+static Response GetSessionState(Session_pool *pool, Session *session) {
+    return (Response){
+        .status = STATUS_OK,
+        .flags = session->isGameOver ? RESPONSE_FLAG_GAME_OVER : 0,
+        .session = GetSessionId(pool, session),
+        .board = PackBoard(&session->board),
+        .score = session->score,
+        .moveCount = session->moveCount
+    };
+}
+
+static Response HandleRequest(Server *server, Connection *connection, const Request_header *header, 
+    const u8 *directions) {
+    Response response = {.status = STATUS_OK, .session = header->session};
+    Session *session = NULL;
+
+    if (header->type == REQUEST_NEW_GAME && header->session == SESSION_NONE) {
+        session = OpenSession(&server->pool, connection);
+        if (session == NULL) {
+            response.status = STATUS_POOL_FULL;
+            return response;
+        }
+    } else {
+        session = FindSession(&server->pool, header->session);
+        if (session == NULL) {
+            response.status = STATUS_BAD_SESSION;
+            return response;
+        }
+    }
+
+    switch (header->type) {
+        case REQUEST_NEW_GAME: {
+            StartGame(session, header->seed);
+            return GetSessionState(&server->pool, session);
+        }
+        case REQUEST_MOVE: {
+            if (header->direction >= DIRECTION_COUNT) {
+                response.status = STATUS_BAD_REQUEST;
+                return response;
+            }
+
+            bool didMove = ApplySessionMove(session, header->direction);
+            ++server->moveCount;
+
+            response = GetSessionState(&server->pool, session);
+            response.flags |= didMove ? RESPONSE_FLAG_MOVED : 0;
+            response.movedCount = didMove;
+            return response;
+        }
+        case REQUEST_BATCH: {
+            // A bad batch is rejected as a whole rather than half applied
+            for (i32 i = 0; i < header->count; ++i) {
+                if (directions[i] >= DIRECTION_COUNT) {
+                    response.status = STATUS_BAD_REQUEST;
+                    return response;
+                }
+            }
+
+            i32 movedCount = 0;
+            bool didMove = false;
+            for (i32 i = 0; i < header->count && !session->isGameOver; ++i) {
+                didMove = ApplySessionMove(session, directions[i]);
+                movedCount += didMove;
+                ++server->moveCount;
+            }
+
+            response = GetSessionState(&server->pool, session);
+            response.flags |= didMove ? RESPONSE_FLAG_MOVED : 0;
+            response.movedCount = movedCount;
+            return response;
+        }
+        case REQUEST_GET_STATE: {
+            return GetSessionState(&server->pool, session);
+        }
+        case REQUEST_CLOSE: {
+            CloseSession(&server->pool, session);
+            return response;
+        }
+        default: {
+            response.status = STATUS_BAD_REQUEST;
+            return response;
+        }
+    }
+}
+
+#ifdef __linux__
+
+static void HandleInterrupt(i32 signalNumber) {
+    (void)signalNumber;
+    isServerRunning = false;
+}
+
+static Connection *AcceptConnection(Server *server, i32 socket) {
+    for (i32 i = 0; i < SERVER_MAX_CONNECTIONS; ++i) {
+        Connection *connection = &server->connections[i];
+        if (connection->isOpen) {
+            continue;
+        }
+
+        if (connection->readBuffer == NULL) {
+            connection->readBuffer = TrackedAlloc(CONNECTION_BUFFER_SIZE, ALLOC_TAG_SERVER);
+            connection->writeBuffer = TrackedAlloc(CONNECTION_BUFFER_SIZE, ALLOC_TAG_SERVER);
+            if (connection->readBuffer == NULL || connection->writeBuffer == NULL) {
+                return NULL;
+            }
+        }
+
+        connection->socket = socket;
+        connection->isOpen = true;
+        connection->isPeerClosed = false;
+        connection->isReadDone = false;
+        connection->firstSession = SESSION_LIST_END;
+        connection->readLength = 0;
+        connection->writeLength = 0;
+        connection->writeOffset = 0;
+
+        struct epoll_event event = {.events = EPOLLIN | EPOLLRDHUP, .data.u32 = i};
+        if (epoll_ctl(server->epoll, EPOLL_CTL_ADD, socket, &event) == -1) {
+            connection->isOpen = false;
+            return NULL;
+        }
+
+        return connection;
+    }
+
+    return NULL;
+}
+
+// Its sessions go with it, a bot that disconnects without closing them would otherwise hold their slots forever
+static void CloseConnection(Server *server, Connection *connection) {
+    while (connection->firstSession != SESSION_LIST_END) {
+        CloseSession(&server->pool, &server->pool.sessions[connection->firstSession]);
+    }
+
+    epoll_ctl(server->epoll, EPOLL_CTL_DEL, connection->socket, NULL);
+    close(connection->socket);
+    connection->isOpen = false;
+}
+
+static void AcceptConnections(Server *server) {
+    i32 socket;
+    while ((socket = accept(server->listener, NULL, NULL)) != -1) {
+        SetNonBlocking(socket);
+        SetNoDelay(socket);
+
+        if (AcceptConnection(server, socket) == NULL) {
+            fprintf(stderr, "Too many connections, dropping one\n");
+            close(socket);
+        }
+    }
+}
+
+// Returns false if the stream can't be trusted anymore
+static bool ProcessRequests(Server *server, Connection *connection) {
+    i32 offset = 0;
+    while (connection->readLength - offset >= (i32)sizeof(Request_header)) {
+        Request_header header;
+        memcpy(&header, connection->readBuffer + offset, sizeof(header));
+
+        i32 size = sizeof(header);
+        if (header.type == REQUEST_BATCH) {
+            if (header.count > PROTOCOL_MAX_BATCH) {
+                return false;
+            }
+            size += header.count;
+        }
+
+        if (connection->readLength - offset < size) {
+            break;
+        }
+
+        // Waits for the client to read what it has been sent so far
+        if (CONNECTION_BUFFER_SIZE - connection->writeLength < (i32)sizeof(Response)) {
+            break;
+        }
+
+        Response response = HandleRequest(server, connection, &header, 
+            connection->readBuffer + offset + sizeof(header));
+        memcpy(connection->writeBuffer + connection->writeLength, &response, sizeof(response));
+        connection->writeLength += sizeof(response);
+
+        offset += size;
+        ++server->requestCount;
+    }
+
+    memmove(connection->readBuffer, connection->readBuffer + offset, connection->readLength - offset);
+    connection->readLength -= offset;
+
+    return true;
+}
+
+static bool FlushConnection(Connection *connection) {
+    while (connection->writeOffset < connection->writeLength) {
+        i64 written = write(connection->socket, connection->writeBuffer + connection->writeOffset, 
+            connection->writeLength - connection->writeOffset);
+        if (written == -1) {
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        connection->writeOffset += written;
+    }
+
+    connection->writeOffset = 0;
+    connection->writeLength = 0;
+
+    return true;
+}
+
+// Returns false on a socket error
+static bool ReadConnection(Connection *connection) {
+    while (connection->readLength < CONNECTION_BUFFER_SIZE) {
+        i64 received = read(connection->socket, connection->readBuffer + connection->readLength, 
+            CONNECTION_BUFFER_SIZE - connection->readLength);
+        if (received == 0) {
+            connection->isPeerClosed = true;
+            connection->isReadDone = true;
+            return true;
+        }
+        if (received == -1) {
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        connection->readLength += received;
+    }
+
+    return true;
+}
+
+static bool ServiceConnection(Server *server, Connection *connection, u32 events) {
+    if (events & (EPOLLERR | EPOLLHUP)) {
+        return false;
+    }
+
+    // Requests sent before a half close still get handled and answered, if the client is listening. Once the peer has
+    // closed its end, reading never blocks, so it keeps going until everything is read or the write buffer is full.
+    if (events & EPOLLRDHUP) {
+        connection->isPeerClosed = true;
+    }
+
+    bool canRead = (events & EPOLLIN) || connection->isPeerClosed;
+    while (true) {
+        i32 readBefore = connection->readLength;
+        if (canRead && !connection->isReadDone && !ReadConnection(connection)) {
+            return false;
+        }
+        bool didReadNothing = readBefore < CONNECTION_BUFFER_SIZE && connection->readLength == readBefore && 
+            !connection->isReadDone;
+
+        // A full write buffer can hold back requests, so keep going until nothing more can be done
+        bool didProgress = true;
+        while (didProgress) {
+            i32 pendingBefore = connection->readLength;
+            i32 unsentBefore = connection->writeLength;
+            if (!ProcessRequests(server, connection) || !FlushConnection(connection)) {
+                return false;
+            }
+            didProgress = connection->writeLength == 0 && (connection->readLength != pendingBefore || unsentBefore > 0);
+        }
+
+        if (!connection->isPeerClosed || connection->isReadDone || connection->writeLength > 0 || didReadNothing) {
+            break;
+        }
+    }
+
+    if (connection->isReadDone && connection->writeLength == 0) {
+        return false;
+    }
+
+    // Stop listening for requests while there is no room for them, otherwise a level-triggered EPOLLIN would spin.
+    // The same goes for EPOLLRDHUP once the peer has closed, then only the answers still to send are waited on.
+    u32 interest = connection->writeLength > 0 ? EPOLLOUT : 0;
+    if (!connection->isPeerClosed) {
+        interest |= EPOLLRDHUP;
+        interest |= connection->readLength < CONNECTION_BUFFER_SIZE ? EPOLLIN : 0;
+    }
+
+    struct epoll_event event = {
+        .events = interest, 
+        .data.u32 = connection - server->connections
+    };
+    epoll_ctl(server->epoll, EPOLL_CTL_MOD, connection->socket, &event);
+
+    return true;
+}
+
+i32 RunServer(const char *address, i32 maxSessions) {
+    if (maxSessions <= 0 || maxSessions > SERVER_MAX_SESSIONS) {
+        fprintf(stderr, "Session count must be between 1 and %d\n", SERVER_MAX_SESSIONS);
+        return 1;
+    }
+
+    Server server = {0};
+    if (!InitSessionPool(&server.pool, maxSessions)) {
+        fprintf(stderr, "Could not allocate %d sessions\n", maxSessions);
+        return 1;
+    }
+
+    server.connections = TrackedAlloc(SERVER_MAX_CONNECTIONS * sizeof(Connection), ALLOC_TAG_SERVER);
+    if (!server.connections) {
+        fprintf(stderr, "Could not allocate %d connections\n", SERVER_MAX_CONNECTIONS);
+        FreeSessionPool(&server.pool);
+        return 1;
+    }
+    memset(server.connections, 0, SERVER_MAX_CONNECTIONS * sizeof(Connection));
+
+    server.listener = ListenOnAddress(address);
+    if (server.listener == -1) {
+        TrackedFree(server.connections, ALLOC_TAG_SERVER);
+        FreeSessionPool(&server.pool);
+        return 1;
+    }
+
+    server.epoll = epoll_create1(0);
+    struct epoll_event listenerEvent = {.events = EPOLLIN, .data.u32 = LISTENER_EVENT_TAG};
+    epoll_ctl(server.epoll, EPOLL_CTL_ADD, server.listener, &listenerEvent);
+
+    isServerRunning = true;
+    signal(SIGINT, &HandleInterrupt);
+    signal(SIGTERM, &HandleInterrupt);
+    signal(SIGPIPE, SIG_IGN);
+
+    printf("Serving %d sessions on %s\n", maxSessions, address);
+
+    struct epoll_event events[SERVER_MAX_EVENTS];
+    while (isServerRunning) {
+        i32 eventCount = epoll_wait(server.epoll, events, SERVER_MAX_EVENTS, -1);
+        if (eventCount == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait");
+            break;
+        }
+
+        for (i32 i = 0; i < eventCount; ++i) {
+            if (events[i].data.u32 == LISTENER_EVENT_TAG) {
+                AcceptConnections(&server);
+                continue;
+            }
+
+            Connection *connection = &server.connections[events[i].data.u32];
+            if (connection->isOpen && !ServiceConnection(&server, connection, events[i].events)) {
+                CloseConnection(&server, connection);
+            }
+        }
+    }
+
+    printf("Served %lld requests (%lld moves), %d sessions still open\n", (long long)server.requestCount, 
+        (long long)server.moveCount, server.pool.capacity - server.pool.freeCount);
+
+    for (i32 i = 0; i < SERVER_MAX_CONNECTIONS; ++i) {
+        if (server.connections[i].isOpen) {
+            CloseConnection(&server, &server.connections[i]);
+        }
+        TrackedFree(server.connections[i].readBuffer, ALLOC_TAG_SERVER);
+        TrackedFree(server.connections[i].writeBuffer, ALLOC_TAG_SERVER);
+    }
+    TrackedFree(server.connections, ALLOC_TAG_SERVER);
+
+    close(server.listener);
+    close(server.epoll);
+    FreeSessionPool(&server.pool);
+
+    return 0;
+}
+
+#else
+
+i32 RunServer(const char *address, i32 maxSessions) {
+    fprintf(stderr, "The server is only available on Linux\n");
+    return 1;
+}
+
+#endif
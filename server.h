@@ -0,0 +1,16 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "common.h"
+
+#define SERVER_DEFAULT_MAX_SESSIONS 65536
+#define SESSION_INDEX_BITS 20 // The rest of a session id is a generation counter so stale ids are rejected
+#define SERVER_MAX_SESSIONS (1 << SESSION_INDEX_BITS)
+
+// Headless game server, see protocol.h. Runs until interrupted.
+i32 RunServer(const char *address, i32 maxSessions);
+
+// Hammers a running server with random moves at increasing session counts and prints requests/sec and latency
+i32 RunLoadGenerator(const char *address, f64 secondsPerLevel);
+
+#endif
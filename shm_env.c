@@ -0,0 +1,527 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "allocator.h"
+#include "batch_env.h"
+#include "latency.h"
+#include "platform.h"
+#include "shm_env.h"
+
+#ifdef __linux__
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#define SHM_ENV_SPIN_COUNT 4096
+#define SHM_ENV_WAIT_TIMEOUT_NS 100000000 // Sleeps are capped so that a side which died is eventually noticed
+#define SHM_ENV_ATTACH_TIMEOUT 2.0
+
+
+typedef struct Shm_env_frame {
+    u8 *exponents;
+    u8 *legalMoves;
+    f32 *rewards;
+    u8 *dones;
+    i32 *finalScores;
+    u8 *actions;
+} Shm_env_frame;
+
+
+static u64 AlignToCacheLine(u64 value) {
+    return (value + 63) & ~63ull;
+}
+
+static void ComputeLayout(Shm_env_header *header, i32 count) {
+    u64 offset = AlignToCacheLine(sizeof(Shm_env_header));
+
+    header->exponentsOffset = offset;
+    offset = AlignToCacheLine(offset + (u64)count * TILE_COUNT * sizeof(u8));
+    header->legalMovesOffset = offset;
+    offset = AlignToCacheLine(offset + (u64)count * sizeof(u8));
+    header->rewardsOffset = offset;
+    offset = AlignToCacheLine(offset + (u64)count * sizeof(f32));
+    header->donesOffset = offset;
+    offset = AlignToCacheLine(offset + (u64)count * sizeof(u8));
+    header->finalScoresOffset = offset;
+    offset = AlignToCacheLine(offset + (u64)count * sizeof(i32));
+    header->actionsOffset = offset;
+    offset = AlignToCacheLine(offset + (u64)count * sizeof(u8));
+
+    header->size = offset;
+}
+
+static Shm_env_frame GetFrame(Shm_env_header *header) {
+    u8 *base = (u8 *)header;
+
+    return (Shm_env_frame){
+        .exponents = base + header->exponentsOffset,
+        .legalMoves = base + header->legalMovesOffset,
+        .rewards = (f32 *)(base + header->rewardsOffset),
+        .dones = base + header->donesOffset,
+        .finalScores = (i32 *)(base + header->finalScoresOffset),
+        .actions = base + header->actionsOffset
+    };
+}
+
+static void PrintTransportStats(const char *transport, i32 count, i64 frameCount, f64 elapsed,
+    const Latency_histogram *histogram) {
+    printf("%-6s %12.0f steps/s  %9.0f frames/s  mean %7.1f us  p50 %7.1f us  p99 %7.1f us\n", transport,
+        frameCount * count / elapsed, frameCount / elapsed, 1e6 * GetLatencyMean(histogram),
+        1e6 * GetLatencyPercentile(histogram, 0.5), 1e6 * GetLatencyPercentile(histogram, 0.99));
+}
+
+#ifdef __linux__
+
+static void RelaxCpu(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// Returns true if the wait timed out
+static bool WaitOnFutex(u32 *address, u32 expected) {
+    struct timespec timeout = {.tv_nsec = SHM_ENV_WAIT_TIMEOUT_NS};
+    return syscall(SYS_futex, address, FUTEX_WAIT, expected, &timeout, NULL, 0) == -1 && errno == ETIMEDOUT;
+}
+
+static void WakeFutex(u32 *address) {
+    syscall(SYS_futex, address, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+static bool IsProcessAlive(i32 pid) {
+    return kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+// Returns the new value of sequence, or previous if the other side closed the session first or died. The other side
+// is only checked on timeouts, and not at all while peerPid is still 0.
+static u32 WaitForSequence(Shm_env_header *header, u32 *sequence, u32 *waiting, u32 previous, const i32 *peerPid) {
+    // Spinning only pays off if the other side is running on another core meanwhile
+    static i32 spinCount = -1;
+    if (spinCount == -1) {
+        spinCount = GetProcessorCount() > 1 ? SHM_ENV_SPIN_COUNT : 0;
+    }
+
+    for (i32 i = 0; i < spinCount; ++i) {
+        u32 current = __atomic_load_n(sequence, __ATOMIC_ACQUIRE);
+        if (current != previous) {
+            return current;
+        }
+        RelaxCpu();
+    }
+
+    // The flag has to be visible before the sequence is checked again, or a publish in between would not wake us
+    u32 current;
+    while (true) {
+        __atomic_store_n(waiting, 1, __ATOMIC_SEQ_CST);
+
+        current = __atomic_load_n(sequence, __ATOMIC_SEQ_CST);
+        if (current != previous || __atomic_load_n(&header->isClosed, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+
+        if (WaitOnFutex(sequence, previous)) {
+            i32 pid = __atomic_load_n(peerPid, __ATOMIC_ACQUIRE);
+            if (pid > 0 && !IsProcessAlive(pid)) {
+                __atomic_store_n(&header->isClosed, 1, __ATOMIC_RELEASE);
+                current = previous;
+                break;
+            }
+        }
+    }
+    __atomic_store_n(waiting, 0, __ATOMIC_RELAXED);
+
+    return current;
+}
+
+static u32 PublishSequence(u32 *sequence, u32 *waiting) {
+    u32 current = __atomic_add_fetch(sequence, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(waiting, __ATOMIC_SEQ_CST)) {
+        WakeFutex(sequence);
+    }
+
+    return current;
+}
+
+static void CloseShmEnv(Shm_env_header *header) {
+    __atomic_store_n(&header->isClosed, 1, __ATOMIC_RELEASE);
+    WakeFutex(&header->observationSequence);
+    WakeFutex(&header->actionSequence);
+}
+
+// True unless the object's game is still running. One whose game died before writing its pid counts as left over.
+static bool IsShmEnvStale(const char *name) {
+    i32 file = shm_open(name, O_RDONLY, 0);
+    if (file == -1) {
+        return errno == ENOENT;
+    }
+
+    i32 serverPid = 0;
+    struct stat status;
+    if (fstat(file, &status) == 0 && status.st_size >= (off_t)sizeof(Shm_env_header)) {
+        Shm_env_header *header = mmap(NULL, sizeof(Shm_env_header), PROT_READ, MAP_SHARED, file, 0);
+        if (header != MAP_FAILED) {
+            serverPid = __atomic_load_n(&header->serverPid, __ATOMIC_ACQUIRE);
+            munmap(header, sizeof(Shm_env_header));
+        }
+    }
+    close(file);
+
+    return serverPid <= 0 || !IsProcessAlive(serverPid);
+}
+
+i32 RunShmEnv(const char *name, i32 count) {
+    if (count <= 0) {
+        fprintf(stderr, "Game count must be positive\n");
+        return 1;
+    }
+
+    Shm_env_header layout = {0};
+    ComputeLayout(&layout, count);
+    layout.serverPid = getpid();
+
+    i32 file = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (file == -1 && errno == EEXIST && IsShmEnvStale(name)) {
+        shm_unlink(name); // Left over from a run that didn't shut down
+        file = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    }
+    if (file == -1) {
+        if (errno == EEXIST) {
+            fprintf(stderr, "Another game is serving %s\n", name);
+        } else {
+            perror("shm_open");
+        }
+        return 1;
+    }
+
+    if (ftruncate(file, layout.size) == -1) {
+        perror("ftruncate");
+        close(file);
+        shm_unlink(name);
+        return 1;
+    }
+
+    Shm_env_header *header = mmap(NULL, layout.size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    close(file);
+    if (header == MAP_FAILED) {
+        perror("mmap");
+        shm_unlink(name);
+        return 1;
+    }
+    __atomic_store_n(&header->serverPid, layout.serverPid, __ATOMIC_RELEASE);
+
+    Batch_env env;
+    if (!InitBatchEnv(&env, count, time(NULL))) {
+        fprintf(stderr, "Could not allocate %d games\n", count);
+        munmap(header, layout.size);
+        shm_unlink(name);
+        return 1;
+    }
+
+    *header = layout;
+    header->version = SHM_ENV_VERSION;
+    header->gameCount = count;
+    header->tileCount = TILE_COUNT;
+
+    Shm_env_frame frame = GetFrame(header);
+    BindBatchEnvOutputs(&env, frame.legalMoves, frame.rewards, frame.dones, frame.finalScores);
+
+    // The magic goes in last, a trainer that sees it can trust the rest of the header
+    __atomic_store_n(&header->magic, SHM_ENV_MAGIC, __ATOMIC_RELEASE);
+
+    printf("Serving %d games on %s (%llu bytes)\n", count, name, (unsigned long long)layout.size);
+
+    u32 actionSequence = 0;
+    while (true) {
+        GetBatchEnvObservations(&env, frame.exponents);
+        PublishSequence(&header->observationSequence, &header->observationWaiting);
+
+        u32 current = WaitForSequence(header, &header->actionSequence, &header->actionWaiting, actionSequence,
+            &header->clientPid);
+        if (current == actionSequence) {
+            break;
+        }
+        actionSequence = current;
+
+        StepBatchEnv(&env, frame.actions);
+    }
+
+    FreeBatchEnv(&env);
+    munmap(header, layout.size);
+    shm_unlink(name);
+
+    return 0;
+}
+
+// Retries for a while so that a trainer may be started before the game
+static Shm_env_header *AttachShmEnv(const char *name) {
+    f64 deadline = GetWallTime() + SHM_ENV_ATTACH_TIMEOUT;
+
+    while (true) {
+        i32 file = shm_open(name, O_RDWR, 0);
+        struct stat info;
+        if (file != -1 && fstat(file, &info) == 0 && info.st_size >= (i64)sizeof(Shm_env_header)) {
+            Shm_env_header *header = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+            close(file);
+
+            if (header != MAP_FAILED) {
+                if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) == SHM_ENV_MAGIC) {
+                    if (header->version != SHM_ENV_VERSION || header->tileCount != TILE_COUNT) {
+                        fprintf(stderr, "%s was made by an incompatible version\n", name);
+                        munmap(header, info.st_size);
+                        return NULL;
+                    }
+                    __atomic_store_n(&header->clientPid, (i32)getpid(), __ATOMIC_RELEASE);
+                    return header;
+                }
+                munmap(header, info.st_size);
+            }
+        } else if (file != -1) {
+            close(file);
+        }
+
+        if (GetWallTime() > deadline) {
+            fprintf(stderr, "Nothing is serving %s\n", name);
+            return NULL;
+        }
+
+        struct timespec pause = {.tv_nsec = 10000000};
+        nanosleep(&pause, NULL);
+    }
+}
+
+// Plays random legal moves, timing each round trip from publishing actions to seeing the next frame
+static i64 RunClientLoop(Shm_env_header *header, f64 seconds, Latency_histogram *histogram) {
+    Shm_env_frame frame = GetFrame(header);
+    Rng rng = CreateRng(2048);
+
+    u32 observationSequence = WaitForSequence(header, &header->observationSequence, &header->observationWaiting, 0,
+        &header->serverPid);
+
+    i64 frameCount = 0;
+    f64 end = GetWallTime() + seconds;
+    while (GetWallTime() < end) {
+        ChooseRandomActions(frame.legalMoves, frame.actions, header->gameCount, &rng);
+
+        f64 sendTime = GetWallTime();
+        PublishSequence(&header->actionSequence, &header->actionWaiting);
+
+        u32 current = WaitForSequence(header, &header->observationSequence, &header->observationWaiting,
+            observationSequence, &header->serverPid);
+        if (current == observationSequence) {
+            break;
+        }
+        observationSequence = current;
+
+        RecordLatency(histogram, GetWallTime() - sendTime);
+        ++frameCount;
+    }
+
+    return frameCount;
+}
+
+i32 RunShmClient(const char *name, f64 seconds) {
+    Shm_env_header *header = AttachShmEnv(name);
+    if (header == NULL) {
+        return 1;
+    }
+
+    Latency_histogram *histogram = TrackedAlloc(sizeof(Latency_histogram), ALLOC_TAG_ENV);
+    memset(histogram, 0, sizeof(*histogram));
+
+    f64 start = GetWallTime();
+    i64 frameCount = RunClientLoop(header, seconds, histogram);
+    PrintTransportStats("shm", header->gameCount, frameCount, GetWallTime() - start, histogram);
+
+    CloseShmEnv(header);
+    munmap(header, header->size);
+    TrackedFree(histogram, ALLOC_TAG_ENV);
+
+    return 0;
+}
+
+static bool ReadFully(i32 socket, void *buffer, i64 size) {
+    for (i64 offset = 0; offset < size;) {
+        i64 received = read(socket, (u8 *)buffer + offset, size - offset);
+        if (received <= 0) {
+            return false;
+        }
+        offset += received;
+    }
+
+    return true;
+}
+
+static bool WriteFully(i32 socket, const void *buffer, i64 size) {
+    for (i64 offset = 0; offset < size;) {
+        i64 written = write(socket, (const u8 *)buffer + offset, size - offset);
+        if (written <= 0) {
+            return false;
+        }
+        offset += written;
+    }
+
+    return true;
+}
+
+// The same frames as the shared-memory transport, but copied into a buffer and through the kernel each way
+static void ServeSocketEnv(i32 socket, i32 count) {
+    Batch_env env;
+    Shm_env_header layout = {0};
+    ComputeLayout(&layout, count);
+
+    u8 *buffer = TrackedAlloc(layout.size, ALLOC_TAG_ENV);
+    if (buffer == NULL || !InitBatchEnv(&env, count, time(NULL))) {
+        return;
+    }
+
+    *(Shm_env_header *)buffer = layout;
+    Shm_env_frame frame = GetFrame((Shm_env_header *)buffer);
+    u64 frameSize = layout.actionsOffset - layout.exponentsOffset;
+
+    do {
+        GetBatchEnvObservations(&env, frame.exponents);
+        memcpy(frame.legalMoves, env.legalMoves, count * sizeof(u8));
+        memcpy(frame.rewards, env.rewards, count * sizeof(f32));
+        memcpy(frame.dones, env.dones, count * sizeof(u8));
+        memcpy(frame.finalScores, env.finalScores, count * sizeof(i32));
+
+        if (!WriteFully(socket, frame.exponents, frameSize) || !ReadFully(socket, frame.actions, count)) {
+            break;
+        }
+
+        StepBatchEnv(&env, frame.actions);
+    } while (true);
+
+    FreeBatchEnv(&env);
+    TrackedFree(buffer, ALLOC_TAG_ENV);
+}
+
+static i64 RunSocketClientLoop(i32 socket, i32 count, f64 seconds, Latency_histogram *histogram) {
+    Shm_env_header layout = {0};
+    ComputeLayout(&layout, count);
+
+    u8 *buffer = TrackedAlloc(layout.size, ALLOC_TAG_ENV);
+    *(Shm_env_header *)buffer = layout;
+    Shm_env_frame frame = GetFrame((Shm_env_header *)buffer);
+    u64 frameSize = layout.actionsOffset - layout.exponentsOffset;
+    Rng rng = CreateRng(2048);
+
+    i64 frameCount = 0;
+    if (ReadFully(socket, frame.exponents, frameSize)) {
+        f64 end = GetWallTime() + seconds;
+        while (GetWallTime() < end) {
+            ChooseRandomActions(frame.legalMoves, frame.actions, count, &rng);
+
+            f64 sendTime = GetWallTime();
+            if (!WriteFully(socket, frame.actions, count) || !ReadFully(socket, frame.exponents, frameSize)) {
+                break;
+            }
+
+            RecordLatency(histogram, GetWallTime() - sendTime);
+            ++frameCount;
+        }
+    }
+
+    TrackedFree(buffer, ALLOC_TAG_ENV);
+
+    return frameCount;
+}
+
+i32 RunShmBenchmark(i32 count, f64 seconds) {
+    if (count <= 0) {
+        fprintf(stderr, "Game count must be positive\n");
+        return 1;
+    }
+
+    printf("Round trips of %d games, %.1f s per transport\n", count, seconds);
+    fflush(stdout); // Or the children inherit the buffered text and print it again
+
+    Latency_histogram *histogram = TrackedAlloc(sizeof(Latency_histogram), ALLOC_TAG_ENV);
+
+    char name[64];
+    snprintf(name, sizeof(name), "/r2048-bench-%d", (i32)getpid());
+
+    pid_t child = fork();
+    if (child == 0) {
+        freopen("/dev/null", "w", stdout); // The banner would only get in the way of the results
+        _exit(RunShmEnv(name, count));
+    }
+
+    Shm_env_header *header = AttachShmEnv(name);
+    if (header == NULL) {
+        waitpid(child, NULL, 0);
+        return 1;
+    }
+
+    memset(histogram, 0, sizeof(*histogram));
+    f64 start = GetWallTime();
+    i64 frameCount = RunClientLoop(header, seconds, histogram);
+    PrintTransportStats("shm", count, frameCount, GetWallTime() - start, histogram);
+
+    CloseShmEnv(header);
+    munmap(header, header->size);
+    waitpid(child, NULL, 0);
+
+    i32 sockets[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) == -1) {
+        perror("socketpair");
+        return 1;
+    }
+
+    child = fork();
+    if (child == 0) {
+        close(sockets[0]);
+        ServeSocketEnv(sockets[1], count);
+        _exit(0);
+    }
+    close(sockets[1]);
+
+    memset(histogram, 0, sizeof(*histogram));
+    start = GetWallTime();
+    frameCount = RunSocketClientLoop(sockets[0], count, seconds, histogram);
+    PrintTransportStats("socket", count, frameCount, GetWallTime() - start, histogram);
+
+    close(sockets[0]);
+    waitpid(child, NULL, 0);
+    TrackedFree(histogram, ALLOC_TAG_ENV);
+
+    return 0;
+}
+
+#else
+
+i32 RunShmEnv(const char *name, i32 count) {
+    (void)name;
+    (void)count;
+
+    fprintf(stderr, "The shared-memory environment is only available on Linux\n");
+    return 1;
+}
+
+i32 RunShmClient(const char *name, f64 seconds) {
+    (void)name;
+    (void)seconds;
+
+    fprintf(stderr, "The shared-memory environment is only available on Linux\n");
+    return 1;
+}
+
+i32 RunShmBenchmark(i32 count, f64 seconds) {
+    (void)count;
+    (void)seconds;
+
+    fprintf(stderr, "The shared-memory environment is only available on Linux\n");
+    return 1;
+}
+
+#endif
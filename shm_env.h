@@ -0,0 +1,67 @@
+#ifndef SHM_ENV_H
+#define SHM_ENV_H
+
+#include "common.h"
+
+// A Batch_env served to another process (a trainer) through a POSIX shared-memory object. The game writes
+// observations straight into the shared region and steps with the actions the trainer wrote there, so nothing is
+// serialised or copied in between. Only implemented for Linux.
+//
+// The region starts with a Shm_env_header, the arrays follow at the offsets it lists (one entry per game, exponents
+// has TILE_COUNT). The two sides take turns:
+//   1. The game writes a frame (exponents, legalMoves, rewards, dones, finalScores) and increments
+//      observationSequence.
+//   2. The trainer waits for observationSequence to change, writes actions and increments actionSequence.
+//   3. The game waits for actionSequence to change and steps, back to 1.
+// Each frame depends on the previous actions, so only one can be in flight and the "ring" is a single slot.
+// Waiting spins briefly and then sleeps on a futex on the sequence word. A side that sleeps sets its
+// *Waiting flag first so that the other side only makes the wake syscall when somebody is actually asleep.
+// Setting isClosed ends the session. Each side writes its pid on startup, and a side whose sleep times out checks
+// that the other pid is still alive, so a trainer or game that dies without closing ends the session too.
+
+#define SHM_ENV_MAGIC 0x38343032u // "2048"
+#define SHM_ENV_VERSION 2
+#define SHM_ENV_DEFAULT_NAME "/r2048-env"
+
+
+// The sequence words sit on their own cache lines since each is written by a different process
+typedef struct Shm_env_header {
+    u32 magic;
+    u32 version;
+    i32 gameCount;
+    i32 tileCount;
+    u32 isClosed;
+    i32 serverPid; // Tells a live game's object from one left behind by a game that died
+    i32 clientPid; // 0 until a trainer attaches
+    u32 padding0;
+
+    u64 exponentsOffset;
+    u64 legalMovesOffset;
+    u64 rewardsOffset;
+    u64 donesOffset;
+    u64 finalScoresOffset;
+    u64 actionsOffset;
+    u64 size;
+    u8 padding1[40]; // Rounds the fields above up to two cache lines
+
+    u32 observationSequence;
+    u32 observationWaiting;
+    u8 padding2[64 - 2 * sizeof(u32)];
+
+    u32 actionSequence;
+    u32 actionWaiting;
+    u8 padding3[64 - 2 * sizeof(u32)];
+} Shm_env_header;
+
+// Game side: creates the shared object and serves count games until the trainer closes it. Fails if another game is
+// serving the same name.
+i32 RunShmEnv(const char *name, i32 count);
+
+// Trainer side test client: plays random legal moves and prints steps/sec and round-trip latency
+i32 RunShmClient(const char *name, f64 seconds);
+
+// Runs the game in a child process and compares the shared-memory transport with the same frames sent over a
+// Unix socket pair
+i32 RunShmBenchmark(i32 count, f64 seconds);
+
+#endif
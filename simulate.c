@@ -0,0 +1,249 @@
+#include <stdio.h>
+#include <time.h>
+
+#include "allocator.h"
+#include "board.h"
+#include "move_tables.h"
+#include "perf.h"
+#include "platform.h"
+#include "results.h"
+#include "simulate.h"
+
+#define SIMULATION_MAX_THREADS 64
+#define SIMULATION_PATH_SIZE 512
+
+
+// Each thread has its own accumulator, merged once they're all done, so the hot loop never touches shared state
+typedef struct Simulation_worker {
+    u64 firstSeed;
+    i32 count;
+    Game_result *results;
+    Game_stats stats;
+} Simulation_worker;
+
+
+void PlayRandomGame(u64 seed, Game_result *result) {
+    f64 start = GetWallTime();
+
+    const Move_tables_data *tables = GetMoveTables();
+    Rng rng = CreateRng(seed);
+    Board board;
+    ResetBoard(&board, &rng);
+    Packed_board packed = PackBoard(&board);
+
+    i32 score = 0;
+    u32 moveCount = 0;
+    while (GetPackedMaxTile(packed) < (i32)PACKED_TILE_MASK) {
+        Packed_board moves[DIRECTION_COUNT];
+        i32 scores[DIRECTION_COUNT] = {0};
+        Direction legalMoves[DIRECTION_COUNT];
+        i32 legalCount = 0;
+
+        for (i32 direction = 0; direction < DIRECTION_COUNT; ++direction) {
+            moves[direction] = MoveWithTables(tables, packed, direction, &scores[direction]);
+            if (moves[direction] != packed) {
+                legalMoves[legalCount++] = direction;
+            }
+        }
+
+        if (legalCount == 0) {
+            break;
+        }
+
+        Direction direction = legalMoves[RandomRange(&rng, 0, legalCount - 1)];
+        score += scores[direction];
+        ++moveCount;
+
+        board = UnpackBoard(moves[direction]);
+        SpawnTile(&board, &rng);
+        packed = PackBoard(&board);
+    }
+
+    *result = (Game_result){
+        .seed = seed,
+        .score = score,
+        .moveCount = moveCount,
+        .duration = GetWallTime() - start,
+        .maxTile = GetPackedMaxTile(packed)
+    };
+}
+
+static void RunSimulationWorker(void *data) {
+    Simulation_worker *worker = data;
+
+    for (i32 i = 0; i < worker->count; ++i) {
+        PlayRandomGame(worker->firstSeed + i, &worker->results[i]);
+        AddGameResult(&worker->stats, &worker->results[i]);
+    }
+}
+
+static FILE *OpenOutput(const char *prefix, const char *name, const char *mode) {
+    char path[SIMULATION_PATH_SIZE];
+    snprintf(path, sizeof(path), "%s%s", prefix, name);
+
+    FILE *file = fopen(path, mode);
+    if (file == NULL) {
+        fprintf(stderr, "Could not open %s\n", path);
+    }
+
+    return file;
+}
+
+static bool WriteStatsOutputs(const Game_stats *stats, const char *prefix) {
+    char path[SIMULATION_PATH_SIZE];
+
+    snprintf(path, sizeof(path), "%ssummary.csv", prefix);
+    bool isOk = WriteGameStatsSummary(stats, path);
+    snprintf(path, sizeof(path), "%shistograms.csv", prefix);
+    isOk &= WriteGameStatsHistograms(stats, path);
+
+    return isOk;
+}
+
+i32 RunSimulation(i64 gameCount, i32 threadCount, u64 firstSeed, const char *outputPrefix, const char *resultsPath) {
+    if (threadCount <= 0) {
+        threadCount = GetProcessorCount();
+    }
+    threadCount = MinI32(threadCount, SIMULATION_MAX_THREADS);
+
+    char path[SIMULATION_PATH_SIZE];
+    snprintf(path, sizeof(path), "%sgames.bin", outputPrefix);
+
+    Game_columns columns;
+    FILE *csv = OpenOutput(outputPrefix, "games.csv", "w");
+    if (csv == NULL || !CreateGameColumns(&columns, path)) {
+        fprintf(stderr, "Could not create %s\n", path);
+        return 1;
+    }
+    WriteGameResultsCsvHeader(csv);
+
+    Results_writer resultsWriter = {0};
+    if (resultsPath != NULL && !OpenResultsWriter(&resultsWriter, resultsPath)) {
+        fprintf(stderr, "Could not open the results in %s.log\n", resultsPath);
+        fclose(csv);
+        CloseGameColumns(&columns);
+        return 1;
+    }
+
+    // The stats are big enough (the sketches) that they don't belong on the stack
+    Simulation_worker *workers = TrackedAlloc(threadCount * sizeof(Simulation_worker), ALLOC_TAG_STATS);
+    Game_result *results = TrackedAlloc(threadCount * SIMULATION_CHUNK_SIZE * sizeof(Game_result), ALLOC_TAG_STATS);
+    Game_stats *total = TrackedAlloc(sizeof(Game_stats), ALLOC_TAG_STATS);
+    Thread threads[SIMULATION_MAX_THREADS];
+
+    InitGameStats(total);
+    for (i32 i = 0; i < threadCount; ++i) {
+        workers[i].results = results + i * SIMULATION_CHUNK_SIZE;
+        InitGameStats(&workers[i].stats);
+    }
+
+    printf("Playing %lld random games on %d threads, seeds from %llu\n", (long long)gameCount, threadCount,
+        (unsigned long long)firstSeed);
+
+    // Only the rounds are counted, not the writing between them
+    Perf_counters counters;
+    Perf_sample perfTotal;
+    InitPerfTotal(&perfTotal);
+    OpenPerfCounters(&counters);
+
+    // Rounds of one chunk per thread, written out in seed order between rounds so memory stays fixed
+    f64 start = GetWallTime();
+    bool isOk = true;
+    for (i64 played = 0; played < gameCount && isOk;) {
+        i32 workerCount = 0;
+        for (i32 i = 0; i < threadCount && played < gameCount; ++i) {
+            workers[i].firstSeed = firstSeed + played;
+            workers[i].count = (i32)(gameCount - played < SIMULATION_CHUNK_SIZE ? gameCount - played :
+                SIMULATION_CHUNK_SIZE);
+            played += workers[i].count;
+            ++workerCount;
+        }
+
+        Perf_sample roundStart = ReadPerfCounters(&counters);
+        for (i32 i = 1; i < workerCount; ++i) {
+            StartThread(&threads[i], &RunSimulationWorker, &workers[i]);
+        }
+        RunSimulationWorker(&workers[0]);
+        for (i32 i = 1; i < workerCount; ++i) {
+            JoinThread(&threads[i]);
+        }
+        Perf_sample roundEnd = ReadPerfCounters(&counters);
+        AccumulatePerfSample(&perfTotal, &roundStart, &roundEnd);
+
+        i64 roundTime = (i64)time(NULL);
+        for (i32 i = 0; i < workerCount; ++i) {
+            for (i32 j = 0; j < workers[i].count; ++j) {
+                const Game_result *result = &workers[i].results[j];
+                WriteGameResultCsv(csv, result);
+                isOk &= WriteGameColumns(&columns, result);
+
+                if (resultsWriter.file != NULL) {
+                    Result_row row = {
+                        .seed = result->seed,
+                        .time = roundTime,
+                        .score = result->score,
+                        .moveCount = result->moveCount,
+                        .duration = result->duration,
+                        .maxTile = result->maxTile,
+                        .boardSize = TILE_COUNT_X,
+                        .policy = RESULT_POLICY_RANDOM
+                    };
+                    isOk &= AppendResult(&resultsWriter, &row);
+                }
+            }
+        }
+    }
+    f64 elapsed = GetWallTime() - start;
+
+    for (i32 i = 0; i < threadCount; ++i) {
+        MergeGameStats(total, &workers[i].stats);
+    }
+
+    isOk &= CloseGameColumns(&columns);
+    if (resultsWriter.file != NULL) {
+        isOk &= CloseResultsWriter(&resultsWriter);
+    }
+    isOk &= fclose(csv) == 0;
+    isOk &= WriteStatsOutputs(total, outputPrefix);
+
+    printf("%.0f games/s\n", total->gameCount / elapsed);
+    PrintGameStats(total);
+
+    // Time is summed over the rounds, so with several threads it's wall time per move across all of them
+    PrintPerfHeader("Per move");
+    PrintPerfRow("Random games", &perfTotal, total->moveSum);
+    ClosePerfCounters(&counters);
+
+    TrackedFree(workers, ALLOC_TAG_STATS);
+    TrackedFree(results, ALLOC_TAG_STATS);
+    TrackedFree(total, ALLOC_TAG_STATS);
+
+    if (!isOk) {
+        fprintf(stderr, "Writing the results failed\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+i32 RunStatsFromColumns(const char *path) {
+    Game_columns columns;
+    if (!OpenGameColumns(&columns, path)) {
+        fprintf(stderr, "%s is not a games.bin file\n", path);
+        return 1;
+    }
+
+    Game_stats *stats = TrackedAlloc(sizeof(Game_stats), ALLOC_TAG_STATS);
+    InitGameStats(stats);
+
+    Game_result result;
+    while (ReadGameColumns(&columns, &result)) {
+        AddGameResult(stats, &result);
+    }
+    CloseGameColumns(&columns);
+
+    PrintGameStats(stats);
+    TrackedFree(stats, ALLOC_TAG_STATS);
+
+    return 0;
+}
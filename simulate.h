@@ -0,0 +1,21 @@
+#ifndef SIMULATE_H
+#define SIMULATE_H
+
+#include "common.h"
+#include "stats.h"
+
+#define SIMULATION_CHUNK_SIZE 4096 // Games a thread plays before handing its results over
+
+// Plays a game of uniformly random legal moves, everything (spawns and moves) drawn from the seed. Stops early at the
+// 32768 tile, since the packed engine can't merge past it.
+void PlayRandomGame(u64 seed, Game_result *result);
+
+// Plays games firstSeed, firstSeed + 1, ... across threads. Per-game results go to <prefix>games.csv and
+// <prefix>games.bin (in seed order), the aggregates to <prefix>summary.csv and <prefix>histograms.csv. resultsPath,
+// unless it's NULL, is a results store that gets every game too.
+i32 RunSimulation(i64 gameCount, i32 threadCount, u64 firstSeed, const char *outputPrefix, const char *resultsPath);
+
+// Recomputes the aggregates from a games.bin file, a block at a time
+i32 RunStatsFromColumns(const char *path);
+
+#endif
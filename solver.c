@@ -0,0 +1,708 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "solver.h"
+
+#define SOLVER_MAX_THREADS 64
+#define SOLVER_CHUNK_SIZE 4096 // States a thread expands per round of the forward pass
+#define SOLVER_MIN_UNSORTED 65536 // New states a layer collects before they're sorted into the rest
+#define SOLVER_DEFAULT_TARGET_2X2 5 // 32
+#define SOLVER_DEFAULT_TARGET_3X3 9 // 512
+
+
+// While a layer collects positions they're whole Small_boards. Once it's expanded they're packed down to the bytes
+// that hold cells (5 for 3x3), which is all the backward pass and the table need.
+typedef struct Solver_layer {
+    Small_board *states;
+    i64 count;
+    i64 capacity;
+    i64 sortedCount; // states[0, sortedCount) are sorted and unique, the rest were just appended
+    u8 *packedStates;
+} Solver_layer;
+
+// Values of the positions of one layer, only kept while the two layers below it are solved
+typedef struct Solver_values {
+    f64 *scores;
+    f64 *winProbabilities;
+    i64 capacity;
+} Solver_values;
+
+typedef struct Solver {
+    Small_geometry geometry;
+    i32 stateBytes;
+    i32 targetExponent;
+    i32 layerCount; // One past the largest tile sum seen, halved
+    Solver_layer layers[SOLVER_MAX_LAYERS];
+} Solver;
+
+typedef struct Solver_worker {
+    const Solver *solver;
+    i32 layer;
+    i64 first;
+    i64 count;
+
+    // Forward pass: the positions after each move and spawn of a 2 ([0]) or a 4 ([1]), sorted and unique
+    Small_board *successors[2];
+    i64 successorCounts[2];
+
+    // Backward pass: the values of the two layers above, and where this layer's go
+    const Solver_values *nextValues[2];
+    Solver_values *values;
+    f32 *scores;
+    f32 *winProbabilities;
+    u8 *moves;
+} Solver_worker;
+
+
+static u32 GetSmallCell(Small_board board, i32 cell) {
+    return (board >> (PACKED_TILE_BITS * cell)) & PACKED_TILE_MASK;
+}
+
+static i32 GetSmallBoardLayer(const Small_geometry *geometry, Small_board board) {
+    i32 sum = 0;
+    for (i32 i = 0; i < geometry->cellCount; ++i) {
+        u32 value = GetSmallCell(board, i);
+        sum += value != 0 ? PowerOf2(value) : 0;
+    }
+
+    return sum / 2;
+}
+
+static u32 GetSmallMaxTile(const Small_geometry *geometry, Small_board board) {
+    u32 maxTile = 0;
+    for (i32 i = 0; i < geometry->cellCount; ++i) {
+        maxTile = GetSmallCell(board, i) > maxTile ? GetSmallCell(board, i) : maxTile;
+    }
+
+    return maxTile;
+}
+
+i32 GetSmallBoardBytes(i32 size) {
+    return (size * size * PACKED_TILE_BITS + 7) / 8;
+}
+
+void InitSmallGeometry(Small_geometry *geometry, i32 size) {
+    *geometry = (Small_geometry){0};
+    geometry->size = size;
+    geometry->cellCount = size * size;
+
+    for (i32 line = 0; line < size; ++line) {
+        for (i32 i = 0; i < size; ++i) {
+            geometry->lines[DIRECTION_UP][line][i] = i * size + line;
+            geometry->lines[DIRECTION_DOWN][line][i] = (size - 1 - i) * size + line;
+            geometry->lines[DIRECTION_LEFT][line][i] = line * size + i;
+            geometry->lines[DIRECTION_RIGHT][line][i] = line * size + size - 1 - i;
+        }
+    }
+
+    for (i32 symmetry = 0; symmetry < SYMMETRY_COUNT; ++symmetry) {
+        for (i32 y = 0; y < size; ++y) {
+            for (i32 x = 0; x < size; ++x) {
+                i32 newX = (symmetry & SYMMETRY_TRANSPOSE) ? y : x;
+                i32 newY = (symmetry & SYMMETRY_TRANSPOSE) ? x : y;
+                newX = (symmetry & SYMMETRY_FLIP_X) ? size - 1 - newX : newX;
+                newY = (symmetry & SYMMETRY_FLIP_Y) ? size - 1 - newY : newY;
+
+                geometry->symmetries[symmetry][y * size + x] = newY * size + newX;
+            }
+        }
+    }
+}
+
+Small_board MoveSmallBoard(const Small_geometry *geometry, Small_board board, Direction direction, i32 *score) {
+    Small_board result = 0;
+
+    for (i32 line = 0; line < geometry->size; ++line) {
+        const u8 *cells = geometry->lines[direction][line];
+
+        u32 values[SOLVER_MAX_SIZE] = {0};
+        i32 count = 0;
+        bool canMerge = false;
+        for (i32 i = 0; i < geometry->size; ++i) {
+            u32 value = GetSmallCell(board, cells[i]);
+            if (value == 0) {
+                continue;
+            }
+
+            if (canMerge && value == values[count - 1]) {
+                ++values[count - 1];
+                *score += PowerOf2(value + 1);
+                canMerge = false;
+                continue;
+            }
+
+            values[count++] = value;
+            canMerge = true;
+        }
+
+        for (i32 i = 0; i < count; ++i) {
+            result |= (Small_board)values[i] << (PACKED_TILE_BITS * cells[i]);
+        }
+    }
+
+    return result;
+}
+
+Small_board CanonicaliseSmallBoard(const Small_geometry *geometry, Small_board board, i32 *symmetry) {
+    Small_board best = board;
+    *symmetry = 0;
+
+    for (i32 i = 1; i < SYMMETRY_COUNT; ++i) {
+        Small_board transformed = 0;
+        for (i32 cell = 0; cell < geometry->cellCount; ++cell) {
+            transformed |= (Small_board)GetSmallCell(board, cell) << (PACKED_TILE_BITS * geometry->symmetries[i][cell]);
+        }
+
+        if (transformed < best) {
+            best = transformed;
+            *symmetry = i;
+        }
+    }
+
+    return best;
+}
+
+static i32 CompareSmallBoards(const void *a, const void *b) {
+    Small_board boardA = *(const Small_board *)a;
+    Small_board boardB = *(const Small_board *)b;
+    return (boardA > boardB) - (boardA < boardB);
+}
+
+// Sorts and removes duplicates in place, returns the new count
+static i64 SortUniqueSmallBoards(Small_board *boards, i64 count) {
+    qsort(boards, count, sizeof(Small_board), &CompareSmallBoards);
+
+    i64 uniqueCount = 0;
+    for (i64 i = 0; i < count; ++i) {
+        if (uniqueCount == 0 || boards[i] != boards[uniqueCount - 1]) {
+            boards[uniqueCount++] = boards[i];
+        }
+    }
+
+    return uniqueCount;
+}
+
+static void SortSolverLayer(Solver_layer *layer) {
+    layer->count = SortUniqueSmallBoards(layer->states, layer->count);
+    layer->sortedCount = layer->count;
+}
+
+// Keeps a layer from holding many more duplicates than positions: new states are sorted in once there are as many
+// of them as there were positions
+static void AddToSolverLayer(Solver_layer *layer, const Small_board *boards, i64 count) {
+    if (layer->count + count > layer->capacity) {
+        layer->capacity = 2 * (layer->count + count);
+        layer->states = TrackedRealloc(layer->states, layer->capacity * sizeof(Small_board), ALLOC_TAG_SOLVER);
+    }
+
+    memcpy(layer->states + layer->count, boards, count * sizeof(Small_board));
+    layer->count += count;
+
+    i64 unsortedCount = layer->count - layer->sortedCount;
+    if (unsortedCount >= SOLVER_MIN_UNSORTED && unsortedCount >= layer->sortedCount) {
+        SortSolverLayer(layer);
+    }
+}
+
+// The low bytes of a little-endian Small_board
+static Small_board ReadPackedState(const u8 *states, i32 stateBytes, i64 index) {
+    Small_board board = 0;
+    memcpy(&board, states + index * stateBytes, stateBytes);
+    return board;
+}
+
+static void PackSolverLayer(Solver_layer *layer, i32 stateBytes) {
+    layer->packedStates = TrackedAlloc(layer->count * stateBytes, ALLOC_TAG_SOLVER);
+    for (i64 i = 0; i < layer->count; ++i) {
+        memcpy(layer->packedStates + i * stateBytes, &layer->states[i], stateBytes);
+    }
+
+    TrackedFree(layer->states, ALLOC_TAG_SOLVER);
+    layer->states = NULL;
+    layer->capacity = 0;
+}
+
+static i64 FindPackedState(const u8 *states, i32 stateBytes, i64 count, Small_board board) {
+    i64 low = 0;
+    i64 high = count - 1;
+    while (low <= high) {
+        i64 middle = low + (high - low) / 2;
+        Small_board state = ReadPackedState(states, stateBytes, middle);
+        if (state == board) {
+            return middle;
+        }
+
+        if (state < board) {
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+
+    return -1;
+}
+
+static void ExpandSolverStates(void *data) {
+    Solver_worker *worker = data;
+    const Small_geometry *geometry = &worker->solver->geometry;
+    const Small_board *states = worker->solver->layers[worker->layer].states;
+
+    worker->successorCounts[0] = 0;
+    worker->successorCounts[1] = 0;
+
+    for (i64 i = worker->first; i < worker->first + worker->count; ++i) {
+        for (i32 direction = 0; direction < DIRECTION_COUNT; ++direction) {
+            i32 score = 0;
+            Small_board moved = MoveSmallBoard(geometry, states[i], direction, &score);
+            if (moved == states[i]) {
+                continue;
+            }
+
+            for (i32 cell = 0; cell < geometry->cellCount; ++cell) {
+                if (GetSmallCell(moved, cell) != 0) {
+                    continue;
+                }
+
+                for (i32 exponent = 1; exponent <= 2; ++exponent) {
+                    i32 symmetry;
+                    Small_board spawned = moved | ((Small_board)exponent << (PACKED_TILE_BITS * cell));
+                    worker->successors[exponent - 1][worker->successorCounts[exponent - 1]++] =
+                        CanonicaliseSmallBoard(geometry, spawned, &symmetry);
+                }
+            }
+        }
+    }
+
+    for (i32 i = 0; i < 2; ++i) {
+        worker->successorCounts[i] = SortUniqueSmallBoards(worker->successors[i], worker->successorCounts[i]);
+    }
+}
+
+static void SolveSolverStates(void *data) {
+    Solver_worker *worker = data;
+    const Solver *solver = worker->solver;
+    const Small_geometry *geometry = &solver->geometry;
+    const u8 *states = solver->layers[worker->layer].packedStates;
+
+    for (i64 i = worker->first; i < worker->first + worker->count; ++i) {
+        Small_board board = ReadPackedState(states, solver->stateBytes, i);
+        f64 bestScore = 0.0;
+        f64 bestWinProbability = 0.0;
+        Direction scoreMove = DIRECTION_NONE;
+        Direction winMove = DIRECTION_NONE;
+
+        for (i32 direction = 0; direction < DIRECTION_COUNT; ++direction) {
+            i32 moveScore = 0;
+            Small_board moved = MoveSmallBoard(geometry, board, direction, &moveScore);
+            if (moved == board) {
+                continue;
+            }
+
+            i32 emptyCount = 0;
+            f64 score = 0.0;
+            f64 winProbability = 0.0;
+            for (i32 cell = 0; cell < geometry->cellCount; ++cell) {
+                if (GetSmallCell(moved, cell) != 0) {
+                    continue;
+                }
+                ++emptyCount;
+
+                // A 2 adds 2 to the tile sum, the next layer, and a 4 the one after
+                for (i32 exponent = 1; exponent <= 2; ++exponent) {
+                    i32 symmetry;
+                    Small_board spawned = CanonicaliseSmallBoard(geometry,
+                        moved | ((Small_board)exponent << (PACKED_TILE_BITS * cell)), &symmetry);
+                    const Solver_layer *next = &solver->layers[worker->layer + exponent];
+                    i64 index = FindPackedState(next->packedStates, solver->stateBytes, next->count, spawned);
+
+                    score += 0.5 * worker->nextValues[exponent - 1]->scores[index];
+                    winProbability += 0.5 * worker->nextValues[exponent - 1]->winProbabilities[index];
+                }
+            }
+            score = moveScore + score / emptyCount;
+            winProbability /= emptyCount;
+
+            if (scoreMove == DIRECTION_NONE || score > bestScore) {
+                bestScore = score;
+                scoreMove = direction;
+            }
+            if (winMove == DIRECTION_NONE || winProbability > bestWinProbability) {
+                bestWinProbability = winProbability;
+                winMove = direction;
+            }
+        }
+
+        // Already there, whatever comes next
+        if (GetSmallMaxTile(geometry, board) >= (u32)solver->targetExponent) {
+            bestWinProbability = 1.0;
+            winMove = scoreMove;
+        }
+
+        i64 index = i - worker->first;
+        worker->values->scores[i] = bestScore;
+        worker->values->winProbabilities[i] = bestWinProbability;
+        worker->scores[index] = bestScore;
+        worker->winProbabilities[index] = bestWinProbability;
+        worker->moves[index] = (scoreMove == DIRECTION_NONE ? SOLVER_NO_MOVE : scoreMove) |
+            (winMove == DIRECTION_NONE ? SOLVER_NO_MOVE : winMove) << 4;
+    }
+}
+
+static void RunSolverWorkers(Solver_worker *workers, i32 workerCount, Thread_function function) {
+    Thread threads[SOLVER_MAX_THREADS];
+
+    for (i32 i = 1; i < workerCount; ++i) {
+        StartThread(&threads[i], function, &workers[i]);
+    }
+    function(&workers[0]);
+    for (i32 i = 1; i < workerCount; ++i) {
+        JoinThread(&threads[i]);
+    }
+}
+
+// Layer by layer from the starts, each one finished (sorted) before it's expanded. Returns the position count.
+static i64 EnumerateSolverStates(Solver *solver, Solver_worker *workers, i32 threadCount) {
+    const Small_geometry *geometry = &solver->geometry;
+
+    for (i32 i = 0; i < geometry->cellCount; ++i) {
+        for (i32 j = i + 1; j < geometry->cellCount; ++j) {
+            i32 symmetry;
+            Small_board start = CanonicaliseSmallBoard(geometry, (1ull << (PACKED_TILE_BITS * i)) |
+                (1ull << (PACKED_TILE_BITS * j)), &symmetry);
+            AddToSolverLayer(&solver->layers[GetSmallBoardLayer(geometry, start)], &start, 1);
+        }
+    }
+
+    i64 stateCount = 0;
+    for (i32 layer = 0; layer < SOLVER_MAX_LAYERS; ++layer) {
+        Solver_layer *current = &solver->layers[layer];
+        SortSolverLayer(current);
+        if (current->count == 0) {
+            continue;
+        }
+
+        stateCount += current->count;
+        solver->layerCount = layer + 1;
+
+        if (layer + 2 >= SOLVER_MAX_LAYERS) {
+            fprintf(stderr, "Tile sums past %d don't fit in the layers\n", 2 * SOLVER_MAX_LAYERS);
+            return -1;
+        }
+
+        for (i64 done = 0; done < current->count;) {
+            i32 workerCount = 0;
+            for (i32 i = 0; i < threadCount && done < current->count; ++i) {
+                workers[i].layer = layer;
+                workers[i].first = done;
+                workers[i].count = current->count - done < SOLVER_CHUNK_SIZE ? current->count - done : SOLVER_CHUNK_SIZE;
+                done += workers[i].count;
+                ++workerCount;
+            }
+
+            RunSolverWorkers(workers, workerCount, &ExpandSolverStates);
+
+            for (i32 i = 0; i < workerCount; ++i) {
+                AddToSolverLayer(&solver->layers[layer + 1], workers[i].successors[0], workers[i].successorCounts[0]);
+                AddToSolverLayer(&solver->layers[layer + 2], workers[i].successors[1], workers[i].successorCounts[1]);
+            }
+        }
+
+        // Positions are only added to layers above this one
+        PackSolverLayer(current, solver->stateBytes);
+    }
+
+    return stateCount;
+}
+
+static void ReserveSolverValues(Solver_values *values, i64 count) {
+    if (count > values->capacity) {
+        values->capacity = count;
+        values->scores = TrackedRealloc(values->scores, count * sizeof(f64), ALLOC_TAG_SOLVER);
+        values->winProbabilities = TrackedRealloc(values->winProbabilities, count * sizeof(f64), ALLOC_TAG_SOLVER);
+    }
+}
+
+static void FreeSolverValues(Solver_values *values) {
+    TrackedFree(values->scores, ALLOC_TAG_SOLVER);
+    TrackedFree(values->winProbabilities, ALLOC_TAG_SOLVER);
+    *values = (Solver_values){0};
+}
+
+// Offsets of the table's arrays in the file
+typedef struct Solver_table_layout {
+    i64 layerStarts;
+    i64 scores;
+    i64 winProbabilities;
+    i64 moves;
+    i64 states;
+    i64 size;
+} Solver_table_layout;
+
+static Solver_table_layout GetSolverTableLayout(i64 layerCount, i64 stateCount, i32 stateBytes) {
+    Solver_table_layout layout;
+    layout.layerStarts = sizeof(Solver_header);
+    layout.scores = layout.layerStarts + (layerCount + 1) * sizeof(u64);
+    layout.winProbabilities = layout.scores + stateCount * sizeof(f32);
+    layout.moves = layout.winProbabilities + stateCount * sizeof(f32);
+    layout.states = layout.moves + stateCount * sizeof(u8);
+    layout.size = layout.states + stateCount * stateBytes;
+
+    return layout;
+}
+
+static bool WriteAt(FILE *file, i64 offset, const void *data, i64 size) {
+    return fseek(file, offset, SEEK_SET) == 0 && fwrite(data, 1, size, file) == (size_t)size;
+}
+
+// From the largest tile sum down, writing each layer's values to the file as they're done. Only three layers of
+// values are in memory at a time.
+static bool SolveSolverLayers(Solver *solver, Solver_worker *workers, i32 threadCount, FILE *file,
+    Solver_table_layout layout, Solver_header *header) {
+    const Small_geometry *geometry = &solver->geometry;
+
+    i64 maxLayerSize = 0;
+    for (i32 i = 0; i < solver->layerCount; ++i) {
+        maxLayerSize = solver->layers[i].count > maxLayerSize ? solver->layers[i].count : maxLayerSize;
+    }
+
+    // Layers past the last one are empty, nothing ever looks a position up in them
+    Solver_values values[3] = {0};
+    for (i32 i = 0; i < 3; ++i) {
+        ReserveSolverValues(&values[i], 1);
+    }
+
+    f32 *scores = TrackedAlloc(maxLayerSize * sizeof(f32), ALLOC_TAG_SOLVER);
+    f32 *winProbabilities = TrackedAlloc(maxLayerSize * sizeof(f32), ALLOC_TAG_SOLVER);
+    u8 *moves = TrackedAlloc(maxLayerSize * sizeof(u8), ALLOC_TAG_SOLVER);
+
+    bool isOk = true;
+    i64 stateStart = 0;
+    for (i32 layer = 0; layer < solver->layerCount; ++layer) {
+        stateStart += solver->layers[layer].count;
+    }
+
+    for (i32 layer = solver->layerCount - 1; layer >= 0 && isOk; --layer) {
+        const Solver_layer *current = &solver->layers[layer];
+        stateStart -= current->count;
+
+        // values[layer % 3] held layer + 3, which nothing needs any more
+        Solver_values *layerValues = &values[layer % 3];
+        ReserveSolverValues(layerValues, current->count);
+
+        i64 perWorker = (current->count + threadCount - 1) / threadCount;
+        i32 workerCount = 0;
+        for (i64 first = 0; first < current->count; first += perWorker) {
+            Solver_worker *worker = &workers[workerCount++];
+            worker->layer = layer;
+            worker->first = first;
+            worker->count = current->count - first < perWorker ? current->count - first : perWorker;
+            worker->nextValues[0] = &values[(layer + 1) % 3];
+            worker->nextValues[1] = &values[(layer + 2) % 3];
+            worker->values = layerValues;
+            worker->scores = scores + first;
+            worker->winProbabilities = winProbabilities + first;
+            worker->moves = moves + first;
+        }
+
+        if (workerCount > 0) {
+            RunSolverWorkers(workers, workerCount, &SolveSolverStates);
+        }
+
+        isOk = WriteAt(file, layout.scores + stateStart * sizeof(f32), scores, current->count * sizeof(f32)) &&
+            WriteAt(file, layout.winProbabilities + stateStart * sizeof(f32), winProbabilities,
+                current->count * sizeof(f32)) &&
+            WriteAt(file, layout.moves + stateStart, moves, current->count);
+    }
+
+    // Every start is equally likely, ResetBoard puts two 2s on any two cells
+    i32 startCount = 0;
+    for (i32 i = 0; i < geometry->cellCount; ++i) {
+        for (i32 j = i + 1; j < geometry->cellCount; ++j) {
+            i32 symmetry;
+            Small_board start = CanonicaliseSmallBoard(geometry, (1ull << (PACKED_TILE_BITS * i)) |
+                (1ull << (PACKED_TILE_BITS * j)), &symmetry);
+            i32 layer = GetSmallBoardLayer(geometry, start);
+            i64 index = FindPackedState(solver->layers[layer].packedStates, solver->stateBytes,
+                solver->layers[layer].count, start);
+
+            header->startScore += values[layer % 3].scores[index];
+            header->startWinProbability += values[layer % 3].winProbabilities[index];
+            ++startCount;
+        }
+    }
+    header->startScore /= startCount;
+    header->startWinProbability /= startCount;
+
+    for (i32 i = 0; i < 3; ++i) {
+        FreeSolverValues(&values[i]);
+    }
+    TrackedFree(scores, ALLOC_TAG_SOLVER);
+    TrackedFree(winProbabilities, ALLOC_TAG_SOLVER);
+    TrackedFree(moves, ALLOC_TAG_SOLVER);
+
+    return isOk;
+}
+
+i32 RunSolver(i32 size, i32 targetExponent, i32 threadCount, const char *path) {
+    if (size < 2 || size > SOLVER_MAX_SIZE) {
+        fprintf(stderr, "The solver handles boards from 2x2 to %dx%d\n", SOLVER_MAX_SIZE, SOLVER_MAX_SIZE);
+        return 1;
+    }
+
+    if (threadCount <= 0) {
+        threadCount = GetProcessorCount();
+    }
+    threadCount = MinI32(threadCount, SOLVER_MAX_THREADS);
+
+    if (targetExponent <= 0) {
+        targetExponent = size == 2 ? SOLVER_DEFAULT_TARGET_2X2 : SOLVER_DEFAULT_TARGET_3X3;
+    }
+
+    Solver *solver = TrackedAlloc(sizeof(Solver), ALLOC_TAG_SOLVER);
+    memset(solver, 0, sizeof(Solver));
+    InitSmallGeometry(&solver->geometry, size);
+    solver->stateBytes = GetSmallBoardBytes(size);
+    solver->targetExponent = targetExponent;
+
+    // Every position has at most DIRECTION_COUNT * cellCount successors of each kind
+    Solver_worker *workers = TrackedAlloc(threadCount * sizeof(Solver_worker), ALLOC_TAG_SOLVER);
+    i64 successorCapacity = (i64)SOLVER_CHUNK_SIZE * DIRECTION_COUNT * solver->geometry.cellCount;
+    for (i32 i = 0; i < threadCount; ++i) {
+        workers[i] = (Solver_worker){.solver = solver};
+        for (i32 j = 0; j < 2; ++j) {
+            workers[i].successors[j] = TrackedAlloc(successorCapacity * sizeof(Small_board), ALLOC_TAG_SOLVER);
+        }
+    }
+
+    printf("Solving %dx%d, target tile %u, %d threads\n", size, size, PowerOf2(targetExponent), threadCount);
+
+    f64 start = GetWallTime();
+    i64 stateCount = EnumerateSolverStates(solver, workers, threadCount);
+    f64 enumerated = GetWallTime();
+
+    for (i32 i = 0; i < threadCount; ++i) {
+        for (i32 j = 0; j < 2; ++j) {
+            TrackedFree(workers[i].successors[j], ALLOC_TAG_SOLVER);
+        }
+    }
+
+    Solver_table_layout layout = GetSolverTableLayout(solver->layerCount, stateCount, solver->stateBytes);
+    Solver_header header = {
+        .magic = SOLVER_MAGIC,
+        .version = SOLVER_VERSION,
+        .size = size,
+        .targetExponent = targetExponent,
+        .layerCount = solver->layerCount,
+        .stateCount = stateCount
+    };
+
+    FILE *file = stateCount > 0 ? fopen(path, "wb") : NULL;
+    bool isOk = file != NULL;
+    if (isOk) {
+        printf("Enumerated %lld positions in %d layers in %.2f s (%.0f positions/s)\n", (long long)stateCount,
+            solver->layerCount, enumerated - start, stateCount / (enumerated - start));
+
+        u64 *layerStarts = TrackedAlloc((solver->layerCount + 1) * sizeof(u64), ALLOC_TAG_SOLVER);
+        layerStarts[0] = 0;
+        for (i32 i = 0; i < solver->layerCount; ++i) {
+            layerStarts[i + 1] = layerStarts[i] + solver->layers[i].count;
+            isOk &= WriteAt(file, layout.states + layerStarts[i] * solver->stateBytes, solver->layers[i].packedStates,
+                solver->layers[i].count * solver->stateBytes);
+        }
+        isOk &= WriteAt(file, layout.layerStarts, layerStarts, (solver->layerCount + 1) * sizeof(u64));
+        TrackedFree(layerStarts, ALLOC_TAG_SOLVER);
+
+        isOk = isOk && SolveSolverLayers(solver, workers, threadCount, file, layout, &header);
+        isOk = isOk && WriteAt(file, 0, &header, sizeof(header));
+        isOk &= fclose(file) == 0;
+    }
+
+    f64 solved = GetWallTime();
+    if (isOk) {
+        printf("Solved them in %.2f s (%.0f positions/s)\n", solved - enumerated, stateCount / (solved - enumerated));
+        printf("From the start: expected score %.2f, %u reached with probability %.6f\n", header.startScore,
+            PowerOf2(targetExponent), header.startWinProbability);
+        printf("Wrote %s, %.1f MB. Peak memory %.1f MB\n", path, layout.size / 1e6, GetAllocTotals().peakBytes / 1e6);
+    } else {
+        fprintf(stderr, "Could not write %s\n", path);
+    }
+
+    for (i32 i = 0; i < SOLVER_MAX_LAYERS; ++i) {
+        TrackedFree(solver->layers[i].states, ALLOC_TAG_SOLVER);
+        TrackedFree(solver->layers[i].packedStates, ALLOC_TAG_SOLVER);
+    }
+    TrackedFree(workers, ALLOC_TAG_SOLVER);
+    TrackedFree(solver, ALLOC_TAG_SOLVER);
+
+    return isOk ? 0 : 1;
+}
+
+bool OpenSolverTable(Solver_table *table, const char *path) {
+    *table = (Solver_table){0};
+
+    if (!MapFile(&table->file, path)) {
+        return false;
+    }
+
+    const Solver_header *header = table->file.data;
+    bool isValid = table->file.size >= (i64)sizeof(Solver_header) && memcmp(header->magic, SOLVER_MAGIC, 8) == 0 &&
+        header->version == SOLVER_VERSION && header->size >= 2 && header->size <= SOLVER_MAX_SIZE &&
+        header->layerCount <= SOLVER_MAX_LAYERS;
+
+    Solver_table_layout layout = {0};
+    if (isValid) {
+        layout = GetSolverTableLayout(header->layerCount, header->stateCount, GetSmallBoardBytes(header->size));
+        isValid = table->file.size == layout.size;
+    }
+
+    if (!isValid) {
+        UnmapFile(&table->file);
+        return false;
+    }
+
+    const u8 *data = table->file.data;
+    table->header = header;
+    table->layerStarts = (const u64 *)(data + layout.layerStarts);
+    table->states = data + layout.states;
+    table->stateBytes = GetSmallBoardBytes(header->size);
+    table->scores = (const f32 *)(data + layout.scores);
+    table->winProbabilities = (const f32 *)(data + layout.winProbabilities);
+    table->moves = data + layout.moves;
+    InitSmallGeometry(&table->geometry, header->size);
+
+    return true;
+}
+
+void CloseSolverTable(Solver_table *table) {
+    UnmapFile(&table->file);
+    *table = (Solver_table){0};
+}
+
+bool LookUpSolverTable(const Solver_table *table, Small_board board, Direction *scoreMove, Direction *winMove,
+    f32 *score, f32 *winProbability) {
+    i32 symmetry;
+    Small_board canonical = CanonicaliseSmallBoard(&table->geometry, board, &symmetry);
+
+    i32 layer = GetSmallBoardLayer(&table->geometry, canonical);
+    if (layer >= (i32)table->header->layerCount) {
+        return false;
+    }
+
+    u64 first = table->layerStarts[layer];
+    i64 index = FindPackedState(table->states + first * table->stateBytes, table->stateBytes,
+        table->layerStarts[layer + 1] - first, canonical);
+    if (index < 0) {
+        return false;
+    }
+    index += first;
+
+    u8 moves = table->moves[index];
+    *scoreMove = (moves & 0xF) == SOLVER_NO_MOVE ? DIRECTION_NONE : UntransformDirection(moves & 0xF, symmetry);
+    *winMove = (moves >> 4) == SOLVER_NO_MOVE ? DIRECTION_NONE : UntransformDirection(moves >> 4, symmetry);
+    *score = table->scores[index];
+    *winProbability = table->winProbabilities[index];
+
+    return true;
+}
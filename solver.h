@@ -0,0 +1,82 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include "common.h"
+#include "board.h"
+#include "platform.h"
+
+#define SOLVER_MAX_SIZE 3
+#define SOLVER_MAX_CELLS (SOLVER_MAX_SIZE * SOLVER_MAX_SIZE)
+#define SOLVER_MAX_LAYERS 8192 // Tile sums up to 16382, more than a 3x3 board can hold
+
+#define SOLVER_MAGIC "R2048SLV"
+#define SOLVER_VERSION 1
+#define SOLVER_NO_MOVE 0xF
+#define SOLVER_DEFAULT_PATH "solution.bin"
+
+// Exact play on square boards of up to 3x3, far enough below the 4x4 game that every reachable position can be
+// enumerated. Every move adds a 2 or a 4 and merges keep the sum of the tiles, so a position only ever leads to
+// positions with a larger tile sum. The solver enumerates the positions a layer (tile sum) at a time from the starts
+// ResetBoard makes, then computes the values from the largest sum down, each layer only needing the two above it.
+//
+// Two values per position, each under its own optimal play: the expected score still to come, and the probability
+// of reaching the target tile.
+
+// 4 bits a cell like a Packed_board, size cells to a row (cell y * size + x), so 36 bits for 3x3. Stored packed in
+// GetSmallBoardBytes bytes, the low bytes of the (little-endian) u64.
+typedef u64 Small_board;
+
+typedef struct Small_geometry {
+    i32 size;
+    i32 cellCount;
+    u8 lines[DIRECTION_COUNT][SOLVER_MAX_SIZE][SOLVER_MAX_SIZE]; // Each line's cells, starting at the wall moved to
+    u8 symmetries[SYMMETRY_COUNT][SOLVER_MAX_CELLS]; // Where each cell goes, same convention as TransformPackedBoard
+} Small_geometry;
+
+// The table file is this header followed by
+//   u64 layerStarts[layerCount + 1]   Layer i holds the positions with tile sum 2 * i
+//   f32 scores[stateCount]
+//   f32 winProbabilities[stateCount]
+//   u8 moves[stateCount]              Best move for the score in the low nibble, for winning in the high one
+//   u8 states[stateCount][GetSmallBoardBytes(size)]   Canonical, packed, sorted within each layer
+typedef struct Solver_header {
+    char magic[8];
+    u32 version;
+    u32 size;
+    u32 targetExponent;
+    u32 layerCount;
+    u64 stateCount;
+    f64 startScore; // Averaged over the starts
+    f64 startWinProbability;
+} Solver_header;
+
+typedef struct Solver_table {
+    Mapped_file file;
+    const Solver_header *header;
+    Small_geometry geometry;
+    const u64 *layerStarts;
+    const u8 *states;
+    i32 stateBytes;
+    const f32 *scores;
+    const f32 *winProbabilities;
+    const u8 *moves;
+} Solver_table;
+
+
+i32 GetSmallBoardBytes(i32 size);
+void InitSmallGeometry(Small_geometry *geometry, i32 size);
+Small_board MoveSmallBoard(const Small_geometry *geometry, Small_board board, Direction direction, i32 *score);
+Small_board CanonicaliseSmallBoard(const Small_geometry *geometry, Small_board board, i32 *symmetry);
+
+// Solves size x size with the given target tile (an exponent, 0 picks one) and writes the table to path. Prints
+// states/s for both passes and the peak memory.
+i32 RunSolver(i32 size, i32 targetExponent, i32 threadCount, const char *path);
+
+bool OpenSolverTable(Solver_table *table, const char *path);
+void CloseSolverTable(Solver_table *table);
+
+// The moves are for board as given, not its canonical form. False for positions that can't be reached.
+bool LookUpSolverTable(const Solver_table *table, Small_board board, Direction *scoreMove, Direction *winMove,
+    f32 *score, f32 *winProbability);
+
+#endif
@@ -0,0 +1,91 @@
+#include "search.h"
+#include "spectator.h"
+
+#define SPECTATOR_MAX_LAG 1.0 // Seconds a game can fall behind before it skips ahead
+
+
+static void StartSpectatorGame(Spectator *spectator, Spectator_game *game, f64 time) {
+    Rng rng = CreateRng(spectator->nextSeed++);
+    Board board;
+    ResetBoard(&board, &rng);
+
+    *game = (Spectator_game){
+        .board = PackBoard(&board),
+        .rng = rng,
+        .nextMoveTime = time + spectator->moveInterval
+    };
+}
+
+static void PlaySpectatorMove(Spectator *spectator, Spectator_game *game) {
+    Direction bestMove = DIRECTION_NONE;
+    Packed_board bestBoard = game->board;
+    i32 bestScore = 0;
+    f32 bestValue = 0.0f;
+    if (LookUpBook(spectator->book, game->board, &bestMove, &bestValue)) {
+        bestBoard = MoveWithTables(spectator->tables, game->board, bestMove, &bestScore);
+    } else {
+        for (i32 direction = 0; direction < DIRECTION_COUNT; ++direction) {
+            i32 score = 0;
+            Packed_board moved = MoveWithTables(spectator->tables, game->board, direction, &score);
+            if (moved == game->board) {
+                continue;
+            }
+
+            f32 value = EvaluatePackedBoard(moved);
+            if (bestMove == DIRECTION_NONE || value > bestValue) {
+                bestMove = direction;
+                bestBoard = moved;
+                bestScore = score;
+                bestValue = value;
+            }
+        }
+    }
+
+    // The packed engine can't merge past 32768, so that's where a game ends at the latest
+    if (bestMove == DIRECTION_NONE || GetPackedMaxTile(bestBoard) == (i32)PACKED_TILE_MASK) {
+        game->isOver = true;
+        return;
+    }
+
+    Board board = UnpackBoard(bestBoard);
+    SpawnTile(&board, &game->rng);
+    game->board = PackBoard(&board);
+    game->score += bestScore;
+    ++game->moveCount;
+    ++spectator->moveCount;
+}
+
+void InitSpectator(Spectator *spectator, i32 gameCount, f64 movesPerSecond, u64 seed, f64 time, const Book *book) {
+    spectator->gameCount = MinI32(MaxI32(gameCount, 1), SPECTATOR_MAX_GAMES);
+    spectator->moveInterval = 1.0 / (movesPerSecond > 0.0 ? movesPerSecond : SPECTATOR_DEFAULT_MOVE_RATE);
+    spectator->nextSeed = seed;
+    spectator->tables = GetMoveTables();
+    spectator->book = book;
+    spectator->moveCount = 0;
+
+    for (i32 i = 0; i < spectator->gameCount; ++i) {
+        StartSpectatorGame(spectator, &spectator->games[i], time);
+        spectator->games[i].nextMoveTime += spectator->moveInterval * i / spectator->gameCount;
+    }
+}
+
+void StepSpectator(Spectator *spectator, f64 time) {
+    for (i32 i = 0; i < spectator->gameCount; ++i) {
+        Spectator_game *game = &spectator->games[i];
+
+        // After a stall (a dragged window, say) the games skip ahead rather than racing to catch up
+        if (game->nextMoveTime < time - SPECTATOR_MAX_LAG) {
+            game->nextMoveTime = time;
+        }
+
+        while (game->nextMoveTime <= time) {
+            if (game->isOver) {
+                StartSpectatorGame(spectator, game, game->nextMoveTime);
+                continue;
+            }
+
+            PlaySpectatorMove(spectator, game);
+            game->nextMoveTime += game->isOver ? SPECTATOR_RESTART_DELAY : spectator->moveInterval;
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef SPECTATOR_H
+#define SPECTATOR_H
+
+#include "common.h"
+#include "board.h"
+#include "book.h"
+#include "move_tables.h"
+
+#define SPECTATOR_MAX_GAMES 256
+#define SPECTATOR_DEFAULT_GAMES 64
+#define SPECTATOR_DEFAULT_MOVE_RATE 8.0 // Moves a second, per game
+#define SPECTATOR_RESTART_DELAY 2.0 // Seconds a finished game stays up before the next one starts
+
+// The games behind the spectator wall, each played by a bot that takes the book's move in the openings it has, and
+// otherwise the move the search heuristic likes best one move ahead. Every game has its own seed and clock, staggered
+// so that the wall doesn't move in lockstep. Rendering is up to main.c.
+
+typedef struct Spectator_game {
+    Packed_board board;
+    Rng rng;
+    i32 score;
+    i32 moveCount;
+    f64 nextMoveTime;
+    bool isOver;
+} Spectator_game;
+
+typedef struct Spectator {
+    Spectator_game games[SPECTATOR_MAX_GAMES];
+    i32 gameCount;
+    f64 moveInterval;
+    u64 nextSeed;
+    const Move_tables_data *tables;
+    const Book *book; // May be NULL or closed
+    i64 moveCount; // Across every game since InitSpectator
+} Spectator;
+
+void InitSpectator(Spectator *spectator, i32 gameCount, f64 movesPerSecond, u64 seed, f64 time, const Book *book);
+
+// Plays every move that was due by time, restarting games that have been over for SPECTATOR_RESTART_DELAY
+void StepSpectator(Spectator *spectator, f64 time);
+
+#endif
@@ -0,0 +1,442 @@
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "board.h"
+#include "stats.h"
+
+
+static f64 GetSketchGamma(void) {
+    return (1.0 + SKETCH_RELATIVE_ACCURACY) / (1.0 - SKETCH_RELATIVE_ACCURACY);
+}
+
+// Bucket i holds values in (gamma^(i - 1), gamma^i]
+static f64 GetSketchBucketUpper(i32 index) {
+    return pow(GetSketchGamma(), index);
+}
+
+void InitSketch(Quantile_sketch *sketch) {
+    memset(sketch, 0, sizeof(*sketch));
+}
+
+void AddToSketch(Quantile_sketch *sketch, f64 value) {
+    ++sketch->count;
+
+    if (value < 1.0) {
+        ++sketch->zeroCount;
+        return;
+    }
+
+    i32 index = (i32)ceil(log(value) / log(GetSketchGamma()));
+    ++sketch->buckets[MinI32(index, SKETCH_BUCKET_COUNT - 1)];
+}
+
+void MergeSketch(Quantile_sketch *into, const Quantile_sketch *from) {
+    for (i32 i = 0; i < SKETCH_BUCKET_COUNT; ++i) {
+        into->buckets[i] += from->buckets[i];
+    }
+    into->zeroCount += from->zeroCount;
+    into->count += from->count;
+}
+
+f64 GetSketchQuantile(const Quantile_sketch *sketch, f64 quantile) {
+    if (sketch->count == 0) {
+        return 0.0;
+    }
+
+    i64 rank = (i64)(quantile * (sketch->count - 1));
+    i64 seen = sketch->zeroCount;
+    if (seen > rank) {
+        return 0.0;
+    }
+
+    // The middle of the bucket in relative terms, which is what bounds the error
+    f64 gamma = GetSketchGamma();
+    for (i32 i = 0; i < SKETCH_BUCKET_COUNT; ++i) {
+        seen += sketch->buckets[i];
+        if (seen > rank) {
+            return 2.0 * GetSketchBucketUpper(i) / (gamma + 1.0);
+        }
+    }
+
+    return GetSketchBucketUpper(SKETCH_BUCKET_COUNT - 1);
+}
+
+void InitGameStats(Game_stats *stats) {
+    memset(stats, 0, sizeof(*stats));
+}
+
+void AddGameResult(Game_stats *stats, const Game_result *result) {
+    if (stats->gameCount == 0 || result->score < stats->minScore) {
+        stats->minScore = result->score;
+    }
+    if (stats->gameCount == 0 || result->score > stats->maxScore) {
+        stats->maxScore = result->score;
+    }
+    if (result->moveCount > stats->maxMoves) {
+        stats->maxMoves = result->moveCount;
+    }
+
+    ++stats->gameCount;
+    stats->scoreSum += result->score;
+    stats->scoreSumSquares += (f64)result->score * result->score;
+    stats->moveSum += result->moveCount;
+    stats->durationSum += result->duration;
+    ++stats->maxTileCounts[MinI32(result->maxTile, STATS_MAX_EXPONENT)];
+
+    AddToSketch(&stats->scores, result->score);
+    AddToSketch(&stats->moves, result->moveCount);
+    AddToSketch(&stats->durations, result->duration * 1e6);
+}
+
+void MergeGameStats(Game_stats *into, const Game_stats *from) {
+    if (from->gameCount == 0) {
+        return;
+    }
+
+    if (into->gameCount == 0 || from->minScore < into->minScore) {
+        into->minScore = from->minScore;
+    }
+    if (into->gameCount == 0 || from->maxScore > into->maxScore) {
+        into->maxScore = from->maxScore;
+    }
+    if (from->maxMoves > into->maxMoves) {
+        into->maxMoves = from->maxMoves;
+    }
+
+    into->gameCount += from->gameCount;
+    into->scoreSum += from->scoreSum;
+    into->scoreSumSquares += from->scoreSumSquares;
+    into->moveSum += from->moveSum;
+    into->durationSum += from->durationSum;
+    for (i32 i = 0; i <= STATS_MAX_EXPONENT; ++i) {
+        into->maxTileCounts[i] += from->maxTileCounts[i];
+    }
+
+    MergeSketch(&into->scores, &from->scores);
+    MergeSketch(&into->moves, &from->moves);
+    MergeSketch(&into->durations, &from->durations);
+}
+
+f64 GetTileReachRate(const Game_stats *stats, i32 exponent) {
+    if (stats->gameCount == 0) {
+        return 0.0;
+    }
+
+    i64 reached = 0;
+    for (i32 i = MaxI32(exponent, 0); i <= STATS_MAX_EXPONENT; ++i) {
+        reached += stats->maxTileCounts[i];
+    }
+
+    return (f64)reached / stats->gameCount;
+}
+
+f64 GetScoreStandardDeviation(const Game_stats *stats) {
+    if (stats->gameCount == 0) {
+        return 0.0;
+    }
+
+    f64 mean = (f64)stats->scoreSum / stats->gameCount;
+    f64 variance = stats->scoreSumSquares / stats->gameCount - mean * mean;
+
+    return variance > 0.0 ? sqrt(variance) : 0.0;
+}
+
+static void WriteSketchQuantiles(FILE *file, const char *metric, const Quantile_sketch *sketch) {
+    const f64 QUANTILES[] = {0.5, 0.9, 0.99, 0.999};
+    const char *NAMES[] = {"p50", "p90", "p99", "p999"};
+
+    for (i32 i = 0; i < 4; ++i) {
+        fprintf(file, "%s_%s,%.6g\n", metric, NAMES[i], GetSketchQuantile(sketch, QUANTILES[i]));
+    }
+}
+
+bool WriteGameStatsSummary(const Game_stats *stats, const char *path) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        return false;
+    }
+
+    i64 games = stats->gameCount > 0 ? stats->gameCount : 1; // Keeps the means at 0 rather than NaN
+
+    fprintf(file, "metric,value\n");
+    fprintf(file, "games,%lld\n", (long long)stats->gameCount);
+    fprintf(file, "score_mean,%.6g\n", (f64)stats->scoreSum / games);
+    fprintf(file, "score_stddev,%.6g\n", GetScoreStandardDeviation(stats));
+    fprintf(file, "score_min,%d\n", stats->minScore);
+    fprintf(file, "score_max,%d\n", stats->maxScore);
+    WriteSketchQuantiles(file, "score", &stats->scores);
+    fprintf(file, "moves_mean,%.6g\n", (f64)stats->moveSum / games);
+    fprintf(file, "moves_max,%u\n", stats->maxMoves);
+    WriteSketchQuantiles(file, "moves", &stats->moves);
+    fprintf(file, "duration_us_mean,%.6g\n", 1e6 * stats->durationSum / games);
+    WriteSketchQuantiles(file, "duration_us", &stats->durations);
+
+    for (i32 i = 1; i <= STATS_MAX_EXPONENT; ++i) {
+        if (GetTileReachRate(stats, i) > 0.0) {
+            fprintf(file, "reach_%u,%.6g\n", PowerOf2(i), GetTileReachRate(stats, i));
+        }
+    }
+
+    return fclose(file) == 0;
+}
+
+static void WriteSketchBuckets(FILE *file, const char *metric, const Quantile_sketch *sketch) {
+    if (sketch->zeroCount > 0) {
+        fprintf(file, "%s,0,1,%lld\n", metric, (long long)sketch->zeroCount);
+    }
+
+    for (i32 i = 0; i < SKETCH_BUCKET_COUNT; ++i) {
+        if (sketch->buckets[i] > 0) {
+            fprintf(file, "%s,%.6g,%.6g,%lld\n", metric, i == 0 ? 1.0 : GetSketchBucketUpper(i - 1),
+                GetSketchBucketUpper(i), (long long)sketch->buckets[i]);
+        }
+    }
+}
+
+bool WriteGameStatsHistograms(const Game_stats *stats, const char *path) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        return false;
+    }
+
+    fprintf(file, "metric,lower,upper,count\n");
+    WriteSketchBuckets(file, "score", &stats->scores);
+    WriteSketchBuckets(file, "moves", &stats->moves);
+    WriteSketchBuckets(file, "duration_us", &stats->durations);
+
+    return fclose(file) == 0;
+}
+
+void PrintGameStats(const Game_stats *stats) {
+    if (stats->gameCount == 0) {
+        printf("No games\n");
+        return;
+    }
+
+    printf("%lld games\n", (long long)stats->gameCount);
+    printf("Score     mean %9.1f  stddev %9.1f  min %7d  p50 %9.0f  p99 %9.0f  max %7d\n",
+        (f64)stats->scoreSum / stats->gameCount, GetScoreStandardDeviation(stats), stats->minScore,
+        GetSketchQuantile(&stats->scores, 0.5), GetSketchQuantile(&stats->scores, 0.99), stats->maxScore);
+    printf("Moves     mean %9.1f  p50 %9.0f  p99 %9.0f  max %7u\n", (f64)stats->moveSum / stats->gameCount,
+        GetSketchQuantile(&stats->moves, 0.5), GetSketchQuantile(&stats->moves, 0.99), stats->maxMoves);
+    printf("Duration  mean %9.1f us  p50 %9.1f us  p99 %9.1f us\n", 1e6 * stats->durationSum / stats->gameCount,
+        GetSketchQuantile(&stats->durations, 0.5), GetSketchQuantile(&stats->durations, 0.99));
+
+    printf("Reached  ");
+    for (i32 i = 1; i <= STATS_MAX_EXPONENT; ++i) {
+        f64 rate = GetTileReachRate(stats, i);
+        if (rate > 0.0 && rate < 1.0) {
+            printf("  %u: %.4g%%", PowerOf2(i), 100.0 * rate);
+        }
+    }
+    printf("\n");
+}
+
+typedef struct Sketch_bucket_record {
+    u32 index;
+    u32 padding;
+    i64 count;
+} Sketch_bucket_record;
+
+static bool WriteSketch(FILE *file, const Quantile_sketch *sketch) {
+    u32 bucketCount = 0;
+    for (i32 i = 0; i < SKETCH_BUCKET_COUNT; ++i) {
+        bucketCount += sketch->buckets[i] != 0;
+    }
+
+    bool isOk = fwrite(&sketch->zeroCount, sizeof(i64), 1, file) == 1 && 
+        fwrite(&sketch->count, sizeof(i64), 1, file) == 1 && fwrite(&bucketCount, sizeof(u32), 1, file) == 1;
+
+    for (i32 i = 0; i < SKETCH_BUCKET_COUNT && isOk; ++i) {
+        if (sketch->buckets[i] != 0) {
+            Sketch_bucket_record record = {.index = i, .count = sketch->buckets[i]};
+            isOk = fwrite(&record, sizeof(record), 1, file) == 1;
+        }
+    }
+
+    return isOk;
+}
+
+static bool ReadSketch(FILE *file, Quantile_sketch *sketch) {
+    InitSketch(sketch);
+
+    u32 bucketCount;
+    if (fread(&sketch->zeroCount, sizeof(i64), 1, file) != 1 || fread(&sketch->count, sizeof(i64), 1, file) != 1 ||
+        fread(&bucketCount, sizeof(u32), 1, file) != 1 || bucketCount > SKETCH_BUCKET_COUNT) {
+        return false;
+    }
+
+    for (u32 i = 0; i < bucketCount; ++i) {
+        Sketch_bucket_record record;
+        if (fread(&record, sizeof(record), 1, file) != 1 || record.index >= SKETCH_BUCKET_COUNT) {
+            return false;
+        }
+        sketch->buckets[record.index] = record.count;
+    }
+
+    return true;
+}
+
+// Everything in front of the sketches is plain counters
+#define GAME_STATS_SCALARS_SIZE offsetof(Game_stats, scores)
+
+bool WriteGameStats(FILE *file, const Game_stats *stats) {
+    return fwrite(stats, GAME_STATS_SCALARS_SIZE, 1, file) == 1 && WriteSketch(file, &stats->scores) && 
+        WriteSketch(file, &stats->moves) && WriteSketch(file, &stats->durations);
+}
+
+bool ReadGameStats(FILE *file, Game_stats *stats) {
+    InitGameStats(stats);
+
+    return fread(stats, GAME_STATS_SCALARS_SIZE, 1, file) == 1 && ReadSketch(file, &stats->scores) && 
+        ReadSketch(file, &stats->moves) && ReadSketch(file, &stats->durations);
+}
+
+bool WriteGameResultsCsvHeader(FILE *file) {
+    return fprintf(file, "seed,score,moves,duration,max_tile\n") > 0;
+}
+
+void WriteGameResultCsv(FILE *file, const Game_result *result) {
+    fprintf(file, "%llu,%d,%u,%.9g,%u\n", (unsigned long long)result->seed, result->score, result->moveCount,
+        result->duration, PowerOf2(result->maxTile));
+}
+
+static bool AllocGameColumns(Game_columns *columns) {
+    columns->seeds = TrackedAlloc(GAME_COLUMNS_BLOCK_SIZE * sizeof(u64), ALLOC_TAG_STATS);
+    columns->scores = TrackedAlloc(GAME_COLUMNS_BLOCK_SIZE * sizeof(i32), ALLOC_TAG_STATS);
+    columns->moveCounts = TrackedAlloc(GAME_COLUMNS_BLOCK_SIZE * sizeof(u32), ALLOC_TAG_STATS);
+    columns->durations = TrackedAlloc(GAME_COLUMNS_BLOCK_SIZE * sizeof(f32), ALLOC_TAG_STATS);
+    columns->maxTiles = TrackedAlloc(GAME_COLUMNS_BLOCK_SIZE * sizeof(u8), ALLOC_TAG_STATS);
+
+    return columns->seeds != NULL && columns->scores != NULL && columns->moveCounts != NULL &&
+        columns->durations != NULL && columns->maxTiles != NULL;
+}
+
+static void FreeGameColumns(Game_columns *columns) {
+    TrackedFree(columns->seeds, ALLOC_TAG_STATS);
+    TrackedFree(columns->scores, ALLOC_TAG_STATS);
+    TrackedFree(columns->moveCounts, ALLOC_TAG_STATS);
+    TrackedFree(columns->durations, ALLOC_TAG_STATS);
+    TrackedFree(columns->maxTiles, ALLOC_TAG_STATS);
+}
+
+bool CreateGameColumns(Game_columns *columns, const char *path) {
+    *columns = (Game_columns){.isWriting = true};
+
+    columns->file = fopen(path, "wb");
+    if (columns->file == NULL) {
+        return false;
+    }
+
+    u32 version = GAME_COLUMNS_VERSION;
+    if (!AllocGameColumns(columns) || fwrite(GAME_COLUMNS_MAGIC, 8, 1, columns->file) != 1 ||
+        fwrite(&version, sizeof(version), 1, columns->file) != 1) {
+        CloseGameColumns(columns);
+        return false;
+    }
+
+    return true;
+}
+
+bool OpenGameColumns(Game_columns *columns, const char *path) {
+    *columns = (Game_columns){.isWriting = false};
+
+    columns->file = fopen(path, "rb");
+    if (columns->file == NULL) {
+        return false;
+    }
+
+    char magic[8];
+    u32 version;
+    if (!AllocGameColumns(columns) || fread(magic, 8, 1, columns->file) != 1 ||
+        fread(&version, sizeof(version), 1, columns->file) != 1 || memcmp(magic, GAME_COLUMNS_MAGIC, 8) != 0 ||
+        version != GAME_COLUMNS_VERSION) {
+        CloseGameColumns(columns);
+        return false;
+    }
+
+    return true;
+}
+
+static bool FlushGameColumns(Game_columns *columns) {
+    if (columns->rowCount == 0) {
+        return true;
+    }
+
+    size_t count = columns->rowCount;
+    Game_columns_block_header header = {.rowCount = count};
+    bool isOk = fwrite(&header, sizeof(header), 1, columns->file) == 1 &&
+        fwrite(columns->seeds, sizeof(u64), count, columns->file) == count &&
+        fwrite(columns->scores, sizeof(i32), count, columns->file) == count &&
+        fwrite(columns->moveCounts, sizeof(u32), count, columns->file) == count &&
+        fwrite(columns->durations, sizeof(f32), count, columns->file) == count &&
+        fwrite(columns->maxTiles, sizeof(u8), count, columns->file) == count;
+
+    columns->rowCount = 0;
+
+    return isOk;
+}
+
+bool WriteGameColumns(Game_columns *columns, const Game_result *result) {
+    i32 row = columns->rowCount++;
+    columns->seeds[row] = result->seed;
+    columns->scores[row] = result->score;
+    columns->moveCounts[row] = result->moveCount;
+    columns->durations[row] = result->duration;
+    columns->maxTiles[row] = result->maxTile;
+
+    return columns->rowCount < GAME_COLUMNS_BLOCK_SIZE || FlushGameColumns(columns);
+}
+
+static bool ReadGameColumnsBlock(Game_columns *columns) {
+    Game_columns_block_header header;
+    if (fread(&header, sizeof(header), 1, columns->file) != 1 || header.rowCount > GAME_COLUMNS_BLOCK_SIZE) {
+        return false;
+    }
+
+    size_t count = header.rowCount;
+    columns->rowCount = count;
+    columns->readCount = 0;
+
+    return fread(columns->seeds, sizeof(u64), count, columns->file) == count &&
+        fread(columns->scores, sizeof(i32), count, columns->file) == count &&
+        fread(columns->moveCounts, sizeof(u32), count, columns->file) == count &&
+        fread(columns->durations, sizeof(f32), count, columns->file) == count &&
+        fread(columns->maxTiles, sizeof(u8), count, columns->file) == count;
+}
+
+bool ReadGameColumns(Game_columns *columns, Game_result *result) {
+    while (columns->readCount == columns->rowCount) {
+        if (!ReadGameColumnsBlock(columns)) {
+            return false;
+        }
+    }
+
+    i32 row = columns->readCount++;
+    *result = (Game_result){
+        .seed = columns->seeds[row],
+        .score = columns->scores[row],
+        .moveCount = columns->moveCounts[row],
+        .duration = columns->durations[row],
+        .maxTile = columns->maxTiles[row]
+    };
+
+    return true;
+}
+
+bool CloseGameColumns(Game_columns *columns) {
+    bool isOk = true;
+    if (columns->file != NULL) {
+        if (columns->isWriting) {
+            isOk = FlushGameColumns(columns);
+        }
+        isOk &= fclose(columns->file) == 0;
+    }
+
+    FreeGameColumns(columns);
+    *columns = (Game_columns){0};
+
+    return isOk;
+}
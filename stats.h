@@ -0,0 +1,107 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+
+#include "common.h"
+
+#define SKETCH_RELATIVE_ACCURACY 0.01 // Quantiles come back within 1% of a value that was recorded
+#define SKETCH_BUCKET_COUNT 2048       // Enough for values up to ~1e17 at that accuracy
+#define STATS_MAX_EXPONENT 31
+
+#define GAME_COLUMNS_MAGIC "R2048COL"
+#define GAME_COLUMNS_VERSION 1
+#define GAME_COLUMNS_BLOCK_SIZE 65536 // Rows per block, also all the writer keeps in memory
+
+
+typedef struct Game_result {
+    u64 seed;
+    i32 score;
+    u32 moveCount;
+    f32 duration; // Seconds
+    u8 maxTile;   // Exponent
+} Game_result;
+
+// Log-spaced buckets with a fixed relative width (DDSketch), so any number of values fit in the same memory and
+// two sketches merge by adding their buckets. Values below 1 all land in zeroCount.
+typedef struct Quantile_sketch {
+    i64 buckets[SKETCH_BUCKET_COUNT];
+    i64 zeroCount;
+    i64 count;
+} Quantile_sketch;
+
+// Everything is a count or a sum, so accumulators kept per thread can be merged in any order once the threads are done
+typedef struct Game_stats {
+    i64 gameCount;
+
+    i64 scoreSum;
+    f64 scoreSumSquares;
+    i32 minScore;
+    i32 maxScore;
+
+    i64 moveSum;
+    u32 maxMoves;
+
+    f64 durationSum;
+
+    i64 maxTileCounts[STATS_MAX_EXPONENT + 1]; // Games whose largest tile had this exponent
+
+    Quantile_sketch scores;
+    Quantile_sketch moves;
+    Quantile_sketch durations; // In microseconds
+} Game_stats;
+
+// Per-game results in blocks of up to GAME_COLUMNS_BLOCK_SIZE rows. A block is a Game_columns_block_header followed
+// by each column in turn: seed (u64), score (i32), moveCount (u32), duration (f32) and maxTile (u8), so a reader can
+// skip the columns it doesn't need. The file starts with the 8 magic bytes and a u32 version.
+typedef struct Game_columns_block_header {
+    u32 rowCount;
+    u32 reserved;
+} Game_columns_block_header;
+
+typedef struct Game_columns {
+    FILE *file;
+    bool isWriting;
+    i32 rowCount; // Rows in the block currently in memory
+    i32 readCount; // Rows of that block already returned by ReadGameColumns
+
+    u64 *seeds;
+    i32 *scores;
+    u32 *moveCounts;
+    f32 *durations;
+    u8 *maxTiles;
+} Game_columns;
+
+
+void InitSketch(Quantile_sketch *sketch);
+void AddToSketch(Quantile_sketch *sketch, f64 value);
+void MergeSketch(Quantile_sketch *into, const Quantile_sketch *from);
+f64 GetSketchQuantile(const Quantile_sketch *sketch, f64 quantile); // quantile in [0, 1]
+
+void InitGameStats(Game_stats *stats);
+void AddGameResult(Game_stats *stats, const Game_result *result);
+void MergeGameStats(Game_stats *into, const Game_stats *from);
+f64 GetTileReachRate(const Game_stats *stats, i32 exponent); // Share of games with a tile at least this large
+f64 GetScoreStandardDeviation(const Game_stats *stats);
+
+// metric,value rows: counts, means, quantiles and the reach rate of every tile seen
+bool WriteGameStatsSummary(const Game_stats *stats, const char *path);
+// metric,lower,upper,count rows for every non-empty bucket of the three sketches
+bool WriteGameStatsHistograms(const Game_stats *stats, const char *path);
+void PrintGameStats(const Game_stats *stats);
+
+// Binary, only the non-empty sketch buckets, so a shard's aggregates cost a few KB on disk rather than the ~50KB
+// they take in memory
+bool WriteGameStats(FILE *file, const Game_stats *stats);
+bool ReadGameStats(FILE *file, Game_stats *stats);
+
+bool WriteGameResultsCsvHeader(FILE *file);
+void WriteGameResultCsv(FILE *file, const Game_result *result);
+
+bool CreateGameColumns(Game_columns *columns, const char *path);
+bool OpenGameColumns(Game_columns *columns, const char *path);
+bool WriteGameColumns(Game_columns *columns, const Game_result *result);
+bool ReadGameColumns(Game_columns *columns, Game_result *result); // False at the end of the file
+bool CloseGameColumns(Game_columns *columns); // Writes out the last block when writing
+
+#endif
@@ -0,0 +1,117 @@
+#include "timeline.h"
+
+
+static f32 Ease(Easing easing, f32 t) {
+    switch (easing) {
+        case EASING_LINEAR:
+            return t;
+        case EASING_BUMP:
+            return -4.0f * t * (t - 1.0f);
+    }
+
+    return t;
+}
+
+static Tween *StartTween(Timeline *timeline, i32 id, Easing easing) {
+    timeline->easings[id] = (u8)easing;
+
+    if (timeline->slots[id] < 0) {
+        timeline->slots[id] = (i8)timeline->count;
+        timeline->tweens[timeline->count++] = (Tween){.id = id};
+    }
+
+    Tween *tween = &timeline->tweens[timeline->slots[id]];
+    tween->previousValue = timeline->values[id];
+
+    return tween;
+}
+
+// The last tween takes the removed one's place, so the active ones stay packed at the front
+static void RemoveTween(Timeline *timeline, i32 index) {
+    Tween *tween = &timeline->tweens[index];
+    timeline->slots[tween->id] = -1;
+
+    --timeline->count;
+    if (index != timeline->count) {
+        *tween = timeline->tweens[timeline->count];
+        timeline->slots[tween->id] = (i8)index;
+    }
+}
+
+void InitTimeline(Timeline *timeline) {
+    *timeline = (Timeline){0};
+
+    for (i32 i = 0; i < TIMELINE_MAX_TWEENS; ++i) {
+        timeline->slots[i] = -1;
+    }
+}
+
+void PlayTween(Timeline *timeline, i32 id, f32 duration, Easing easing) {
+    timeline->values[id] = 0.0f;
+    TweenTo(timeline, id, 1.0f, duration, easing);
+}
+
+void TweenTo(Timeline *timeline, i32 id, f32 target, f32 duration, Easing easing) {
+    if (timeline->values[id] == target) {
+        SetTween(timeline, id, target);
+        timeline->easings[id] = (u8)easing;
+        return;
+    }
+
+    Tween *tween = StartTween(timeline, id, easing);
+    tween->target = target;
+    tween->rate = 1.0f / duration;
+}
+
+void SetTween(Timeline *timeline, i32 id, f32 value) {
+    timeline->values[id] = value;
+
+    if (timeline->slots[id] >= 0) {
+        RemoveTween(timeline, timeline->slots[id]);
+    }
+}
+
+u32 StepTimeline(Timeline *timeline, f32 step) {
+    u32 finished = 0;
+
+    for (i32 i = 0; i < timeline->count;) {
+        Tween *tween = &timeline->tweens[i];
+        f32 *value = &timeline->values[tween->id];
+        tween->previousValue = *value;
+
+        f32 delta = tween->rate * step;
+        if (*value < tween->target - delta) {
+            *value += delta;
+        } else if (*value > tween->target + delta) {
+            *value -= delta;
+        } else {
+            *value = tween->target;
+            finished |= TWEEN_BIT(tween->id);
+
+            // Its replacement is at i now
+            RemoveTween(timeline, i);
+            continue;
+        }
+
+        ++i;
+    }
+
+    return finished;
+}
+
+bool IsTweenActive(const Timeline *timeline, i32 id) {
+    return timeline->slots[id] >= 0;
+}
+
+bool IsTimelineActive(const Timeline *timeline) {
+    return timeline->count > 0;
+}
+
+f32 GetTweenValue(const Timeline *timeline, i32 id, f32 alpha) {
+    f32 value = timeline->values[id];
+    if (timeline->slots[id] >= 0) {
+        value = LerpF32(timeline->tweens[timeline->slots[id]].previousValue, value, alpha);
+    }
+
+    return Ease(timeline->easings[id], value);
+}
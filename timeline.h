@@ -0,0 +1,55 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include "common.h"
+
+#define TIMELINE_MAX_TWEENS 16 // Ids go from 0 up to this
+
+#define TWEEN_BIT(id) (1u << (id))
+
+
+typedef enum Easing {
+    EASING_LINEAR,
+    EASING_BUMP // Up to 1 halfway through and back down to 0
+} Easing;
+
+typedef struct Tween {
+    i32 id;
+    f32 target;
+    f32 rate; // Per second
+    f32 previousValue; // Before the last step
+} Tween;
+
+// Every animation is a value between 0 and 1 that a tween moves towards a target at a steady rate. The values of all
+// ids are kept, but only the tweens still moving are in tweens, so a step costs as much as the animations that are
+// running and nothing when none are. Steps happen at a fixed rate (see SIMULATION_STEP in main.c) and rendering
+// blends between the last two of them.
+typedef struct Timeline {
+    f32 values[TIMELINE_MAX_TWEENS];
+    u8 easings[TIMELINE_MAX_TWEENS];
+    i8 slots[TIMELINE_MAX_TWEENS]; // Index in tweens, -1 when the value isn't moving
+    Tween tweens[TIMELINE_MAX_TWEENS];
+    i32 count;
+} Timeline;
+
+
+void InitTimeline(Timeline *timeline); // Every value at 0
+
+// From 0 to 1, restarting if it's already running
+void PlayTween(Timeline *timeline, i32 id, f32 duration, Easing easing);
+// Carries on from the current value, with duration being the time a change of 1 takes, so a tween turned around
+// halfway takes half as long to get back
+void TweenTo(Timeline *timeline, i32 id, f32 target, f32 duration, Easing easing);
+// Stops the tween where it is told to, without reporting it as finished
+void SetTween(Timeline *timeline, i32 id, f32 value);
+
+// Returns TWEEN_BIT of every tween that got to its target during the step
+u32 StepTimeline(Timeline *timeline, f32 step);
+
+bool IsTweenActive(const Timeline *timeline, i32 id);
+bool IsTimelineActive(const Timeline *timeline);
+
+// Eased, alpha of the way from the value before the last step to the current one
+f32 GetTweenValue(const Timeline *timeline, i32 id, f32 alpha);
+
+#endif